@@ -25,13 +25,120 @@ extern "C" {
 
 #include <stdint.h>
 
+/* Default key length of the one-shot functions and of AESCtxInit(). Contexts
+ * initialized with AESCtxInitKeyLen() can use any key length.
+ */
 #ifndef AES_KEY_LEN
 #define AES_KEY_LEN 16 /* 128=>16, 192=>24, 256=>32 */
 #endif
 
+/* AES_MAX_KEY_LEN
+ * Largest key length of the contexts, they have room for its round keys.
+ * 32 => AES-128, AES-192 and AES-256 (240 bytes of round keys). Default.
+ * 16 => AES-128 only (176 bytes of round keys), saves RAM on small targets.
+ */
+#ifndef AES_MAX_KEY_LEN
+#define AES_MAX_KEY_LEN 32
+#endif
+
+#if AES_KEY_LEN > AES_MAX_KEY_LEN
+#error "AES_KEY_LEN must not be larger than AES_MAX_KEY_LEN"
+#endif
+
+/* AES_FASTER
+ * 0 => Smaller code. Byte oriented, uses only 522 bytes of tables. Default for
+ *      AVR.
+ * 1 => Faster code. Word oriented, uses 2 KiB more tables (T-tables).
+ */
+#ifndef AES_FASTER
+#ifdef AVR
+#define AES_FASTER 0
+#else
+#define AES_FASTER 1
+#endif
+#endif
+
+/* AES_AESNI
+ * 0 => Portable code only.
+ * 1 => Use the AES-NI instructions when the CPU supports them (x86 with GCC or
+ *      Clang), detected at run-time. Falls back to the portable code.
+ */
+#ifndef AES_AESNI
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define AES_AESNI 1
+#else
+#define AES_AESNI 0
+#endif
+#endif
+
 #define AES_BLOCK_LEN 16
 #define AES_NUM_ROUNDS (AES_KEY_LEN / 4 + 6)
-#define AES_SUBKEYS_LEN (AES_BLOCK_LEN * (AES_NUM_ROUNDS + 1))
+#define AES_MAX_NUM_ROUNDS (AES_MAX_KEY_LEN / 4 + 6)
+#define AES_SUBKEYS_LEN (AES_BLOCK_LEN * (AES_MAX_NUM_ROUNDS + 1))
+
+#if AES_AESNI
+uint8_t AESNiSupported(void);
+#endif
+
+struct aes_ctx_t {
+  uint8_t subkeys[AES_SUBKEYS_LEN]; /* Expanded key (all round keys). */
+  uint8_t rounds;                   /* 10, 12 or 14. */
+};
+
+void AESCtxInit(struct aes_ctx_t *ctx_ptr, const uint8_t key[AES_KEY_LEN]);
+uint8_t AESCtxInitKeyLen(struct aes_ctx_t *ctx_ptr, const uint8_t *key_ptr,
+                         uint8_t key_len);
+void AESCtxEncrypt(const struct aes_ctx_t *ctx_ptr,
+                   const uint8_t plain[AES_BLOCK_LEN],
+                   uint8_t cipher[AES_BLOCK_LEN]);
+void AESCtxDecrypt(const struct aes_ctx_t *ctx_ptr,
+                   const uint8_t cipher[AES_BLOCK_LEN],
+                   uint8_t plain[AES_BLOCK_LEN]);
+void AESCtxECBEncrypt(const struct aes_ctx_t *ctx_ptr, const uint8_t *plain_ptr,
+                      uint32_t length, uint8_t *cipher_ptr);
+void AESCtxCBCEncrypt(const struct aes_ctx_t *ctx_ptr,
+                      const uint8_t iv[AES_BLOCK_LEN],
+                      const uint8_t *plain_ptr, uint32_t length,
+                      uint8_t *cipher_ptr);
+void AESCtxCBCDecrypt(const struct aes_ctx_t *ctx_ptr,
+                      const uint8_t iv[AES_BLOCK_LEN],
+                      const uint8_t *cipher_ptr, uint32_t length,
+                      uint8_t *plain_ptr);
+
+void AESXorBlock(uint8_t *out_ptr, const uint8_t *a_ptr, const uint8_t *b_ptr);
+
+struct aes_inv_ctx_t {
+  uint8_t subkeys[AES_SUBKEYS_LEN]; /* Equivalent inverse cipher round keys. */
+  uint8_t rounds;
+};
+
+void AESInvCtxInit(struct aes_inv_ctx_t *inv_ctx_ptr,
+                   const struct aes_ctx_t *ctx_ptr);
+void AESInvCtxDecrypt(const struct aes_inv_ctx_t *inv_ctx_ptr,
+                      const uint8_t cipher[AES_BLOCK_LEN],
+                      uint8_t plain[AES_BLOCK_LEN]);
+void AESInvCtxECBDecrypt(const struct aes_inv_ctx_t *inv_ctx_ptr,
+                         const uint8_t *cipher_ptr, uint32_t length,
+                         uint8_t *plain_ptr);
+void AESInvCtxCBCDecrypt(const struct aes_ctx_t *ctx_ptr,
+                         const struct aes_inv_ctx_t *inv_ctx_ptr,
+                         const uint8_t iv[AES_BLOCK_LEN],
+                         const uint8_t *cipher_ptr, uint32_t length,
+                         uint8_t *plain_ptr);
+void AESInvCtxCBCDecryptRange(const struct aes_inv_ctx_t *inv_ctx_ptr,
+                              const uint8_t prev[AES_BLOCK_LEN],
+                              const uint8_t *cipher_ptr, uint32_t length,
+                              uint8_t *plain_ptr);
+
+void AESCtxInitCt(struct aes_ctx_t *ctx_ptr, const uint8_t key[AES_KEY_LEN]);
+uint8_t AESCtxInitCtKeyLen(struct aes_ctx_t *ctx_ptr, const uint8_t *key_ptr,
+                           uint8_t key_len);
+void AESCtxECBEncryptCt(const struct aes_ctx_t *ctx_ptr,
+                        const uint8_t *plain_ptr, uint32_t length,
+                        uint8_t *cipher_ptr);
+void AESCtxCTREncryptCt(const struct aes_ctx_t *ctx_ptr,
+                        uint8_t counter[AES_BLOCK_LEN], const uint8_t *in_ptr,
+                        uint32_t length, uint8_t *out_ptr);
 
 void AES_ECBEncrypt(const uint8_t key[AES_KEY_LEN],
                     const uint8_t plain[AES_BLOCK_LEN],
@@ -49,6 +156,48 @@ void AES_CBCDecrypt(const uint8_t key[AES_KEY_LEN],
                     const uint8_t iv[AES_BLOCK_LEN], const uint8_t *cipher_ptr,
                     uint32_t length, uint8_t *plain_ptr);
 
+struct aes_cbc_t {
+  struct aes_ctx_t ctx;
+  struct aes_inv_ctx_t inv_ctx;
+  uint8_t chain[AES_BLOCK_LEN]; /* Previous cipher-text block. */
+  uint8_t buf[AES_BLOCK_LEN];   /* Partial (or held back) block. */
+  uint8_t buf_len;
+  uint8_t padding; /* PKCS#7. */
+};
+
+uint8_t AESCbcInit(struct aes_cbc_t *cbc_ptr, const uint8_t *key_ptr,
+                   uint8_t key_len);
+void AESCbcStart(struct aes_cbc_t *cbc_ptr, const uint8_t iv[AES_BLOCK_LEN],
+                 uint8_t padding);
+uint32_t AESCbcEncrypt(struct aes_cbc_t *cbc_ptr, const uint8_t *plain_ptr,
+                       uint32_t length, uint8_t *cipher_ptr);
+uint8_t AESCbcEncryptFinish(struct aes_cbc_t *cbc_ptr,
+                            uint8_t cipher[AES_BLOCK_LEN],
+                            uint8_t *length_ptr);
+uint32_t AESCbcDecrypt(struct aes_cbc_t *cbc_ptr, const uint8_t *cipher_ptr,
+                       uint32_t length, uint8_t *plain_ptr);
+uint8_t AESCbcDecryptFinish(struct aes_cbc_t *cbc_ptr,
+                            uint8_t plain[AES_BLOCK_LEN],
+                            uint8_t *length_ptr);
+
+struct aes_ctr_t {
+  struct aes_ctx_t ctx;
+  uint8_t iv[AES_BLOCK_LEN];        /* Initial counter block. */
+  uint8_t counter[AES_BLOCK_LEN];   /* Next counter block. */
+  uint8_t keystream[AES_BLOCK_LEN]; /* Last key stream block. */
+  uint8_t used;                     /* Key stream bytes used. */
+  uint8_t counter_len;              /* Counter length in bytes (1-16). */
+};
+
+uint8_t AESCtrInit(struct aes_ctr_t *ctr_ptr, const uint8_t *key_ptr,
+                   uint8_t key_len, const uint8_t iv[AES_BLOCK_LEN],
+                   uint8_t counter_len);
+void AESCtrSeek(struct aes_ctr_t *ctr_ptr, uint64_t offset);
+void AESCtrEncrypt(struct aes_ctr_t *ctr_ptr, const uint8_t *in_ptr,
+                   uint32_t length, uint8_t *out_ptr);
+void AESCtrDecrypt(struct aes_ctr_t *ctr_ptr, const uint8_t *in_ptr,
+                   uint32_t length, uint8_t *out_ptr);
+
 struct aes_hash_state_t {
   uint8_t hash[AES_BLOCK_LEN];
   uint8_t plain[AES_KEY_LEN];
@@ -62,6 +211,49 @@ void AESHashUpdate(struct aes_hash_state_t *state_ptr, const uint8_t *plain_ptr,
                    uint32_t length);
 void AESHashFinish(struct aes_hash_state_t *state_ptr);
 
+/* AES_CMAC_MIN_TAG_LEN
+ * 8 => Tags of 8 to 16 bytes (NIST SP 800-38B, appendix A). Default.
+ * N => Tags of N to 16 bytes.
+ */
+#ifndef AES_CMAC_MIN_TAG_LEN
+#define AES_CMAC_MIN_TAG_LEN 8
+#endif
+
+#define AES_CMAC_TAG_LEN 16
+
+struct aes_cmac_t {
+  struct aes_ctx_t ctx;
+  uint8_t k1[AES_BLOCK_LEN];  /* Subkey for a complete last block. */
+  uint8_t k2[AES_BLOCK_LEN];  /* Subkey for a padded last block. */
+  uint8_t x[AES_BLOCK_LEN];   /* CBC-MAC state. */
+  uint8_t buf[AES_BLOCK_LEN]; /* Last, possibly partial, block. */
+  uint8_t buf_len;
+};
+
+uint8_t AESCmacInit(struct aes_cmac_t *cmac_ptr, const uint8_t *key_ptr,
+                    uint8_t key_len);
+void AESCmacStart(struct aes_cmac_t *cmac_ptr);
+void AESCmacUpdate(struct aes_cmac_t *cmac_ptr, const uint8_t *data_ptr,
+                   uint32_t length);
+void AESCmacFinish(struct aes_cmac_t *cmac_ptr, uint8_t tag[AES_CMAC_TAG_LEN]);
+uint8_t AESCmacVerify(struct aes_cmac_t *cmac_ptr, const uint8_t *tag_ptr,
+                      uint8_t tag_len);
+
+struct aes_mmo_t {
+  struct aes_ctx_t ctx;
+  uint8_t hash[AES_BLOCK_LEN];
+  uint8_t buf[AES_BLOCK_LEN];
+  uint8_t buf_len;
+};
+
+uint8_t AESMmoInit(struct aes_mmo_t *mmo_ptr, const uint8_t *key_ptr,
+                   uint8_t key_len);
+void AESMmoStart(struct aes_mmo_t *mmo_ptr);
+void AESMmoStartIv(struct aes_mmo_t *mmo_ptr, const uint8_t iv[AES_BLOCK_LEN]);
+void AESMmoUpdate(struct aes_mmo_t *mmo_ptr, const uint8_t *data_ptr,
+                  uint32_t length);
+void AESMmoFinish(struct aes_mmo_t *mmo_ptr);
+
 #ifdef __cplusplus
 }
 #endif
@@ -0,0 +1,63 @@
+/*
+ AES-CCM authenticated encryption.
+
+ Copyright 2021 Djones A. Boni
+
+ Licensed under the Apache License, Version 2.0 (the "License");
+ you may not use this file except in compliance with the License.
+ You may obtain a copy of the License at
+
+ http://www.apache.org/licenses/LICENSE-2.0
+
+ Unless required by applicable law or agreed to in writing, software
+ distributed under the License is distributed on an "AS IS" BASIS,
+ WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ See the License for the specific language governing permissions and
+ limitations under the License.
+*/
+
+#ifndef _AES_CCM_H_
+#define _AES_CCM_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include "aes.h"
+
+#define AES_CCM_MAX_TAG_LEN 16
+
+struct aes_ccm_t {
+  struct aes_ctx_t ctx;
+  uint8_t ctr[AES_BLOCK_LEN];       /* Next counter block. */
+  uint8_t keystream[AES_BLOCK_LEN]; /* Key stream of the current block. */
+  uint8_t x[AES_BLOCK_LEN];         /* CBC-MAC state. */
+  uint8_t s0[AES_BLOCK_LEN];        /* Encrypted counter block 0. */
+  uint8_t buf[AES_BLOCK_LEN];       /* Partial CBC-MAC block. */
+  uint64_t aad_len;                 /* Associated data bytes left. */
+  uint64_t data_len;                /* Data bytes left. */
+  uint8_t buf_len;
+  uint8_t len_len; /* Length field size, 2 to 8 bytes. */
+  uint8_t tag_len;
+  uint8_t phase;
+};
+
+uint8_t AESCcmInit(struct aes_ccm_t *ccm_ptr, const uint8_t *key_ptr,
+                   uint8_t key_len);
+uint8_t AESCcmStart(struct aes_ccm_t *ccm_ptr, const uint8_t *nonce_ptr,
+                    uint8_t nonce_len, uint64_t aad_len, uint64_t data_len,
+                    uint8_t tag_len);
+uint8_t AESCcmAad(struct aes_ccm_t *ccm_ptr, const uint8_t *aad_ptr,
+                  uint32_t length);
+uint8_t AESCcmEncrypt(struct aes_ccm_t *ccm_ptr, const uint8_t *plain_ptr,
+                      uint32_t length, uint8_t *cipher_ptr);
+uint8_t AESCcmDecrypt(struct aes_ccm_t *ccm_ptr, const uint8_t *cipher_ptr,
+                      uint32_t length, uint8_t *plain_ptr);
+uint8_t AESCcmFinish(struct aes_ccm_t *ccm_ptr, uint8_t *tag_ptr);
+uint8_t AESCcmVerify(struct aes_ccm_t *ccm_ptr, const uint8_t *tag_ptr);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _AES_CCM_H_ */
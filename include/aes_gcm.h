@@ -0,0 +1,92 @@
+/*
+ AES-GCM authenticated encryption.
+
+ Copyright 2021 Djones A. Boni
+
+ Licensed under the Apache License, Version 2.0 (the "License");
+ you may not use this file except in compliance with the License.
+ You may obtain a copy of the License at
+
+ http://www.apache.org/licenses/LICENSE-2.0
+
+ Unless required by applicable law or agreed to in writing, software
+ distributed under the License is distributed on an "AS IS" BASIS,
+ WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ See the License for the specific language governing permissions and
+ limitations under the License.
+*/
+
+#ifndef _AES_GCM_H_
+#define _AES_GCM_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include "aes.h"
+
+/* AES_GCM_PCLMUL
+ * 0 => Portable GHASH only (4-bit tables).
+ * 1 => Use the PCLMULQDQ instruction when the CPU supports it (x86 with GCC
+ *      or Clang), detected at run-time. Falls back to the portable code.
+ */
+#ifndef AES_GCM_PCLMUL
+#define AES_GCM_PCLMUL AES_AESNI
+#endif
+
+/* AES_GCM_MIN_TAG_LEN
+ * 12 => Tags of 12 to 16 bytes.
+ * 8  => Also the short tags of 8 bytes, for restricted uses only (NIST
+ *       SP 800-38D, appendix C).
+ * 4  => Also the short tags of 4 and 8 bytes, for restricted uses only.
+ * Other tag lengths (5 to 7 and 9 to 11 bytes) are never accepted.
+ */
+#ifndef AES_GCM_MIN_TAG_LEN
+#define AES_GCM_MIN_TAG_LEN 12
+#endif
+
+#define AES_GCM_TAG_LEN 16
+#define AES_GCM_IV_LEN 12
+
+/* Blocks hashed with a single reduction (PCLMULQDQ) and encrypted at a time. */
+#define AES_GCM_BLOCKS 8
+
+#if AES_GCM_PCLMUL
+uint8_t AESGcmPclmulSupported(void);
+#endif
+
+struct aes_gcm_t {
+  struct aes_ctr_t ctr; /* Key, counter and key stream. */
+  uint64_t hh[16];      /* 4-bit multiplication table of H, high halves. */
+  uint64_t hl[16];      /* 4-bit multiplication table of H, low halves. */
+#if AES_GCM_PCLMUL
+  uint8_t hpow[AES_GCM_BLOCKS][AES_BLOCK_LEN]; /* H^1..H^8, byte reversed. */
+#endif
+  uint8_t ek_j0[AES_BLOCK_LEN]; /* Encrypted pre-counter block. */
+  uint8_t x[AES_BLOCK_LEN];     /* GHASH accumulator. */
+  uint8_t buf[AES_BLOCK_LEN];   /* Partial GHASH block. */
+  uint64_t aad_len;
+  uint64_t data_len;
+  uint8_t buf_len;
+  uint8_t phase;
+};
+
+uint8_t AESGcmInit(struct aes_gcm_t *gcm_ptr, const uint8_t *key_ptr,
+                   uint8_t key_len);
+uint8_t AESGcmStart(struct aes_gcm_t *gcm_ptr, const uint8_t *iv_ptr,
+                    uint32_t iv_len);
+void AESGcmAad(struct aes_gcm_t *gcm_ptr, const uint8_t *aad_ptr,
+               uint32_t length);
+void AESGcmEncrypt(struct aes_gcm_t *gcm_ptr, const uint8_t *plain_ptr,
+                   uint32_t length, uint8_t *cipher_ptr);
+void AESGcmDecrypt(struct aes_gcm_t *gcm_ptr, const uint8_t *cipher_ptr,
+                   uint32_t length, uint8_t *plain_ptr);
+void AESGcmFinish(struct aes_gcm_t *gcm_ptr, uint8_t tag[AES_GCM_TAG_LEN]);
+uint8_t AESGcmVerify(struct aes_gcm_t *gcm_ptr, const uint8_t *tag_ptr,
+                     uint8_t tag_len);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _AES_GCM_H_ */
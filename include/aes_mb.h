@@ -0,0 +1,56 @@
+/*
+ AES multi-buffer CBC encryption.
+
+ Copyright 2021 Djones A. Boni
+
+ Licensed under the Apache License, Version 2.0 (the "License");
+ you may not use this file except in compliance with the License.
+ You may obtain a copy of the License at
+
+ http://www.apache.org/licenses/LICENSE-2.0
+
+ Unless required by applicable law or agreed to in writing, software
+ distributed under the License is distributed on an "AS IS" BASIS,
+ WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ See the License for the specific language governing permissions and
+ limitations under the License.
+*/
+
+#ifndef _AES_MB_H_
+#define _AES_MB_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include "aes.h"
+
+/* Jobs processed at a time, one per lane. */
+#define AES_MB_LANES 8
+
+struct aes_mb_job_t {
+  const struct aes_ctx_t *ctx_ptr; /* Key of the job. */
+  const uint8_t *plain_ptr;
+  uint8_t *cipher_ptr;
+  uint32_t length;              /* Multiple of AES_BLOCK_LEN. */
+  uint8_t chain[AES_BLOCK_LEN]; /* Previous cipher-text block. */
+};
+
+struct aes_mb_t {
+  struct aes_mb_job_t *jobs[AES_MB_LANES]; /* NULL if the lane is free. */
+  const uint8_t *in_ptr[AES_MB_LANES];
+  uint8_t *out_ptr[AES_MB_LANES];
+  uint32_t left[AES_MB_LANES]; /* Blocks left. */
+  uint8_t num_jobs;
+};
+
+void AESMbInit(struct aes_mb_t *mb_ptr);
+struct aes_mb_job_t *AESMbSubmit(struct aes_mb_t *mb_ptr,
+                                 struct aes_mb_job_t *job_ptr);
+struct aes_mb_job_t *AESMbFlush(struct aes_mb_t *mb_ptr);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _AES_MB_H_ */
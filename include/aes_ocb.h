@@ -0,0 +1,77 @@
+/*
+ AES-OCB authenticated encryption.
+
+ Copyright 2021 Djones A. Boni
+
+ Licensed under the Apache License, Version 2.0 (the "License");
+ you may not use this file except in compliance with the License.
+ You may obtain a copy of the License at
+
+ http://www.apache.org/licenses/LICENSE-2.0
+
+ Unless required by applicable law or agreed to in writing, software
+ distributed under the License is distributed on an "AS IS" BASIS,
+ WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ See the License for the specific language governing permissions and
+ limitations under the License.
+*/
+
+#ifndef _AES_OCB_H_
+#define _AES_OCB_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include "aes.h"
+
+#define AES_OCB_TAG_LEN 16
+#define AES_OCB_MAX_NONCE_LEN 15
+
+/* Offsets L_0..L_31, enough for messages of up to 2^32 - 1 blocks. */
+#define AES_OCB_L_LEN 32
+
+/* Blocks encrypted at a time. */
+#define AES_OCB_BLOCKS 8
+
+struct aes_ocb_t {
+  struct aes_ctx_t ctx;
+  struct aes_inv_ctx_t inv_ctx;
+  uint8_t l_star[AES_BLOCK_LEN];            /* L_* = Ek(0). */
+  uint8_t l_dollar[AES_BLOCK_LEN];          /* L_$ = double(L_*). */
+  uint8_t l[AES_OCB_L_LEN][AES_BLOCK_LEN];  /* L_i = double(L_i-1). */
+  uint8_t ktop_in[AES_BLOCK_LEN];           /* Nonce block of 'stretch'. */
+  uint8_t stretch[AES_BLOCK_LEN + 8];       /* Ktop | Ktop ^ (Ktop << 8). */
+  uint8_t offset[AES_BLOCK_LEN];            /* Data offset. */
+  uint8_t checksum[AES_BLOCK_LEN];          /* XOR of the plain-text. */
+  uint8_t buf[AES_BLOCK_LEN];               /* Partial data block. */
+  uint8_t aad_offset[AES_BLOCK_LEN];        /* Associated data offset. */
+  uint8_t aad_sum[AES_BLOCK_LEN];           /* Associated data hash. */
+  uint8_t aad_buf[AES_BLOCK_LEN];           /* Partial associated data block. */
+  uint32_t blocks;                          /* Data blocks. */
+  uint32_t aad_blocks;                      /* Associated data blocks. */
+  uint8_t buf_len;
+  uint8_t aad_buf_len;
+  uint8_t tag_len;
+};
+
+uint8_t AESOcbInit(struct aes_ocb_t *ocb_ptr, const uint8_t *key_ptr,
+                   uint8_t key_len);
+uint8_t AESOcbStart(struct aes_ocb_t *ocb_ptr, const uint8_t *nonce_ptr,
+                    uint8_t nonce_len, uint8_t tag_len);
+void AESOcbAad(struct aes_ocb_t *ocb_ptr, const uint8_t *aad_ptr,
+               uint32_t length);
+uint32_t AESOcbEncrypt(struct aes_ocb_t *ocb_ptr, const uint8_t *plain_ptr,
+                       uint32_t length, uint8_t *cipher_ptr);
+void AESOcbEncryptFinish(struct aes_ocb_t *ocb_ptr, uint8_t *cipher_ptr,
+                         uint8_t *length_ptr, uint8_t *tag_ptr);
+uint32_t AESOcbDecrypt(struct aes_ocb_t *ocb_ptr, const uint8_t *cipher_ptr,
+                       uint32_t length, uint8_t *plain_ptr);
+uint8_t AESOcbDecryptFinish(struct aes_ocb_t *ocb_ptr, uint8_t *plain_ptr,
+                            uint8_t *length_ptr, const uint8_t *tag_ptr);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _AES_OCB_H_ */
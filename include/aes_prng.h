@@ -0,0 +1,60 @@
+/*
+ AES PRNG (CTR-DRBG pseudo random number generator).
+
+ Copyright 2021 Djones A. Boni
+
+ Licensed under the Apache License, Version 2.0 (the "License");
+ you may not use this file except in compliance with the License.
+ You may obtain a copy of the License at
+
+ http://www.apache.org/licenses/LICENSE-2.0
+
+ Unless required by applicable law or agreed to in writing, software
+ distributed under the License is distributed on an "AS IS" BASIS,
+ WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ See the License for the specific language governing permissions and
+ limitations under the License.
+*/
+
+#ifndef _AES_PRNG_H_
+#define _AES_PRNG_H_
+
+#include "aes.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* AES_PRNG (NIST SP 800-90A CTR_DRBG with derivation function) */
+
+#ifndef AES_PRNG_KEY_LEN
+#define AES_PRNG_KEY_LEN 16
+#endif
+
+/* Random calls before AESPrngRandom() asks for a new seed. */
+#ifndef AES_PRNG_RESEED_INTERVAL
+#define AES_PRNG_RESEED_INTERVAL 0x01000000UL
+#endif
+
+#define AES_PRNG_SEED_LEN (AES_PRNG_KEY_LEN + AES_BLOCK_LEN)
+#define AES_PRNG_MAX_REQUEST 65536UL
+
+struct aes_prng_t {
+  struct aes_ctx_t ctx;
+  uint8_t key[AES_PRNG_KEY_LEN];
+  uint8_t v[AES_BLOCK_LEN];
+  uint32_t reseed_counter;
+};
+
+void AESPrngSeed(const void *buff_ptr, uint32_t num);
+uint8_t AESPrngRandom(void *buff_ptr, uint32_t num);
+
+#ifdef AES_PRNG_DEBUG
+extern struct aes_prng_t Aes_Prng_State __attribute__((section(".noinit")));
+#endif
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _AES_PRNG_H_ */
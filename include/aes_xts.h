@@ -0,0 +1,58 @@
+/*
+ AES-XTS storage encryption.
+
+ Copyright 2021 Djones A. Boni
+
+ Licensed under the Apache License, Version 2.0 (the "License");
+ you may not use this file except in compliance with the License.
+ You may obtain a copy of the License at
+
+ http://www.apache.org/licenses/LICENSE-2.0
+
+ Unless required by applicable law or agreed to in writing, software
+ distributed under the License is distributed on an "AS IS" BASIS,
+ WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ See the License for the specific language governing permissions and
+ limitations under the License.
+*/
+
+#ifndef _AES_XTS_H_
+#define _AES_XTS_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include "aes.h"
+
+/* Blocks (and sector tweaks) encrypted at a time. */
+#define AES_XTS_BLOCKS 8
+
+struct aes_xts_t {
+  struct aes_ctx_t ctx;         /* Data key, encryption. */
+  struct aes_inv_ctx_t inv_ctx; /* Data key, decryption. */
+  struct aes_ctx_t tweak_ctx;   /* Tweak key. */
+};
+
+uint8_t AESXtsInit(struct aes_xts_t *xts_ptr, const uint8_t *key_ptr,
+                   uint8_t key_len);
+uint8_t AESXtsEncrypt(const struct aes_xts_t *xts_ptr,
+                      const uint8_t tweak[AES_BLOCK_LEN],
+                      const uint8_t *plain_ptr, uint32_t length,
+                      uint8_t *cipher_ptr);
+uint8_t AESXtsDecrypt(const struct aes_xts_t *xts_ptr,
+                      const uint8_t tweak[AES_BLOCK_LEN],
+                      const uint8_t *cipher_ptr, uint32_t length,
+                      uint8_t *plain_ptr);
+uint8_t AESXtsEncryptSectors(const struct aes_xts_t *xts_ptr, uint64_t sector,
+                             uint32_t sector_len, uint32_t num_sectors,
+                             const uint8_t *plain_ptr, uint8_t *cipher_ptr);
+uint8_t AESXtsDecryptSectors(const struct aes_xts_t *xts_ptr, uint64_t sector,
+                             uint32_t sector_len, uint32_t num_sectors,
+                             const uint8_t *cipher_ptr, uint8_t *plain_ptr);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _AES_XTS_H_ */
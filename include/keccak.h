@@ -24,16 +24,49 @@ extern "C" {
 #endif
 
 #include "keccak_types.h"
+#include <stddef.h>
 #include <stdint.h>
 
 /* KECCAK_FASTER
  * 0 => Smaller code.
- * 1 => Faster code.
+ * 1 => Faster code (unrolled Keccak-f[1600] with 64-bit words).
  */
 #ifndef KECCAK_FASTER
 #define KECCAK_FASTER 1
 #endif
 
+/* KECCAK_INTERLEAVE
+ * 0 => Lanes in memory order.
+ * 1 => Bit-interleaved lanes, for Keccak-f[1600] (KECCAK_WORD == 8) on 32-bit
+ *      CPUs: 64-bit rotations become 32-bit rotations. The lanes are converted
+ *      when data is absorbed or squeezed. Output left in the state (digests)
+ *      is read after KeccakStateToBytes().
+ */
+#ifndef KECCAK_INTERLEAVE
+#define KECCAK_INTERLEAVE 0
+#endif
+#if (KECCAK_INTERLEAVE != 0 && KECCAK_WORD != 8)
+#error "KECCAK_INTERLEAVE needs KECCAK_WORD == 8."
+#endif
+
+/* KECCAK_AVX512
+ * 0 => Portable code only.
+ * 1 => Keccak-f[1600] with the AVX-512 instructions when the CPU supports them
+ *      (x86 with GCC or Clang, KECCAK_WORD == 8), detected at run-time. Falls
+ *      back to the portable code.
+ */
+#ifndef KECCAK_AVX512
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__)) &&         \
+    KECCAK_WORD == 8 && KECCAK_INTERLEAVE == 0
+#define KECCAK_AVX512 1
+#else
+#define KECCAK_AVX512 0
+#endif
+#endif
+#if (KECCAK_AVX512 != 0 && KECCAK_INTERLEAVE != 0)
+#error "KECCAK_AVX512 needs KECCAK_INTERLEAVE == 0."
+#endif
+
 #define KECCAK_STATE_SIZE (25 * KECCAK_WORD) /* State size in bytes. */
 #define KECCAK_NR (12 + 2 * KECCAK_L)        /* Number of rounds. */
 
@@ -45,22 +78,27 @@ extern "C" {
 void KeccakInit(struct keccak_t *state_ptr);
 
 void KeccakAbsorb(struct keccak_t *state_ptr, uint8_t rate, uint8_t rounds,
-                  const void *buff_ptr, uint16_t num);
+                  const void *buff_ptr, size_t num);
 void KeccakFinish(struct keccak_t *state_ptr, uint8_t rate, uint8_t rounds,
                   uint8_t pad_byte);
 void KeccakSqueeze(struct keccak_t *state_ptr, uint8_t rate, uint8_t rounds,
-                   void *buff_ptr, uint16_t num);
+                   void *buff_ptr, size_t num);
 
 void KeccakEncrypt(struct keccak_t *state_ptr, uint8_t rate, uint8_t rounds,
-                   void *buff_ptr, uint16_t num);
+                   void *buff_ptr, size_t num);
 void KeccakDecrypt(struct keccak_t *state_ptr, uint8_t rate, uint8_t rounds,
-                   void *buff_ptr, uint16_t num);
+                   void *buff_ptr, size_t num);
 
 void KeccakProcessData(struct keccak_t *state_ptr, uint8_t rate, uint8_t rounds,
-                       void *buff_ptr, uint16_t num,
+                       void *buff_ptr, size_t num,
                        void (*function_ptr)(uint8_t *state_ptr,
                                             uint8_t *buff_ptr));
 void KeccakF(struct keccak_t *state_ptr, uint8_t rounds);
+void KeccakStateToBytes(struct keccak_t *state_ptr);
+
+#if KECCAK_AVX512
+uint8_t KeccakAvx512Supported(void);
+#endif
 
 #ifdef __cplusplus
 }
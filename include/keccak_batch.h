@@ -0,0 +1,59 @@
+/*
+ Keccak batch hashing implementation.
+
+ Copyright 2021 Djones A. Boni
+
+ Licensed under the Apache License, Version 2.0 (the "License");
+ you may not use this file except in compliance with the License.
+ You may obtain a copy of the License at
+
+ http://www.apache.org/licenses/LICENSE-2.0
+
+ Unless required by applicable law or agreed to in writing, software
+ distributed under the License is distributed on an "AS IS" BASIS,
+ WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ See the License for the specific language governing permissions and
+ limitations under the License.
+*/
+
+#ifndef _KECCAK_BATCH_H_
+#define _KECCAK_BATCH_H_
+
+#include "keccak_hash.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#ifndef KECCAK_BATCH_PENDING
+#define KECCAK_BATCH_PENDING 16 /* Messages waiting for a group. */
+#endif
+
+#if (KECCAK_WORD == 8)
+
+void SHA3_512Batch(const void *const data_ptr[], const size_t num[],
+                   void *digest_ptr, size_t count);
+void SHA3_384Batch(const void *const data_ptr[], const size_t num[],
+                   void *digest_ptr, size_t count);
+void SHA3_256Batch(const void *const data_ptr[], const size_t num[],
+                   void *digest_ptr, size_t count);
+void SHA3_224Batch(const void *const data_ptr[], const size_t num[],
+                   void *digest_ptr, size_t count);
+
+void SHAKE256Batch(const void *const data_ptr[], const size_t num[],
+                   void *out_ptr, size_t out_len, size_t count);
+void SHAKE128Batch(const void *const data_ptr[], const size_t num[],
+                   void *out_ptr, size_t out_len, size_t count);
+
+#endif
+
+void KeccakHashBatch(const void *const data_ptr[], const size_t num[],
+                     void *digest_ptr, size_t count);
+void KeccakXofBatch(const void *const data_ptr[], const size_t num[],
+                    void *out_ptr, size_t out_len, size_t count);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _KECCAK_BATCH_H_ */
@@ -0,0 +1,149 @@
+/*
+ cSHAKE, KMAC and ParallelHash (NIST SP 800-185) implementation.
+
+ Copyright 2021 Djones A. Boni
+
+ Licensed under the Apache License, Version 2.0 (the "License");
+ you may not use this file except in compliance with the License.
+ You may obtain a copy of the License at
+
+ http://www.apache.org/licenses/LICENSE-2.0
+
+ Unless required by applicable law or agreed to in writing, software
+ distributed under the License is distributed on an "AS IS" BASIS,
+ WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ See the License for the specific language governing permissions and
+ limitations under the License.
+*/
+
+#ifndef _KECCAK_CSHAKE_H_
+#define _KECCAK_CSHAKE_H_
+
+#include "keccak.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#if (KECCAK_WORD == 8)
+
+/* PARALLELHASH_LANES
+ * 1 => Hash the blocks one at a time.
+ * 4 => Hash the blocks four at a time (KeccakF_x4(), AVX2).
+ */
+#ifndef PARALLELHASH_LANES
+#define PARALLELHASH_LANES 4
+#endif
+
+/* PARALLELHASH_THREADS
+ * 1 => Single thread.
+ * N => Hash the blocks of large inputs in N threads (POSIX threads).
+ */
+#ifndef PARALLELHASH_THREADS
+#define PARALLELHASH_THREADS 1
+#endif
+
+/* PARALLELHASH_BUFFER_BLOCK_LEN
+ * 0 => Small updates hash their blocks one at a time.
+ * N => Buffer PARALLELHASH_LANES * PARALLELHASH_THREADS blocks of up to N
+ *      bytes of small updates and hash them as one batch (longer blocks are
+ *      not buffered).
+ */
+#ifndef PARALLELHASH_BUFFER_BLOCK_LEN
+#if PARALLELHASH_LANES > 1 || PARALLELHASH_THREADS > 1
+#define PARALLELHASH_BUFFER_BLOCK_LEN 8192
+#else
+#define PARALLELHASH_BUFFER_BLOCK_LEN 0
+#endif
+#endif
+
+/* Bytes of the buffer of struct parallelhash_t. */
+#define PARALLELHASH_BUFFER_LEN                                                \
+  (PARALLELHASH_BUFFER_BLOCK_LEN * PARALLELHASH_LANES * PARALLELHASH_THREADS)
+
+#define CSHAKE_PAD 0x04 /* cSHAKE PAD start: 0010*. */
+
+struct cshake_256_t {
+  struct keccak_t hash;
+  uint8_t pad_byte; /* SHAKE pad if the name and customization are empty. */
+};
+
+struct cshake_128_t {
+  struct keccak_t hash;
+  uint8_t pad_byte; /* SHAKE pad if the name and customization are empty. */
+};
+
+struct parallelhash_t {
+  struct keccak_t final; /* cSHAKE of the chaining values. */
+  struct keccak_t leaf;  /* SHAKE of the current block. */
+  size_t block_len;      /* Block length B (bytes, greater than zero). */
+  size_t block_num;      /* Bytes in the current block. */
+  size_t num_blocks;     /* Blocks finished. */
+  uint8_t rate;          /* 168 => ParallelHash128, 136 => ParallelHash256. */
+#if PARALLELHASH_BUFFER_LEN > 0
+  size_t buff_num;                       /* Bytes in the buffer. */
+  uint8_t buff[PARALLELHASH_BUFFER_LEN]; /* Blocks of small updates. */
+#endif
+};
+
+struct kmac_key_t {
+  struct keccak_t hash; /* State after the key, reused by each message. */
+  uint8_t rate;         /* 168 => KMAC128, 136 => KMAC256. */
+};
+
+struct kmac_t {
+  struct keccak_t hash;
+  uint8_t rate;
+};
+
+void CSHAKE256Init(struct cshake_256_t *state_ptr, const void *name_ptr,
+                   size_t name_len, const void *custom_ptr, size_t custom_len);
+void CSHAKE256Absorb(struct cshake_256_t *state_ptr, const void *data_ptr,
+                     size_t num);
+void CSHAKE256Finish(struct cshake_256_t *state_ptr);
+void CSHAKE256Squeeze(struct cshake_256_t *state_ptr, void *data_ptr,
+                      size_t num);
+
+void CSHAKE128Init(struct cshake_128_t *state_ptr, const void *name_ptr,
+                   size_t name_len, const void *custom_ptr, size_t custom_len);
+void CSHAKE128Absorb(struct cshake_128_t *state_ptr, const void *data_ptr,
+                     size_t num);
+void CSHAKE128Finish(struct cshake_128_t *state_ptr);
+void CSHAKE128Squeeze(struct cshake_128_t *state_ptr, void *data_ptr,
+                      size_t num);
+
+uint8_t ParallelHash256Init(struct parallelhash_t *ph_ptr, size_t block_len,
+                            const void *custom_ptr, size_t custom_len);
+uint8_t ParallelHash128Init(struct parallelhash_t *ph_ptr, size_t block_len,
+                            const void *custom_ptr, size_t custom_len);
+void ParallelHashUpdate(struct parallelhash_t *ph_ptr, const void *data_ptr,
+                        size_t num);
+void ParallelHashFinish(struct parallelhash_t *ph_ptr, size_t out_len);
+void ParallelHashXofFinish(struct parallelhash_t *ph_ptr);
+void ParallelHashSqueeze(struct parallelhash_t *ph_ptr, void *data_ptr,
+                         size_t num);
+
+void KMAC256KeySetup(struct kmac_key_t *key_ptr, const void *key_buff_ptr,
+                     size_t key_len, const void *custom_ptr, size_t custom_len);
+void KMAC128KeySetup(struct kmac_key_t *key_ptr, const void *key_buff_ptr,
+                     size_t key_len, const void *custom_ptr, size_t custom_len);
+void KMACInit(struct kmac_t *kmac_ptr, const struct kmac_key_t *key_ptr);
+void KMACUpdate(struct kmac_t *kmac_ptr, const void *data_ptr, size_t num);
+void KMACFinish(struct kmac_t *kmac_ptr, size_t out_len);
+void KMACXofFinish(struct kmac_t *kmac_ptr);
+void KMACSqueeze(struct kmac_t *kmac_ptr, void *data_ptr, size_t num);
+
+#ifdef PARALLELHASH_DEBUG
+/* Blocks hashed in batches (PARALLELHASH_LANES at a time) and, of them, in
+ * batches divided between the threads. */
+extern size_t ParallelHash_Batch_Blocks;
+extern size_t ParallelHash_Thread_Blocks;
+#endif
+
+#endif
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _KECCAK_CSHAKE_H_ */
@@ -82,7 +82,7 @@ struct keccak_hash_t {
 
 void KeccakHashInit(struct keccak_hash_t *hash_ptr);
 void KeccakHashUpdate(struct keccak_hash_t *hash_ptr, const void *buff_ptr,
-                      uint16_t num);
+                      size_t num);
 void KeccakHashFinish(struct keccak_hash_t *hash_ptr);
 
 /* XOF (Based on SHAKE) */
@@ -95,10 +95,10 @@ void KeccakXofInit(struct keccak_xof_t *xof_ptr);
 void KeccakXofDomain(struct keccak_xof_t *xof_ptr, const void *domain_ptr,
                      uint16_t domain_length);
 void KeccakXofAbsorb(struct keccak_xof_t *xof_ptr, const void *buff_ptr,
-                     uint16_t num);
+                     size_t num);
 void KeccakXofFinish(struct keccak_xof_t *xof_ptr);
 void KeccakXofSqueeze(struct keccak_xof_t *xof_ptr, void *buff_ptr,
-                      uint16_t num);
+                      size_t num);
 
 #ifdef __cplusplus
 }
@@ -0,0 +1,86 @@
+/*
+ TurboSHAKE and KangarooTwelve implementation.
+
+ Copyright 2021 Djones A. Boni
+
+ Licensed under the Apache License, Version 2.0 (the "License");
+ you may not use this file except in compliance with the License.
+ You may obtain a copy of the License at
+
+ http://www.apache.org/licenses/LICENSE-2.0
+
+ Unless required by applicable law or agreed to in writing, software
+ distributed under the License is distributed on an "AS IS" BASIS,
+ WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ See the License for the specific language governing permissions and
+ limitations under the License.
+*/
+
+#ifndef _KECCAK_K12_H_
+#define _KECCAK_K12_H_
+
+#include "keccak.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#if (KECCAK_WORD == 8)
+
+/* K12_THREADS
+ * 1 => Single thread.
+ * N => Hash the chunks of large inputs in N threads (POSIX threads).
+ */
+#ifndef K12_THREADS
+#define K12_THREADS 1
+#endif
+
+#define TURBOSHAKE_NR 12    /* Number of rounds. */
+#define TURBOSHAKE_PAD 0x1F /* Default domain separation byte. */
+#define K12_CHUNK_LEN 8192  /* Chunk length. */
+#define K12_CV_LEN 32       /* Chaining value length. */
+
+struct turboshake_256_t {
+  struct keccak_t hash;
+};
+
+struct turboshake_128_t {
+  struct keccak_t hash;
+};
+
+struct k12_t {
+  struct keccak_t final; /* Final node: first chunk and chaining values. */
+  struct keccak_t leaf;  /* Leaf of the current chunk. */
+  uint32_t chunk_num;    /* Bytes in the current chunk. */
+  uint32_t num_chunks;   /* Chunks started, including the first one. */
+};
+
+void TurboSHAKE256Init(struct turboshake_256_t *state_ptr);
+void TurboSHAKE256Absorb(struct turboshake_256_t *state_ptr,
+                         const void *data_ptr, size_t num);
+uint8_t TurboSHAKE256Finish(struct turboshake_256_t *state_ptr,
+                            uint8_t domain);
+void TurboSHAKE256Squeeze(struct turboshake_256_t *state_ptr, void *data_ptr,
+                          size_t num);
+
+void TurboSHAKE128Init(struct turboshake_128_t *state_ptr);
+void TurboSHAKE128Absorb(struct turboshake_128_t *state_ptr,
+                         const void *data_ptr, size_t num);
+uint8_t TurboSHAKE128Finish(struct turboshake_128_t *state_ptr,
+                            uint8_t domain);
+void TurboSHAKE128Squeeze(struct turboshake_128_t *state_ptr, void *data_ptr,
+                          size_t num);
+
+void K12Init(struct k12_t *k12_ptr);
+void K12Update(struct k12_t *k12_ptr, const void *data_ptr, size_t num);
+void K12Finish(struct k12_t *k12_ptr, const void *custom_ptr,
+               size_t custom_len);
+void K12Squeeze(struct k12_t *k12_ptr, void *data_ptr, size_t num);
+
+#endif
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _KECCAK_K12_H_ */
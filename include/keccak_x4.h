@@ -0,0 +1,66 @@
+/*
+ Keccak 4-way parallel implementation.
+
+ Copyright 2021 Djones A. Boni
+
+ Licensed under the Apache License, Version 2.0 (the "License");
+ you may not use this file except in compliance with the License.
+ You may obtain a copy of the License at
+
+ http://www.apache.org/licenses/LICENSE-2.0
+
+ Unless required by applicable law or agreed to in writing, software
+ distributed under the License is distributed on an "AS IS" BASIS,
+ WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ See the License for the specific language governing permissions and
+ limitations under the License.
+*/
+
+#ifndef _KECCAK_X4_H_
+#define _KECCAK_X4_H_
+
+#include "keccak.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* KECCAK_AVX2
+ * 0 => Portable code only.
+ * 1 => Use the AVX2 instructions when the CPU supports them (x86 with GCC or
+ *      Clang, KECCAK_WORD == 8), detected at run-time. Falls back to the
+ *      portable code.
+ */
+#ifndef KECCAK_AVX2
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__)) &&         \
+    KECCAK_WORD == 8 && KECCAK_INTERLEAVE == 0
+#define KECCAK_AVX2 1
+#else
+#define KECCAK_AVX2 0
+#endif
+#endif
+#if (KECCAK_AVX2 != 0 && KECCAK_INTERLEAVE != 0)
+#error "KECCAK_AVX2 needs KECCAK_INTERLEAVE == 0."
+#endif
+
+#define KECCAK_X4 4 /* Number of states processed together. */
+
+#if KECCAK_AVX2
+uint8_t KeccakAvx2Supported(void);
+#endif
+
+void KeccakF_x4(struct keccak_t *state_ptr[KECCAK_X4], uint8_t rounds);
+
+void KeccakAbsorb_x4(struct keccak_t *state_ptr[KECCAK_X4], uint8_t rate,
+                     uint8_t rounds, const void *buff_ptr[KECCAK_X4],
+                     size_t num);
+void KeccakFinish_x4(struct keccak_t *state_ptr[KECCAK_X4], uint8_t rate,
+                     uint8_t rounds, uint8_t pad_byte);
+void KeccakSqueeze_x4(struct keccak_t *state_ptr[KECCAK_X4], uint8_t rate,
+                      uint8_t rounds, void *buff_ptr[KECCAK_X4], size_t num);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _KECCAK_X4_H_ */
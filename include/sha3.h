@@ -24,6 +24,7 @@ extern "C" {
 #endif
 
 #include "keccak_types.h"
+#include <stddef.h>
 #include <stdint.h>
 
 #if (KECCAK_WORD == 8)
@@ -54,41 +55,41 @@ struct shake_128_t {
 
 void SHA3_512Init(struct sha3_512_t *state_ptr);
 void SHA3_512Update(struct sha3_512_t *state_ptr, const void *data_ptr,
-                    uint16_t num);
+                    size_t num);
 void SHA3_512Finish(struct sha3_512_t *state_ptr);
 
 void SHA3_384Init(struct sha3_384_t *state_ptr);
 void SHA3_384Update(struct sha3_384_t *state_ptr, const void *data_ptr,
-                    uint16_t num);
+                    size_t num);
 void SHA3_384Finish(struct sha3_384_t *state_ptr);
 
 void SHA3_256Init(struct sha3_256_t *state_ptr);
 void SHA3_256Update(struct sha3_256_t *state_ptr, const void *data_ptr,
-                    uint16_t num);
+                    size_t num);
 void SHA3_256Finish(struct sha3_256_t *state_ptr);
 
 void SHA3_224Init(struct sha3_224_t *state_ptr);
 void SHA3_224Update(struct sha3_224_t *state_ptr, const void *data_ptr,
-                    uint16_t num);
+                    size_t num);
 void SHA3_224Finish(struct sha3_224_t *state_ptr);
 
 void SHAKE256Init(struct shake_256_t *state_ptr);
 void SHAKE256Domain(struct shake_256_t *state_ptr, const void *domain_ptr,
                     uint16_t domain_length);
 void SHAKE256Absorb(struct shake_256_t *state_ptr, const void *data_ptr,
-                    uint16_t num);
+                    size_t num);
 void SHAKE256Finish(struct shake_256_t *state_ptr);
 void SHAKE256Squeeze(struct shake_256_t *state_ptr, void *data_ptr,
-                     uint16_t num);
+                     size_t num);
 
 void SHAKE128Init(struct shake_128_t *state_ptr);
 void SHAKE128Domain(struct shake_128_t *state_ptr, const void *domain_ptr,
                     uint16_t domain_length);
 void SHAKE128Absorb(struct shake_128_t *state_ptr, const void *data_ptr,
-                    uint16_t num);
+                    size_t num);
 void SHAKE128Finish(struct shake_128_t *state_ptr);
 void SHAKE128Squeeze(struct shake_128_t *state_ptr, void *data_ptr,
-                     uint16_t num);
+                     size_t num);
 
 #endif
 
@@ -18,21 +18,30 @@
 
 #include "aes.h"
 #include <stddef.h>
+#include <string.h>
+
+#if (AES_CMAC_MIN_TAG_LEN < 1 || AES_CMAC_MIN_TAG_LEN > AES_CMAC_TAG_LEN)
+#error "Invalid parameter AES_CMAC_MIN_TAG_LEN."
+#endif
+
+#if AES_AESNI
+#include <cpuid.h>
+#include <emmintrin.h>
+#include <wmmintrin.h>
+#define AES_NI_TARGET __attribute__((target("aes,sse2")))
+#endif
 
 #ifdef AVR
 #include <avr/pgmspace.h>
 #define PGM_READ_BYTE(x) pgm_read_byte(x)
+#define PGM_READ_DWORD(x) pgm_read_dword(x)
 #else
 #undef PROGMEM
 #define PROGMEM
 #define PGM_READ_BYTE(x) *(x)
+#define PGM_READ_DWORD(x) *(x)
 #endif
 
-struct aes_subkey_t {
-  uint8_t byte[AES_KEY_LEN];
-  uint8_t i;
-};
-
 PROGMEM const uint8_t AES_Bytesub_Table[256] = {
     0x63, 0x7c, 0x77, 0x7b, 0xf2, 0x6b, 0x6f, 0xc5, 0x30, 0x01, 0x67, 0x2b,
     0xfe, 0xd7, 0xab, 0x76, 0xca, 0x82, 0xc9, 0x7d, 0xfa, 0x59, 0x47, 0xf0,
@@ -124,135 +133,43 @@ void AESRotword(uint8_t bytes[4]) {
 
 void AESRcon(uint8_t bytes[4], uint8_t i) { bytes[0] ^= AESRconPoli(i); }
 
-uint8_t ModAESKeyLen(uint8_t x) {
-#if AES_KEY_LEN == 16
-  return x % AES_KEY_LEN;
-#elif AES_KEY_LEN == 32
-  return x % AES_KEY_LEN;
-#elif AES_KEY_LEN == 24
-  /* return x % AES_KEY_LEN; */
-  if (x >= 192)
-    x -= 192;
-  if (x >= 96)
-    x -= 96;
-  if (x >= 48)
-    x -= 48;
-  if (x >= 24)
-    x -= 24;
-  return x;
-#endif
-}
-
-uint8_t ModAESKeyLen4(uint8_t x) {
-#if AES_KEY_LEN == 16
-  return x % (AES_KEY_LEN / 4);
-#elif AES_KEY_LEN == 32
-  return x % (AES_KEY_LEN / 4);
-#elif AES_KEY_LEN == 24
-  /* return x % (AES_KEY_LEN / 4); */
-  if (x >= 192)
-    x -= 192;
-  if (x >= 96)
-    x -= 96;
-  if (x >= 48)
-    x -= 48;
-  if (x >= 24)
-    x -= 24;
-  if (x >= 12)
-    x -= 12;
-  if (x >= 6)
-    x -= 6;
-  return x;
-#endif
-}
-
-uint8_t DivAESKeyLen4(uint8_t x) {
-#if AES_KEY_LEN == 16
-  return x / (AES_KEY_LEN / 4);
-#elif AES_KEY_LEN == 32
-  return x / (AES_KEY_LEN / 4);
-#elif AES_KEY_LEN == 24
-  /* return x / (AES_KEY_LEN / 4); */
-  uint8_t y = 0;
-  if (x >= 192) {
-    x -= 192;
-    y += 32;
-  }
-  if (x >= 96) {
-    x -= 96;
-    y += 16;
-  }
-  if (x >= 48) {
-    x -= 48;
-    y += 8;
-  }
-  if (x >= 24) {
-    x -= 24;
-    y += 4;
-  }
-  if (x >= 12) {
-    x -= 12;
-    y += 2;
-  }
-  if (x >= 6) {
-    x -= 6;
-    y += 1;
-  }
-  return y;
-#endif
-}
-
-void AESKeyExpansionInternal(struct aes_subkey_t *subkey_ptr) {
-  uint8_t temp[4], j;
-  const uint8_t i = subkey_ptr->i;
-
-  for (j = 0; j < 4; ++j) {
-    temp[j] = subkey_ptr->byte[ModAESKeyLen(4 * i + (AES_KEY_LEN - 4) + j)];
-  }
-
-  if (ModAESKeyLen4(i) == 0) {
-    AESRotword(temp);
-    AESSubword(temp);
-    AESRcon(temp, (uint8_t)(DivAESKeyLen4(i) - 1));
-  } else if ((AES_KEY_LEN / 4) > 6 && ModAESKeyLen4(i) == 4) {
-    AESSubword(temp);
+/** AES key expansion
+ *
+ * Expands 'key' of 'key_len' bytes (16, 24 or 32) into all the rounds+1 round
+ * keys, stored one after the other in 'subkeys'.
+ */
+void AESKeyExpansion(uint8_t subkeys[AES_SUBKEYS_LEN], const uint8_t *key_ptr,
+                     uint8_t key_len) {
+  const uint8_t nk = key_len / 4;
+  uint8_t temp[4], i, j, k, rcon;
+
+  /* The first round keys are the key itself */
+  for (i = 0; i < key_len; ++i) {
+    subkeys[i] = key_ptr[i];
   }
 
-  for (j = 0; j < 4; ++j) {
-    subkey_ptr->byte[ModAESKeyLen(4 * i + j)] =
-        subkey_ptr->byte[ModAESKeyLen(4 * i + j)] ^ temp[j];
-  }
-}
+  /* k = i % nk and rcon = i / nk - 1, counted instead of divided. */
+  k = 0;
+  rcon = 0;
+  for (i = nk; i < 4 * (nk + 7); ++i) {
+    for (j = 0; j < 4; ++j) {
+      temp[j] = subkeys[4 * (i - 1) + j];
+    }
 
-void AESKeyExpansion(struct aes_subkey_t *subkey_ptr, uint8_t round) {
-  uint8_t i;
-  if (round == 0) {
-    subkey_ptr->i = AES_KEY_LEN / 4;
-  } else {
-    for (i = 0; i < 4; ++i) {
-      if (subkey_ptr->i >= 4 * (AES_NUM_ROUNDS + 1)) {
-        break;
-      }
-      AESKeyExpansionInternal(subkey_ptr);
-      subkey_ptr->i = (uint8_t)(subkey_ptr->i + 1);
+    if (k == 0) {
+      AESRotword(temp);
+      AESSubword(temp);
+      AESRcon(temp, rcon++);
+    } else if (nk > 6 && k == 4) {
+      AESSubword(temp);
     }
-  }
-}
 
-void AESInvKeyExpansion(struct aes_subkey_t *subkey_ptr, uint8_t round) {
-  uint8_t i;
-  if (round == 0) {
-  } else {
-    if (round == AES_NUM_ROUNDS) {
-      subkey_ptr->i = 4 * (AES_NUM_ROUNDS + 1);
+    for (j = 0; j < 4; ++j) {
+      subkeys[4 * i + j] = subkeys[4 * i + j - key_len] ^ temp[j];
     }
 
-    for (i = 0; i < 4; ++i) {
-      if (subkey_ptr->i == 0) {
-        break;
-      }
-      subkey_ptr->i = (uint8_t)(subkey_ptr->i - 1);
-      AESKeyExpansionInternal(subkey_ptr);
+    if (++k == nk) {
+      k = 0;
     }
   }
 }
@@ -385,12 +302,10 @@ void AESMixCol(uint8_t a[AES_BLOCK_LEN]) {
   AESMixcolumn(&a[12]);
 }
 
-void AESKeyAdd(uint8_t a[AES_BLOCK_LEN], struct aes_subkey_t *subkey_ptr,
-               uint8_t round) {
+void AESKeyAdd(uint8_t a[AES_BLOCK_LEN], const uint8_t subkey[AES_BLOCK_LEN]) {
   uint8_t i;
-  AESKeyExpansion(subkey_ptr, round);
   for (i = 0; i < AES_BLOCK_LEN; ++i) {
-    a[i] = a[i] ^ subkey_ptr->byte[ModAESKeyLen(16 * round + i)];
+    a[i] = a[i] ^ subkey[i];
   }
 }
 
@@ -448,47 +363,32 @@ void AESInvMixCol(uint8_t a[AES_BLOCK_LEN]) {
   AESInvMixColumn(&a[12]);
 }
 
-void AESInvKeyAdd(uint8_t a[AES_BLOCK_LEN], struct aes_subkey_t *subkey_ptr,
-                  uint8_t round) {
-  uint8_t i;
-  for (i = 0; i < AES_BLOCK_LEN; ++i) {
-    a[i] = a[i] ^ subkey_ptr->byte[ModAESKeyLen(16 * round + i)];
-  }
-  AESInvKeyExpansion(subkey_ptr, round);
-}
-
-/** AES encrypt
+/* Compact backend.
  *
- * Encrypts plain-text 'plain' with 'key', outputs cipher-text
- * to 'cipher'.
+ * Byte oriented, uses only the small tables. Default for AVR.
  */
-void AES_ECBEncrypt(const uint8_t key[AES_KEY_LEN],
-                    const uint8_t plain[AES_BLOCK_LEN],
-                    uint8_t cipher[AES_BLOCK_LEN]) {
+
+void AESCompactEncrypt(const uint8_t subkeys[AES_SUBKEYS_LEN], uint8_t rounds,
+                       const uint8_t plain[AES_BLOCK_LEN],
+                       uint8_t cipher[AES_BLOCK_LEN]) {
   uint8_t round;
   uint8_t a[AES_BLOCK_LEN];
-  struct aes_subkey_t subkey;
   uint8_t i;
 
-  /* Copy key to subkey */
-  for (i = 0; i < AES_KEY_LEN; ++i) {
-    subkey.byte[i] = key[i];
-  }
-
   /* Copy plain-text to temporary variables */
   for (i = 0; i < AES_BLOCK_LEN; ++i) {
     a[i] = plain[i];
   }
 
   /* Rounds */
-  for (round = 0; round < AES_NUM_ROUNDS; ++round) {
-    AESKeyAdd(&a[0], &subkey, round);
+  for (round = 0; round < rounds; ++round) {
+    AESKeyAdd(&a[0], &subkeys[AES_BLOCK_LEN * round]);
     AESByteSub(&a[0]);
     AESShiftRow(&a[0]);
-    if (round < AES_NUM_ROUNDS - 1)
+    if (round < rounds - 1)
       AESMixCol(&a[0]);
   }
-  AESKeyAdd(&a[0], &subkey, round);
+  AESKeyAdd(&a[0], &subkeys[AES_BLOCK_LEN * round]);
 
   /* Copy cipher-text to output variable */
   for (i = 0; i < AES_BLOCK_LEN; ++i) {
@@ -496,211 +396,2185 @@ void AES_ECBEncrypt(const uint8_t key[AES_KEY_LEN],
   }
 }
 
-/** AES key decryption expansion
- *
- * Expand the key for decryption, i.e. create a "decryption key".
- */
-void AESKeyDecryptExpansion(uint8_t decrypt_key[AES_KEY_LEN],
-                            const uint8_t key[AES_KEY_LEN]) {
-  struct aes_subkey_t subkey;
+/* Decrypts with the encryption round keys (inverse cipher). */
+void AESCompactDecryptFwdKeys(const uint8_t subkeys[AES_SUBKEYS_LEN],
+                              uint8_t rounds,
+                              const uint8_t cipher[AES_BLOCK_LEN],
+                              uint8_t plain[AES_BLOCK_LEN]) {
+  uint8_t round;
+  uint8_t a[AES_BLOCK_LEN];
   uint8_t i;
 
-  /* Copy key to subkey */
-  for (i = 0; i < AES_KEY_LEN; ++i) {
-    subkey.byte[i] = key[i];
+  /* Copy cipher-text to temporary variables */
+  for (i = 0; i < AES_BLOCK_LEN; ++i) {
+    a[i] = cipher[i];
   }
 
-  /* Run key expansion AES_NUM_ROUNDS+1 times */
-  for (i = 0; i < AES_NUM_ROUNDS + 1; ++i) {
-    AESKeyExpansion(&subkey, i);
+  /* Rounds */
+  for (round = rounds; round > 0; --round) {
+    AESKeyAdd(&a[0], &subkeys[AES_BLOCK_LEN * round]);
+    if (round < rounds) {
+      AESInvMixCol(&a[0]);
+    }
+    AESInvShiftRow(&a[0]);
+    AESInvByteSub(&a[0]);
   }
+  AESKeyAdd(&a[0], &subkeys[AES_BLOCK_LEN * round]);
 
-  /* Copy expanded key to decryption key */
-  for (i = 0; i < AES_KEY_LEN; ++i) {
-    decrypt_key[i] = subkey.byte[i];
+  /* Copy plain-text to output variable */
+  for (i = 0; i < AES_BLOCK_LEN; ++i) {
+    plain[i] = a[i];
   }
 }
 
-/** AES decrypt
- *
- * Decrypts cipher-text 'cipher' with 'key', outputs plain-text
- * to 'plain'.
- */
-void AES_ECBDecrypt(const uint8_t key[AES_KEY_LEN],
-                    const uint8_t cipher[AES_BLOCK_LEN],
-                    uint8_t plain[AES_BLOCK_LEN]) {
+/* Decrypts with the inverse context round keys (equivalent inverse cipher). */
+void AESCompactDecrypt(const uint8_t inv_subkeys[AES_SUBKEYS_LEN],
+                       uint8_t rounds, const uint8_t cipher[AES_BLOCK_LEN],
+                       uint8_t plain[AES_BLOCK_LEN]) {
   uint8_t round;
   uint8_t a[AES_BLOCK_LEN];
-  struct aes_subkey_t subkey;
   uint8_t i;
 
-  /* Converto do decryption key, into subkey */
-  AESKeyDecryptExpansion(&subkey.byte[0], key);
-
   /* Copy cipher-text to temporary variables */
   for (i = 0; i < AES_BLOCK_LEN; ++i) {
     a[i] = cipher[i];
   }
 
   /* Rounds */
-  for (round = AES_NUM_ROUNDS; round > 0; --round) {
-    AESInvKeyAdd(&a[0], &subkey, round);
-    if (round < AES_NUM_ROUNDS) {
-      AESInvMixCol(&a[0]);
-    }
-    AESInvShiftRow(&a[0]);
+  AESKeyAdd(&a[0], &inv_subkeys[0]);
+  for (round = 1; round <= rounds; ++round) {
     AESInvByteSub(&a[0]);
+    AESInvShiftRow(&a[0]);
+    if (round < rounds)
+      AESInvMixCol(&a[0]);
+    AESKeyAdd(&a[0], &inv_subkeys[AES_BLOCK_LEN * round]);
   }
-  AESInvKeyAdd(&a[0], &subkey, round);
 
   /* Copy plain-text to output variable */
-  for (i = AES_BLOCK_LEN; i > 0; --i) {
-    plain[i - 1] = a[i - 1];
+  for (i = 0; i < AES_BLOCK_LEN; ++i) {
+    plain[i] = a[i];
   }
 }
 
-/** AES CBC encrypt
+#if AES_FASTER
+
+/* T-table backend.
  *
- * Encrypts the plain-text 'plain' of size 'length' bytes with 'key'
- * and initialization vector 'iv', outputs cipher-text to 'cipher'.
+ * Word oriented. Each column of the state is a 32-bit word, row 0 in the least
+ * significant byte. One lookup in a T-table does SubBytes and MixColumns of one
+ * byte, ShiftRows is done by selecting the bytes from the right columns.
  *
- * Note: Encryption and decryption must use the same initialization vector.
- * The initialization vector should be a nonce (number used once with the key).
- * It is not a secret and can be transmitted in plain-text.
+ * The tables for rows 1, 2 and 3 are the table for row 0 rotated by 8, 16 and
+ * 24 bits. Only the row 0 tables are stored to save 6 KiB.
  */
-void AES_CBCEncrypt(const uint8_t key[AES_KEY_LEN],
-                    const uint8_t iv[AES_BLOCK_LEN], const uint8_t *plain_ptr,
-                    uint32_t length, uint8_t *cipher_ptr) {
-  uint8_t a[AES_BLOCK_LEN];
-  uint8_t i;
 
-  /* A = C[0] = Ek(iv) */
-  for (i = 0; i < AES_BLOCK_LEN; ++i) {
-    a[i] = iv[i];
+/* Te0[x] = {02}S[x] | S[x]<<8 | S[x]<<16 | {03}S[x]<<24 */
+PROGMEM const uint32_t AES_Te0_Table[256] = {
+    0xa56363c6, 0x847c7cf8, 0x997777ee, 0x8d7b7bf6, 0x0df2f2ff, 0xbd6b6bd6,
+    0xb16f6fde, 0x54c5c591, 0x50303060, 0x03010102, 0xa96767ce, 0x7d2b2b56,
+    0x19fefee7, 0x62d7d7b5, 0xe6abab4d, 0x9a7676ec, 0x45caca8f, 0x9d82821f,
+    0x40c9c989, 0x877d7dfa, 0x15fafaef, 0xeb5959b2, 0xc947478e, 0x0bf0f0fb,
+    0xecadad41, 0x67d4d4b3, 0xfda2a25f, 0xeaafaf45, 0xbf9c9c23, 0xf7a4a453,
+    0x967272e4, 0x5bc0c09b, 0xc2b7b775, 0x1cfdfde1, 0xae93933d, 0x6a26264c,
+    0x5a36366c, 0x413f3f7e, 0x02f7f7f5, 0x4fcccc83, 0x5c343468, 0xf4a5a551,
+    0x34e5e5d1, 0x08f1f1f9, 0x937171e2, 0x73d8d8ab, 0x53313162, 0x3f15152a,
+    0x0c040408, 0x52c7c795, 0x65232346, 0x5ec3c39d, 0x28181830, 0xa1969637,
+    0x0f05050a, 0xb59a9a2f, 0x0907070e, 0x36121224, 0x9b80801b, 0x3de2e2df,
+    0x26ebebcd, 0x6927274e, 0xcdb2b27f, 0x9f7575ea, 0x1b090912, 0x9e83831d,
+    0x742c2c58, 0x2e1a1a34, 0x2d1b1b36, 0xb26e6edc, 0xee5a5ab4, 0xfba0a05b,
+    0xf65252a4, 0x4d3b3b76, 0x61d6d6b7, 0xceb3b37d, 0x7b292952, 0x3ee3e3dd,
+    0x712f2f5e, 0x97848413, 0xf55353a6, 0x68d1d1b9, 0x00000000, 0x2cededc1,
+    0x60202040, 0x1ffcfce3, 0xc8b1b179, 0xed5b5bb6, 0xbe6a6ad4, 0x46cbcb8d,
+    0xd9bebe67, 0x4b393972, 0xde4a4a94, 0xd44c4c98, 0xe85858b0, 0x4acfcf85,
+    0x6bd0d0bb, 0x2aefefc5, 0xe5aaaa4f, 0x16fbfbed, 0xc5434386, 0xd74d4d9a,
+    0x55333366, 0x94858511, 0xcf45458a, 0x10f9f9e9, 0x06020204, 0x817f7ffe,
+    0xf05050a0, 0x443c3c78, 0xba9f9f25, 0xe3a8a84b, 0xf35151a2, 0xfea3a35d,
+    0xc0404080, 0x8a8f8f05, 0xad92923f, 0xbc9d9d21, 0x48383870, 0x04f5f5f1,
+    0xdfbcbc63, 0xc1b6b677, 0x75dadaaf, 0x63212142, 0x30101020, 0x1affffe5,
+    0x0ef3f3fd, 0x6dd2d2bf, 0x4ccdcd81, 0x140c0c18, 0x35131326, 0x2fececc3,
+    0xe15f5fbe, 0xa2979735, 0xcc444488, 0x3917172e, 0x57c4c493, 0xf2a7a755,
+    0x827e7efc, 0x473d3d7a, 0xac6464c8, 0xe75d5dba, 0x2b191932, 0x957373e6,
+    0xa06060c0, 0x98818119, 0xd14f4f9e, 0x7fdcdca3, 0x66222244, 0x7e2a2a54,
+    0xab90903b, 0x8388880b, 0xca46468c, 0x29eeeec7, 0xd3b8b86b, 0x3c141428,
+    0x79dedea7, 0xe25e5ebc, 0x1d0b0b16, 0x76dbdbad, 0x3be0e0db, 0x56323264,
+    0x4e3a3a74, 0x1e0a0a14, 0xdb494992, 0x0a06060c, 0x6c242448, 0xe45c5cb8,
+    0x5dc2c29f, 0x6ed3d3bd, 0xefacac43, 0xa66262c4, 0xa8919139, 0xa4959531,
+    0x37e4e4d3, 0x8b7979f2, 0x32e7e7d5, 0x43c8c88b, 0x5937376e, 0xb76d6dda,
+    0x8c8d8d01, 0x64d5d5b1, 0xd24e4e9c, 0xe0a9a949, 0xb46c6cd8, 0xfa5656ac,
+    0x07f4f4f3, 0x25eaeacf, 0xaf6565ca, 0x8e7a7af4, 0xe9aeae47, 0x18080810,
+    0xd5baba6f, 0x887878f0, 0x6f25254a, 0x722e2e5c, 0x241c1c38, 0xf1a6a657,
+    0xc7b4b473, 0x51c6c697, 0x23e8e8cb, 0x7cdddda1, 0x9c7474e8, 0x211f1f3e,
+    0xdd4b4b96, 0xdcbdbd61, 0x868b8b0d, 0x858a8a0f, 0x907070e0, 0x423e3e7c,
+    0xc4b5b571, 0xaa6666cc, 0xd8484890, 0x05030306, 0x01f6f6f7, 0x120e0e1c,
+    0xa36161c2, 0x5f35356a, 0xf95757ae, 0xd0b9b969, 0x91868617, 0x58c1c199,
+    0x271d1d3a, 0xb99e9e27, 0x38e1e1d9, 0x13f8f8eb, 0xb398982b, 0x33111122,
+    0xbb6969d2, 0x70d9d9a9, 0x898e8e07, 0xa7949433, 0xb69b9b2d, 0x221e1e3c,
+    0x92878715, 0x20e9e9c9, 0x49cece87, 0xff5555aa, 0x78282850, 0x7adfdfa5,
+    0x8f8c8c03, 0xf8a1a159, 0x80898909, 0x170d0d1a, 0xdabfbf65, 0x31e6e6d7,
+    0xc6424284, 0xb86868d0, 0xc3414182, 0xb0999929, 0x772d2d5a, 0x110f0f1e,
+    0xcbb0b07b, 0xfc5454a8, 0xd6bbbb6d, 0x3a16162c};
+
+/* Td0[x] = {0e}Si[x] | {09}Si[x]<<8 | {0d}Si[x]<<16 | {0b}Si[x]<<24 */
+PROGMEM const uint32_t AES_Td0_Table[256] = {
+    0x50a7f451, 0x5365417e, 0xc3a4171a, 0x965e273a, 0xcb6bab3b, 0xf1459d1f,
+    0xab58faac, 0x9303e34b, 0x55fa3020, 0xf66d76ad, 0x9176cc88, 0x254c02f5,
+    0xfcd7e54f, 0xd7cb2ac5, 0x80443526, 0x8fa362b5, 0x495ab1de, 0x671bba25,
+    0x980eea45, 0xe1c0fe5d, 0x02752fc3, 0x12f04c81, 0xa397468d, 0xc6f9d36b,
+    0xe75f8f03, 0x959c9215, 0xeb7a6dbf, 0xda595295, 0x2d83bed4, 0xd3217458,
+    0x2969e049, 0x44c8c98e, 0x6a89c275, 0x78798ef4, 0x6b3e5899, 0xdd71b927,
+    0xb64fe1be, 0x17ad88f0, 0x66ac20c9, 0xb43ace7d, 0x184adf63, 0x82311ae5,
+    0x60335197, 0x457f5362, 0xe07764b1, 0x84ae6bbb, 0x1ca081fe, 0x942b08f9,
+    0x58684870, 0x19fd458f, 0x876cde94, 0xb7f87b52, 0x23d373ab, 0xe2024b72,
+    0x578f1fe3, 0x2aab5566, 0x0728ebb2, 0x03c2b52f, 0x9a7bc586, 0xa50837d3,
+    0xf2872830, 0xb2a5bf23, 0xba6a0302, 0x5c8216ed, 0x2b1ccf8a, 0x92b479a7,
+    0xf0f207f3, 0xa1e2694e, 0xcdf4da65, 0xd5be0506, 0x1f6234d1, 0x8afea6c4,
+    0x9d532e34, 0xa055f3a2, 0x32e18a05, 0x75ebf6a4, 0x39ec830b, 0xaaef6040,
+    0x069f715e, 0x51106ebd, 0xf98a213e, 0x3d06dd96, 0xae053edd, 0x46bde64d,
+    0xb58d5491, 0x055dc471, 0x6fd40604, 0xff155060, 0x24fb9819, 0x97e9bdd6,
+    0xcc434089, 0x779ed967, 0xbd42e8b0, 0x888b8907, 0x385b19e7, 0xdbeec879,
+    0x470a7ca1, 0xe90f427c, 0xc91e84f8, 0x00000000, 0x83868009, 0x48ed2b32,
+    0xac70111e, 0x4e725a6c, 0xfbff0efd, 0x5638850f, 0x1ed5ae3d, 0x27392d36,
+    0x64d90f0a, 0x21a65c68, 0xd1545b9b, 0x3a2e3624, 0xb1670a0c, 0x0fe75793,
+    0xd296eeb4, 0x9e919b1b, 0x4fc5c080, 0xa220dc61, 0x694b775a, 0x161a121c,
+    0x0aba93e2, 0xe52aa0c0, 0x43e0223c, 0x1d171b12, 0x0b0d090e, 0xadc78bf2,
+    0xb9a8b62d, 0xc8a91e14, 0x8519f157, 0x4c0775af, 0xbbdd99ee, 0xfd607fa3,
+    0x9f2601f7, 0xbcf5725c, 0xc53b6644, 0x347efb5b, 0x7629438b, 0xdcc623cb,
+    0x68fcedb6, 0x63f1e4b8, 0xcadc31d7, 0x10856342, 0x40229713, 0x2011c684,
+    0x7d244a85, 0xf83dbbd2, 0x1132f9ae, 0x6da129c7, 0x4b2f9e1d, 0xf330b2dc,
+    0xec52860d, 0xd0e3c177, 0x6c16b32b, 0x99b970a9, 0xfa489411, 0x2264e947,
+    0xc48cfca8, 0x1a3ff0a0, 0xd82c7d56, 0xef903322, 0xc74e4987, 0xc1d138d9,
+    0xfea2ca8c, 0x360bd498, 0xcf81f5a6, 0x28de7aa5, 0x268eb7da, 0xa4bfad3f,
+    0xe49d3a2c, 0x0d927850, 0x9bcc5f6a, 0x62467e54, 0xc2138df6, 0xe8b8d890,
+    0x5ef7392e, 0xf5afc382, 0xbe805d9f, 0x7c93d069, 0xa92dd56f, 0xb31225cf,
+    0x3b99acc8, 0xa77d1810, 0x6e639ce8, 0x7bbb3bdb, 0x097826cd, 0xf418596e,
+    0x01b79aec, 0xa89a4f83, 0x656e95e6, 0x7ee6ffaa, 0x08cfbc21, 0xe6e815ef,
+    0xd99be7ba, 0xce366f4a, 0xd4099fea, 0xd67cb029, 0xafb2a431, 0x31233f2a,
+    0x3094a5c6, 0xc066a235, 0x37bc4e74, 0xa6ca82fc, 0xb0d090e0, 0x15d8a733,
+    0x4a9804f1, 0xf7daec41, 0x0e50cd7f, 0x2ff69117, 0x8dd64d76, 0x4db0ef43,
+    0x544daacc, 0xdf0496e4, 0xe3b5d19e, 0x1b886a4c, 0xb81f2cc1, 0x7f516546,
+    0x04ea5e9d, 0x5d358c01, 0x737487fa, 0x2e410bfb, 0x5a1d67b3, 0x52d2db92,
+    0x335610e9, 0x1347d66d, 0x8c61d79a, 0x7a0ca137, 0x8e14f859, 0x893c13eb,
+    0xee27a9ce, 0x35c961b7, 0xede51ce1, 0x3cb1477a, 0x59dfd29c, 0x3f73f255,
+    0x79ce1418, 0xbf37c773, 0xeacdf753, 0x5baafd5f, 0x146f3ddf, 0x86db4478,
+    0x81f3afca, 0x3ec468b9, 0x2c342438, 0x5f40a3c2, 0x72c31d16, 0x0c25e2bc,
+    0x8b493c28, 0x41950dff, 0x7101a839, 0xdeb30c08, 0x9ce4b4d8, 0x90c15664,
+    0x6184cb7b, 0x70b632d5, 0x745c6c48, 0x4257b8d0};
+
+uint32_t AESTe0Table(uint8_t i) { return PGM_READ_DWORD(&AES_Te0_Table[i]); }
+
+uint32_t AESTd0Table(uint8_t i) { return PGM_READ_DWORD(&AES_Td0_Table[i]); }
+
+uint32_t AESRotl(uint32_t x, uint8_t n) { return (x << n) | (x >> (32 - n)); }
+
+uint32_t AESLoadWord(const uint8_t bytes[4]) {
+  return (uint32_t)bytes[0] | ((uint32_t)bytes[1] << 8) |
+         ((uint32_t)bytes[2] << 16) | ((uint32_t)bytes[3] << 24);
+}
+
+void AESStoreWord(uint8_t bytes[4], uint32_t x) {
+  bytes[0] = (uint8_t)x;
+  bytes[1] = (uint8_t)(x >> 8);
+  bytes[2] = (uint8_t)(x >> 16);
+  bytes[3] = (uint8_t)(x >> 24);
+}
+
+/* Byte 'n' of word 'x'. */
+#define AES_BYTE(x, n) ((uint8_t)((x) >> (8 * (n))))
+
+/* SubBytes ShiftRows MixColumns of output column 'j'. */
+#define AES_TE_COLUMN(s, j)                                                    \
+  (AESTe0Table(AES_BYTE(s[(j)], 0)) ^                                          \
+   AESRotl(AESTe0Table(AES_BYTE(s[((j) + 1) & 3], 1)), 8) ^                    \
+   AESRotl(AESTe0Table(AES_BYTE(s[((j) + 2) & 3], 2)), 16) ^                   \
+   AESRotl(AESTe0Table(AES_BYTE(s[((j) + 3) & 3], 3)), 24))
+
+/* SubBytes ShiftRows of output column 'j' (last round). */
+#define AES_SE_COLUMN(s, j)                                                    \
+  ((uint32_t)AESByteSubTable(AES_BYTE(s[(j)], 0)) ^                            \
+   ((uint32_t)AESByteSubTable(AES_BYTE(s[((j) + 1) & 3], 1)) << 8) ^           \
+   ((uint32_t)AESByteSubTable(AES_BYTE(s[((j) + 2) & 3], 2)) << 16) ^          \
+   ((uint32_t)AESByteSubTable(AES_BYTE(s[((j) + 3) & 3], 3)) << 24))
+
+/* InvSubBytes InvShiftRows InvMixColumns of output column 'j'. */
+#define AES_TD_COLUMN(s, j)                                                    \
+  (AESTd0Table(AES_BYTE(s[(j)], 0)) ^                                          \
+   AESRotl(AESTd0Table(AES_BYTE(s[((j) + 3) & 3], 1)), 8) ^                    \
+   AESRotl(AESTd0Table(AES_BYTE(s[((j) + 2) & 3], 2)), 16) ^                   \
+   AESRotl(AESTd0Table(AES_BYTE(s[((j) + 1) & 3], 3)), 24))
+
+/* InvSubBytes InvShiftRows of output column 'j' (last round). */
+#define AES_SD_COLUMN(s, j)                                                    \
+  ((uint32_t)AESInvByteSubTable(AES_BYTE(s[(j)], 0)) ^                         \
+   ((uint32_t)AESInvByteSubTable(AES_BYTE(s[((j) + 3) & 3], 1)) << 8) ^        \
+   ((uint32_t)AESInvByteSubTable(AES_BYTE(s[((j) + 2) & 3], 2)) << 16) ^       \
+   ((uint32_t)AESInvByteSubTable(AES_BYTE(s[((j) + 1) & 3], 3)) << 24))
+
+/* InvMixColumns of one round key column.
+ * Td0[S[x]] is InvMixColumns of byte x, the S-box cancels the inverse S-box.
+ */
+uint32_t AESInvMixWord(uint32_t x) {
+  return AESTd0Table(AESByteSubTable(AES_BYTE(x, 0))) ^
+         AESRotl(AESTd0Table(AESByteSubTable(AES_BYTE(x, 1))), 8) ^
+         AESRotl(AESTd0Table(AESByteSubTable(AES_BYTE(x, 2))), 16) ^
+         AESRotl(AESTd0Table(AESByteSubTable(AES_BYTE(x, 3))), 24);
+}
+
+void AESTTableEncrypt(const uint8_t subkeys[AES_SUBKEYS_LEN], uint8_t rounds,
+                      const uint8_t plain[AES_BLOCK_LEN],
+                      uint8_t cipher[AES_BLOCK_LEN]) {
+  uint32_t s[4], t[4];
+  uint8_t round, j;
+
+  for (j = 0; j < 4; ++j) {
+    s[j] = AESLoadWord(&plain[4 * j]) ^ AESLoadWord(&subkeys[4 * j]);
   }
-  AES_ECBEncrypt(key, a, a);
 
-  while (length > 0) {
-    /* A = C[i] = Ek(P[i] ^ C[i-1] */
-    for (i = 0; i < AES_BLOCK_LEN; ++i) {
-      a[i] ^= *plain_ptr++;
-    }
-    length -= AES_BLOCK_LEN;
-    AES_ECBEncrypt(key, a, a);
+  for (round = 1; round < rounds; ++round) {
+    const uint8_t *k = &subkeys[AES_BLOCK_LEN * round];
+    t[0] = AES_TE_COLUMN(s, 0) ^ AESLoadWord(&k[0]);
+    t[1] = AES_TE_COLUMN(s, 1) ^ AESLoadWord(&k[4]);
+    t[2] = AES_TE_COLUMN(s, 2) ^ AESLoadWord(&k[8]);
+    t[3] = AES_TE_COLUMN(s, 3) ^ AESLoadWord(&k[12]);
+    s[0] = t[0];
+    s[1] = t[1];
+    s[2] = t[2];
+    s[3] = t[3];
+  }
 
-    /* cipher = A = C[i] */
-    for (i = 0; i < AES_BLOCK_LEN; ++i) {
-      *cipher_ptr++ = a[i];
-    }
+  for (j = 0; j < 4; ++j) {
+    t[j] = AES_SE_COLUMN(s, j) ^
+           AESLoadWord(&subkeys[AES_BLOCK_LEN * rounds + 4 * j]);
+  }
+  for (j = 0; j < 4; ++j) {
+    AESStoreWord(&cipher[4 * j], t[j]);
   }
 }
 
-/** AES CBC decrypt
- *
- * Decrypts the cipher-text 'cipher' of size 'length' bytes with 'key'
- * and initialization vector 'iv', outputs plain-text to 'plain'.
- *
- * Note: Encryption and decryption must use the same initialization vector.
- * The initialization vector should be a nonce (number used once with the key).
- * It is not a secret and can be transmitted in plain-text.
+/* Decrypts with the inverse context round keys (equivalent inverse cipher). */
+void AESTTableDecrypt(const uint8_t inv_subkeys[AES_SUBKEYS_LEN],
+                      uint8_t rounds, const uint8_t cipher[AES_BLOCK_LEN],
+                      uint8_t plain[AES_BLOCK_LEN]) {
+  uint32_t s[4], t[4];
+  uint8_t round, j;
+
+  for (j = 0; j < 4; ++j) {
+    s[j] = AESLoadWord(&cipher[4 * j]) ^ AESLoadWord(&inv_subkeys[4 * j]);
+  }
+
+  for (round = 1; round < rounds; ++round) {
+    const uint8_t *k = &inv_subkeys[AES_BLOCK_LEN * round];
+    t[0] = AES_TD_COLUMN(s, 0) ^ AESLoadWord(&k[0]);
+    t[1] = AES_TD_COLUMN(s, 1) ^ AESLoadWord(&k[4]);
+    t[2] = AES_TD_COLUMN(s, 2) ^ AESLoadWord(&k[8]);
+    t[3] = AES_TD_COLUMN(s, 3) ^ AESLoadWord(&k[12]);
+    s[0] = t[0];
+    s[1] = t[1];
+    s[2] = t[2];
+    s[3] = t[3];
+  }
+
+  for (j = 0; j < 4; ++j) {
+    t[j] = AES_SD_COLUMN(s, j) ^
+           AESLoadWord(&inv_subkeys[AES_BLOCK_LEN * rounds + 4 * j]);
+  }
+  for (j = 0; j < 4; ++j) {
+    AESStoreWord(&plain[4 * j], t[j]);
+  }
+}
+
+/* Decrypts with the encryption round keys, InvMixColumns is applied to the
+ * round keys on the fly.
  */
-void AES_CBCDecrypt(const uint8_t key[AES_KEY_LEN],
-                    const uint8_t iv[AES_BLOCK_LEN], const uint8_t *cipher_ptr,
-                    uint32_t length, uint8_t *plain_ptr) {
-  uint8_t a[AES_BLOCK_LEN];
-  uint8_t b[AES_BLOCK_LEN];
-  uint8_t i;
+void AESTTableDecryptFwdKeys(const uint8_t subkeys[AES_SUBKEYS_LEN],
+                             uint8_t rounds,
+                             const uint8_t cipher[AES_BLOCK_LEN],
+                             uint8_t plain[AES_BLOCK_LEN]) {
+  uint32_t s[4], t[4];
+  uint8_t round, j;
 
-  /* A = C[0] = Ek(iv) */
-  for (i = 0; i < AES_BLOCK_LEN; ++i) {
-    a[i] = iv[i];
+  for (j = 0; j < 4; ++j) {
+    s[j] = AESLoadWord(&cipher[4 * j]) ^
+           AESLoadWord(&subkeys[AES_BLOCK_LEN * rounds + 4 * j]);
   }
-  AES_ECBEncrypt(key, a, a);
 
-  while (length > 0) {
-    /* B = Dk(C[i]) */
-    for (i = 0; i < AES_BLOCK_LEN; ++i) {
-      b[i] = cipher_ptr[i];
-    }
-    length -= AES_BLOCK_LEN;
-    AES_ECBDecrypt(key, b, b);
+  for (round = rounds - 1; round > 0; --round) {
+    const uint8_t *k = &subkeys[AES_BLOCK_LEN * round];
+    t[0] = AES_TD_COLUMN(s, 0) ^ AESInvMixWord(AESLoadWord(&k[0]));
+    t[1] = AES_TD_COLUMN(s, 1) ^ AESInvMixWord(AESLoadWord(&k[4]));
+    t[2] = AES_TD_COLUMN(s, 2) ^ AESInvMixWord(AESLoadWord(&k[8]));
+    t[3] = AES_TD_COLUMN(s, 3) ^ AESInvMixWord(AESLoadWord(&k[12]));
+    s[0] = t[0];
+    s[1] = t[1];
+    s[2] = t[2];
+    s[3] = t[3];
+  }
 
-    /* plain = P[i] = Dk(C[i]) XOR C[i-1] */
-    /* A = C[i] */
-    for (i = 0; i < AES_BLOCK_LEN; ++i) {
-      *plain_ptr++ = b[i] ^ a[i];
-      a[i] = *cipher_ptr++;
-    }
+  for (j = 0; j < 4; ++j) {
+    t[j] = AES_SD_COLUMN(s, j) ^ AESLoadWord(&subkeys[4 * j]);
+  }
+  for (j = 0; j < 4; ++j) {
+    AESStoreWord(&plain[4 * j], t[j]);
   }
 }
 
-/* AES HASH.
- *
- * Length padding.
- * Merkle-Damgard construction: Length extension attack is possible.
- *
- * If you want to be REALLY SURE your EEPROM data is not corrupted, this makes
- * a very strong CRC. Much slower than a normal CRC though.
- *
- * If you want a MAC (message authentication code) on serial that is strong
- * against replay attacks, use a NONCE initialization vector (number used only
- * once, random or incremental) and encrypt the hash with the MAC key.
- * This way there is no length extension attack and no replay attack.
+#endif /* AES_FASTER */
+
+/* Bitsliced backend.
  *
- * struct aes_hash_state_t state_ptr;
- * aes_hash_init(&state_ptr);
- * aes_hash_update(&state_ptr, data1, length1);
- * aes_hash_update(&state_ptr, data2, length2);
- * // ... as much as you want
- * aes_hash_finish(&state_ptr);
- * // Hash in state_ptr.hash
+ * Constant-time: no table lookups nor branches depending on secret data. Uses
+ * only 64-bit logic operations and shifts.
  *
+ * The state of AES_CT_BLOCKS (4) blocks is kept in eight 64-bit words, word
+ * 'b' holds bit 'b' of all the 64 bytes. Block 'k' byte 'i' is at bit
+ * 16 * k + i, so every 16-bit group of a word is one block, and every nibble
+ * of a group is one column (row 0 in the least significant bit).
  */
 
-void AESHashInit(struct aes_hash_state_t *state_ptr) {
-  uint8_t i;
-  for (i = 0; i < AES_BLOCK_LEN; ++i)
-    state_ptr->hash[i] = 0x00;
-  state_ptr->length = 0;
+#define AES_CT_BLOCKS 4
+
+/* 8x8 bit matrix transposition: bit 'j' of byte 'i' <=> bit 'i' of byte 'j'. */
+uint64_t AESCtTranspose8(uint64_t x) {
+  uint64_t t;
+  t = (x ^ (x >> 7)) & 0x00AA00AA00AA00AA;
+  x = x ^ t ^ (t << 7);
+  t = (x ^ (x >> 14)) & 0x0000CCCC0000CCCC;
+  x = x ^ t ^ (t << 14);
+  t = (x ^ (x >> 28)) & 0x00000000F0F0F0F0;
+  x = x ^ t ^ (t << 28);
+  return x;
 }
 
-void AESHashInitIv(struct aes_hash_state_t *state_ptr,
-                   const uint8_t iv[AES_BLOCK_LEN]) {
+uint64_t AESCtLoad64(const uint8_t bytes[8]) {
+  uint64_t x = 0;
   uint8_t i;
-  for (i = 0; i < AES_BLOCK_LEN; ++i)
-    state_ptr->hash[i] = iv[i];
-  state_ptr->length = 0;
+  for (i = 8; i > 0; --i) {
+    x = (x << 8) | bytes[i - 1];
+  }
+  return x;
 }
 
-void AESHashUpdate(struct aes_hash_state_t *state_ptr, const uint8_t *plain_ptr,
-                   uint32_t length) {
+void AESCtStore64(uint8_t bytes[8], uint64_t x) {
   uint8_t i;
+  for (i = 0; i < 8; ++i) {
+    bytes[i] = (uint8_t)(x >> (8 * i));
+  }
+}
 
-  while (length > 0) {
-    /* Try to fill one plain block. */
-    for (i = state_ptr->length; i < AES_KEY_LEN && length > 0; i++, length--)
-      state_ptr->plain[i] = *plain_ptr++;
+/* Puts block 'k' into the bitsliced state. */
+void AESCtPack(uint64_t q[8], const uint8_t block[AES_BLOCK_LEN], uint8_t k) {
+  uint64_t lo = AESCtTranspose8(AESCtLoad64(&block[0]));
+  uint64_t hi = AESCtTranspose8(AESCtLoad64(&block[8]));
+  uint8_t b;
+  for (b = 0; b < 8; ++b) {
+    uint64_t plane = ((lo >> (8 * b)) & 0xFF) | (((hi >> (8 * b)) & 0xFF) << 8);
+    q[b] |= plane << (16 * k);
+  }
+}
 
-    if (i >= AES_KEY_LEN) {
-      /* Block filled. Encrypt. */
-      AES_ECBEncrypt(state_ptr->plain, state_ptr->hash, state_ptr->hash);
-      state_ptr->length = 0;
-    } else {
-      state_ptr->length = i;
+/* Gets block 'k' from the bitsliced state. */
+void AESCtUnpack(uint8_t block[AES_BLOCK_LEN], const uint64_t q[8], uint8_t k) {
+  uint64_t lo = 0, hi = 0;
+  uint8_t b;
+  for (b = 0; b < 8; ++b) {
+    uint64_t plane = (q[b] >> (16 * k)) & 0xFFFF;
+    lo |= (plane & 0xFF) << (8 * b);
+    hi |= (plane >> 8) << (8 * b);
+  }
+  AESCtStore64(&block[0], AESCtTranspose8(lo));
+  AESCtStore64(&block[8], AESCtTranspose8(hi));
+}
+
+/* S-box circuit by Boyar and Peralta, 113 gates. */
+void AESCtSbox(uint64_t q[8]) {
+  uint64_t x0, x1, x2, x3, x4, x5, x6, x7;
+  uint64_t y1, y2, y3, y4, y5, y6, y7, y8, y9, y10, y11, y12, y13, y14, y15,
+      y16, y17, y18, y19, y20, y21;
+  uint64_t z0, z1, z2, z3, z4, z5, z6, z7, z8, z9, z10, z11, z12, z13, z14,
+      z15, z16, z17;
+  uint64_t t0, t1, t2, t3, t4, t5, t6, t7, t8, t9, t10, t11, t12, t13, t14,
+      t15, t16, t17, t18, t19, t20, t21, t22, t23, t24, t25, t26, t27, t28,
+      t29, t30, t31, t32, t33, t34, t35, t36, t37, t38, t39, t40, t41, t42,
+      t43, t44, t45, t46, t47, t48, t49, t50, t51, t52, t53, t54, t55, t56,
+      t57, t58, t59, t60, t61, t62, t63, t64, t65, t66, t67;
+  uint64_t s0, s1, s2, s3, s4, s5, s6, s7;
+
+  x0 = q[7];
+  x1 = q[6];
+  x2 = q[5];
+  x3 = q[4];
+  x4 = q[3];
+  x5 = q[2];
+  x6 = q[1];
+  x7 = q[0];
+
+  /* Top linear transformation */
+  y14 = x3 ^ x5;
+  y13 = x0 ^ x6;
+  y9 = x0 ^ x3;
+  y8 = x0 ^ x5;
+  t0 = x1 ^ x2;
+  y1 = t0 ^ x7;
+  y4 = y1 ^ x3;
+  y12 = y13 ^ y14;
+  y2 = y1 ^ x0;
+  y5 = y1 ^ x6;
+  y3 = y5 ^ y8;
+  t1 = x4 ^ y12;
+  y15 = t1 ^ x5;
+  y20 = t1 ^ x1;
+  y6 = y15 ^ x7;
+  y10 = y15 ^ t0;
+  y11 = y20 ^ y9;
+  y7 = x7 ^ y11;
+  y17 = y10 ^ y11;
+  y19 = y10 ^ y8;
+  y16 = t0 ^ y11;
+  y21 = y13 ^ y16;
+  y18 = x0 ^ y16;
+
+  /* Non-linear section */
+  t2 = y12 & y15;
+  t3 = y3 & y6;
+  t4 = t3 ^ t2;
+  t5 = y4 & x7;
+  t6 = t5 ^ t2;
+  t7 = y13 & y16;
+  t8 = y5 & y1;
+  t9 = t8 ^ t7;
+  t10 = y2 & y7;
+  t11 = t10 ^ t7;
+  t12 = y9 & y11;
+  t13 = y14 & y17;
+  t14 = t13 ^ t12;
+  t15 = y8 & y10;
+  t16 = t15 ^ t12;
+  t17 = t4 ^ t14;
+  t18 = t6 ^ t16;
+  t19 = t9 ^ t14;
+  t20 = t11 ^ t16;
+  t21 = t17 ^ y20;
+  t22 = t18 ^ y19;
+  t23 = t19 ^ y21;
+  t24 = t20 ^ y18;
+
+  t25 = t21 ^ t22;
+  t26 = t21 & t23;
+  t27 = t24 ^ t26;
+  t28 = t25 & t27;
+  t29 = t28 ^ t22;
+  t30 = t23 ^ t24;
+  t31 = t22 ^ t26;
+  t32 = t31 & t30;
+  t33 = t32 ^ t24;
+  t34 = t23 ^ t33;
+  t35 = t27 ^ t33;
+  t36 = t24 & t35;
+  t37 = t36 ^ t34;
+  t38 = t27 ^ t36;
+  t39 = t29 & t38;
+  t40 = t25 ^ t39;
+
+  t41 = t40 ^ t37;
+  t42 = t29 ^ t33;
+  t43 = t29 ^ t40;
+  t44 = t33 ^ t37;
+  t45 = t42 ^ t41;
+  z0 = t44 & y15;
+  z1 = t37 & y6;
+  z2 = t33 & x7;
+  z3 = t43 & y16;
+  z4 = t40 & y1;
+  z5 = t29 & y7;
+  z6 = t42 & y11;
+  z7 = t45 & y17;
+  z8 = t41 & y10;
+  z9 = t44 & y12;
+  z10 = t37 & y3;
+  z11 = t33 & y4;
+  z12 = t43 & y13;
+  z13 = t40 & y5;
+  z14 = t29 & y2;
+  z15 = t42 & y9;
+  z16 = t45 & y14;
+  z17 = t41 & y8;
+
+  /* Bottom linear transformation */
+  t46 = z15 ^ z16;
+  t47 = z10 ^ z11;
+  t48 = z5 ^ z13;
+  t49 = z9 ^ z10;
+  t50 = z2 ^ z12;
+  t51 = z2 ^ z5;
+  t52 = z7 ^ z8;
+  t53 = z0 ^ z3;
+  t54 = z6 ^ z7;
+  t55 = z16 ^ z17;
+  t56 = z12 ^ t48;
+  t57 = t50 ^ t53;
+  t58 = z4 ^ t46;
+  t59 = z3 ^ t54;
+  t60 = t46 ^ t57;
+  t61 = z14 ^ t57;
+  t62 = t52 ^ t58;
+  t63 = t49 ^ t58;
+  t64 = z4 ^ t59;
+  t65 = t61 ^ t62;
+  t66 = z1 ^ t63;
+  s0 = t59 ^ t63;
+  s6 = t56 ^ ~t62;
+  s7 = t48 ^ ~t60;
+  t67 = t64 ^ t65;
+  s3 = t53 ^ t66;
+  s4 = t51 ^ t66;
+  s5 = t47 ^ t65;
+  s1 = t64 ^ ~s3;
+  s2 = t55 ^ ~t67;
+
+  q[7] = s0;
+  q[6] = s1;
+  q[5] = s2;
+  q[4] = s3;
+  q[3] = s4;
+  q[2] = s5;
+  q[1] = s6;
+  q[0] = s7;
+}
+
+/* Row 'r' of every column is moved 'r' columns to the left. */
+void AESCtShiftRow(uint64_t q[8]) {
+  uint8_t b;
+  for (b = 0; b < 8; ++b) {
+    uint64_t x = q[b];
+    q[b] = (x & 0x1111111111111111) |
+           ((x >> 4) & 0x0222022202220222) |
+           ((x << 12) & 0x2000200020002000) |
+           ((x >> 8) & 0x0044004400440044) |
+           ((x << 8) & 0x4400440044004400) |
+           ((x >> 12) & 0x0008000800080008) |
+           ((x << 4) & 0x8880888088808880);
+  }
+}
+
+/* Rotates every nibble (column) right, row 'r+n' goes to row 'r'. */
+#define AES_CT_ROT1(x)                                                         \
+  ((((x) >> 1) & 0x7777777777777777) | (((x) << 3) & 0x8888888888888888))
+#define AES_CT_ROT2(x)                                                         \
+  ((((x) >> 2) & 0x3333333333333333) | (((x) << 2) & 0xCCCCCCCCCCCCCCCC))
+
+void AESCtMixCol(uint64_t q[8]) {
+  uint64_t t[8], r[8];
+  uint8_t b;
+
+  for (b = 0; b < 8; ++b) {
+    /* r = a[r+1] ^ a[r+2] ^ a[r+3], t = a[r] ^ a[r+1] */
+    uint64_t r1 = AES_CT_ROT1(q[b]);
+    r[b] = r1 ^ AES_CT_ROT2(q[b] ^ r1);
+    t[b] = q[b] ^ r1;
+  }
+
+  /* a[r] = {02}t ^ r */
+  q[0] = t[7] ^ r[0];
+  q[1] = t[0] ^ t[7] ^ r[1];
+  q[2] = t[1] ^ r[2];
+  q[3] = t[2] ^ t[7] ^ r[3];
+  q[4] = t[3] ^ t[7] ^ r[4];
+  q[5] = t[4] ^ r[5];
+  q[6] = t[5] ^ r[6];
+  q[7] = t[6] ^ r[7];
+}
+
+void AESCtKeyAdd(uint64_t q[8], const uint64_t sk[8]) {
+  uint8_t b;
+  for (b = 0; b < 8; ++b) {
+    q[b] ^= sk[b];
+  }
+}
+
+/* Bitslices all the round keys, replicated for all the blocks. */
+void AESCtRoundKeys(uint64_t sk[AES_MAX_NUM_ROUNDS + 1][8],
+                    const uint8_t subkeys[AES_SUBKEYS_LEN], uint8_t rounds) {
+  uint8_t round, b, k;
+  for (round = 0; round <= rounds; ++round) {
+    for (b = 0; b < 8; ++b) {
+      sk[round][b] = 0;
+    }
+    for (k = 0; k < AES_CT_BLOCKS; ++k) {
+      AESCtPack(sk[round], &subkeys[AES_BLOCK_LEN * round], k);
     }
   }
 }
 
-void AESHashFinish(struct aes_hash_state_t *state_ptr) {
-  uint8_t i = state_ptr->length;
+void AESCtEncrypt(uint64_t q[8], const uint64_t sk[AES_MAX_NUM_ROUNDS + 1][8],
+                  uint8_t rounds) {
+  uint8_t round;
 
-  /* Mark end of data. */
-  state_ptr->plain[i++] = 0x80;
+  AESCtKeyAdd(q, sk[0]);
+  for (round = 1; round < rounds; ++round) {
+    AESCtSbox(q);
+    AESCtShiftRow(q);
+    AESCtMixCol(q);
+    AESCtKeyAdd(q, sk[round]);
+  }
+  AESCtSbox(q);
+  AESCtShiftRow(q);
+  AESCtKeyAdd(q, sk[rounds]);
+}
 
-  /* Fill the block. */
-  for (; i < AES_KEY_LEN; i++)
-    state_ptr->plain[i] = 0x00;
+/* SubWord() of the key expansion with the bitsliced S-box. */
+void AESCtSubword(uint8_t bytes[4]) {
+  uint64_t q[8];
+  uint8_t b, i;
 
-  /* Encrypt. */
-  AES_ECBEncrypt(state_ptr->plain, state_ptr->hash, state_ptr->hash);
+  for (b = 0; b < 8; ++b) {
+    q[b] = 0;
+    for (i = 0; i < 4; ++i) {
+      q[b] |= (uint64_t)((bytes[i] >> b) & 1) << i;
+    }
+  }
+  AESCtSbox(q);
+  for (i = 0; i < 4; ++i) {
+    bytes[i] = 0;
+    for (b = 0; b < 8; ++b) {
+      bytes[i] = (uint8_t)(bytes[i] | (((q[b] >> i) & 1) << b));
+    }
+  }
+}
+
+#if AES_AESNI
+
+/* AES-NI backend.
+ *
+ * Used instead of the portable code when the CPU supports the AES
+ * instructions. The round keys have the same layout as the portable code, so
+ * the contexts can be shared between the backends.
+ */
+
+static int8_t AES_Ni_Supported = -1;
+
+/** AES-NI supported
+ *
+ * Returns 1 if the CPU supports the AES-NI instructions, 0 otherwise. CPUID is
+ * queried only on the first call.
+ */
+uint8_t AESNiSupported(void) {
+  if (AES_Ni_Supported < 0) {
+    unsigned int eax, ebx, ecx, edx;
+    AES_Ni_Supported = 0;
+    if (__get_cpuid(1, &eax, &ebx, &ecx, &edx) && (ecx & bit_AES) != 0 &&
+        (edx & bit_SSE2) != 0) {
+      AES_Ni_Supported = 1;
+    }
+  }
+  return (uint8_t)AES_Ni_Supported;
+}
+
+AES_NI_TARGET
+static void AESNiKeyExpansion(uint8_t subkeys[AES_SUBKEYS_LEN],
+                              const uint8_t *key_ptr, uint8_t key_len) {
+  const uint8_t nk = key_len / 4;
+  uint32_t w[4 * (AES_MAX_NUM_ROUNDS + 1)];
+  uint32_t temp;
+  uint8_t i, k, rcon;
+
+  memcpy(w, key_ptr, key_len);
+
+  /* k = i % nk and rcon = i / nk - 1, counted instead of divided. */
+  k = 0;
+  rcon = 0;
+  for (i = nk; i < 4 * (nk + 7); ++i) {
+    temp = w[i - 1];
+
+    if (k == 0 || (nk > 6 && k == 4)) {
+      /* Dword 0 = SubWord(temp), dword 1 = RotWord(SubWord(temp)) */
+      __m128i x = _mm_aeskeygenassist_si128(
+          _mm_shuffle_epi32(_mm_cvtsi32_si128((int)temp), 0x00), 0x00);
+
+      if (k == 0) {
+        temp = (uint32_t)_mm_cvtsi128_si32(_mm_srli_si128(x, 4)) ^
+               AESRconPoli(rcon++);
+      } else {
+        temp = (uint32_t)_mm_cvtsi128_si32(x);
+      }
+    }
+
+    w[i] = w[i - nk] ^ temp;
+
+    if (++k == nk) {
+      k = 0;
+    }
+  }
+
+  memcpy(subkeys, w, AES_BLOCK_LEN * (nk + 7));
+}
+
+AES_NI_TARGET
+static void AESNiInvKeys(uint8_t inv_subkeys[AES_SUBKEYS_LEN],
+                         const uint8_t subkeys[AES_SUBKEYS_LEN],
+                         uint8_t rounds) {
+  uint8_t round;
+  __m128i k;
+
+  for (round = 0; round <= rounds; ++round) {
+    k = _mm_loadu_si128(
+        (const __m128i *)&subkeys[AES_BLOCK_LEN * (rounds - round)]);
+    if (round > 0 && round < rounds) {
+      k = _mm_aesimc_si128(k);
+    }
+    _mm_storeu_si128((__m128i *)&inv_subkeys[AES_BLOCK_LEN * round], k);
+  }
+}
+
+AES_NI_TARGET
+static void AESNiEncrypt(const uint8_t subkeys[AES_SUBKEYS_LEN], uint8_t rounds,
+                         const uint8_t plain[AES_BLOCK_LEN],
+                         uint8_t cipher[AES_BLOCK_LEN]) {
+  const __m128i *k = (const __m128i *)subkeys;
+  __m128i a = _mm_loadu_si128((const __m128i *)plain);
+  uint8_t round;
+
+  a = _mm_xor_si128(a, _mm_loadu_si128(&k[0]));
+  for (round = 1; round < rounds; ++round) {
+    a = _mm_aesenc_si128(a, _mm_loadu_si128(&k[round]));
+  }
+  a = _mm_aesenclast_si128(a, _mm_loadu_si128(&k[rounds]));
+
+  _mm_storeu_si128((__m128i *)cipher, a);
+}
+
+/* Encrypts 2 independent blocks, interleaved. */
+AES_NI_TARGET
+static void AESNiEncrypt2(const uint8_t subkeys[AES_SUBKEYS_LEN],
+                          uint8_t rounds,
+                          const uint8_t plain[2 * AES_BLOCK_LEN],
+                          uint8_t cipher[2 * AES_BLOCK_LEN]) {
+  const __m128i *k = (const __m128i *)subkeys;
+  __m128i a = _mm_loadu_si128((const __m128i *)&plain[0]);
+  __m128i b = _mm_loadu_si128((const __m128i *)&plain[AES_BLOCK_LEN]);
+  __m128i round_key = _mm_loadu_si128(&k[0]);
+  uint8_t round;
+
+  a = _mm_xor_si128(a, round_key);
+  b = _mm_xor_si128(b, round_key);
+  for (round = 1; round < rounds; ++round) {
+    round_key = _mm_loadu_si128(&k[round]);
+    a = _mm_aesenc_si128(a, round_key);
+    b = _mm_aesenc_si128(b, round_key);
+  }
+  round_key = _mm_loadu_si128(&k[rounds]);
+  a = _mm_aesenclast_si128(a, round_key);
+  b = _mm_aesenclast_si128(b, round_key);
+
+  _mm_storeu_si128((__m128i *)&cipher[0], a);
+  _mm_storeu_si128((__m128i *)&cipher[AES_BLOCK_LEN], b);
+}
+
+/* Decrypts with the inverse context round keys (equivalent inverse cipher). */
+AES_NI_TARGET
+static void AESNiDecrypt(const uint8_t inv_subkeys[AES_SUBKEYS_LEN],
+                         uint8_t rounds, const uint8_t cipher[AES_BLOCK_LEN],
+                         uint8_t plain[AES_BLOCK_LEN]) {
+  const __m128i *k = (const __m128i *)inv_subkeys;
+  __m128i a = _mm_loadu_si128((const __m128i *)cipher);
+  uint8_t round;
+
+  a = _mm_xor_si128(a, _mm_loadu_si128(&k[0]));
+  for (round = 1; round < rounds; ++round) {
+    a = _mm_aesdec_si128(a, _mm_loadu_si128(&k[round]));
+  }
+  a = _mm_aesdeclast_si128(a, _mm_loadu_si128(&k[rounds]));
+
+  _mm_storeu_si128((__m128i *)plain, a);
+}
+
+/* Decrypts with the encryption context round keys, InvMixColumns is applied to
+ * the round keys on the fly.
+ */
+AES_NI_TARGET
+static void AESNiDecryptFwdKeys(const uint8_t subkeys[AES_SUBKEYS_LEN],
+                                uint8_t rounds,
+                                const uint8_t cipher[AES_BLOCK_LEN],
+                                uint8_t plain[AES_BLOCK_LEN]) {
+  const __m128i *k = (const __m128i *)subkeys;
+  __m128i a = _mm_loadu_si128((const __m128i *)cipher);
+  uint8_t round;
+
+  a = _mm_xor_si128(a, _mm_loadu_si128(&k[rounds]));
+  for (round = rounds - 1; round > 0; --round) {
+    a = _mm_aesdec_si128(a, _mm_aesimc_si128(_mm_loadu_si128(&k[round])));
+  }
+  a = _mm_aesdeclast_si128(a, _mm_loadu_si128(&k[0]));
+
+  _mm_storeu_si128((__m128i *)plain, a);
+}
+
+/* Applies one AES-NI instruction with the same round key to 8 blocks. The
+ * blocks are independent, so the instructions are pipelined.
+ */
+#define AES_NI_ROUND8(instr, a, k)                                             \
+  do {                                                                         \
+    const __m128i round_key = (k);                                             \
+    a[0] = instr(a[0], round_key);                                             \
+    a[1] = instr(a[1], round_key);                                             \
+    a[2] = instr(a[2], round_key);                                             \
+    a[3] = instr(a[3], round_key);                                             \
+    a[4] = instr(a[4], round_key);                                             \
+    a[5] = instr(a[5], round_key);                                             \
+    a[6] = instr(a[6], round_key);                                             \
+    a[7] = instr(a[7], round_key);                                             \
+  } while (0)
+
+AES_NI_TARGET
+static void AESNiEncrypt8(const uint8_t subkeys[AES_SUBKEYS_LEN],
+                          uint8_t rounds,
+                          const uint8_t plain[8 * AES_BLOCK_LEN],
+                          uint8_t cipher[8 * AES_BLOCK_LEN]) {
+  const __m128i *k = (const __m128i *)subkeys;
+  __m128i a[8];
+  uint8_t round, j;
+
+  for (j = 0; j < 8; ++j) {
+    a[j] = _mm_loadu_si128((const __m128i *)&plain[AES_BLOCK_LEN * j]);
+  }
+
+  AES_NI_ROUND8(_mm_xor_si128, a, _mm_loadu_si128(&k[0]));
+  for (round = 1; round < rounds; ++round) {
+    AES_NI_ROUND8(_mm_aesenc_si128, a, _mm_loadu_si128(&k[round]));
+  }
+  AES_NI_ROUND8(_mm_aesenclast_si128, a, _mm_loadu_si128(&k[rounds]));
+
+  for (j = 0; j < 8; ++j) {
+    _mm_storeu_si128((__m128i *)&cipher[AES_BLOCK_LEN * j], a[j]);
+  }
+}
+
+AES_NI_TARGET
+static void AESNiDecrypt8(const uint8_t inv_subkeys[AES_SUBKEYS_LEN],
+                          uint8_t rounds,
+                          const uint8_t cipher[8 * AES_BLOCK_LEN],
+                          uint8_t plain[8 * AES_BLOCK_LEN]) {
+  const __m128i *k = (const __m128i *)inv_subkeys;
+  __m128i a[8];
+  uint8_t round, j;
+
+  for (j = 0; j < 8; ++j) {
+    a[j] = _mm_loadu_si128((const __m128i *)&cipher[AES_BLOCK_LEN * j]);
+  }
+
+  AES_NI_ROUND8(_mm_xor_si128, a, _mm_loadu_si128(&k[0]));
+  for (round = 1; round < rounds; ++round) {
+    AES_NI_ROUND8(_mm_aesdec_si128, a, _mm_loadu_si128(&k[round]));
+  }
+  AES_NI_ROUND8(_mm_aesdeclast_si128, a, _mm_loadu_si128(&k[rounds]));
+
+  for (j = 0; j < 8; ++j) {
+    _mm_storeu_si128((__m128i *)&plain[AES_BLOCK_LEN * j], a[j]);
+  }
+}
+
+#endif /* AES_AESNI */
+
+/** AES context initialization
+ *
+ * Expands 'key' (AES_KEY_LEN bytes) once into the context. The context can
+ * then be used to encrypt and decrypt any number of blocks without running the
+ * key expansion again.
+ */
+void AESCtxInit(struct aes_ctx_t *ctx_ptr, const uint8_t key[AES_KEY_LEN]) {
+  AESCtxInitKeyLen(ctx_ptr, key, AES_KEY_LEN);
+}
+
+/* Returns 1 if contexts support keys of 'key_len' bytes, 0 otherwise. */
+uint8_t AESKeyLenValid(uint8_t key_len) {
+  return (key_len == 16 || key_len == 24 || key_len == 32) &&
+         key_len <= AES_MAX_KEY_LEN;
+}
+
+/** AES context initialization with key length
+ *
+ * Same as AESCtxInit(), but the key length is chosen per context: 'key_len'
+ * is 16, 24 or 32 bytes (AES-128, AES-192 or AES-256), up to AES_MAX_KEY_LEN.
+ * Returns 1 on success, 0 if the key length is not supported (the context is
+ * not initialized).
+ */
+uint8_t AESCtxInitKeyLen(struct aes_ctx_t *ctx_ptr, const uint8_t *key_ptr,
+                         uint8_t key_len) {
+  if (!AESKeyLenValid(key_len)) {
+    return 0;
+  }
+  ctx_ptr->rounds = (uint8_t)(key_len / 4 + 6);
+#if AES_AESNI
+  if (AESNiSupported()) {
+    AESNiKeyExpansion(ctx_ptr->subkeys, key_ptr, key_len);
+    return 1;
+  }
+#endif
+  AESKeyExpansion(ctx_ptr->subkeys, key_ptr, key_len);
+  return 1;
+}
+
+/** AES context encrypt
+ *
+ * Encrypts plain-text 'plain' with the context key, outputs cipher-text
+ * to 'cipher'.
+ */
+void AESCtxEncrypt(const struct aes_ctx_t *ctx_ptr,
+                   const uint8_t plain[AES_BLOCK_LEN],
+                   uint8_t cipher[AES_BLOCK_LEN]) {
+#if AES_AESNI
+  if (AESNiSupported()) {
+    AESNiEncrypt(ctx_ptr->subkeys, ctx_ptr->rounds, plain, cipher);
+    return;
+  }
+#endif
+#if AES_FASTER
+  AESTTableEncrypt(ctx_ptr->subkeys, ctx_ptr->rounds, plain, cipher);
+#else
+  AESCompactEncrypt(ctx_ptr->subkeys, ctx_ptr->rounds, plain, cipher);
+#endif
+}
+
+/** AES context decrypt
+ *
+ * Decrypts cipher-text 'cipher' with the context key, outputs plain-text
+ * to 'plain'.
+ */
+void AESCtxDecrypt(const struct aes_ctx_t *ctx_ptr,
+                   const uint8_t cipher[AES_BLOCK_LEN],
+                   uint8_t plain[AES_BLOCK_LEN]) {
+#if AES_AESNI
+  if (AESNiSupported()) {
+    AESNiDecryptFwdKeys(ctx_ptr->subkeys, ctx_ptr->rounds, cipher, plain);
+    return;
+  }
+#endif
+#if AES_FASTER
+  AESTTableDecryptFwdKeys(ctx_ptr->subkeys, ctx_ptr->rounds, cipher, plain);
+#else
+  AESCompactDecryptFwdKeys(ctx_ptr->subkeys, ctx_ptr->rounds, cipher, plain);
+#endif
+}
+
+/** AES inverse context initialization
+ *
+ * Creates the decryption context from the encryption context 'ctx_ptr'. The
+ * round keys are stored in the order they are used by the equivalent inverse
+ * cipher, with InvMixColumns already applied to the middle round keys, so
+ * decryption has the same structure as encryption.
+ */
+void AESInvCtxInit(struct aes_inv_ctx_t *inv_ctx_ptr,
+                   const struct aes_ctx_t *ctx_ptr) {
+  uint8_t round;
+  uint8_t i;
+
+  inv_ctx_ptr->rounds = ctx_ptr->rounds;
+
+#if AES_AESNI
+  if (AESNiSupported()) {
+    AESNiInvKeys(inv_ctx_ptr->subkeys, ctx_ptr->subkeys, ctx_ptr->rounds);
+    return;
+  }
+#endif
+
+  for (round = 0; round <= ctx_ptr->rounds; ++round) {
+    const uint8_t *key =
+        &ctx_ptr->subkeys[AES_BLOCK_LEN * (ctx_ptr->rounds - round)];
+    uint8_t *subkey = &inv_ctx_ptr->subkeys[AES_BLOCK_LEN * round];
+
+    for (i = 0; i < AES_BLOCK_LEN; ++i) {
+      subkey[i] = key[i];
+    }
+    if (round > 0 && round < ctx_ptr->rounds) {
+      AESInvMixCol(subkey);
+    }
+  }
+}
+
+/** AES inverse context decrypt
+ *
+ * Decrypts cipher-text 'cipher' with the inverse context key (equivalent
+ * inverse cipher), outputs plain-text to 'plain'.
+ */
+void AESInvCtxDecrypt(const struct aes_inv_ctx_t *inv_ctx_ptr,
+                      const uint8_t cipher[AES_BLOCK_LEN],
+                      uint8_t plain[AES_BLOCK_LEN]) {
+#if AES_AESNI
+  if (AESNiSupported()) {
+    AESNiDecrypt(inv_ctx_ptr->subkeys, inv_ctx_ptr->rounds, cipher, plain);
+    return;
+  }
+#endif
+#if AES_FASTER
+  AESTTableDecrypt(inv_ctx_ptr->subkeys, inv_ctx_ptr->rounds, cipher, plain);
+#else
+  AESCompactDecrypt(inv_ctx_ptr->subkeys, inv_ctx_ptr->rounds, cipher, plain);
+#endif
+}
+
+/** AES context initialization (constant-time)
+ *
+ * Same as AESCtxInit(), but the key expansion uses the bitsliced S-box, so no
+ * table is indexed with key bytes.
+ */
+void AESCtxInitCt(struct aes_ctx_t *ctx_ptr, const uint8_t key[AES_KEY_LEN]) {
+  AESCtxInitCtKeyLen(ctx_ptr, key, AES_KEY_LEN);
+}
+
+/** AES context initialization with key length (constant-time)
+ *
+ * Same as AESCtxInitKeyLen(), but the key expansion uses the bitsliced S-box.
+ */
+uint8_t AESCtxInitCtKeyLen(struct aes_ctx_t *ctx_ptr, const uint8_t *key_ptr,
+                           uint8_t key_len) {
+  uint8_t *subkeys = ctx_ptr->subkeys;
+  uint8_t nk = key_len / 4;
+  uint8_t temp[4], i, j, k, rcon;
+
+  if (!AESKeyLenValid(key_len)) {
+    return 0;
+  }
+  ctx_ptr->rounds = (uint8_t)(nk + 6);
+
+#if AES_AESNI
+  if (AESNiSupported()) {
+    AESNiKeyExpansion(subkeys, key_ptr, key_len);
+    return 1;
+  }
+#endif
+
+  for (i = 0; i < key_len; ++i) {
+    subkeys[i] = key_ptr[i];
+  }
+
+  k = 0;
+  rcon = 0;
+  for (i = nk; i < 4 * (nk + 7); ++i) {
+    for (j = 0; j < 4; ++j) {
+      temp[j] = subkeys[4 * (i - 1) + j];
+    }
+
+    if (k == 0) {
+      AESRotword(temp);
+      AESCtSubword(temp);
+      AESRcon(temp, rcon++);
+    } else if (nk > 6 && k == 4) {
+      AESCtSubword(temp);
+    }
+
+    for (j = 0; j < 4; ++j) {
+      subkeys[4 * i + j] = subkeys[4 * i + j - key_len] ^ temp[j];
+    }
+
+    if (++k == nk) {
+      k = 0;
+    }
+  }
+  return 1;
+}
+
+/** AES context ECB encrypt (constant-time)
+ *
+ * Encrypts 'length' bytes (multiple of AES_BLOCK_LEN) of plain-text 'plain'
+ * with the context key, outputs cipher-text to 'cipher'. Uses AES-NI if
+ * available, otherwise the bitsliced code that encrypts AES_CT_BLOCKS blocks
+ * at a time.
+ */
+void AESCtxECBEncryptCt(const struct aes_ctx_t *ctx_ptr,
+                        const uint8_t *plain_ptr, uint32_t length,
+                        uint8_t *cipher_ptr) {
+  uint64_t sk[AES_MAX_NUM_ROUNDS + 1][8];
+  uint64_t q[8];
+  uint8_t b, k, num;
+
+#if AES_AESNI
+  if (AESNiSupported()) {
+    for (; length > 0; length -= AES_BLOCK_LEN) {
+      AESNiEncrypt(ctx_ptr->subkeys, ctx_ptr->rounds, plain_ptr, cipher_ptr);
+      plain_ptr += AES_BLOCK_LEN;
+      cipher_ptr += AES_BLOCK_LEN;
+    }
+    return;
+  }
+#endif
+
+  AESCtRoundKeys(sk, ctx_ptr->subkeys, ctx_ptr->rounds);
+
+  while (length > 0) {
+    num = AES_CT_BLOCKS;
+    if (length < AES_CT_BLOCKS * AES_BLOCK_LEN) {
+      num = (uint8_t)(length / AES_BLOCK_LEN);
+    }
+
+    for (b = 0; b < 8; ++b) {
+      q[b] = 0;
+    }
+    for (k = 0; k < num; ++k) {
+      AESCtPack(q, &plain_ptr[AES_BLOCK_LEN * k], k);
+    }
+
+    AESCtEncrypt(q, (const uint64_t(*)[8])sk, ctx_ptr->rounds);
+
+    for (k = 0; k < num; ++k) {
+      AESCtUnpack(&cipher_ptr[AES_BLOCK_LEN * k], q, k);
+    }
+
+    plain_ptr += AES_BLOCK_LEN * num;
+    cipher_ptr += AES_BLOCK_LEN * num;
+    length -= AES_BLOCK_LEN * num;
+  }
+}
+
+/* Increments the 128-bit big-endian counter block. */
+void AESCounterIncrement(uint8_t counter[AES_BLOCK_LEN]) {
+  uint8_t i = AES_BLOCK_LEN;
+  while (i > 0 && ++counter[i - 1] == 0) {
+    --i;
+  }
+}
+
+/** AES context CTR encrypt (constant-time)
+ *
+ * Encrypts (or decrypts) 'length' bytes of 'in' with the context key in
+ * counter mode, outputs to 'out'. The whole 'counter' block is a 128-bit
+ * big-endian counter, on return it is the next unused counter value.
+ *
+ * Uses AES-NI if available, otherwise the bitsliced code that encrypts
+ * AES_CT_BLOCKS counter blocks at a time.
+ */
+void AESCtxCTREncryptCt(const struct aes_ctx_t *ctx_ptr,
+                        uint8_t counter[AES_BLOCK_LEN], const uint8_t *in_ptr,
+                        uint32_t length, uint8_t *out_ptr) {
+  uint64_t sk[AES_MAX_NUM_ROUNDS + 1][8];
+  uint64_t q[8];
+  uint8_t keystream[AES_CT_BLOCKS * AES_BLOCK_LEN];
+  uint8_t b, k, num;
+  uint32_t i, n;
+
+#if AES_AESNI
+  if (!AESNiSupported())
+#endif
+  {
+    AESCtRoundKeys(sk, ctx_ptr->subkeys, ctx_ptr->rounds);
+  }
+
+  while (length > 0) {
+    num = AES_CT_BLOCKS;
+    if (length < AES_CT_BLOCKS * AES_BLOCK_LEN) {
+      num = (uint8_t)((length + AES_BLOCK_LEN - 1) / AES_BLOCK_LEN);
+    }
+
+#if AES_AESNI
+    if (AESNiSupported()) {
+      for (k = 0; k < num; ++k) {
+        AESNiEncrypt(ctx_ptr->subkeys, ctx_ptr->rounds, counter,
+                     &keystream[AES_BLOCK_LEN * k]);
+        AESCounterIncrement(counter);
+      }
+    } else
+#endif
+    {
+      for (b = 0; b < 8; ++b) {
+        q[b] = 0;
+      }
+      for (k = 0; k < num; ++k) {
+        AESCtPack(q, counter, k);
+        AESCounterIncrement(counter);
+      }
+
+      AESCtEncrypt(q, (const uint64_t(*)[8])sk, ctx_ptr->rounds);
+
+      for (k = 0; k < num; ++k) {
+        AESCtUnpack(&keystream[AES_BLOCK_LEN * k], q, k);
+      }
+    }
+
+    n = AES_BLOCK_LEN * num;
+    if (n > length) {
+      n = length;
+    }
+    for (i = 0; i < n; ++i) {
+      out_ptr[i] = in_ptr[i] ^ keystream[i];
+    }
+
+    in_ptr += n;
+    out_ptr += n;
+    length -= n;
+  }
+}
+
+/** AES context ECB encrypt
+ *
+ * Encrypts 'length' bytes (multiple of AES_BLOCK_LEN) of plain-text 'plain'
+ * with the context key, outputs cipher-text to 'cipher'.
+ *
+ * The blocks are independent, with AES-NI 8 blocks are encrypted at a time to
+ * keep the AES unit pipeline full, and the remaining blocks 2 at a time.
+ */
+void AESCtxECBEncrypt(const struct aes_ctx_t *ctx_ptr, const uint8_t *plain_ptr,
+                      uint32_t length, uint8_t *cipher_ptr) {
+#if AES_AESNI
+  if (AESNiSupported()) {
+    for (; length >= 8 * AES_BLOCK_LEN; length -= 8 * AES_BLOCK_LEN) {
+      AESNiEncrypt8(ctx_ptr->subkeys, ctx_ptr->rounds, plain_ptr, cipher_ptr);
+      plain_ptr += 8 * AES_BLOCK_LEN;
+      cipher_ptr += 8 * AES_BLOCK_LEN;
+    }
+    for (; length >= 2 * AES_BLOCK_LEN; length -= 2 * AES_BLOCK_LEN) {
+      AESNiEncrypt2(ctx_ptr->subkeys, ctx_ptr->rounds, plain_ptr, cipher_ptr);
+      plain_ptr += 2 * AES_BLOCK_LEN;
+      cipher_ptr += 2 * AES_BLOCK_LEN;
+    }
+  }
+#endif
+  for (; length > 0; length -= AES_BLOCK_LEN) {
+    AESCtxEncrypt(ctx_ptr, plain_ptr, cipher_ptr);
+    plain_ptr += AES_BLOCK_LEN;
+    cipher_ptr += AES_BLOCK_LEN;
+  }
+}
+
+/** AES inverse context ECB decrypt
+ *
+ * Decrypts 'length' bytes (multiple of AES_BLOCK_LEN) of cipher-text 'cipher'
+ * with the inverse context key, outputs plain-text to 'plain'.
+ *
+ * The blocks are independent, with AES-NI 8 blocks are decrypted at a time to
+ * keep the AES unit pipeline full.
+ */
+void AESInvCtxECBDecrypt(const struct aes_inv_ctx_t *inv_ctx_ptr,
+                         const uint8_t *cipher_ptr, uint32_t length,
+                         uint8_t *plain_ptr) {
+#if AES_AESNI
+  if (AESNiSupported()) {
+    for (; length >= 8 * AES_BLOCK_LEN; length -= 8 * AES_BLOCK_LEN) {
+      AESNiDecrypt8(inv_ctx_ptr->subkeys, inv_ctx_ptr->rounds, cipher_ptr,
+                    plain_ptr);
+      cipher_ptr += 8 * AES_BLOCK_LEN;
+      plain_ptr += 8 * AES_BLOCK_LEN;
+    }
+  }
+#endif
+  for (; length > 0; length -= AES_BLOCK_LEN) {
+    AESInvCtxDecrypt(inv_ctx_ptr, cipher_ptr, plain_ptr);
+    cipher_ptr += AES_BLOCK_LEN;
+    plain_ptr += AES_BLOCK_LEN;
+  }
+}
+
+/* XORs blocks 'a' and 'b', outputs to 'out' (may be the same as 'a'). */
+void AESXorBlock(uint8_t *out_ptr, const uint8_t *a_ptr,
+                 const uint8_t *b_ptr) {
+  uint8_t t[AES_BLOCK_LEN];
+  uint8_t i;
+
+  memcpy(t, a_ptr, AES_BLOCK_LEN);
+  for (i = 0; i < AES_BLOCK_LEN; ++i) {
+    t[i] ^= b_ptr[i];
+  }
+  memcpy(out_ptr, t, AES_BLOCK_LEN);
+}
+
+/** AES context CBC encrypt
+ *
+ * Same as AES_CBCEncrypt(), but with the key already expanded in the context.
+ */
+void AESCtxCBCEncrypt(const struct aes_ctx_t *ctx_ptr,
+                      const uint8_t iv[AES_BLOCK_LEN],
+                      const uint8_t *plain_ptr, uint32_t length,
+                      uint8_t *cipher_ptr) {
+  uint8_t a[AES_BLOCK_LEN];
+  uint8_t i;
+
+  /* A = C[0] = Ek(iv) */
+  AESCtxEncrypt(ctx_ptr, iv, a);
+
+  while (length >= AES_BLOCK_LEN) {
+    /* A = C[i] = Ek(P[i] ^ C[i-1] */
+    for (i = 0; i < AES_BLOCK_LEN; ++i) {
+      a[i] ^= *plain_ptr++;
+    }
+    length -= AES_BLOCK_LEN;
+    AESCtxEncrypt(ctx_ptr, a, a);
+
+    /* cipher = A = C[i] */
+    for (i = 0; i < AES_BLOCK_LEN; ++i) {
+      *cipher_ptr++ = a[i];
+    }
+  }
+}
+
+/** AES context CBC decrypt
+ *
+ * Same as AES_CBCDecrypt(), but with the key already expanded in the context.
+ */
+void AESCtxCBCDecrypt(const struct aes_ctx_t *ctx_ptr,
+                      const uint8_t iv[AES_BLOCK_LEN],
+                      const uint8_t *cipher_ptr, uint32_t length,
+                      uint8_t *plain_ptr) {
+  uint8_t a[AES_BLOCK_LEN];
+  uint8_t b[AES_BLOCK_LEN];
+  uint8_t i;
+
+  /* A = C[0] = Ek(iv) */
+  AESCtxEncrypt(ctx_ptr, iv, a);
+
+  while (length >= AES_BLOCK_LEN) {
+    /* B = Dk(C[i]) */
+    length -= AES_BLOCK_LEN;
+    AESCtxDecrypt(ctx_ptr, cipher_ptr, b);
+
+    /* plain = P[i] = Dk(C[i]) XOR C[i-1] */
+    /* A = C[i] */
+    for (i = 0; i < AES_BLOCK_LEN; ++i) {
+      *plain_ptr++ = b[i] ^ a[i];
+      a[i] = *cipher_ptr++;
+    }
+  }
+}
+
+/** AES inverse context CBC decrypt
+ *
+ * Same as AES_CBCDecrypt(), but with the key already expanded in the contexts.
+ * The encryption context is used only for the initialization vector, the
+ * blocks are decrypted with the inverse context.
+ */
+void AESInvCtxCBCDecrypt(const struct aes_ctx_t *ctx_ptr,
+                         const struct aes_inv_ctx_t *inv_ctx_ptr,
+                         const uint8_t iv[AES_BLOCK_LEN],
+                         const uint8_t *cipher_ptr, uint32_t length,
+                         uint8_t *plain_ptr) {
+  uint8_t a[AES_BLOCK_LEN];
+
+  /* A = C[0] = Ek(iv) */
+  AESCtxEncrypt(ctx_ptr, iv, a);
+
+  AESInvCtxCBCDecryptRange(inv_ctx_ptr, a, cipher_ptr, length, plain_ptr);
+}
+
+#define AES_CBC_BLOCKS 8
+
+/** AES inverse context CBC decrypt range
+ *
+ * Decrypts 'length' bytes (multiple of AES_BLOCK_LEN) of cipher-text 'cipher'
+ * taken from anywhere in a CBC message, outputs plain-text to 'plain'. 'prev'
+ * is the cipher-text block that precedes 'cipher' in the message, or Ek(iv)
+ * (AESCtxEncrypt() of the initialization vector) for the first block.
+ *
+ * A plain-text block depends only on its cipher-text block and the previous
+ * one, so any range of a large message can be decrypted without the rest, and
+ * the blocks are decrypted AES_CBC_BLOCKS at a time with
+ * AESInvCtxECBDecrypt(). 'plain' may be the same buffer as 'cipher'.
+ */
+void AESInvCtxCBCDecryptRange(const struct aes_inv_ctx_t *inv_ctx_ptr,
+                              const uint8_t prev[AES_BLOCK_LEN],
+                              const uint8_t *cipher_ptr, uint32_t length,
+                              uint8_t *plain_ptr) {
+  uint8_t a[AES_BLOCK_LEN];
+  uint8_t b[AES_CBC_BLOCKS * AES_BLOCK_LEN];
+  uint8_t next[AES_BLOCK_LEN];
+  uint32_t n;
+  uint8_t j;
+
+  memcpy(a, prev, AES_BLOCK_LEN);
+
+  while (length >= AES_BLOCK_LEN) {
+    n = AES_CBC_BLOCKS;
+    if (length < AES_CBC_BLOCKS * AES_BLOCK_LEN) {
+      n = length / AES_BLOCK_LEN;
+    }
+
+    /* B[j] = Dk(C[i+j]) */
+    AESInvCtxECBDecrypt(inv_ctx_ptr, cipher_ptr, AES_BLOCK_LEN * n, b);
+    memcpy(next, &cipher_ptr[AES_BLOCK_LEN * (n - 1)], AES_BLOCK_LEN);
+
+    /* P[i+j] = B[j] XOR C[i+j-1], from the last block so that in-place
+     * decryption does not overwrite C[i+j-1] before it is used. */
+    for (j = (uint8_t)(n - 1); j > 0; --j) {
+      AESXorBlock(&plain_ptr[AES_BLOCK_LEN * j], &b[AES_BLOCK_LEN * j],
+                  &cipher_ptr[AES_BLOCK_LEN * (j - 1)]);
+    }
+    AESXorBlock(plain_ptr, b, a);
+
+    /* A = last C */
+    memcpy(a, next, AES_BLOCK_LEN);
+
+    cipher_ptr += AES_BLOCK_LEN * n;
+    plain_ptr += AES_BLOCK_LEN * n;
+    length -= AES_BLOCK_LEN * n;
+  }
+}
+
+/** AES encrypt
+ *
+ * Encrypts plain-text 'plain' with 'key', outputs cipher-text
+ * to 'cipher'.
+ */
+void AES_ECBEncrypt(const uint8_t key[AES_KEY_LEN],
+                    const uint8_t plain[AES_BLOCK_LEN],
+                    uint8_t cipher[AES_BLOCK_LEN]) {
+  struct aes_ctx_t ctx;
+  AESCtxInit(&ctx, key);
+  AESCtxEncrypt(&ctx, plain, cipher);
+}
+
+/** AES decrypt
+ *
+ * Decrypts cipher-text 'cipher' with 'key', outputs plain-text
+ * to 'plain'.
+ */
+void AES_ECBDecrypt(const uint8_t key[AES_KEY_LEN],
+                    const uint8_t cipher[AES_BLOCK_LEN],
+                    uint8_t plain[AES_BLOCK_LEN]) {
+  struct aes_ctx_t ctx;
+  AESCtxInit(&ctx, key);
+  AESCtxDecrypt(&ctx, cipher, plain);
+}
+
+/** AES CBC encrypt
+ *
+ * Encrypts the plain-text 'plain' of size 'length' bytes with 'key'
+ * and initialization vector 'iv', outputs cipher-text to 'cipher'.
+ * 'length' should be a multiple of AES_BLOCK_LEN, a partial last block is
+ * ignored. AESCbcEncrypt() encrypts a stream of any length.
+ *
+ * Note: Encryption and decryption must use the same initialization vector.
+ * The initialization vector should be a nonce (number used once with the key).
+ * It is not a secret and can be transmitted in plain-text.
+ */
+void AES_CBCEncrypt(const uint8_t key[AES_KEY_LEN],
+                    const uint8_t iv[AES_BLOCK_LEN], const uint8_t *plain_ptr,
+                    uint32_t length, uint8_t *cipher_ptr) {
+  struct aes_ctx_t ctx;
+  AESCtxInit(&ctx, key);
+  AESCtxCBCEncrypt(&ctx, iv, plain_ptr, length, cipher_ptr);
+}
+
+/** AES CBC decrypt
+ *
+ * Decrypts the cipher-text 'cipher' of size 'length' bytes with 'key'
+ * and initialization vector 'iv', outputs plain-text to 'plain'.
+ *
+ * Note: Encryption and decryption must use the same initialization vector.
+ * The initialization vector should be a nonce (number used once with the key).
+ * It is not a secret and can be transmitted in plain-text.
+ */
+void AES_CBCDecrypt(const uint8_t key[AES_KEY_LEN],
+                    const uint8_t iv[AES_BLOCK_LEN], const uint8_t *cipher_ptr,
+                    uint32_t length, uint8_t *plain_ptr) {
+  struct aes_ctx_t ctx;
+  struct aes_inv_ctx_t inv_ctx;
+  AESCtxInit(&ctx, key);
+  AESInvCtxInit(&inv_ctx, &ctx);
+  AESInvCtxCBCDecrypt(&ctx, &inv_ctx, iv, cipher_ptr, length, plain_ptr);
+}
+
+/* AES CBC stream.
+ *
+ * CBC encryption and decryption of a message that arrives in pieces of any
+ * length. The context keeps the chaining value and buffers only a partial
+ * block; whole blocks go directly from the input to the output. The message
+ * is the same as with AESCtxCBCEncrypt() (the first chaining value is Ek(iv)).
+ *
+ * With 'padding' the message is padded with PKCS#7 when encrypting and the
+ * padding is checked and removed when decrypting. Without it, the message
+ * length must be a multiple of AES_BLOCK_LEN.
+ *
+ * Encrypt and decrypt return the number of bytes written to the output, which
+ * must have room for 'length' + AES_BLOCK_LEN bytes. The buffered block is
+ * output before the new data, so the output must not overlap the input.
+ *
+ * struct aes_cbc_t cbc;
+ * AESCbcInit(&cbc, key, 16);
+ * AESCbcStart(&cbc, iv, 1);
+ * n = AESCbcEncrypt(&cbc, data1, length1, out);
+ * n = AESCbcEncrypt(&cbc, data2, length2, out);
+ * // ... as much as you want
+ * AESCbcEncryptFinish(&cbc, out, &last_len);
+ *
+ * CBC does not authenticate the data. When decrypting, check a MAC of the
+ * cipher-text before looking at the padding.
+ *
+ */
+
+/** AES-CBC stream init
+ *
+ * Expands the key of 'key_len' bytes (16, 24 or 32) for encryption and
+ * decryption. Returns 1 on success, 0 if the key length is not supported.
+ */
+uint8_t AESCbcInit(struct aes_cbc_t *cbc_ptr, const uint8_t *key_ptr,
+                   uint8_t key_len) {
+  if (!AESCtxInitKeyLen(&cbc_ptr->ctx, key_ptr, key_len)) {
+    return 0;
+  }
+  AESInvCtxInit(&cbc_ptr->inv_ctx, &cbc_ptr->ctx);
+  cbc_ptr->buf_len = 0;
+  cbc_ptr->padding = 0;
+  return 1;
+}
+
+/** AES-CBC stream start
+ *
+ * Starts a message with the initialization vector 'iv', padded with PKCS#7 if
+ * 'padding' is not zero.
+ */
+void AESCbcStart(struct aes_cbc_t *cbc_ptr, const uint8_t iv[AES_BLOCK_LEN],
+                 uint8_t padding) {
+  AESCtxEncrypt(&cbc_ptr->ctx, iv, cbc_ptr->chain);
+  cbc_ptr->buf_len = 0;
+  cbc_ptr->padding = padding != 0;
+}
+
+/* Encrypts 'length' bytes (multiple of AES_BLOCK_LEN), chaining. */
+void AESCbcEncryptBlocks(struct aes_cbc_t *cbc_ptr, const uint8_t *plain_ptr,
+                         uint32_t length, uint8_t *cipher_ptr) {
+  for (; length > 0; length -= AES_BLOCK_LEN) {
+    AESXorBlock(cbc_ptr->chain, cbc_ptr->chain, plain_ptr);
+    AESCtxEncrypt(&cbc_ptr->ctx, cbc_ptr->chain, cbc_ptr->chain);
+    memcpy(cipher_ptr, cbc_ptr->chain, AES_BLOCK_LEN);
+    plain_ptr += AES_BLOCK_LEN;
+    cipher_ptr += AES_BLOCK_LEN;
+  }
+}
+
+/* Decrypts 'length' bytes (multiple of AES_BLOCK_LEN), chaining. */
+void AESCbcDecryptBlocks(struct aes_cbc_t *cbc_ptr, const uint8_t *cipher_ptr,
+                         uint32_t length, uint8_t *plain_ptr) {
+  uint8_t next[AES_BLOCK_LEN];
+
+  memcpy(next, &cipher_ptr[length - AES_BLOCK_LEN], AES_BLOCK_LEN);
+  AESInvCtxCBCDecryptRange(&cbc_ptr->inv_ctx, cbc_ptr->chain, cipher_ptr,
+                           length, plain_ptr);
+  memcpy(cbc_ptr->chain, next, AES_BLOCK_LEN);
+}
+
+/* Appends up to a block of 'data' to the buffer. Returns the bytes used. */
+uint8_t AESCbcBuffer(struct aes_cbc_t *cbc_ptr, const uint8_t *data_ptr,
+                     uint32_t length) {
+  uint8_t n = AES_BLOCK_LEN - cbc_ptr->buf_len;
+
+  if (n > length) {
+    n = (uint8_t)length;
+  }
+  memcpy(&cbc_ptr->buf[cbc_ptr->buf_len], data_ptr, n);
+  cbc_ptr->buf_len += n;
+  return n;
+}
+
+/** AES-CBC stream encrypt
+ *
+ * Encrypts 'length' bytes of 'plain', outputs the whole cipher-text blocks to
+ * 'cipher'. Returns the number of bytes written to 'cipher'.
+ */
+uint32_t AESCbcEncrypt(struct aes_cbc_t *cbc_ptr, const uint8_t *plain_ptr,
+                       uint32_t length, uint8_t *cipher_ptr) {
+  uint32_t out_len = 0;
+  uint32_t n;
+
+  if (cbc_ptr->buf_len > 0) {
+    n = AESCbcBuffer(cbc_ptr, plain_ptr, length);
+    plain_ptr += n;
+    length -= n;
+    if (cbc_ptr->buf_len < AES_BLOCK_LEN) {
+      return 0;
+    }
+    AESCbcEncryptBlocks(cbc_ptr, cbc_ptr->buf, AES_BLOCK_LEN, cipher_ptr);
+    cbc_ptr->buf_len = 0;
+    cipher_ptr += AES_BLOCK_LEN;
+    out_len += AES_BLOCK_LEN;
+  }
+
+  n = length - length % AES_BLOCK_LEN;
+  AESCbcEncryptBlocks(cbc_ptr, plain_ptr, n, cipher_ptr);
+  out_len += n;
+
+  AESCbcBuffer(cbc_ptr, &plain_ptr[n], length - n);
+  return out_len;
+}
+
+/** AES-CBC stream encrypt finish
+ *
+ * Ends the message. With padding, outputs the last block to 'cipher' and
+ * sets 'length' to AES_BLOCK_LEN, otherwise sets 'length' to 0. Returns 1 on
+ * success, 0 if the message has no padding and its length is not a multiple
+ * of AES_BLOCK_LEN.
+ */
+uint8_t AESCbcEncryptFinish(struct aes_cbc_t *cbc_ptr,
+                            uint8_t cipher[AES_BLOCK_LEN],
+                            uint8_t *length_ptr) {
+  uint8_t pad = AES_BLOCK_LEN - cbc_ptr->buf_len;
+
+  *length_ptr = 0;
+  if (!cbc_ptr->padding) {
+    return cbc_ptr->buf_len == 0;
+  }
+
+  memset(&cbc_ptr->buf[cbc_ptr->buf_len], pad, pad);
+  AESCbcEncryptBlocks(cbc_ptr, cbc_ptr->buf, AES_BLOCK_LEN, cipher);
+  cbc_ptr->buf_len = 0;
+  *length_ptr = AES_BLOCK_LEN;
+  return 1;
+}
+
+/** AES-CBC stream decrypt
+ *
+ * Decrypts 'length' bytes of 'cipher', outputs plain-text to 'plain'. Returns
+ * the number of bytes written to 'plain'. With padding, the last block is
+ * kept until AESCbcDecryptFinish(). Whole blocks are decrypted
+ * AES_CBC_BLOCKS at a time.
+ */
+uint32_t AESCbcDecrypt(struct aes_cbc_t *cbc_ptr, const uint8_t *cipher_ptr,
+                       uint32_t length, uint8_t *plain_ptr) {
+  uint32_t out_len = 0;
+  uint32_t n;
+
+  while (length > 0) {
+    if (cbc_ptr->buf_len == AES_BLOCK_LEN) {
+      AESCbcDecryptBlocks(cbc_ptr, cbc_ptr->buf, AES_BLOCK_LEN, plain_ptr);
+      cbc_ptr->buf_len = 0;
+      plain_ptr += AES_BLOCK_LEN;
+      out_len += AES_BLOCK_LEN;
+    }
+
+    if (cbc_ptr->buf_len == 0) {
+      n = length - length % AES_BLOCK_LEN;
+      if (n == length && cbc_ptr->padding) {
+        n -= AES_BLOCK_LEN;
+      }
+      if (n > 0) {
+        AESCbcDecryptBlocks(cbc_ptr, cipher_ptr, n, plain_ptr);
+        cipher_ptr += n;
+        plain_ptr += n;
+        length -= n;
+        out_len += n;
+      }
+    }
+
+    n = AESCbcBuffer(cbc_ptr, cipher_ptr, length);
+    cipher_ptr += n;
+    length -= n;
+  }
+
+  return out_len;
+}
+
+/** AES-CBC stream decrypt finish
+ *
+ * Ends the message. Outputs the last block to 'plain' and sets 'length' to
+ * the number of bytes of it that are plain-text (the padding is removed).
+ * Returns 1 on success, 0 if the cipher-text length is not a multiple of
+ * AES_BLOCK_LEN or the padding is not valid. The padding is checked in
+ * constant time.
+ */
+uint8_t AESCbcDecryptFinish(struct aes_cbc_t *cbc_ptr,
+                            uint8_t plain[AES_BLOCK_LEN],
+                            uint8_t *length_ptr) {
+  uint8_t pad, i, diff;
+
+  *length_ptr = 0;
+  if (cbc_ptr->buf_len == 0 && !cbc_ptr->padding) {
+    return 1;
+  }
+  if (cbc_ptr->buf_len != AES_BLOCK_LEN) {
+    return 0;
+  }
+
+  AESCbcDecryptBlocks(cbc_ptr, cbc_ptr->buf, AES_BLOCK_LEN, plain);
+  cbc_ptr->buf_len = 0;
+  if (!cbc_ptr->padding) {
+    *length_ptr = AES_BLOCK_LEN;
+    return 1;
+  }
+
+  /* The last 'pad' bytes must be equal to 'pad', 1 to 16. The masks are 0xFF
+   * when the subtraction borrows. */
+  pad = plain[AES_BLOCK_LEN - 1];
+  diff = (uint8_t)(((uint16_t)pad - 1) >> 8);
+  diff |= (uint8_t)(((uint16_t)AES_BLOCK_LEN - pad) >> 8);
+  for (i = 0; i < AES_BLOCK_LEN; ++i) {
+    diff |= (plain[i] ^ pad) &
+            (uint8_t)(((uint16_t)(AES_BLOCK_LEN - 1 - i) - pad) >> 8);
+  }
+
+  if (diff != 0) {
+    return 0;
+  }
+  *length_ptr = AES_BLOCK_LEN - pad;
+  return 1;
+}
+
+/* AES CTR.
+ *
+ * Counter mode. The counter is the last 'counter_len' bytes (1 to 16) of the
+ * counter block, big-endian, the other bytes are a nonce. The counter wraps
+ * without changing the nonce. AESCtrInit() returns 0 if the key length or the
+ * counter length is not supported.
+ *
+ * Encryption and decryption are the same operation and can be done in pieces
+ * of any length. AESCtrSeek() moves to any byte offset of the key stream.
+ *
+ * The key stream is generated AES_CTR_BLOCKS blocks at a time, encrypted with
+ * AESCtxECBEncrypt(), so the backend can pipeline the blocks.
+ *
+ * struct aes_ctr_t ctr;
+ * AESCtrInit(&ctr, key, 16, iv, 4);
+ * AESCtrEncrypt(&ctr, data1, length1, data1);
+ * AESCtrEncrypt(&ctr, data2, length2, data2);
+ * // ... as much as you want
+ *
+ */
+
+#define AES_CTR_BLOCKS 8
+
+/* Increments the counter (last 'counter_len' bytes) of 'block'. */
+void AESCtrIncrement(uint8_t block[AES_BLOCK_LEN], uint8_t counter_len) {
+  uint8_t i = AES_BLOCK_LEN;
+  while (i > AES_BLOCK_LEN - counter_len && ++block[i - 1] == 0) {
+    --i;
+  }
+}
+
+/* Adds 'x' to the counter (last 'counter_len' bytes) of 'block'. */
+void AESCtrAdd(uint8_t block[AES_BLOCK_LEN], uint8_t counter_len, uint64_t x) {
+  uint8_t i;
+  uint16_t carry = 0;
+
+  for (i = AES_BLOCK_LEN; i > AES_BLOCK_LEN - counter_len && (carry | x) != 0;
+       --i) {
+    carry = (uint16_t)(carry + block[i - 1] + (uint8_t)x);
+    block[i - 1] = (uint8_t)carry;
+    carry >>= 8;
+    x >>= 8;
+  }
+}
+
+uint8_t AESCtrInit(struct aes_ctr_t *ctr_ptr, const uint8_t *key_ptr,
+                   uint8_t key_len, const uint8_t iv[AES_BLOCK_LEN],
+                   uint8_t counter_len) {
+  uint8_t i;
+
+  if (counter_len == 0 || counter_len > AES_BLOCK_LEN ||
+      !AESCtxInitKeyLen(&ctr_ptr->ctx, key_ptr, key_len)) {
+    return 0;
+  }
+
+  for (i = 0; i < AES_BLOCK_LEN; ++i) {
+    ctr_ptr->iv[i] = iv[i];
+    ctr_ptr->counter[i] = iv[i];
+  }
+  ctr_ptr->counter_len = counter_len;
+  ctr_ptr->used = AES_BLOCK_LEN;
+  return 1;
+}
+
+void AESCtrSeek(struct aes_ctr_t *ctr_ptr, uint64_t offset) {
+  uint8_t i;
+
+  for (i = 0; i < AES_BLOCK_LEN; ++i) {
+    ctr_ptr->counter[i] = ctr_ptr->iv[i];
+  }
+  AESCtrAdd(ctr_ptr->counter, ctr_ptr->counter_len, offset / AES_BLOCK_LEN);
+  ctr_ptr->used = AES_BLOCK_LEN;
+
+  /* Inside a block, generate it and skip the used bytes. */
+  if (offset % AES_BLOCK_LEN != 0) {
+    AESCtxEncrypt(&ctr_ptr->ctx, ctr_ptr->counter, ctr_ptr->keystream);
+    AESCtrIncrement(ctr_ptr->counter, ctr_ptr->counter_len);
+    ctr_ptr->used = (uint8_t)(offset % AES_BLOCK_LEN);
+  }
+}
+
+void AESCtrEncrypt(struct aes_ctr_t *ctr_ptr, const uint8_t *in_ptr,
+                   uint32_t length, uint8_t *out_ptr) {
+  uint8_t keystream[AES_CTR_BLOCKS * AES_BLOCK_LEN];
+  uint32_t i, n;
+
+  /* Use what is left of the last key stream block. */
+  while (length > 0 && ctr_ptr->used < AES_BLOCK_LEN) {
+    *out_ptr++ = *in_ptr++ ^ ctr_ptr->keystream[ctr_ptr->used++];
+    --length;
+  }
+
+  /* Many blocks at a time. */
+  while (length >= AES_BLOCK_LEN) {
+    n = AES_CTR_BLOCKS;
+    if (length < AES_CTR_BLOCKS * AES_BLOCK_LEN) {
+      n = length / AES_BLOCK_LEN;
+    }
+
+    /* Counter blocks are independent of each other, so the byte stores do
+     * not stall the following block loads in a chain. */
+    for (i = 0; i < n; ++i) {
+      memcpy(&keystream[AES_BLOCK_LEN * i], ctr_ptr->counter, AES_BLOCK_LEN);
+      AESCtrAdd(&keystream[AES_BLOCK_LEN * i], ctr_ptr->counter_len, i);
+    }
+    AESCtrAdd(ctr_ptr->counter, ctr_ptr->counter_len, n);
+    n *= AES_BLOCK_LEN;
+    AESCtxECBEncrypt(&ctr_ptr->ctx, keystream, n, keystream);
+
+    for (i = 0; i < n; i += AES_BLOCK_LEN) {
+      AESXorBlock(&out_ptr[i], &in_ptr[i], &keystream[i]);
+    }
+    in_ptr += n;
+    out_ptr += n;
+    length -= n;
+  }
+
+  /* Partial last block, keep the rest of the key stream for the next call. */
+  if (length > 0) {
+    AESCtxEncrypt(&ctr_ptr->ctx, ctr_ptr->counter, ctr_ptr->keystream);
+    AESCtrIncrement(ctr_ptr->counter, ctr_ptr->counter_len);
+    ctr_ptr->used = 0;
+    while (length > 0) {
+      *out_ptr++ = *in_ptr++ ^ ctr_ptr->keystream[ctr_ptr->used++];
+      --length;
+    }
+  }
+}
+
+void AESCtrDecrypt(struct aes_ctr_t *ctr_ptr, const uint8_t *in_ptr,
+                   uint32_t length, uint8_t *out_ptr) {
+  AESCtrEncrypt(ctr_ptr, in_ptr, length, out_ptr);
+}
+
+/* AES HASH.
+ *
+ * Length padding.
+ * Merkle-Damgard construction: Length extension attack is possible.
+ *
+ * If you want to be REALLY SURE your EEPROM data is not corrupted, this makes
+ * a very strong CRC. Much slower than a normal CRC though.
+ *
+ * If you want a MAC (message authentication code) on serial that is strong
+ * against replay attacks, use a NONCE initialization vector (number used only
+ * once, random or incremental) and encrypt the hash with the MAC key.
+ * This way there is no length extension attack and no replay attack.
+ *
+ * struct aes_hash_state_t state_ptr;
+ * aes_hash_init(&state_ptr);
+ * aes_hash_update(&state_ptr, data1, length1);
+ * aes_hash_update(&state_ptr, data2, length2);
+ * // ... as much as you want
+ * aes_hash_finish(&state_ptr);
+ * // Hash in state_ptr.hash
+ *
+ */
+
+void AESHashInit(struct aes_hash_state_t *state_ptr) {
+  uint8_t i;
+  for (i = 0; i < AES_BLOCK_LEN; ++i)
+    state_ptr->hash[i] = 0x00;
+  state_ptr->length = 0;
+}
+
+void AESHashInitIv(struct aes_hash_state_t *state_ptr,
+                   const uint8_t iv[AES_BLOCK_LEN]) {
+  uint8_t i;
+  for (i = 0; i < AES_BLOCK_LEN; ++i)
+    state_ptr->hash[i] = iv[i];
+  state_ptr->length = 0;
+}
+
+void AESHashUpdate(struct aes_hash_state_t *state_ptr, const uint8_t *plain_ptr,
+                   uint32_t length) {
+  uint8_t i;
+
+  while (length > 0) {
+    /* Try to fill one plain block. */
+    for (i = state_ptr->length; i < AES_KEY_LEN && length > 0; i++, length--)
+      state_ptr->plain[i] = *plain_ptr++;
+
+    if (i >= AES_KEY_LEN) {
+      /* Block filled. Encrypt. */
+      AES_ECBEncrypt(state_ptr->plain, state_ptr->hash, state_ptr->hash);
+      state_ptr->length = 0;
+    } else {
+      state_ptr->length = i;
+    }
+  }
+}
+
+void AESHashFinish(struct aes_hash_state_t *state_ptr) {
+  uint8_t i = state_ptr->length;
+
+  /* Mark end of data. */
+  state_ptr->plain[i++] = 0x80;
+
+  /* Fill the block. */
+  for (; i < AES_KEY_LEN; i++)
+    state_ptr->plain[i] = 0x00;
+
+  /* Encrypt. */
+  AES_ECBEncrypt(state_ptr->plain, state_ptr->hash, state_ptr->hash);
+}
+
+/* AES CMAC.
+ *
+ * Message authentication code (NIST SP 800-38B, RFC 4493). A CBC-MAC where
+ * the last block is XORed with a subkey derived from the key, so messages of
+ * any length are secure.
+ *
+ * Unlike AES HASH, the key is expanded only once by AESCmacInit(), every
+ * message then needs only AESCmacStart().
+ *
+ * struct aes_cmac_t cmac;
+ * AESCmacInit(&cmac, key, 16);
+ * AESCmacStart(&cmac);
+ * AESCmacUpdate(&cmac, data1, length1);
+ * AESCmacUpdate(&cmac, data2, length2);
+ * // ... as much as you want
+ * AESCmacFinish(&cmac, tag);
+ *
+ * To check a received message call AESCmacVerify() instead of
+ * AESCmacFinish().
+ *
+ */
+
+/* Multiplies 'a' by x in GF(2^128), big-endian, outputs to 'out'. */
+void AESCmacDouble(uint8_t out[AES_BLOCK_LEN], const uint8_t a[AES_BLOCK_LEN]) {
+  uint8_t carry = a[0] >> 7;
+  uint8_t i;
+
+  for (i = 0; i < AES_BLOCK_LEN - 1; ++i) {
+    out[i] = (uint8_t)((a[i] << 1) | (a[i + 1] >> 7));
+  }
+  out[AES_BLOCK_LEN - 1] =
+      (uint8_t)((a[AES_BLOCK_LEN - 1] << 1) ^ (carry * 0x87));
+}
+
+/** AES-CMAC init
+ *
+ * Expands the key of 'key_len' bytes (16, 24 or 32) and computes the subkeys.
+ * Starts a message. Returns 1 on success, 0 if the key length is not
+ * supported.
+ */
+uint8_t AESCmacInit(struct aes_cmac_t *cmac_ptr, const uint8_t *key_ptr,
+                    uint8_t key_len) {
+  uint8_t l[AES_BLOCK_LEN];
+
+  if (!AESCtxInitKeyLen(&cmac_ptr->ctx, key_ptr, key_len)) {
+    return 0;
+  }
+
+  memset(l, 0, AES_BLOCK_LEN);
+  AESCtxEncrypt(&cmac_ptr->ctx, l, l);
+  AESCmacDouble(cmac_ptr->k1, l);
+  AESCmacDouble(cmac_ptr->k2, cmac_ptr->k1);
+
+  AESCmacStart(cmac_ptr);
+  return 1;
+}
+
+/** AES-CMAC start
+ *
+ * Starts a new message with the same key.
+ */
+void AESCmacStart(struct aes_cmac_t *cmac_ptr) {
+  memset(cmac_ptr->x, 0, AES_BLOCK_LEN);
+  cmac_ptr->buf_len = 0;
+}
+
+/* CBC-MAC of one block. */
+void AESCmacBlock(struct aes_cmac_t *cmac_ptr, const uint8_t *block_ptr) {
+  AESXorBlock(cmac_ptr->x, cmac_ptr->x, block_ptr);
+  AESCtxEncrypt(&cmac_ptr->ctx, cmac_ptr->x, cmac_ptr->x);
+}
+
+/** AES-CMAC update
+ *
+ * Authenticates 'length' bytes of 'data'. Can be called many times, with any
+ * length.
+ */
+void AESCmacUpdate(struct aes_cmac_t *cmac_ptr, const uint8_t *data_ptr,
+                   uint32_t length) {
+  uint8_t n;
+
+  /* The last block is kept in the buffer until the message is finished. */
+  while (length > 0) {
+    if (cmac_ptr->buf_len == AES_BLOCK_LEN) {
+      AESCmacBlock(cmac_ptr, cmac_ptr->buf);
+      cmac_ptr->buf_len = 0;
+    }
+
+    if (cmac_ptr->buf_len == 0) {
+      for (; length > AES_BLOCK_LEN; length -= AES_BLOCK_LEN) {
+        AESCmacBlock(cmac_ptr, data_ptr);
+        data_ptr += AES_BLOCK_LEN;
+      }
+    }
+
+    n = AES_BLOCK_LEN - cmac_ptr->buf_len;
+    if (n > length) {
+      n = (uint8_t)length;
+    }
+    memcpy(&cmac_ptr->buf[cmac_ptr->buf_len], data_ptr, n);
+    cmac_ptr->buf_len += n;
+    data_ptr += n;
+    length -= n;
+  }
+}
+
+/** AES-CMAC finish
+ *
+ * Outputs the authentication tag of the message to 'tag'.
+ */
+void AESCmacFinish(struct aes_cmac_t *cmac_ptr,
+                   uint8_t tag[AES_CMAC_TAG_LEN]) {
+  uint8_t i = cmac_ptr->buf_len;
+
+  if (i == AES_BLOCK_LEN) {
+    AESXorBlock(cmac_ptr->buf, cmac_ptr->buf, cmac_ptr->k1);
+  } else {
+    /* Mark end of data and fill the block. */
+    cmac_ptr->buf[i++] = 0x80;
+    for (; i < AES_BLOCK_LEN; ++i) {
+      cmac_ptr->buf[i] = 0x00;
+    }
+    AESXorBlock(cmac_ptr->buf, cmac_ptr->buf, cmac_ptr->k2);
+  }
+
+  AESCmacBlock(cmac_ptr, cmac_ptr->buf);
+  memcpy(tag, cmac_ptr->x, AES_CMAC_TAG_LEN);
+}
+
+/** AES-CMAC verify
+ *
+ * Returns 1 if the first 'tag_len' bytes (AES_CMAC_MIN_TAG_LEN to 16) of the
+ * tag of the message are equal to 'tag', 0 otherwise. Shorter tags are always
+ * rejected. Compares in constant time.
+ */
+uint8_t AESCmacVerify(struct aes_cmac_t *cmac_ptr, const uint8_t *tag_ptr,
+                      uint8_t tag_len) {
+  uint8_t tag[AES_CMAC_TAG_LEN];
+  uint8_t i, diff = 0;
+
+  if (tag_len < AES_CMAC_MIN_TAG_LEN || tag_len > AES_CMAC_TAG_LEN) {
+    return 0;
+  }
+
+  AESCmacFinish(cmac_ptr, tag);
+
+  for (i = 0; i < tag_len; ++i) {
+    diff |= tag[i] ^ tag_ptr[i];
+  }
+  return diff == 0;
+}
+
+/* AES MMO.
+ *
+ * Integrity hash with a fixed key, a replacement for AES HASH. Each block of
+ * data is XORed into the hash, encrypted and XORed with the data again
+ * (Matyas-Meyer-Oseas with the chaining value moved from the key to the
+ * input):
+ *
+ * hash = E(key, hash ^ block) ^ block
+ *
+ * The key is expanded only once, so it runs at the speed of CBC encryption
+ * instead of one key expansion per block. Any constant key can be used, all
+ * zeros for example. Padding is 0x80 and zeros, as AES HASH.
+ *
+ * This is a strong CRC to detect corrupted EEPROM or flash data. With a
+ * 128-bit hash and a fixed permutation it is NOT collision resistant against
+ * an attacker: use AES CMAC with a secret key to authenticate data.
+ *
+ * struct aes_mmo_t mmo;
+ * AESMmoInit(&mmo, key, 16);
+ * AESMmoUpdate(&mmo, data1, length1);
+ * AESMmoUpdate(&mmo, data2, length2);
+ * // ... as much as you want
+ * AESMmoFinish(&mmo);
+ * // Hash in mmo.hash
+ * AESMmoStart(&mmo);
+ * // ... next hash
+ *
+ */
+
+/** AES-MMO init
+ *
+ * Expands the key of 'key_len' bytes (16, 24 or 32) and starts a hash.
+ * Returns 1 on success, 0 if the key length is not supported.
+ */
+uint8_t AESMmoInit(struct aes_mmo_t *mmo_ptr, const uint8_t *key_ptr,
+                   uint8_t key_len) {
+  if (!AESCtxInitKeyLen(&mmo_ptr->ctx, key_ptr, key_len)) {
+    return 0;
+  }
+  AESMmoStart(mmo_ptr);
+  return 1;
+}
+
+/** AES-MMO start
+ *
+ * Starts a new hash with the same key, the initial hash value is zero.
+ */
+void AESMmoStart(struct aes_mmo_t *mmo_ptr) {
+  memset(mmo_ptr->hash, 0, AES_BLOCK_LEN);
+  mmo_ptr->buf_len = 0;
+}
+
+/** AES-MMO start with IV
+ *
+ * Starts a new hash with the same key, the initial hash value is 'iv'.
+ */
+void AESMmoStartIv(struct aes_mmo_t *mmo_ptr, const uint8_t iv[AES_BLOCK_LEN]) {
+  memcpy(mmo_ptr->hash, iv, AES_BLOCK_LEN);
+  mmo_ptr->buf_len = 0;
+}
+
+/* Compresses one block into the hash. */
+void AESMmoBlock(struct aes_mmo_t *mmo_ptr, const uint8_t *block_ptr) {
+  AESXorBlock(mmo_ptr->hash, mmo_ptr->hash, block_ptr);
+  AESCtxEncrypt(&mmo_ptr->ctx, mmo_ptr->hash, mmo_ptr->hash);
+  AESXorBlock(mmo_ptr->hash, mmo_ptr->hash, block_ptr);
+}
+
+/** AES-MMO update
+ *
+ * Hashes 'length' bytes of 'data'. Can be called many times, with any length.
+ */
+void AESMmoUpdate(struct aes_mmo_t *mmo_ptr, const uint8_t *data_ptr,
+                  uint32_t length) {
+  uint8_t n;
+
+  if (mmo_ptr->buf_len > 0) {
+    n = AES_BLOCK_LEN - mmo_ptr->buf_len;
+    if (n > length) {
+      n = (uint8_t)length;
+    }
+    memcpy(&mmo_ptr->buf[mmo_ptr->buf_len], data_ptr, n);
+    mmo_ptr->buf_len += n;
+    data_ptr += n;
+    length -= n;
+
+    if (mmo_ptr->buf_len < AES_BLOCK_LEN) {
+      return;
+    }
+    AESMmoBlock(mmo_ptr, mmo_ptr->buf);
+    mmo_ptr->buf_len = 0;
+  }
+
+  for (; length >= AES_BLOCK_LEN; length -= AES_BLOCK_LEN) {
+    AESMmoBlock(mmo_ptr, data_ptr);
+    data_ptr += AES_BLOCK_LEN;
+  }
+
+  memcpy(mmo_ptr->buf, data_ptr, length);
+  mmo_ptr->buf_len = (uint8_t)length;
+}
+
+/** AES-MMO finish
+ *
+ * Pads and hashes the last block. The hash is in mmo.hash.
+ */
+void AESMmoFinish(struct aes_mmo_t *mmo_ptr) {
+  uint8_t i = mmo_ptr->buf_len;
+
+  /* Mark end of data. */
+  mmo_ptr->buf[i++] = 0x80;
+
+  /* Fill the block. */
+  for (; i < AES_BLOCK_LEN; ++i) {
+    mmo_ptr->buf[i] = 0x00;
+  }
+
+  AESMmoBlock(mmo_ptr, mmo_ptr->buf);
+  mmo_ptr->buf_len = 0;
 }
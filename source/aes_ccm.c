@@ -0,0 +1,353 @@
+/*
+ AES-CCM authenticated encryption.
+
+ Copyright 2021 Djones A. Boni
+
+ Licensed under the Apache License, Version 2.0 (the "License");
+ you may not use this file except in compliance with the License.
+ You may obtain a copy of the License at
+
+ http://www.apache.org/licenses/LICENSE-2.0
+
+ Unless required by applicable law or agreed to in writing, software
+ distributed under the License is distributed on an "AS IS" BASIS,
+ WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ See the License for the specific language governing permissions and
+ limitations under the License.
+*/
+
+#include "aes_ccm.h"
+#include <string.h>
+
+/* AES CCM.
+ *
+ * Counter with CBC-MAC (NIST SP 800-38C, RFC 3610). The plain-text is
+ * authenticated with CBC-MAC and encrypted in counter mode, both with the
+ * same key and only the forward cipher, so no inverse context is needed.
+ *
+ * The CBC-MAC of a data block and the key stream of the next block are
+ * independent: they are encrypted together with one AESCtxECBEncrypt() of 2
+ * blocks, which the AES-NI backend interleaves.
+ *
+ * The lengths of the associated data and of the data must be known when the
+ * message starts. The nonce has 7 to 13 bytes, the length field has the other
+ * 15 - nonce_len bytes (a 13-byte nonce allows 64 KiB messages). The tag has
+ * 4, 6, 8, 10, 12, 14 or 16 bytes. Never repeat a nonce with the same key.
+ * Data beyond the lengths given at the start is rejected, so the counter never
+ * wraps to the block that encrypts the tag.
+ *
+ * struct aes_ccm_t ccm;
+ * AESCcmInit(&ccm, key, 16);
+ * AESCcmStart(&ccm, nonce, 13, header_length, data_length, 8);
+ * AESCcmAad(&ccm, header, header_length);
+ * AESCcmEncrypt(&ccm, data1, length1, data1);
+ * AESCcmEncrypt(&ccm, data2, length2, data2);
+ * // ... until data_length bytes
+ * AESCcmFinish(&ccm, tag);
+ *
+ * To decrypt, call AESCcmDecrypt() and then AESCcmVerify() with the received
+ * tag. Discard the plain-text if the tag is not valid.
+ *
+ */
+
+enum aes_ccm_phase_t { AES_CCM_PHASE_AAD = 0, AES_CCM_PHASE_DATA = 1 };
+
+/* Increments the counter (last 'len_len' bytes) of the counter block. */
+void AESCcmIncrement(uint8_t ctr[AES_BLOCK_LEN], uint8_t len_len) {
+  uint8_t i = AES_BLOCK_LEN;
+  while (i > AES_BLOCK_LEN - len_len && ++ctr[i - 1] == 0) {
+    --i;
+  }
+}
+
+/* Writes 'x' big-endian in 'len' bytes. */
+void AESCcmStoreLen(uint8_t *ptr, uint8_t len, uint64_t x) {
+  for (; len > 0; --len) {
+    ptr[len - 1] = (uint8_t)x;
+    x >>= 8;
+  }
+}
+
+/* CBC-MAC of the buffer block. */
+void AESCcmMacBlock(struct aes_ccm_t *ccm_ptr) {
+  AESXorBlock(ccm_ptr->x, ccm_ptr->x, ccm_ptr->buf);
+  AESCtxEncrypt(&ccm_ptr->ctx, ccm_ptr->x, ccm_ptr->x);
+  ccm_ptr->buf_len = 0;
+}
+
+/* CBC-MAC of the buffer block and key stream of the next counter block, with
+ * one call to encrypt both. */
+void AESCcmMacBlockKeystream(struct aes_ccm_t *ccm_ptr) {
+  uint8_t b[2 * AES_BLOCK_LEN];
+
+  AESXorBlock(b, ccm_ptr->x, ccm_ptr->buf);
+  memcpy(&b[AES_BLOCK_LEN], ccm_ptr->ctr, AES_BLOCK_LEN);
+
+  AESCtxECBEncrypt(&ccm_ptr->ctx, b, 2 * AES_BLOCK_LEN, b);
+
+  memcpy(ccm_ptr->x, b, AES_BLOCK_LEN);
+  memcpy(ccm_ptr->keystream, &b[AES_BLOCK_LEN], AES_BLOCK_LEN);
+  AESCcmIncrement(ccm_ptr->ctr, ccm_ptr->len_len);
+  ccm_ptr->buf_len = 0;
+}
+
+/* Pads the partial block with zeros. */
+void AESCcmPad(struct aes_ccm_t *ccm_ptr) {
+  memset(&ccm_ptr->buf[ccm_ptr->buf_len], 0, AES_BLOCK_LEN - ccm_ptr->buf_len);
+  ccm_ptr->buf_len = AES_BLOCK_LEN;
+}
+
+/* Ends the associated data, which is padded to a whole block, and generates
+ * the key stream of the first data block. */
+void AESCcmStartData(struct aes_ccm_t *ccm_ptr) {
+  if (ccm_ptr->phase != AES_CCM_PHASE_AAD) {
+    return;
+  }
+
+  if (ccm_ptr->buf_len > 0) {
+    AESCcmPad(ccm_ptr);
+    AESCcmMacBlockKeystream(ccm_ptr);
+  } else {
+    AESCtxEncrypt(&ccm_ptr->ctx, ccm_ptr->ctr, ccm_ptr->keystream);
+    AESCcmIncrement(ccm_ptr->ctr, ccm_ptr->len_len);
+  }
+  ccm_ptr->phase = AES_CCM_PHASE_DATA;
+}
+
+/** AES-CCM init
+ *
+ * Expands the key of 'key_len' bytes (16, 24 or 32). Returns 1 on success, 0
+ * if the key length is not supported.
+ */
+uint8_t AESCcmInit(struct aes_ccm_t *ccm_ptr, const uint8_t *key_ptr,
+                   uint8_t key_len) {
+  return AESCtxInitKeyLen(&ccm_ptr->ctx, key_ptr, key_len);
+}
+
+/** AES-CCM start
+ *
+ * Starts a message with the nonce 'nonce' of 'nonce_len' bytes (7 to 13),
+ * 'aad_len' bytes of associated data, 'data_len' bytes of data and a tag of
+ * 'tag_len' bytes (4 to 16, even). Returns 1 on success, 0 if a parameter is
+ * not valid or 'data_len' does not fit in the length field.
+ */
+uint8_t AESCcmStart(struct aes_ccm_t *ccm_ptr, const uint8_t *nonce_ptr,
+                    uint8_t nonce_len, uint64_t aad_len, uint64_t data_len,
+                    uint8_t tag_len) {
+  uint8_t b[2 * AES_BLOCK_LEN];
+  uint8_t len_len = AES_BLOCK_LEN - 1 - nonce_len;
+
+  if (nonce_len < 7 || nonce_len > 13 || tag_len < 4 ||
+      tag_len > AES_CCM_MAX_TAG_LEN || tag_len % 2 != 0) {
+    return 0;
+  }
+  if (len_len < 8 && (data_len >> (8 * len_len)) != 0) {
+    return 0;
+  }
+
+  /* B0 = flags | nonce | data length, A0 = flags | nonce | 0 */
+  b[0] = (uint8_t)(((aad_len > 0) << 6) | (((tag_len - 2) / 2) << 3) |
+                   (len_len - 1));
+  memcpy(&b[1], nonce_ptr, nonce_len);
+  AESCcmStoreLen(&b[1 + nonce_len], len_len, data_len);
+
+  b[AES_BLOCK_LEN] = len_len - 1;
+  memcpy(&b[AES_BLOCK_LEN + 1], nonce_ptr, nonce_len);
+  memset(&b[AES_BLOCK_LEN + 1 + nonce_len], 0, len_len);
+  memcpy(ccm_ptr->ctr, &b[AES_BLOCK_LEN], AES_BLOCK_LEN);
+  AESCcmIncrement(ccm_ptr->ctr, len_len);
+
+  /* X1 = Ek(B0), S0 = Ek(A0) */
+  AESCtxECBEncrypt(&ccm_ptr->ctx, b, 2 * AES_BLOCK_LEN, b);
+  memcpy(ccm_ptr->x, b, AES_BLOCK_LEN);
+  memcpy(ccm_ptr->s0, &b[AES_BLOCK_LEN], AES_BLOCK_LEN);
+
+  /* The associated data starts with its encoded length. */
+  ccm_ptr->buf_len = 0;
+  if (aad_len > 0 && aad_len < 0xFF00) {
+    AESCcmStoreLen(ccm_ptr->buf, 2, aad_len);
+    ccm_ptr->buf_len = 2;
+  } else if (aad_len > 0 && aad_len <= 0xFFFFFFFF) {
+    ccm_ptr->buf[0] = 0xFF;
+    ccm_ptr->buf[1] = 0xFE;
+    AESCcmStoreLen(&ccm_ptr->buf[2], 4, aad_len);
+    ccm_ptr->buf_len = 6;
+  } else if (aad_len > 0) {
+    ccm_ptr->buf[0] = 0xFF;
+    ccm_ptr->buf[1] = 0xFF;
+    AESCcmStoreLen(&ccm_ptr->buf[2], 8, aad_len);
+    ccm_ptr->buf_len = 10;
+  }
+
+  ccm_ptr->aad_len = aad_len;
+  ccm_ptr->data_len = data_len;
+  ccm_ptr->len_len = len_len;
+  ccm_ptr->tag_len = tag_len;
+  ccm_ptr->phase = AES_CCM_PHASE_AAD;
+  return 1;
+}
+
+/** AES-CCM associated data
+ *
+ * Authenticates 'length' bytes of 'aad'. Must be called before encrypting or
+ * decrypting, can be called many times. Returns 1 on success, 0 (and does
+ * nothing) if the data has already started or 'length' is more than the
+ * associated data left.
+ */
+uint8_t AESCcmAad(struct aes_ccm_t *ccm_ptr, const uint8_t *aad_ptr,
+                  uint32_t length) {
+  uint8_t n;
+
+  if (ccm_ptr->phase != AES_CCM_PHASE_AAD || length > ccm_ptr->aad_len) {
+    return 0;
+  }
+  ccm_ptr->aad_len -= length;
+
+  /* A full block is kept until more data comes, the last one is encrypted
+   * together with the first key stream block. */
+  while (length > 0) {
+    if (ccm_ptr->buf_len == AES_BLOCK_LEN) {
+      AESCcmMacBlock(ccm_ptr);
+    }
+
+    n = AES_BLOCK_LEN - ccm_ptr->buf_len;
+    if (n > length) {
+      n = (uint8_t)length;
+    }
+    memcpy(&ccm_ptr->buf[ccm_ptr->buf_len], aad_ptr, n);
+    ccm_ptr->buf_len += n;
+    aad_ptr += n;
+    length -= n;
+  }
+  return 1;
+}
+
+/** AES-CCM encrypt
+ *
+ * Authenticates and encrypts 'length' bytes of 'plain', outputs to 'cipher'
+ * (may be the same as 'plain'). Can be called many times, with any length.
+ * Returns 1 on success, 0 (and outputs nothing) if 'length' is more than the
+ * data left.
+ */
+uint8_t AESCcmEncrypt(struct aes_ccm_t *ccm_ptr, const uint8_t *plain_ptr,
+                      uint32_t length, uint8_t *cipher_ptr) {
+  uint8_t n, i;
+
+  if (length > ccm_ptr->data_len) {
+    return 0;
+  }
+  AESCcmStartData(ccm_ptr);
+  ccm_ptr->data_len -= length;
+
+  while (length > 0) {
+    if (ccm_ptr->buf_len == AES_BLOCK_LEN) {
+      AESCcmMacBlockKeystream(ccm_ptr);
+    }
+
+    n = AES_BLOCK_LEN - ccm_ptr->buf_len;
+    if (n > length) {
+      n = (uint8_t)length;
+    }
+    if (n == AES_BLOCK_LEN) {
+      memcpy(ccm_ptr->buf, plain_ptr, AES_BLOCK_LEN);
+      AESXorBlock(cipher_ptr, ccm_ptr->buf, ccm_ptr->keystream);
+      ccm_ptr->buf_len = AES_BLOCK_LEN;
+    } else {
+      for (i = 0; i < n; ++i) {
+        uint8_t p = plain_ptr[i];
+        cipher_ptr[i] = p ^ ccm_ptr->keystream[ccm_ptr->buf_len];
+        ccm_ptr->buf[ccm_ptr->buf_len++] = p;
+      }
+    }
+    plain_ptr += n;
+    cipher_ptr += n;
+    length -= n;
+  }
+  return 1;
+}
+
+/** AES-CCM decrypt
+ *
+ * Decrypts and authenticates 'length' bytes of 'cipher', outputs to 'plain'
+ * (may be the same as 'cipher'). Can be called many times, with any length.
+ * Returns 1 on success, 0 (and outputs nothing) if 'length' is more than the
+ * data left.
+ */
+uint8_t AESCcmDecrypt(struct aes_ccm_t *ccm_ptr, const uint8_t *cipher_ptr,
+                      uint32_t length, uint8_t *plain_ptr) {
+  uint8_t n, i;
+
+  if (length > ccm_ptr->data_len) {
+    return 0;
+  }
+  AESCcmStartData(ccm_ptr);
+  ccm_ptr->data_len -= length;
+
+  while (length > 0) {
+    if (ccm_ptr->buf_len == AES_BLOCK_LEN) {
+      AESCcmMacBlockKeystream(ccm_ptr);
+    }
+
+    n = AES_BLOCK_LEN - ccm_ptr->buf_len;
+    if (n > length) {
+      n = (uint8_t)length;
+    }
+    if (n == AES_BLOCK_LEN) {
+      AESXorBlock(ccm_ptr->buf, cipher_ptr, ccm_ptr->keystream);
+      memcpy(plain_ptr, ccm_ptr->buf, AES_BLOCK_LEN);
+      ccm_ptr->buf_len = AES_BLOCK_LEN;
+    } else {
+      for (i = 0; i < n; ++i) {
+        uint8_t p = cipher_ptr[i] ^ ccm_ptr->keystream[ccm_ptr->buf_len];
+        plain_ptr[i] = p;
+        ccm_ptr->buf[ccm_ptr->buf_len++] = p;
+      }
+    }
+    cipher_ptr += n;
+    plain_ptr += n;
+    length -= n;
+  }
+  return 1;
+}
+
+/** AES-CCM finish
+ *
+ * Outputs the authentication tag of the message ('tag_len' bytes) to 'tag'.
+ * Returns 1 on success, 0 if the associated data or data lengths are not the
+ * ones given to AESCcmStart().
+ */
+uint8_t AESCcmFinish(struct aes_ccm_t *ccm_ptr, uint8_t *tag_ptr) {
+  uint8_t i;
+
+  AESCcmStartData(ccm_ptr);
+  if (ccm_ptr->buf_len > 0) {
+    AESCcmPad(ccm_ptr);
+    AESCcmMacBlock(ccm_ptr);
+  }
+
+  for (i = 0; i < ccm_ptr->tag_len; ++i) {
+    tag_ptr[i] = ccm_ptr->x[i] ^ ccm_ptr->s0[i];
+  }
+
+  return ccm_ptr->aad_len == 0 && ccm_ptr->data_len == 0;
+}
+
+/** AES-CCM verify
+ *
+ * Returns 1 if the tag of the message is equal to 'tag' ('tag_len' bytes) and
+ * the lengths are the ones given to AESCcmStart(), 0 otherwise. Compares in
+ * constant time.
+ */
+uint8_t AESCcmVerify(struct aes_ccm_t *ccm_ptr, const uint8_t *tag_ptr) {
+  uint8_t tag[AES_CCM_MAX_TAG_LEN];
+  uint8_t i, diff = 0;
+
+  if (!AESCcmFinish(ccm_ptr, tag)) {
+    return 0;
+  }
+
+  for (i = 0; i < ccm_ptr->tag_len; ++i) {
+    diff |= tag[i] ^ tag_ptr[i];
+  }
+  return diff == 0;
+}
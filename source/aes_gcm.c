@@ -0,0 +1,549 @@
+/*
+ AES-GCM authenticated encryption.
+
+ Copyright 2021 Djones A. Boni
+
+ Licensed under the Apache License, Version 2.0 (the "License");
+ you may not use this file except in compliance with the License.
+ You may obtain a copy of the License at
+
+ http://www.apache.org/licenses/LICENSE-2.0
+
+ Unless required by applicable law or agreed to in writing, software
+ distributed under the License is distributed on an "AS IS" BASIS,
+ WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ See the License for the specific language governing permissions and
+ limitations under the License.
+*/
+
+#include "aes_gcm.h"
+#include <string.h>
+
+#if (AES_GCM_MIN_TAG_LEN < 4 || AES_GCM_MIN_TAG_LEN > AES_GCM_TAG_LEN)
+#error "Invalid parameter AES_GCM_MIN_TAG_LEN."
+#endif
+
+#if AES_GCM_PCLMUL
+#include <cpuid.h>
+#include <emmintrin.h>
+#include <tmmintrin.h>
+#include <wmmintrin.h>
+#define AES_GCM_TARGET __attribute__((target("pclmul,sse2,ssse3")))
+#endif
+
+#ifdef AVR
+#include <avr/pgmspace.h>
+#define PGM_READ_WORD(x) pgm_read_word(x)
+#else
+#undef PROGMEM
+#define PROGMEM
+#define PGM_READ_WORD(x) *(x)
+#endif
+
+/* AES GCM.
+ *
+ * Galois/Counter Mode (NIST SP 800-38D). Counter mode encryption with a
+ * 32-bit counter, authenticated with GHASH over the associated data and the
+ * cipher-text.
+ *
+ * GHASH uses PCLMULQDQ if available, multiplying AES_GCM_BLOCKS blocks by
+ * H^8..H^1 and doing a single reduction for all of them. Otherwise it uses
+ * 4-bit tables (256 bytes per key), which are not constant-time.
+ *
+ * The key is expanded once by AESGcmInit(), every message then needs only
+ * AESGcmStart() with a new IV (never repeat an IV with the same key).
+ *
+ * struct aes_gcm_t gcm;
+ * AESGcmInit(&gcm, key, 16);
+ * AESGcmStart(&gcm, iv, AES_GCM_IV_LEN);
+ * AESGcmAad(&gcm, header, header_length);
+ * AESGcmEncrypt(&gcm, data1, length1, data1);
+ * AESGcmEncrypt(&gcm, data2, length2, data2);
+ * // ... as much as you want
+ * AESGcmFinish(&gcm, tag);
+ *
+ * To decrypt, call AESGcmDecrypt() and then AESGcmVerify() with the received
+ * tag. Discard the plain-text if the tag is not valid.
+ *
+ */
+
+enum aes_gcm_phase_t { AES_GCM_PHASE_AAD = 0, AES_GCM_PHASE_DATA = 1 };
+
+/* Reduction of the 4 bits shifted out of the low end of the table product. */
+PROGMEM const uint16_t AES_Gcm_Last4_Table[16] = {
+    0x0000, 0x1c20, 0x3840, 0x2460, 0x7080, 0x6ca0, 0x48c0, 0x54e0,
+    0xe100, 0xfd20, 0xd940, 0xc560, 0x9180, 0x8da0, 0xa9c0, 0xb5e0};
+
+uint16_t AESGcmLast4(uint8_t x) {
+  return PGM_READ_WORD(&AES_Gcm_Last4_Table[x]);
+}
+
+uint64_t AESGcmLoad64(const uint8_t *ptr) {
+  uint64_t x = 0;
+  uint8_t i;
+  for (i = 0; i < 8; ++i) {
+    x = (x << 8) | ptr[i];
+  }
+  return x;
+}
+
+void AESGcmStore64(uint8_t *ptr, uint64_t x) {
+  uint8_t i;
+  for (i = 8; i > 0; --i) {
+    ptr[i - 1] = (uint8_t)x;
+    x >>= 8;
+  }
+}
+
+/* Builds the tables with i*H for every 4-bit value i (bit-reflected). */
+void AESGcmTableInit(struct aes_gcm_t *gcm_ptr,
+                     const uint8_t h[AES_BLOCK_LEN]) {
+  uint64_t vh = AESGcmLoad64(&h[0]);
+  uint64_t vl = AESGcmLoad64(&h[8]);
+  uint8_t i, j;
+
+  gcm_ptr->hh[0] = 0;
+  gcm_ptr->hl[0] = 0;
+  gcm_ptr->hh[8] = vh;
+  gcm_ptr->hl[8] = vl;
+
+  /* Powers of two: multiply by x (shift right in GCM bit order). */
+  for (i = 4; i > 0; i >>= 1) {
+    uint64_t carry = vl & 1;
+    vl = (vh << 63) | (vl >> 1);
+    vh = (vh >> 1) ^ (carry * ((uint64_t)0xe1 << 56));
+    gcm_ptr->hh[i] = vh;
+    gcm_ptr->hl[i] = vl;
+  }
+
+  /* The other values are sums of the powers of two. */
+  for (i = 2; i <= 8; i <<= 1) {
+    for (j = 1; j < i; ++j) {
+      gcm_ptr->hh[i + j] = gcm_ptr->hh[i] ^ gcm_ptr->hh[j];
+      gcm_ptr->hl[i + j] = gcm_ptr->hl[i] ^ gcm_ptr->hl[j];
+    }
+  }
+}
+
+/* x = x * H, 4 bits at a time with the tables. */
+void AESGcmTableMul(const struct aes_gcm_t *gcm_ptr,
+                    uint8_t x[AES_BLOCK_LEN]) {
+  uint64_t zh, zl;
+  uint8_t i, n, rem;
+
+  n = x[AES_BLOCK_LEN - 1] & 0x0F;
+  zh = gcm_ptr->hh[n];
+  zl = gcm_ptr->hl[n];
+
+  for (i = AES_BLOCK_LEN; i > 0; --i) {
+    if (i != AES_BLOCK_LEN) {
+      n = x[i - 1] & 0x0F;
+      rem = (uint8_t)(zl & 0x0F);
+      zl = (zh << 60) | (zl >> 4);
+      zh = (zh >> 4) ^ ((uint64_t)AESGcmLast4(rem) << 48);
+      zh ^= gcm_ptr->hh[n];
+      zl ^= gcm_ptr->hl[n];
+    }
+
+    n = x[i - 1] >> 4;
+    rem = (uint8_t)(zl & 0x0F);
+    zl = (zh << 60) | (zl >> 4);
+    zh = (zh >> 4) ^ ((uint64_t)AESGcmLast4(rem) << 48);
+    zh ^= gcm_ptr->hh[n];
+    zl ^= gcm_ptr->hl[n];
+  }
+
+  AESGcmStore64(&x[0], zh);
+  AESGcmStore64(&x[8], zl);
+}
+
+#if AES_GCM_PCLMUL
+
+static int8_t AES_Gcm_Pclmul_Supported = -1;
+
+/** AES-GCM PCLMULQDQ supported
+ *
+ * Returns 1 if the CPU supports the PCLMULQDQ and SSSE3 instructions, 0
+ * otherwise. CPUID is queried only on the first call.
+ */
+uint8_t AESGcmPclmulSupported(void) {
+  if (AES_Gcm_Pclmul_Supported < 0) {
+    unsigned int eax, ebx, ecx, edx;
+    AES_Gcm_Pclmul_Supported = 0;
+    if (__get_cpuid(1, &eax, &ebx, &ecx, &edx) && (ecx & bit_PCLMUL) != 0 &&
+        (ecx & bit_SSSE3) != 0 && (edx & bit_SSE2) != 0) {
+      AES_Gcm_Pclmul_Supported = 1;
+    }
+  }
+  return (uint8_t)AES_Gcm_Pclmul_Supported;
+}
+
+/* Blocks are byte reversed, then the 128x128 carry-less product of the
+ * bit-reflected values is shifted left by one bit and reduced modulo
+ * x^128 + x^7 + x^2 + x + 1 (Intel carry-less multiplication white paper). */
+
+AES_GCM_TARGET
+static __m128i AESGcmClmulBswap(__m128i a) {
+  return _mm_shuffle_epi8(
+      a, _mm_set_epi8(0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15));
+}
+
+/* Accumulates the unreduced product a*b into lo, mid and hi. */
+AES_GCM_TARGET
+static void AESGcmClmulAcc(__m128i *lo, __m128i *mid, __m128i *hi, __m128i a,
+                           __m128i b) {
+  *lo = _mm_xor_si128(*lo, _mm_clmulepi64_si128(a, b, 0x00));
+  *hi = _mm_xor_si128(*hi, _mm_clmulepi64_si128(a, b, 0x11));
+  *mid = _mm_xor_si128(*mid, _mm_clmulepi64_si128(a, b, 0x01));
+  *mid = _mm_xor_si128(*mid, _mm_clmulepi64_si128(a, b, 0x10));
+}
+
+/* Reduces the 256-bit product lo, mid, hi to 128 bits. */
+AES_GCM_TARGET
+static __m128i AESGcmClmulReduce(__m128i lo, __m128i mid, __m128i hi) {
+  __m128i t1, t2, t3;
+
+  lo = _mm_xor_si128(lo, _mm_slli_si128(mid, 8));
+  hi = _mm_xor_si128(hi, _mm_srli_si128(mid, 8));
+
+  /* Shift the 256-bit value [hi:lo] left by one bit. */
+  t1 = _mm_srli_epi32(lo, 31);
+  t2 = _mm_srli_epi32(hi, 31);
+  lo = _mm_slli_epi32(lo, 1);
+  hi = _mm_slli_epi32(hi, 1);
+  t3 = _mm_srli_si128(t1, 12);
+  t2 = _mm_slli_si128(t2, 4);
+  t1 = _mm_slli_si128(t1, 4);
+  lo = _mm_or_si128(lo, t1);
+  hi = _mm_or_si128(hi, t2);
+  hi = _mm_or_si128(hi, t3);
+
+  /* First phase of the reduction. */
+  t1 = _mm_slli_epi32(lo, 31);
+  t1 = _mm_xor_si128(t1, _mm_slli_epi32(lo, 30));
+  t1 = _mm_xor_si128(t1, _mm_slli_epi32(lo, 25));
+  t2 = _mm_srli_si128(t1, 4);
+  t1 = _mm_slli_si128(t1, 12);
+  lo = _mm_xor_si128(lo, t1);
+
+  /* Second phase of the reduction. */
+  t1 = _mm_srli_epi32(lo, 1);
+  t1 = _mm_xor_si128(t1, _mm_srli_epi32(lo, 2));
+  t1 = _mm_xor_si128(t1, _mm_srli_epi32(lo, 7));
+  t1 = _mm_xor_si128(t1, t2);
+  lo = _mm_xor_si128(lo, t1);
+
+  return _mm_xor_si128(hi, lo);
+}
+
+AES_GCM_TARGET
+static void AESGcmClmulInit(struct aes_gcm_t *gcm_ptr,
+                            const uint8_t h[AES_BLOCK_LEN]) {
+  __m128i h1, hn, lo, mid, hi;
+  uint8_t i;
+
+  h1 = AESGcmClmulBswap(_mm_loadu_si128((const __m128i *)h));
+  hn = h1;
+  _mm_storeu_si128((__m128i *)gcm_ptr->hpow[0], h1);
+
+  for (i = 1; i < AES_GCM_BLOCKS; ++i) {
+    lo = mid = hi = _mm_setzero_si128();
+    AESGcmClmulAcc(&lo, &mid, &hi, hn, h1);
+    hn = AESGcmClmulReduce(lo, mid, hi);
+    _mm_storeu_si128((__m128i *)gcm_ptr->hpow[i], hn);
+  }
+}
+
+AES_GCM_TARGET
+static void AESGcmClmulHash(struct aes_gcm_t *gcm_ptr, const uint8_t *data_ptr,
+                            uint32_t num) {
+  const __m128i *hpow = (const __m128i *)gcm_ptr->hpow;
+  __m128i x, c, lo, mid, hi;
+  uint8_t j;
+
+  x = AESGcmClmulBswap(_mm_loadu_si128((const __m128i *)gcm_ptr->x));
+
+  /* X = (X + C1)*H^8 + C2*H^7 + ... + C8*H, reduced once. */
+  for (; num >= AES_GCM_BLOCKS; num -= AES_GCM_BLOCKS) {
+    lo = mid = hi = _mm_setzero_si128();
+    for (j = 0; j < AES_GCM_BLOCKS; ++j) {
+      c = AESGcmClmulBswap(
+          _mm_loadu_si128((const __m128i *)&data_ptr[AES_BLOCK_LEN * j]));
+      if (j == 0) {
+        c = _mm_xor_si128(c, x);
+      }
+      AESGcmClmulAcc(&lo, &mid, &hi, c,
+                     _mm_loadu_si128(&hpow[AES_GCM_BLOCKS - 1 - j]));
+    }
+    x = AESGcmClmulReduce(lo, mid, hi);
+    data_ptr += AES_GCM_BLOCKS * AES_BLOCK_LEN;
+  }
+
+  for (; num > 0; --num) {
+    c = AESGcmClmulBswap(_mm_loadu_si128((const __m128i *)data_ptr));
+    lo = mid = hi = _mm_setzero_si128();
+    AESGcmClmulAcc(&lo, &mid, &hi, _mm_xor_si128(x, c),
+                   _mm_loadu_si128(&hpow[0]));
+    x = AESGcmClmulReduce(lo, mid, hi);
+    data_ptr += AES_BLOCK_LEN;
+  }
+
+  _mm_storeu_si128((__m128i *)gcm_ptr->x, AESGcmClmulBswap(x));
+}
+
+#endif /* AES_GCM_PCLMUL */
+
+/* GHASH 'num' whole blocks into the accumulator. */
+void AESGcmHash(struct aes_gcm_t *gcm_ptr, const uint8_t *data_ptr,
+                uint32_t num) {
+  uint8_t i;
+
+#if AES_GCM_PCLMUL
+  if (AESGcmPclmulSupported()) {
+    AESGcmClmulHash(gcm_ptr, data_ptr, num);
+    return;
+  }
+#endif
+
+  for (; num > 0; --num) {
+    for (i = 0; i < AES_BLOCK_LEN; ++i) {
+      gcm_ptr->x[i] ^= data_ptr[i];
+    }
+    AESGcmTableMul(gcm_ptr, gcm_ptr->x);
+    data_ptr += AES_BLOCK_LEN;
+  }
+}
+
+/* GHASH bytes, keeping a partial block for the next call. */
+void AESGcmHashBytes(struct aes_gcm_t *gcm_ptr, const uint8_t *data_ptr,
+                     uint32_t length) {
+  uint32_t num;
+
+  if (gcm_ptr->buf_len > 0) {
+    while (length > 0 && gcm_ptr->buf_len < AES_BLOCK_LEN) {
+      gcm_ptr->buf[gcm_ptr->buf_len++] = *data_ptr++;
+      --length;
+    }
+    if (gcm_ptr->buf_len < AES_BLOCK_LEN) {
+      return;
+    }
+    AESGcmHash(gcm_ptr, gcm_ptr->buf, 1);
+    gcm_ptr->buf_len = 0;
+  }
+
+  num = length / AES_BLOCK_LEN;
+  if (num > 0) {
+    AESGcmHash(gcm_ptr, data_ptr, num);
+    data_ptr += AES_BLOCK_LEN * num;
+    length -= AES_BLOCK_LEN * num;
+  }
+
+  while (length > 0) {
+    gcm_ptr->buf[gcm_ptr->buf_len++] = *data_ptr++;
+    --length;
+  }
+}
+
+/* Pads the partial block with zeros and hashes it. */
+void AESGcmHashPad(struct aes_gcm_t *gcm_ptr) {
+  if (gcm_ptr->buf_len > 0) {
+    memset(&gcm_ptr->buf[gcm_ptr->buf_len], 0,
+           AES_BLOCK_LEN - gcm_ptr->buf_len);
+    AESGcmHash(gcm_ptr, gcm_ptr->buf, 1);
+    gcm_ptr->buf_len = 0;
+  }
+}
+
+/* Hashes the block with the two lengths in bits. */
+void AESGcmHashLengths(struct aes_gcm_t *gcm_ptr, uint64_t len_a,
+                       uint64_t len_b) {
+  uint8_t block[AES_BLOCK_LEN];
+  AESGcmStore64(&block[0], len_a << 3);
+  AESGcmStore64(&block[8], len_b << 3);
+  AESGcmHash(gcm_ptr, block, 1);
+}
+
+/* Ends the associated data, which is padded to a whole block. */
+void AESGcmStartData(struct aes_gcm_t *gcm_ptr) {
+  if (gcm_ptr->phase == AES_GCM_PHASE_AAD) {
+    AESGcmHashPad(gcm_ptr);
+    gcm_ptr->phase = AES_GCM_PHASE_DATA;
+  }
+}
+
+/** AES-GCM init
+ *
+ * Expands the key of 'key_len' bytes (16, 24 or 32) and computes the hash key
+ * H and its tables. Returns 1 on success, 0 if the key length is not
+ * supported.
+ */
+uint8_t AESGcmInit(struct aes_gcm_t *gcm_ptr, const uint8_t *key_ptr,
+                   uint8_t key_len) {
+  uint8_t h[AES_BLOCK_LEN];
+
+  memset(h, 0, AES_BLOCK_LEN);
+  if (!AESCtrInit(&gcm_ptr->ctr, key_ptr, key_len, h, 4)) {
+    return 0;
+  }
+  AESCtxEncrypt(&gcm_ptr->ctr.ctx, h, h);
+
+  AESGcmTableInit(gcm_ptr, h);
+#if AES_GCM_PCLMUL
+  if (AESGcmPclmulSupported()) {
+    AESGcmClmulInit(gcm_ptr, h);
+  }
+#endif
+
+  memset(gcm_ptr->x, 0, AES_BLOCK_LEN);
+  gcm_ptr->buf_len = 0;
+  gcm_ptr->aad_len = 0;
+  gcm_ptr->data_len = 0;
+  gcm_ptr->phase = AES_GCM_PHASE_AAD;
+  return 1;
+}
+
+/** AES-GCM start
+ *
+ * Starts a message with the IV 'iv' of 'iv_len' bytes. AES_GCM_IV_LEN (12)
+ * bytes is the recommended length, other lengths are hashed with GHASH.
+ * Returns 1 on success, 0 if the IV is empty.
+ */
+uint8_t AESGcmStart(struct aes_gcm_t *gcm_ptr, const uint8_t *iv_ptr,
+                    uint32_t iv_len) {
+  uint8_t j0[AES_BLOCK_LEN];
+
+  if (iv_len == 0) {
+    return 0;
+  }
+
+  memset(gcm_ptr->x, 0, AES_BLOCK_LEN);
+  gcm_ptr->buf_len = 0;
+
+  if (iv_len == AES_GCM_IV_LEN) {
+    memcpy(j0, iv_ptr, AES_GCM_IV_LEN);
+    j0[12] = 0;
+    j0[13] = 0;
+    j0[14] = 0;
+    j0[15] = 1;
+  } else {
+    AESGcmHashBytes(gcm_ptr, iv_ptr, iv_len);
+    AESGcmHashPad(gcm_ptr);
+    AESGcmHashLengths(gcm_ptr, 0, iv_len);
+    memcpy(j0, gcm_ptr->x, AES_BLOCK_LEN);
+    memset(gcm_ptr->x, 0, AES_BLOCK_LEN);
+  }
+
+  AESCtxEncrypt(&gcm_ptr->ctr.ctx, j0, gcm_ptr->ek_j0);
+
+  /* Data is encrypted from the counter block after J0. */
+  memcpy(gcm_ptr->ctr.iv, j0, AES_BLOCK_LEN);
+  AESCtrSeek(&gcm_ptr->ctr, AES_BLOCK_LEN);
+
+  gcm_ptr->aad_len = 0;
+  gcm_ptr->data_len = 0;
+  gcm_ptr->phase = AES_GCM_PHASE_AAD;
+  return 1;
+}
+
+/** AES-GCM associated data
+ *
+ * Authenticates 'length' bytes of 'aad'. Must be called before encrypting or
+ * decrypting, can be called many times.
+ */
+void AESGcmAad(struct aes_gcm_t *gcm_ptr, const uint8_t *aad_ptr,
+               uint32_t length) {
+  gcm_ptr->aad_len += length;
+  AESGcmHashBytes(gcm_ptr, aad_ptr, length);
+}
+
+/** AES-GCM encrypt
+ *
+ * Encrypts 'length' bytes of 'plain' and authenticates the cipher-text,
+ * outputs to 'cipher'. Can be called many times, with any length.
+ */
+void AESGcmEncrypt(struct aes_gcm_t *gcm_ptr, const uint8_t *plain_ptr,
+                   uint32_t length, uint8_t *cipher_ptr) {
+  uint32_t n;
+
+  AESGcmStartData(gcm_ptr);
+  gcm_ptr->data_len += length;
+
+  /* Hash each piece while it is still in the cache. */
+  while (length > 0) {
+    n = AES_GCM_BLOCKS * AES_BLOCK_LEN;
+    if (n > length) {
+      n = length;
+    }
+    AESCtrEncrypt(&gcm_ptr->ctr, plain_ptr, n, cipher_ptr);
+    AESGcmHashBytes(gcm_ptr, cipher_ptr, n);
+    plain_ptr += n;
+    cipher_ptr += n;
+    length -= n;
+  }
+}
+
+/** AES-GCM decrypt
+ *
+ * Authenticates and decrypts 'length' bytes of 'cipher', outputs to 'plain'.
+ * Can be called many times, with any length.
+ */
+void AESGcmDecrypt(struct aes_gcm_t *gcm_ptr, const uint8_t *cipher_ptr,
+                   uint32_t length, uint8_t *plain_ptr) {
+  uint32_t n;
+
+  AESGcmStartData(gcm_ptr);
+  gcm_ptr->data_len += length;
+
+  while (length > 0) {
+    n = AES_GCM_BLOCKS * AES_BLOCK_LEN;
+    if (n > length) {
+      n = length;
+    }
+    AESGcmHashBytes(gcm_ptr, cipher_ptr, n);
+    AESCtrDecrypt(&gcm_ptr->ctr, cipher_ptr, n, plain_ptr);
+    cipher_ptr += n;
+    plain_ptr += n;
+    length -= n;
+  }
+}
+
+/** AES-GCM finish
+ *
+ * Outputs the authentication tag of the message to 'tag'.
+ */
+void AESGcmFinish(struct aes_gcm_t *gcm_ptr, uint8_t tag[AES_GCM_TAG_LEN]) {
+  uint8_t i;
+
+  AESGcmStartData(gcm_ptr);
+  AESGcmHashPad(gcm_ptr);
+  AESGcmHashLengths(gcm_ptr, gcm_ptr->aad_len, gcm_ptr->data_len);
+
+  for (i = 0; i < AES_GCM_TAG_LEN; ++i) {
+    tag[i] = gcm_ptr->x[i] ^ gcm_ptr->ek_j0[i];
+  }
+}
+
+/** AES-GCM verify
+ *
+ * Returns 1 if the first 'tag_len' bytes of the tag of the message are equal
+ * to 'tag', 0 otherwise. 'tag_len' must be 4, 8 or 12 to 16 and at least
+ * AES_GCM_MIN_TAG_LEN, other lengths are always rejected. Compares in constant
+ * time.
+ */
+uint8_t AESGcmVerify(struct aes_gcm_t *gcm_ptr, const uint8_t *tag_ptr,
+                     uint8_t tag_len) {
+  uint8_t tag[AES_GCM_TAG_LEN];
+  uint8_t i, diff = 0;
+
+  if (tag_len < AES_GCM_MIN_TAG_LEN || tag_len > AES_GCM_TAG_LEN ||
+      (tag_len < 12 && tag_len != 4 && tag_len != 8)) {
+    return 0;
+  }
+
+  AESGcmFinish(gcm_ptr, tag);
+
+  for (i = 0; i < tag_len; ++i) {
+    diff |= tag[i] ^ tag_ptr[i];
+  }
+  return diff == 0;
+}
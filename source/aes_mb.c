@@ -0,0 +1,271 @@
+/*
+ AES multi-buffer CBC encryption.
+
+ Copyright 2021 Djones A. Boni
+
+ Licensed under the Apache License, Version 2.0 (the "License");
+ you may not use this file except in compliance with the License.
+ You may obtain a copy of the License at
+
+ http://www.apache.org/licenses/LICENSE-2.0
+
+ Unless required by applicable law or agreed to in writing, software
+ distributed under the License is distributed on an "AS IS" BASIS,
+ WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ See the License for the specific language governing permissions and
+ limitations under the License.
+*/
+
+#include "aes_mb.h"
+#include <stddef.h>
+#include <string.h>
+
+#if AES_AESNI
+#include <emmintrin.h>
+#include <wmmintrin.h>
+#define AES_MB_TARGET __attribute__((target("aes,sse2")))
+#endif
+
+/* AES MULTI-BUFFER.
+ *
+ * CBC encryption of one message is serial: each block needs the previous
+ * cipher-text block, so it runs at the latency of AES. A job manager encrypts
+ * up to AES_MB_LANES independent messages (jobs) at a time, each one with its
+ * own key, interleaving their blocks. With AES-NI the rounds of the 8 lanes
+ * are pipelined, which recovers the throughput of the AES unit.
+ *
+ * Jobs are submitted to the manager. When all the lanes are in use, the
+ * manager encrypts until the shortest job is done and returns it. Flush
+ * encrypts the remaining jobs, returning one per call. The job and its
+ * buffers must not be changed until the job is returned.
+ *
+ * 'chain' is the previous cipher-text block: Ek(iv) (AESCtxEncrypt() of the
+ * initialization vector) gives the same cipher-text as AESCtxCBCEncrypt(). It
+ * is updated with the last cipher-text block, so a message can continue in
+ * another job.
+ *
+ * struct aes_mb_t mb;
+ * struct aes_mb_job_t *done;
+ * AESMbInit(&mb);
+ * // For each message
+ * AESCtxEncrypt(&ctx[i], iv[i], job[i].chain);
+ * job[i].ctx_ptr = &ctx[i];
+ * // ... plain_ptr, cipher_ptr, length
+ * done = AESMbSubmit(&mb, &job[i]);
+ * // A job is done if done != NULL
+ * // Then
+ * while ((done = AESMbFlush(&mb)) != NULL) {
+ *   // Job done
+ * }
+ *
+ */
+
+#if AES_AESNI
+
+/* Applies one AES-NI instruction to the 8 lanes, each lane with its own round
+ * key. */
+#define AES_MB_NI_ROUND8(instr, a, k, round)                                   \
+  do {                                                                         \
+    a[0] = instr(a[0], _mm_loadu_si128(&k[0][round]));                         \
+    a[1] = instr(a[1], _mm_loadu_si128(&k[1][round]));                         \
+    a[2] = instr(a[2], _mm_loadu_si128(&k[2][round]));                         \
+    a[3] = instr(a[3], _mm_loadu_si128(&k[3][round]));                         \
+    a[4] = instr(a[4], _mm_loadu_si128(&k[4][round]));                         \
+    a[5] = instr(a[5], _mm_loadu_si128(&k[5][round]));                         \
+    a[6] = instr(a[6], _mm_loadu_si128(&k[6][round]));                         \
+    a[7] = instr(a[7], _mm_loadu_si128(&k[7][round]));                         \
+  } while (0)
+
+/* Encrypts 'num' blocks of every lane. Free lanes encrypt a scratch block
+ * with the key of a used lane. */
+AES_MB_TARGET
+static void AESMbNiEncrypt(struct aes_mb_t *mb_ptr, uint32_t num) {
+  const __m128i *k[AES_MB_LANES];
+  const uint8_t *in_ptr[AES_MB_LANES];
+  uint8_t *out_ptr[AES_MB_LANES];
+  uint8_t stride[AES_MB_LANES];
+  uint8_t rounds[AES_MB_LANES];
+  uint8_t scratch[AES_BLOCK_LEN];
+  __m128i a[AES_MB_LANES];
+  uint8_t min_rounds = 255, max_rounds = 0;
+  uint8_t round, j, used = 0;
+
+  memset(scratch, 0, AES_BLOCK_LEN);
+  while (mb_ptr->jobs[used] == NULL) {
+    ++used;
+  }
+
+  for (j = 0; j < AES_MB_LANES; ++j) {
+    const struct aes_mb_job_t *job_ptr = mb_ptr->jobs[j];
+    if (job_ptr != NULL) {
+      in_ptr[j] = mb_ptr->in_ptr[j];
+      out_ptr[j] = mb_ptr->out_ptr[j];
+      stride[j] = AES_BLOCK_LEN;
+      a[j] = _mm_loadu_si128((const __m128i *)job_ptr->chain);
+    } else {
+      job_ptr = mb_ptr->jobs[used];
+      in_ptr[j] = scratch;
+      out_ptr[j] = scratch;
+      stride[j] = 0;
+      a[j] = _mm_setzero_si128();
+    }
+    k[j] = (const __m128i *)job_ptr->ctx_ptr->subkeys;
+    rounds[j] = job_ptr->ctx_ptr->rounds;
+    if (rounds[j] < min_rounds) {
+      min_rounds = rounds[j];
+    }
+    if (rounds[j] > max_rounds) {
+      max_rounds = rounds[j];
+    }
+  }
+
+  for (; num > 0; --num) {
+    /* A = C[i-1] ^ P[i] */
+    for (j = 0; j < AES_MB_LANES; ++j) {
+      a[j] = _mm_xor_si128(a[j],
+                           _mm_loadu_si128((const __m128i *)in_ptr[j]));
+    }
+
+    AES_MB_NI_ROUND8(_mm_xor_si128, a, k, 0);
+    for (round = 1; round < min_rounds; ++round) {
+      AES_MB_NI_ROUND8(_mm_aesenc_si128, a, k, round);
+    }
+    if (min_rounds == max_rounds) {
+      AES_MB_NI_ROUND8(_mm_aesenclast_si128, a, k, min_rounds);
+    } else {
+      /* Lanes with different key lengths. */
+      for (; round <= max_rounds; ++round) {
+        for (j = 0; j < AES_MB_LANES; ++j) {
+          if (round < rounds[j]) {
+            a[j] = _mm_aesenc_si128(a[j], _mm_loadu_si128(&k[j][round]));
+          } else if (round == rounds[j]) {
+            a[j] = _mm_aesenclast_si128(a[j], _mm_loadu_si128(&k[j][round]));
+          }
+        }
+      }
+    }
+
+    /* C[i] = A */
+    for (j = 0; j < AES_MB_LANES; ++j) {
+      _mm_storeu_si128((__m128i *)out_ptr[j], a[j]);
+      in_ptr[j] += stride[j];
+      out_ptr[j] += stride[j];
+    }
+  }
+
+  for (j = 0; j < AES_MB_LANES; ++j) {
+    if (mb_ptr->jobs[j] != NULL) {
+      _mm_storeu_si128((__m128i *)mb_ptr->jobs[j]->chain, a[j]);
+    }
+  }
+}
+
+#endif /* AES_AESNI */
+
+/* Encrypts 'num' blocks of every used lane, one block of each lane at a
+ * time. */
+void AESMbEncrypt(struct aes_mb_t *mb_ptr, uint32_t num) {
+  struct aes_mb_job_t *job_ptr;
+  uint32_t i;
+  uint8_t j, k;
+
+  for (j = 0; j < AES_MB_LANES; ++j) {
+    if ((job_ptr = mb_ptr->jobs[j]) != NULL) {
+      for (i = 0; i < num; ++i) {
+        for (k = 0; k < AES_BLOCK_LEN; ++k) {
+          job_ptr->chain[k] ^= mb_ptr->in_ptr[j][AES_BLOCK_LEN * i + k];
+        }
+        AESCtxEncrypt(job_ptr->ctx_ptr, job_ptr->chain, job_ptr->chain);
+        memcpy(&mb_ptr->out_ptr[j][AES_BLOCK_LEN * i], job_ptr->chain,
+               AES_BLOCK_LEN);
+      }
+    }
+  }
+}
+
+/* Encrypts until a job is done, removes it from its lane and returns it. */
+struct aes_mb_job_t *AESMbRun(struct aes_mb_t *mb_ptr) {
+  struct aes_mb_job_t *job_ptr;
+  uint32_t num = 0xFFFFFFFF;
+  uint8_t j;
+
+  for (j = 0; j < AES_MB_LANES; ++j) {
+    if (mb_ptr->jobs[j] != NULL && mb_ptr->left[j] < num) {
+      num = mb_ptr->left[j];
+    }
+  }
+
+  if (num > 0) {
+#if AES_AESNI
+    if (AESNiSupported()) {
+      AESMbNiEncrypt(mb_ptr, num);
+    } else
+#endif
+    {
+      AESMbEncrypt(mb_ptr, num);
+    }
+
+    for (j = 0; j < AES_MB_LANES; ++j) {
+      if (mb_ptr->jobs[j] != NULL) {
+        mb_ptr->in_ptr[j] += AES_BLOCK_LEN * num;
+        mb_ptr->out_ptr[j] += AES_BLOCK_LEN * num;
+        mb_ptr->left[j] -= num;
+      }
+    }
+  }
+
+  for (j = 0; mb_ptr->jobs[j] == NULL || mb_ptr->left[j] > 0; ++j) {
+  }
+  job_ptr = mb_ptr->jobs[j];
+  mb_ptr->jobs[j] = NULL;
+  --mb_ptr->num_jobs;
+  return job_ptr;
+}
+
+/** AES multi-buffer init
+ *
+ * Starts the job manager with all the lanes free.
+ */
+void AESMbInit(struct aes_mb_t *mb_ptr) {
+  uint8_t j;
+  for (j = 0; j < AES_MB_LANES; ++j) {
+    mb_ptr->jobs[j] = NULL;
+  }
+  mb_ptr->num_jobs = 0;
+}
+
+/** AES multi-buffer submit
+ *
+ * Adds the CBC encryption job 'job' to a free lane. If all the lanes are used,
+ * encrypts until a job is done and returns it, otherwise returns NULL. The
+ * jobs are not necessarily returned in the order they were submitted.
+ */
+struct aes_mb_job_t *AESMbSubmit(struct aes_mb_t *mb_ptr,
+                                 struct aes_mb_job_t *job_ptr) {
+  uint8_t j;
+
+  for (j = 0; mb_ptr->jobs[j] != NULL; ++j) {
+  }
+  mb_ptr->jobs[j] = job_ptr;
+  mb_ptr->in_ptr[j] = job_ptr->plain_ptr;
+  mb_ptr->out_ptr[j] = job_ptr->cipher_ptr;
+  mb_ptr->left[j] = job_ptr->length / AES_BLOCK_LEN;
+  ++mb_ptr->num_jobs;
+
+  if (mb_ptr->num_jobs < AES_MB_LANES) {
+    return NULL;
+  }
+  return AESMbRun(mb_ptr);
+}
+
+/** AES multi-buffer flush
+ *
+ * Encrypts the submitted jobs until one is done and returns it. Returns NULL
+ * if there are no jobs left.
+ */
+struct aes_mb_job_t *AESMbFlush(struct aes_mb_t *mb_ptr) {
+  if (mb_ptr->num_jobs == 0) {
+    return NULL;
+  }
+  return AESMbRun(mb_ptr);
+}
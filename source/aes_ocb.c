@@ -0,0 +1,412 @@
+/*
+ AES-OCB authenticated encryption.
+
+ Copyright 2021 Djones A. Boni
+
+ Licensed under the Apache License, Version 2.0 (the "License");
+ you may not use this file except in compliance with the License.
+ You may obtain a copy of the License at
+
+ http://www.apache.org/licenses/LICENSE-2.0
+
+ Unless required by applicable law or agreed to in writing, software
+ distributed under the License is distributed on an "AS IS" BASIS,
+ WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ See the License for the specific language governing permissions and
+ limitations under the License.
+*/
+
+#include "aes_ocb.h"
+#include <string.h>
+
+/* AES OCB.
+ *
+ * Offset codebook mode, version 3 (RFC 7253). Each block is encrypted once,
+ * XORed before and after with an offset, and the plain-text XOR (checksum)
+ * gives the tag: a single pass, with blocks that are independent of each
+ * other. AES_OCB_BLOCKS blocks are encrypted with one call to the ECB
+ * functions, which the AES-NI backend interleaves.
+ *
+ * The offset of block i is the previous one XOR L_ntz(i), where ntz() is the
+ * number of trailing zero bits. The L_i values are computed once by
+ * AESOcbInit(). Consecutive nonces that differ only in the last 6 bits reuse
+ * the encrypted nonce ('stretch') of the previous message.
+ *
+ * The nonce has 1 to 15 bytes and the tag 1 to 16. Never repeat a nonce with
+ * the same key. The associated data is independent from the data and can be
+ * given at any time before the message finishes.
+ *
+ * A partial block is kept until more data comes or the message finishes, as
+ * the last partial block is encrypted differently. Encrypt and decrypt return
+ * the number of bytes written to the output, which must have room for
+ * 'length' + AES_BLOCK_LEN - 1 bytes. The buffered bytes are output before the
+ * new data, so the output must not overlap the input, unless the lengths of
+ * all the previous calls were multiples of AES_BLOCK_LEN.
+ *
+ * struct aes_ocb_t ocb;
+ * AESOcbInit(&ocb, key, 16);
+ * AESOcbStart(&ocb, nonce, 12, 16);
+ * AESOcbAad(&ocb, header, header_length);
+ * n = AESOcbEncrypt(&ocb, data1, length1, out);
+ * n = AESOcbEncrypt(&ocb, data2, length2, out);
+ * // ... as much as you want
+ * AESOcbEncryptFinish(&ocb, out, &last_len, tag);
+ *
+ * To decrypt, call AESOcbDecrypt() and then AESOcbDecryptFinish() with the
+ * received tag. Discard the plain-text if the tag is not valid.
+ *
+ */
+
+/* Doubles 'in' in GF(2^128), outputs to 'out'. */
+void AESOcbDouble(uint8_t out[AES_BLOCK_LEN], const uint8_t in[AES_BLOCK_LEN]) {
+  uint8_t carry = (in[0] & 0x80) ? 0x87 : 0x00;
+  uint8_t i;
+
+  for (i = 0; i < AES_BLOCK_LEN - 1; ++i) {
+    out[i] = (uint8_t)((in[i] << 1) | (in[i + 1] >> 7));
+  }
+  out[AES_BLOCK_LEN - 1] = (uint8_t)(in[AES_BLOCK_LEN - 1] << 1) ^ carry;
+}
+
+/* Number of trailing zero bits of 'x' (not zero). */
+uint8_t AESOcbNtz(uint32_t x) {
+  uint8_t n = 0;
+  while ((x & 1) == 0) {
+    x >>= 1;
+    ++n;
+  }
+  return n;
+}
+
+/* Pads the partial block 'buf' of 'len' bytes with 0x80 and zeros. */
+void AESOcbPad(uint8_t buf[AES_BLOCK_LEN], uint8_t len) {
+  buf[len] = 0x80;
+  memset(&buf[len + 1], 0, AES_BLOCK_LEN - 1 - len);
+}
+
+/* Encrypts (or decrypts) 'num' data blocks, at most AES_OCB_BLOCKS. 'out' may
+ * be the same as 'in'. */
+void AESOcbCryptBlocks(struct aes_ocb_t *ocb_ptr, const uint8_t *in_ptr,
+                       uint8_t num, uint8_t *out_ptr, uint8_t decrypt) {
+  uint8_t offsets[AES_OCB_BLOCKS * AES_BLOCK_LEN];
+  uint8_t b[AES_OCB_BLOCKS * AES_BLOCK_LEN];
+  uint8_t j;
+
+  for (j = 0; j < num; ++j) {
+    uint8_t *offset_ptr = &offsets[AES_BLOCK_LEN * j];
+    const uint8_t *block_ptr = &in_ptr[AES_BLOCK_LEN * j];
+
+    ++ocb_ptr->blocks;
+    AESXorBlock(ocb_ptr->offset, ocb_ptr->offset,
+                ocb_ptr->l[AESOcbNtz(ocb_ptr->blocks)]);
+    memcpy(offset_ptr, ocb_ptr->offset, AES_BLOCK_LEN);
+    AESXorBlock(&b[AES_BLOCK_LEN * j], block_ptr, offset_ptr);
+    if (!decrypt) {
+      AESXorBlock(ocb_ptr->checksum, ocb_ptr->checksum, block_ptr);
+    }
+  }
+
+  if (!decrypt) {
+    AESCtxECBEncrypt(&ocb_ptr->ctx, b, AES_BLOCK_LEN * num, b);
+  } else {
+    AESInvCtxECBDecrypt(&ocb_ptr->inv_ctx, b, AES_BLOCK_LEN * num, b);
+  }
+
+  for (j = 0; j < num; ++j) {
+    uint8_t *block_ptr = &out_ptr[AES_BLOCK_LEN * j];
+
+    AESXorBlock(block_ptr, &b[AES_BLOCK_LEN * j], &offsets[AES_BLOCK_LEN * j]);
+    if (decrypt) {
+      AESXorBlock(ocb_ptr->checksum, ocb_ptr->checksum, block_ptr);
+    }
+  }
+}
+
+/* Hashes 'num' associated data blocks, at most AES_OCB_BLOCKS. */
+void AESOcbHashBlocks(struct aes_ocb_t *ocb_ptr, const uint8_t *aad_ptr,
+                      uint8_t num) {
+  uint8_t b[AES_OCB_BLOCKS * AES_BLOCK_LEN];
+  uint8_t j;
+
+  for (j = 0; j < num; ++j) {
+    ++ocb_ptr->aad_blocks;
+    AESXorBlock(ocb_ptr->aad_offset, ocb_ptr->aad_offset,
+                ocb_ptr->l[AESOcbNtz(ocb_ptr->aad_blocks)]);
+    AESXorBlock(&b[AES_BLOCK_LEN * j], &aad_ptr[AES_BLOCK_LEN * j],
+                ocb_ptr->aad_offset);
+  }
+
+  AESCtxECBEncrypt(&ocb_ptr->ctx, b, AES_BLOCK_LEN * num, b);
+
+  for (j = 0; j < num; ++j) {
+    AESXorBlock(ocb_ptr->aad_sum, ocb_ptr->aad_sum, &b[AES_BLOCK_LEN * j]);
+  }
+}
+
+/* Encrypts (or decrypts) whole blocks, buffering the partial block. Returns
+ * the number of bytes written to 'out'. */
+uint32_t AESOcbCrypt(struct aes_ocb_t *ocb_ptr, const uint8_t *in_ptr,
+                     uint32_t length, uint8_t *out_ptr, uint8_t decrypt) {
+  uint32_t out_len = 0;
+  uint32_t n;
+
+  if (ocb_ptr->buf_len > 0) {
+    n = AES_BLOCK_LEN - ocb_ptr->buf_len;
+    if (n > length) {
+      n = length;
+    }
+    memcpy(&ocb_ptr->buf[ocb_ptr->buf_len], in_ptr, n);
+    ocb_ptr->buf_len += (uint8_t)n;
+    in_ptr += n;
+    length -= n;
+
+    if (ocb_ptr->buf_len < AES_BLOCK_LEN) {
+      return 0;
+    }
+    AESOcbCryptBlocks(ocb_ptr, ocb_ptr->buf, 1, out_ptr, decrypt);
+    ocb_ptr->buf_len = 0;
+    out_ptr += AES_BLOCK_LEN;
+    out_len = AES_BLOCK_LEN;
+  }
+
+  while (length >= AES_BLOCK_LEN) {
+    n = length / AES_BLOCK_LEN;
+    if (n > AES_OCB_BLOCKS) {
+      n = AES_OCB_BLOCKS;
+    }
+    AESOcbCryptBlocks(ocb_ptr, in_ptr, (uint8_t)n, out_ptr, decrypt);
+    n *= AES_BLOCK_LEN;
+    in_ptr += n;
+    out_ptr += n;
+    out_len += n;
+    length -= n;
+  }
+
+  memcpy(ocb_ptr->buf, in_ptr, length);
+  ocb_ptr->buf_len = (uint8_t)length;
+  return out_len;
+}
+
+/* Ends the message: outputs the last partial block to 'out', sets 'length'
+ * to its length and computes the full tag. */
+void AESOcbFinish(struct aes_ocb_t *ocb_ptr, uint8_t *out_ptr,
+                  uint8_t *length_ptr, uint8_t tag[AES_OCB_TAG_LEN],
+                  uint8_t decrypt) {
+  uint8_t b[2 * AES_BLOCK_LEN];
+  uint8_t n = 0, i;
+
+  /* Pad = Ek(Offset_*) of the data and the last block of the associated data
+   * are encrypted together. */
+  if (ocb_ptr->buf_len > 0) {
+    AESXorBlock(ocb_ptr->offset, ocb_ptr->offset, ocb_ptr->l_star);
+    memcpy(b, ocb_ptr->offset, AES_BLOCK_LEN);
+    n = AES_BLOCK_LEN;
+  }
+  if (ocb_ptr->aad_buf_len > 0) {
+    AESXorBlock(ocb_ptr->aad_offset, ocb_ptr->aad_offset, ocb_ptr->l_star);
+    AESOcbPad(ocb_ptr->aad_buf, ocb_ptr->aad_buf_len);
+    AESXorBlock(&b[n], ocb_ptr->aad_buf, ocb_ptr->aad_offset);
+    AESCtxECBEncrypt(&ocb_ptr->ctx, b, n + AES_BLOCK_LEN, b);
+    AESXorBlock(ocb_ptr->aad_sum, ocb_ptr->aad_sum, &b[n]);
+    ocb_ptr->aad_buf_len = 0;
+  } else if (n > 0) {
+    AESCtxEncrypt(&ocb_ptr->ctx, b, b);
+  }
+
+  if (ocb_ptr->buf_len > 0) {
+    for (i = 0; i < ocb_ptr->buf_len; ++i) {
+      out_ptr[i] = ocb_ptr->buf[i] ^ b[i];
+    }
+    if (decrypt) {
+      memcpy(ocb_ptr->buf, out_ptr, ocb_ptr->buf_len);
+    }
+    AESOcbPad(ocb_ptr->buf, ocb_ptr->buf_len);
+    AESXorBlock(ocb_ptr->checksum, ocb_ptr->checksum, ocb_ptr->buf);
+  }
+  *length_ptr = ocb_ptr->buf_len;
+  ocb_ptr->buf_len = 0;
+
+  /* Tag = Ek(Checksum ^ Offset ^ L_$) ^ HASH(A) */
+  AESXorBlock(tag, ocb_ptr->checksum, ocb_ptr->offset);
+  AESXorBlock(tag, tag, ocb_ptr->l_dollar);
+  AESCtxEncrypt(&ocb_ptr->ctx, tag, tag);
+  AESXorBlock(tag, tag, ocb_ptr->aad_sum);
+}
+
+/** AES-OCB init
+ *
+ * Expands the key of 'key_len' bytes (16, 24 or 32) and computes the offsets
+ * L_*, L_$ and L_i. Returns 1 on success, 0 if the key length is not supported.
+ */
+uint8_t AESOcbInit(struct aes_ocb_t *ocb_ptr, const uint8_t *key_ptr,
+                   uint8_t key_len) {
+  uint8_t i;
+
+  if (!AESCtxInitKeyLen(&ocb_ptr->ctx, key_ptr, key_len)) {
+    return 0;
+  }
+  AESInvCtxInit(&ocb_ptr->inv_ctx, &ocb_ptr->ctx);
+
+  memset(ocb_ptr->l_star, 0, AES_BLOCK_LEN);
+  AESCtxEncrypt(&ocb_ptr->ctx, ocb_ptr->l_star, ocb_ptr->l_star);
+  AESOcbDouble(ocb_ptr->l_dollar, ocb_ptr->l_star);
+  AESOcbDouble(ocb_ptr->l[0], ocb_ptr->l_dollar);
+  for (i = 1; i < AES_OCB_L_LEN; ++i) {
+    AESOcbDouble(ocb_ptr->l[i], ocb_ptr->l[i - 1]);
+  }
+
+  /* Valid nonce blocks are never zero: no stretch computed yet. */
+  memset(ocb_ptr->ktop_in, 0, AES_BLOCK_LEN);
+  return 1;
+}
+
+/** AES-OCB start
+ *
+ * Starts a message with the nonce 'nonce' of 'nonce_len' bytes (1 to 15) and a
+ * tag of 'tag_len' bytes (1 to 16). Returns 1 on success, 0 if a parameter is
+ * not valid.
+ */
+uint8_t AESOcbStart(struct aes_ocb_t *ocb_ptr, const uint8_t *nonce_ptr,
+                    uint8_t nonce_len, uint8_t tag_len) {
+  uint8_t nonce[AES_BLOCK_LEN];
+  uint8_t bottom, shift, i;
+
+  if (nonce_len < 1 || nonce_len > AES_OCB_MAX_NONCE_LEN || tag_len < 1 ||
+      tag_len > AES_OCB_TAG_LEN) {
+    return 0;
+  }
+
+  /* Nonce = taglen (7 bits) | zeros | 1 | N */
+  memset(nonce, 0, AES_BLOCK_LEN);
+  nonce[0] = (uint8_t)(((8 * tag_len) % 128) << 1);
+  nonce[AES_BLOCK_LEN - 1 - nonce_len] |= 1;
+  memcpy(&nonce[AES_BLOCK_LEN - nonce_len], nonce_ptr, nonce_len);
+  bottom = nonce[AES_BLOCK_LEN - 1] & 0x3F;
+  nonce[AES_BLOCK_LEN - 1] &= 0xC0;
+
+  /* Stretch = Ktop | (Ktop[0..7] ^ Ktop[1..8]), Ktop = Ek(Nonce with the last
+   * 6 bits cleared) */
+  if (memcmp(nonce, ocb_ptr->ktop_in, AES_BLOCK_LEN) != 0) {
+    memcpy(ocb_ptr->ktop_in, nonce, AES_BLOCK_LEN);
+    AESCtxEncrypt(&ocb_ptr->ctx, nonce, ocb_ptr->stretch);
+    for (i = 0; i < 8; ++i) {
+      ocb_ptr->stretch[AES_BLOCK_LEN + i] =
+          ocb_ptr->stretch[i] ^ ocb_ptr->stretch[i + 1];
+    }
+  }
+
+  /* Offset_0 = Stretch[bottom..bottom + 127] (bits) */
+  shift = bottom % 8;
+  for (i = 0; i < AES_BLOCK_LEN; ++i) {
+    const uint8_t *s_ptr = &ocb_ptr->stretch[bottom / 8 + i];
+    ocb_ptr->offset[i] =
+        (uint8_t)((s_ptr[0] << shift) | (s_ptr[1] >> (8 - shift)));
+  }
+
+  memset(ocb_ptr->checksum, 0, AES_BLOCK_LEN);
+  memset(ocb_ptr->aad_offset, 0, AES_BLOCK_LEN);
+  memset(ocb_ptr->aad_sum, 0, AES_BLOCK_LEN);
+  ocb_ptr->blocks = 0;
+  ocb_ptr->aad_blocks = 0;
+  ocb_ptr->buf_len = 0;
+  ocb_ptr->aad_buf_len = 0;
+  ocb_ptr->tag_len = tag_len;
+  return 1;
+}
+
+/** AES-OCB associated data
+ *
+ * Authenticates 'length' bytes of 'aad'. Can be called many times, at any
+ * point of the message before it finishes.
+ */
+void AESOcbAad(struct aes_ocb_t *ocb_ptr, const uint8_t *aad_ptr,
+               uint32_t length) {
+  uint32_t n;
+
+  if (ocb_ptr->aad_buf_len > 0) {
+    n = AES_BLOCK_LEN - ocb_ptr->aad_buf_len;
+    if (n > length) {
+      n = length;
+    }
+    memcpy(&ocb_ptr->aad_buf[ocb_ptr->aad_buf_len], aad_ptr, n);
+    ocb_ptr->aad_buf_len += (uint8_t)n;
+    aad_ptr += n;
+    length -= n;
+
+    if (ocb_ptr->aad_buf_len < AES_BLOCK_LEN) {
+      return;
+    }
+    AESOcbHashBlocks(ocb_ptr, ocb_ptr->aad_buf, 1);
+    ocb_ptr->aad_buf_len = 0;
+  }
+
+  while (length >= AES_BLOCK_LEN) {
+    n = length / AES_BLOCK_LEN;
+    if (n > AES_OCB_BLOCKS) {
+      n = AES_OCB_BLOCKS;
+    }
+    AESOcbHashBlocks(ocb_ptr, aad_ptr, (uint8_t)n);
+    n *= AES_BLOCK_LEN;
+    aad_ptr += n;
+    length -= n;
+  }
+
+  memcpy(ocb_ptr->aad_buf, aad_ptr, length);
+  ocb_ptr->aad_buf_len = (uint8_t)length;
+}
+
+/** AES-OCB encrypt
+ *
+ * Encrypts 'length' bytes of 'plain', outputs cipher-text to 'cipher'. Returns
+ * the number of bytes written to 'cipher'. A partial block is kept until more
+ * data comes or AESOcbEncryptFinish().
+ */
+uint32_t AESOcbEncrypt(struct aes_ocb_t *ocb_ptr, const uint8_t *plain_ptr,
+                       uint32_t length, uint8_t *cipher_ptr) {
+  return AESOcbCrypt(ocb_ptr, plain_ptr, length, cipher_ptr, 0);
+}
+
+/** AES-OCB encrypt finish
+ *
+ * Ends the message. Outputs the buffered partial block to 'cipher' and sets
+ * 'length' to its length (0 to AES_BLOCK_LEN - 1). Outputs the authentication
+ * tag ('tag_len' bytes) to 'tag'.
+ */
+void AESOcbEncryptFinish(struct aes_ocb_t *ocb_ptr, uint8_t *cipher_ptr,
+                         uint8_t *length_ptr, uint8_t *tag_ptr) {
+  uint8_t tag[AES_OCB_TAG_LEN];
+
+  AESOcbFinish(ocb_ptr, cipher_ptr, length_ptr, tag, 0);
+  memcpy(tag_ptr, tag, ocb_ptr->tag_len);
+}
+
+/** AES-OCB decrypt
+ *
+ * Decrypts 'length' bytes of 'cipher', outputs plain-text to 'plain'. Returns
+ * the number of bytes written to 'plain'. A partial block is kept until more
+ * data comes or AESOcbDecryptFinish().
+ */
+uint32_t AESOcbDecrypt(struct aes_ocb_t *ocb_ptr, const uint8_t *cipher_ptr,
+                       uint32_t length, uint8_t *plain_ptr) {
+  return AESOcbCrypt(ocb_ptr, cipher_ptr, length, plain_ptr, 1);
+}
+
+/** AES-OCB decrypt finish
+ *
+ * Ends the message. Outputs the buffered partial block to 'plain' and sets
+ * 'length' to its length (0 to AES_BLOCK_LEN - 1). Returns 1 if the tag of the
+ * message is equal to 'tag' ('tag_len' bytes), 0 otherwise. Compares in
+ * constant time.
+ */
+uint8_t AESOcbDecryptFinish(struct aes_ocb_t *ocb_ptr, uint8_t *plain_ptr,
+                            uint8_t *length_ptr, const uint8_t *tag_ptr) {
+  uint8_t tag[AES_OCB_TAG_LEN];
+  uint8_t i, diff = 0;
+
+  AESOcbFinish(ocb_ptr, plain_ptr, length_ptr, tag, 1);
+
+  for (i = 0; i < ocb_ptr->tag_len; ++i) {
+    diff |= tag[i] ^ tag_ptr[i];
+  }
+  return diff == 0;
+}
@@ -0,0 +1,270 @@
+/*
+ AES PRNG (CTR-DRBG pseudo random number generator).
+
+ Copyright 2021 Djones A. Boni
+
+ Licensed under the Apache License, Version 2.0 (the "License");
+ you may not use this file except in compliance with the License.
+ You may obtain a copy of the License at
+
+ http://www.apache.org/licenses/LICENSE-2.0
+
+ Unless required by applicable law or agreed to in writing, software
+ distributed under the License is distributed on an "AS IS" BASIS,
+ WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ See the License for the specific language governing permissions and
+ limitations under the License.
+*/
+
+#include "aes_prng.h"
+#include <string.h>
+
+#if (AES_PRNG_KEY_LEN != 16 && AES_PRNG_KEY_LEN != 24 &&                      \
+     AES_PRNG_KEY_LEN != 32) ||                                                \
+    AES_PRNG_KEY_LEN > AES_MAX_KEY_LEN
+#error "Invalid key length AES_PRNG_KEY_LEN."
+#endif
+#if (AES_PRNG_RESEED_INTERVAL <= 0)
+#error "Invalid parameter AES_PRNG_RESEED_INTERVAL."
+#endif
+
+/******************************************************************************/
+
+/*
+ * CTR_DRBG: the random bytes are the encryption of a counter V with the key
+ * K, and after each call K and V are replaced by more encrypted counter
+ * blocks (backtracking resistance). The counter blocks of a call are
+ * independent, so they are encrypted with AESCtxECBEncrypt(), which runs 8
+ * blocks at a time with AES-NI.
+ *
+ * The data given to seed() goes through the block cipher derivation function
+ * (Block_Cipher_df), so it can have any length and does not need to have full
+ * entropy. The seed length (key and V) is encrypted together in every step of
+ * the derivation function.
+ *
+ * If the PRNG is DETERMINISTIC (AES_PRNG_DEBUG == 1) the state will be zeroed
+ * at the start of seed() (CTR_DRBG instantiate). Otherwise the state is kept
+ * in a RAM section that is not zeroed on initialization (section .noinit) and
+ * seed() mixes the data into it (CTR_DRBG reseed).
+ *
+ * seed() must be called before random(). random() returns 0, without output,
+ * after AES_PRNG_RESEED_INTERVAL calls without seed(). Each call outputs at
+ * most AES_PRNG_MAX_REQUEST bytes, larger requests count as many calls.
+ *
+ * The things you can send into the entropy pool via buff_ptr when calling
+ * seed() are the same as for KECCAK_PRNG (keccak_prng.c).
+ */
+
+#if defined(AES_PRNG_DEBUG) && AES_PRNG_DEBUG == 1
+struct aes_prng_t Aes_Prng_State __attribute__((section(".noinit")));
+#else
+static struct aes_prng_t Aes_Prng_State __attribute__((section(".noinit")));
+#endif
+
+/* Counter blocks encrypted at a time. */
+#define AES_PRNG_BLOCKS 8
+
+/* Seed length rounded up to whole blocks (40 => 48 bytes for AES-192). Only
+ * the first AES_PRNG_SEED_LEN bytes are used. */
+#define AES_PRNG_SEED_BLOCKS_LEN                                               \
+  ((AES_PRNG_SEED_LEN + AES_BLOCK_LEN - 1) / AES_BLOCK_LEN * AES_BLOCK_LEN)
+
+/* Derivation function state: the BCC chaining values of all the blocks of
+ * the seed length and a partial block. */
+struct aes_prng_df_t {
+  struct aes_ctx_t ctx;
+  uint8_t x[AES_PRNG_SEED_BLOCKS_LEN];
+  uint8_t buf[AES_BLOCK_LEN];
+  uint8_t buf_len;
+};
+
+/* Writes 'x' big-endian in 4 bytes. */
+void AESPrngStore32(uint8_t *ptr, uint32_t x) {
+  ptr[0] = (uint8_t)(x >> 24);
+  ptr[1] = (uint8_t)(x >> 16);
+  ptr[2] = (uint8_t)(x >> 8);
+  ptr[3] = (uint8_t)x;
+}
+
+/* Increments the counter block V (big-endian, all the 16 bytes). */
+void AESPrngIncrement(uint8_t v[AES_BLOCK_LEN]) {
+  uint8_t i = AES_BLOCK_LEN - 1;
+  while (++v[i] == 0 && i > 0) {
+    --i;
+  }
+}
+
+/* Updates the BCC chaining values with the full buffer block. */
+void AESPrngDfBlock(struct aes_prng_df_t *df_ptr) {
+  uint8_t i;
+
+  for (i = 0; i < AES_PRNG_SEED_BLOCKS_LEN; ++i) {
+    df_ptr->x[i] ^= df_ptr->buf[i % AES_BLOCK_LEN];
+  }
+  AESCtxECBEncrypt(&df_ptr->ctx, df_ptr->x, AES_PRNG_SEED_BLOCKS_LEN,
+                   df_ptr->x);
+  df_ptr->buf_len = 0;
+}
+
+/* Adds 'num' bytes of 'buff' to the derivation function input. */
+void AESPrngDfUpdate(struct aes_prng_df_t *df_ptr, const uint8_t *buff_ptr,
+                     uint32_t num) {
+  uint32_t n;
+
+  while (num > 0) {
+    n = AES_BLOCK_LEN - df_ptr->buf_len;
+    if (n > num) {
+      n = num;
+    }
+    memcpy(&df_ptr->buf[df_ptr->buf_len], buff_ptr, n);
+    df_ptr->buf_len += (uint8_t)n;
+    buff_ptr += n;
+    num -= n;
+
+    if (df_ptr->buf_len == AES_BLOCK_LEN) {
+      AESPrngDfBlock(df_ptr);
+    }
+  }
+}
+
+/* Starts the derivation function of an input of 'num' bytes. */
+void AESPrngDfStart(struct aes_prng_df_t *df_ptr, uint32_t num) {
+  uint8_t key[AES_PRNG_KEY_LEN];
+  uint8_t i;
+
+  for (i = 0; i < AES_PRNG_KEY_LEN; ++i) {
+    key[i] = i;
+  }
+  AESCtxInitKeyLen(&df_ptr->ctx, key, AES_PRNG_KEY_LEN);
+
+  /* BCC(K, IV_i | S) for each block i of the seed length: the chaining values
+   * start with the encrypted IV_i = i | zeros. */
+  memset(df_ptr->x, 0, AES_PRNG_SEED_BLOCKS_LEN);
+  for (i = 0; i < AES_PRNG_SEED_BLOCKS_LEN / AES_BLOCK_LEN; ++i) {
+    AESPrngStore32(&df_ptr->x[AES_BLOCK_LEN * i], i);
+  }
+  AESCtxECBEncrypt(&df_ptr->ctx, df_ptr->x, AES_PRNG_SEED_BLOCKS_LEN,
+                   df_ptr->x);
+
+  /* S = L | N | input | 0x80 | zeros */
+  AESPrngStore32(&df_ptr->buf[0], num);
+  AESPrngStore32(&df_ptr->buf[4], AES_PRNG_SEED_LEN);
+  df_ptr->buf_len = 8;
+}
+
+/* Ends the derivation function, outputs the seed material to 'seed'. */
+void AESPrngDfFinish(struct aes_prng_df_t *df_ptr,
+                     uint8_t seed[AES_PRNG_SEED_LEN]) {
+  uint8_t temp[AES_PRNG_SEED_BLOCKS_LEN];
+  uint8_t i;
+
+  df_ptr->buf[df_ptr->buf_len++] = 0x80;
+  memset(&df_ptr->buf[df_ptr->buf_len], 0, AES_BLOCK_LEN - df_ptr->buf_len);
+  AESPrngDfBlock(df_ptr);
+
+  /* K = leftmost bytes, X = next block, seed = E(X) | E(E(X)) | ... */
+  AESCtxInitKeyLen(&df_ptr->ctx, df_ptr->x, AES_PRNG_KEY_LEN);
+  AESCtxEncrypt(&df_ptr->ctx, &df_ptr->x[AES_PRNG_KEY_LEN], temp);
+  for (i = AES_BLOCK_LEN; i < AES_PRNG_SEED_LEN; i += AES_BLOCK_LEN) {
+    AESCtxEncrypt(&df_ptr->ctx, &temp[i - AES_BLOCK_LEN], &temp[i]);
+  }
+  memcpy(seed, temp, AES_PRNG_SEED_LEN);
+}
+
+/* CTR_DRBG update: replaces the key and V with the next counter blocks XOR
+ * 'data' (AES_PRNG_SEED_LEN bytes or NULL). */
+void AESPrngUpdate(struct aes_prng_t *prng_ptr, const uint8_t *data_ptr) {
+  uint8_t temp[AES_PRNG_SEED_BLOCKS_LEN];
+  uint8_t i;
+
+  for (i = 0; i < AES_PRNG_SEED_LEN; i += AES_BLOCK_LEN) {
+    AESPrngIncrement(prng_ptr->v);
+    memcpy(&temp[i], prng_ptr->v, AES_BLOCK_LEN);
+  }
+  AESCtxECBEncrypt(&prng_ptr->ctx, temp, AES_PRNG_SEED_BLOCKS_LEN, temp);
+
+  if (data_ptr != NULL) {
+    for (i = 0; i < AES_PRNG_SEED_LEN; ++i) {
+      temp[i] ^= data_ptr[i];
+    }
+  }
+
+  memcpy(prng_ptr->key, temp, AES_PRNG_KEY_LEN);
+  memcpy(prng_ptr->v, &temp[AES_PRNG_KEY_LEN], AES_BLOCK_LEN);
+  AESCtxInitKeyLen(&prng_ptr->ctx, prng_ptr->key, AES_PRNG_KEY_LEN);
+}
+
+/* Outputs 'num' (at most AES_PRNG_MAX_REQUEST) random bytes to 'buff'. */
+void AESPrngGenerate(struct aes_prng_t *prng_ptr, uint8_t *buff_ptr,
+                     uint32_t num) {
+  uint8_t b[AES_PRNG_BLOCKS * AES_BLOCK_LEN];
+  uint8_t *v_ptr = prng_ptr->v;
+  uint32_t i, n;
+
+  /* Many counter blocks at a time. Without a carry out of the last byte, the
+   * blocks are copies of V with the last byte changed: incrementing V and
+   * copying it for each block is slower (byte store, then wide load). */
+  while (num > 0) {
+    n = num < sizeof(b) ? num : sizeof(b);
+    if (v_ptr[AES_BLOCK_LEN - 1] < 256 - AES_PRNG_BLOCKS) {
+      for (i = 0; i < n; i += AES_BLOCK_LEN) {
+        memcpy(&b[i], v_ptr, AES_BLOCK_LEN);
+        b[i + AES_BLOCK_LEN - 1] =
+            (uint8_t)(v_ptr[AES_BLOCK_LEN - 1] + i / AES_BLOCK_LEN + 1);
+      }
+      v_ptr[AES_BLOCK_LEN - 1] = b[i - 1];
+    } else {
+      for (i = 0; i < n; i += AES_BLOCK_LEN) {
+        AESPrngIncrement(v_ptr);
+        memcpy(&b[i], v_ptr, AES_BLOCK_LEN);
+      }
+    }
+
+    if (n % AES_BLOCK_LEN == 0) {
+      AESCtxECBEncrypt(&prng_ptr->ctx, b, n, buff_ptr);
+    } else {
+      AESCtxECBEncrypt(&prng_ptr->ctx, b, i, b);
+      memcpy(buff_ptr, b, n);
+    }
+    buff_ptr += n;
+    num -= n;
+  }
+
+  AESPrngUpdate(prng_ptr, NULL);
+  ++prng_ptr->reseed_counter;
+}
+
+void AESPrngSeed(const void *buff_ptr, uint32_t num) {
+  struct aes_prng_df_t df;
+  uint8_t seed[AES_PRNG_SEED_LEN];
+
+  AESPrngDfStart(&df, num);
+  AESPrngDfUpdate(&df, (const uint8_t *)buff_ptr, num);
+  AESPrngDfFinish(&df, seed);
+
+#if defined(AES_PRNG_DEBUG) && AES_PRNG_DEBUG == 1
+  memset(Aes_Prng_State.key, 0, AES_PRNG_KEY_LEN);
+  memset(Aes_Prng_State.v, 0, AES_BLOCK_LEN);
+#endif
+  AESCtxInitKeyLen(&Aes_Prng_State.ctx, Aes_Prng_State.key, AES_PRNG_KEY_LEN);
+  AESPrngUpdate(&Aes_Prng_State, seed);
+  Aes_Prng_State.reseed_counter = 1;
+}
+
+uint8_t AESPrngRandom(void *buff_ptr, uint32_t num) {
+  uint8_t *out_ptr = (uint8_t *)buff_ptr;
+  uint32_t n;
+
+  do {
+    if (Aes_Prng_State.reseed_counter > AES_PRNG_RESEED_INTERVAL) {
+      return 0;
+    }
+
+    n = num < AES_PRNG_MAX_REQUEST ? num : AES_PRNG_MAX_REQUEST;
+    AESPrngGenerate(&Aes_Prng_State, out_ptr, n);
+    out_ptr += n;
+    num -= n;
+  } while (num > 0);
+
+  return 1;
+}
@@ -0,0 +1,408 @@
+/*
+ AES-XTS storage encryption.
+
+ Copyright 2021 Djones A. Boni
+
+ Licensed under the Apache License, Version 2.0 (the "License");
+ you may not use this file except in compliance with the License.
+ You may obtain a copy of the License at
+
+ http://www.apache.org/licenses/LICENSE-2.0
+
+ Unless required by applicable law or agreed to in writing, software
+ distributed under the License is distributed on an "AS IS" BASIS,
+ WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ See the License for the specific language governing permissions and
+ limitations under the License.
+*/
+
+#include "aes_xts.h"
+#include <string.h>
+
+#if AES_AESNI
+#include <emmintrin.h>
+#include <wmmintrin.h>
+#define AES_XTS_TARGET __attribute__((target("aes,sse2")))
+#endif
+
+/* AES XTS.
+ *
+ * XEX-based tweaked code book mode with cipher-text stealing (IEEE 1619,
+ * NIST SP 800-38E). Each data unit (sector) is encrypted with its own tweak,
+ * usually the sector number, and the cipher-text has the same length as the
+ * plain-text (at least AES_BLOCK_LEN bytes, not necessarily a multiple of it).
+ *
+ * The blocks of a sector are independent: AES_XTS_BLOCKS tweaks are computed
+ * and the blocks encrypted at a time. With AES-NI the tweaks are computed in
+ * SSE registers and interleaved with the rounds of the 8 blocks, otherwise the
+ * blocks are encrypted with AESCtxECBEncrypt(). AESXtsEncryptSectors() also
+ * encrypts the tweaks of AES_XTS_BLOCKS consecutive sectors at a time.
+ *
+ * The key has two halves of 16, 24 or 32 bytes, the data key and the tweak
+ * key, which must be different.
+ *
+ * struct aes_xts_t xts;
+ * AESXtsInit(&xts, key, 32);
+ * AESXtsEncryptSectors(&xts, first_sector, 512, num_sectors, data, data);
+ * // ...
+ * AESXtsDecryptSectors(&xts, first_sector, 512, num_sectors, data, data);
+ *
+ * XTS does not authenticate the data.
+ */
+
+/* Little-endian load and store, written out so that the compiler can use a
+ * single 64-bit access. */
+uint64_t AESXtsLoad64(const uint8_t *ptr) {
+  return (uint64_t)ptr[0] | ((uint64_t)ptr[1] << 8) |
+         ((uint64_t)ptr[2] << 16) | ((uint64_t)ptr[3] << 24) |
+         ((uint64_t)ptr[4] << 32) | ((uint64_t)ptr[5] << 40) |
+         ((uint64_t)ptr[6] << 48) | ((uint64_t)ptr[7] << 56);
+}
+
+void AESXtsStore64(uint8_t *ptr, uint64_t x) {
+  ptr[0] = (uint8_t)x;
+  ptr[1] = (uint8_t)(x >> 8);
+  ptr[2] = (uint8_t)(x >> 16);
+  ptr[3] = (uint8_t)(x >> 24);
+  ptr[4] = (uint8_t)(x >> 32);
+  ptr[5] = (uint8_t)(x >> 40);
+  ptr[6] = (uint8_t)(x >> 48);
+  ptr[7] = (uint8_t)(x >> 56);
+}
+
+/* Outputs 'num' consecutive tweaks, starting from 't', to 'tweaks'. Each tweak
+ * is the previous one multiplied by x in GF(2^128), 't' is advanced to the
+ * next one. */
+void AESXtsTweaks(uint8_t t[AES_BLOCK_LEN], uint8_t *tweaks_ptr, uint8_t num) {
+  uint64_t lo = AESXtsLoad64(&t[0]);
+  uint64_t hi = AESXtsLoad64(&t[8]);
+  uint64_t carry;
+
+  for (; num > 0; --num) {
+    AESXtsStore64(&tweaks_ptr[0], lo);
+    AESXtsStore64(&tweaks_ptr[8], hi);
+    tweaks_ptr += AES_BLOCK_LEN;
+
+    carry = hi >> 63;
+    hi = (hi << 1) | (lo >> 63);
+    lo = (lo << 1) ^ (carry * 0x87);
+  }
+
+  AESXtsStore64(&t[0], lo);
+  AESXtsStore64(&t[8], hi);
+}
+
+#if AES_AESNI
+
+/* Multiplies the tweak by x: shifts both 64-bit halves left and adds the bits
+ * shifted out, bit 63 into bit 64 and bit 127 as the reduction 0x87. */
+AES_XTS_TARGET
+static __m128i AESXtsNiMulX(__m128i t) {
+  __m128i carry = _mm_srai_epi32(t, 31);
+  carry = _mm_shuffle_epi32(carry, 0x13);
+  carry = _mm_and_si128(carry, _mm_set_epi32(0, 1, 0, 0x87));
+  return _mm_xor_si128(_mm_add_epi64(t, t), carry);
+}
+
+#define AES_XTS_NI_ROUND8(instr, a, k)                                         \
+  do {                                                                         \
+    const __m128i round_key = (k);                                             \
+    a[0] = instr(a[0], round_key);                                             \
+    a[1] = instr(a[1], round_key);                                             \
+    a[2] = instr(a[2], round_key);                                             \
+    a[3] = instr(a[3], round_key);                                             \
+    a[4] = instr(a[4], round_key);                                             \
+    a[5] = instr(a[5], round_key);                                             \
+    a[6] = instr(a[6], round_key);                                             \
+    a[7] = instr(a[7], round_key);                                             \
+  } while (0)
+
+/* Encrypts or decrypts 'num' groups of 8 blocks starting with the tweak 't',
+ * which is advanced. 'subkeys' are the inverse cipher round keys to decrypt. */
+AES_XTS_TARGET
+static void AESXtsNiBlocks8(const uint8_t subkeys[AES_SUBKEYS_LEN],
+                            uint8_t rounds, uint8_t t[AES_BLOCK_LEN],
+                            const uint8_t *in_ptr, uint32_t num,
+                            uint8_t *out_ptr, uint8_t decrypt) {
+  const __m128i *k = (const __m128i *)subkeys;
+  __m128i tweak = _mm_loadu_si128((const __m128i *)t);
+  __m128i tweaks[8];
+  __m128i a[8];
+  uint8_t round, j;
+
+  for (; num > 0; --num) {
+    for (j = 0; j < 8; ++j) {
+      tweaks[j] = tweak;
+      tweak = AESXtsNiMulX(tweak);
+      a[j] = _mm_xor_si128(
+          _mm_loadu_si128((const __m128i *)&in_ptr[AES_BLOCK_LEN * j]),
+          tweaks[j]);
+    }
+
+    AES_XTS_NI_ROUND8(_mm_xor_si128, a, _mm_loadu_si128(&k[0]));
+    if (decrypt) {
+      for (round = 1; round < rounds; ++round) {
+        AES_XTS_NI_ROUND8(_mm_aesdec_si128, a, _mm_loadu_si128(&k[round]));
+      }
+      AES_XTS_NI_ROUND8(_mm_aesdeclast_si128, a, _mm_loadu_si128(&k[rounds]));
+    } else {
+      for (round = 1; round < rounds; ++round) {
+        AES_XTS_NI_ROUND8(_mm_aesenc_si128, a, _mm_loadu_si128(&k[round]));
+      }
+      AES_XTS_NI_ROUND8(_mm_aesenclast_si128, a, _mm_loadu_si128(&k[rounds]));
+    }
+
+    for (j = 0; j < 8; ++j) {
+      _mm_storeu_si128((__m128i *)&out_ptr[AES_BLOCK_LEN * j],
+                       _mm_xor_si128(a[j], tweaks[j]));
+    }
+
+    in_ptr += 8 * AES_BLOCK_LEN;
+    out_ptr += 8 * AES_BLOCK_LEN;
+  }
+
+  _mm_storeu_si128((__m128i *)t, tweak);
+}
+
+#endif /* AES_AESNI */
+
+/* Encrypts or decrypts one block with the tweak 'tweak'. */
+void AESXtsBlock(const struct aes_xts_t *xts_ptr,
+                 const uint8_t tweak[AES_BLOCK_LEN], const uint8_t *in_ptr,
+                 uint8_t *out_ptr, uint8_t decrypt) {
+  uint8_t b[AES_BLOCK_LEN];
+  uint8_t i;
+
+  for (i = 0; i < AES_BLOCK_LEN; ++i) {
+    b[i] = in_ptr[i] ^ tweak[i];
+  }
+  if (decrypt) {
+    AESInvCtxDecrypt(&xts_ptr->inv_ctx, b, b);
+  } else {
+    AESCtxEncrypt(&xts_ptr->ctx, b, b);
+  }
+  for (i = 0; i < AES_BLOCK_LEN; ++i) {
+    out_ptr[i] = b[i] ^ tweak[i];
+  }
+}
+
+/* Encrypts or decrypts 'length' bytes (multiple of AES_BLOCK_LEN) starting
+ * with the tweak 't', which is advanced. */
+void AESXtsBlocks(const struct aes_xts_t *xts_ptr, uint8_t t[AES_BLOCK_LEN],
+                  const uint8_t *in_ptr, uint32_t length, uint8_t *out_ptr,
+                  uint8_t decrypt) {
+  uint8_t tweaks[AES_XTS_BLOCKS * AES_BLOCK_LEN];
+  uint32_t n, i;
+
+#if AES_AESNI
+  if (AESNiSupported()) {
+    n = length / (8 * AES_BLOCK_LEN);
+    if (decrypt) {
+      AESXtsNiBlocks8(xts_ptr->inv_ctx.subkeys, xts_ptr->inv_ctx.rounds, t,
+                      in_ptr, n, out_ptr, 1);
+    } else {
+      AESXtsNiBlocks8(xts_ptr->ctx.subkeys, xts_ptr->ctx.rounds, t, in_ptr, n,
+                      out_ptr, 0);
+    }
+    in_ptr += 8 * AES_BLOCK_LEN * n;
+    out_ptr += 8 * AES_BLOCK_LEN * n;
+    length -= 8 * AES_BLOCK_LEN * n;
+  }
+#endif
+
+  while (length > 0) {
+    n = AES_XTS_BLOCKS * AES_BLOCK_LEN;
+    if (n > length) {
+      n = length;
+    }
+
+    AESXtsTweaks(t, tweaks, (uint8_t)(n / AES_BLOCK_LEN));
+    for (i = 0; i < n; ++i) {
+      out_ptr[i] = in_ptr[i] ^ tweaks[i];
+    }
+    if (decrypt) {
+      AESInvCtxECBDecrypt(&xts_ptr->inv_ctx, out_ptr, n, out_ptr);
+    } else {
+      AESCtxECBEncrypt(&xts_ptr->ctx, out_ptr, n, out_ptr);
+    }
+    for (i = 0; i < n; ++i) {
+      out_ptr[i] ^= tweaks[i];
+    }
+
+    in_ptr += n;
+    out_ptr += n;
+    length -= n;
+  }
+}
+
+/* Encrypts or decrypts one data unit, 't' is its encrypted tweak. */
+uint8_t AESXtsCrypt(const struct aes_xts_t *xts_ptr,
+                    const uint8_t t[AES_BLOCK_LEN], const uint8_t *in_ptr,
+                    uint32_t length, uint8_t *out_ptr, uint8_t decrypt) {
+  uint8_t tweak[AES_BLOCK_LEN];
+  uint8_t tweaks[2 * AES_BLOCK_LEN];
+  uint8_t a[AES_BLOCK_LEN];
+  uint8_t b[AES_BLOCK_LEN];
+  uint8_t partial = length % AES_BLOCK_LEN;
+  uint32_t whole = length - partial;
+
+  if (length < AES_BLOCK_LEN) {
+    return 0;
+  }
+
+  /* Leave the last whole block for the cipher-text stealing. */
+  if (partial > 0) {
+    whole -= AES_BLOCK_LEN;
+  }
+
+  memcpy(tweak, t, AES_BLOCK_LEN);
+  AESXtsBlocks(xts_ptr, tweak, in_ptr, whole, out_ptr, decrypt);
+
+  if (partial > 0) {
+    in_ptr += whole;
+    out_ptr += whole;
+
+    /* Encryption uses the tweaks m-1 and m, decryption m and m-1. */
+    AESXtsTweaks(tweak, tweaks, 2);
+    AESXtsBlock(xts_ptr, &tweaks[decrypt ? AES_BLOCK_LEN : 0], in_ptr, a,
+                decrypt);
+
+    /* The partial block steals the tail of the previous one. */
+    memcpy(b, a, AES_BLOCK_LEN);
+    memcpy(b, &in_ptr[AES_BLOCK_LEN], partial);
+    memcpy(&out_ptr[AES_BLOCK_LEN], a, partial);
+
+    AESXtsBlock(xts_ptr, &tweaks[decrypt ? 0 : AES_BLOCK_LEN], b, out_ptr,
+                decrypt);
+  }
+
+  return 1;
+}
+
+/* Encrypts or decrypts 'num_sectors' data units, AES_XTS_BLOCKS tweaks at a
+ * time. */
+uint8_t AESXtsSectors(const struct aes_xts_t *xts_ptr, uint64_t sector,
+                      uint32_t sector_len, uint32_t num_sectors,
+                      const uint8_t *in_ptr, uint8_t *out_ptr,
+                      uint8_t decrypt) {
+  uint8_t tweaks[AES_XTS_BLOCKS * AES_BLOCK_LEN];
+  uint8_t n, i;
+
+  if (sector_len < AES_BLOCK_LEN) {
+    return 0;
+  }
+
+  while (num_sectors > 0) {
+    n = AES_XTS_BLOCKS;
+    if (n > num_sectors) {
+      n = (uint8_t)num_sectors;
+    }
+
+    /* The tweak is the sector number, 128-bit little-endian. */
+    memset(tweaks, 0, n * AES_BLOCK_LEN);
+    for (i = 0; i < n; ++i) {
+      AESXtsStore64(&tweaks[i * AES_BLOCK_LEN], sector + i);
+    }
+    AESCtxECBEncrypt(&xts_ptr->tweak_ctx, tweaks, n * AES_BLOCK_LEN, tweaks);
+
+    for (i = 0; i < n; ++i) {
+      AESXtsCrypt(xts_ptr, &tweaks[i * AES_BLOCK_LEN], in_ptr, sector_len,
+                  out_ptr, decrypt);
+      in_ptr += sector_len;
+      out_ptr += sector_len;
+    }
+
+    sector += n;
+    num_sectors -= n;
+  }
+
+  return 1;
+}
+
+/** AES-XTS init
+ *
+ * Expands the key of 'key_len' bytes (32, 48 or 64): the first half is the
+ * data key and the second half the tweak key. Returns 1 on success, 0 if the
+ * key length is not supported or the two halves are equal.
+ */
+uint8_t AESXtsInit(struct aes_xts_t *xts_ptr, const uint8_t *key_ptr,
+                   uint8_t key_len) {
+  uint8_t half = key_len / 2;
+  uint8_t i, diff = 0;
+
+  if (key_len % 2 != 0) {
+    return 0;
+  }
+
+  for (i = 0; i < half; ++i) {
+    diff |= key_ptr[i] ^ key_ptr[half + i];
+  }
+  if (diff == 0) {
+    return 0;
+  }
+
+  if (!AESCtxInitKeyLen(&xts_ptr->ctx, key_ptr, half) ||
+      !AESCtxInitKeyLen(&xts_ptr->tweak_ctx, &key_ptr[half], half)) {
+    return 0;
+  }
+  AESInvCtxInit(&xts_ptr->inv_ctx, &xts_ptr->ctx);
+  return 1;
+}
+
+/** AES-XTS encrypt
+ *
+ * Encrypts one data unit of 'length' bytes (at least AES_BLOCK_LEN) of 'plain'
+ * with the tweak 'tweak', outputs cipher-text to 'cipher' (may be the same as
+ * 'plain'). Returns 1 on success, 0 if the data unit is too short.
+ */
+uint8_t AESXtsEncrypt(const struct aes_xts_t *xts_ptr,
+                      const uint8_t tweak[AES_BLOCK_LEN],
+                      const uint8_t *plain_ptr, uint32_t length,
+                      uint8_t *cipher_ptr) {
+  uint8_t t[AES_BLOCK_LEN];
+  AESCtxEncrypt(&xts_ptr->tweak_ctx, tweak, t);
+  return AESXtsCrypt(xts_ptr, t, plain_ptr, length, cipher_ptr, 0);
+}
+
+/** AES-XTS decrypt
+ *
+ * Decrypts one data unit of 'length' bytes (at least AES_BLOCK_LEN) of
+ * 'cipher' with the tweak 'tweak', outputs plain-text to 'plain' (may be the
+ * same as 'cipher'). Returns 1 on success, 0 if the data unit is too short.
+ */
+uint8_t AESXtsDecrypt(const struct aes_xts_t *xts_ptr,
+                      const uint8_t tweak[AES_BLOCK_LEN],
+                      const uint8_t *cipher_ptr, uint32_t length,
+                      uint8_t *plain_ptr) {
+  uint8_t t[AES_BLOCK_LEN];
+  AESCtxEncrypt(&xts_ptr->tweak_ctx, tweak, t);
+  return AESXtsCrypt(xts_ptr, t, cipher_ptr, length, plain_ptr, 1);
+}
+
+/** AES-XTS encrypt sectors
+ *
+ * Encrypts 'num_sectors' consecutive sectors of 'sector_len' bytes each (at
+ * least AES_BLOCK_LEN), the first one is the sector number 'sector'. Outputs
+ * cipher-text to 'cipher' (may be the same as 'plain'). Returns 1 on success,
+ * 0 if the sectors are too short.
+ */
+uint8_t AESXtsEncryptSectors(const struct aes_xts_t *xts_ptr, uint64_t sector,
+                             uint32_t sector_len, uint32_t num_sectors,
+                             const uint8_t *plain_ptr, uint8_t *cipher_ptr) {
+  return AESXtsSectors(xts_ptr, sector, sector_len, num_sectors, plain_ptr,
+                       cipher_ptr, 0);
+}
+
+/** AES-XTS decrypt sectors
+ *
+ * Decrypts 'num_sectors' consecutive sectors of 'sector_len' bytes each (at
+ * least AES_BLOCK_LEN), the first one is the sector number 'sector'. Outputs
+ * plain-text to 'plain' (may be the same as 'cipher'). Returns 1 on success, 0
+ * if the sectors are too short.
+ */
+uint8_t AESXtsDecryptSectors(const struct aes_xts_t *xts_ptr, uint64_t sector,
+                             uint32_t sector_len, uint32_t num_sectors,
+                             const uint8_t *cipher_ptr, uint8_t *plain_ptr) {
+  return AESXtsSectors(xts_ptr, sector, sector_len, num_sectors, cipher_ptr,
+                       plain_ptr, 1);
+}
@@ -18,7 +18,18 @@
 
 #include "keccak.h"
 
-typedef void (*function_process_data)(uint8_t *state_ptr, uint8_t *buff_ptr);
+#include <string.h>
+
+#if KECCAK_AVX512
+#include <cpuid.h>
+#include <immintrin.h>
+#define KECCAK_AVX512_TARGET __attribute__((target("avx512f")))
+#endif
+
+/* Processes 'num' bytes of the state, starting at byte 'pos', and of the
+ * buffer. Called once per block. */
+typedef void (*function_process_block)(keccak_uint_t *a_ptr, uint8_t pos,
+                                       uint8_t *buff_ptr, uint8_t num);
 
 void KeccakInit(struct keccak_t *state_ptr) {
   uint8_t *a_ptr = (uint8_t *)&state_ptr->a[0], i;
@@ -27,65 +38,321 @@ void KeccakInit(struct keccak_t *state_ptr) {
   }
 }
 
-static void FunctionAbsorb(uint8_t *state_ptr, const uint8_t *buff_ptr) {
-  *state_ptr ^= *buff_ptr;
+#if KECCAK_INTERLEAVE
+
+/*
+ * Bit-interleaved lanes: the even bits of a lane are in the low 32 bits of
+ * the keccak_uint_t and the odd bits in the high 32 bits. A 64-bit rotation is
+ * then two 32-bit rotations (of the halves, swapped for odd amounts), without
+ * the shifts and ORs that emulate it on 32-bit CPUs.
+ *
+ * The lanes are converted from and to memory order (8 bytes, little-endian)
+ * when data is absorbed into or squeezed out of the state. XOR is the same in
+ * both orders, so absorbing XORs the converted data into the state.
+ */
+
+/* Moves the even bits of 'x' to the low 16 bits and the odd bits to the high
+ * 16 bits. */
+static uint32_t KeccakUnshuffle(uint32_t x) {
+  uint32_t t;
+  t = (x ^ (x >> 1)) & 0x22222222UL;
+  x ^= t ^ (t << 1);
+  t = (x ^ (x >> 2)) & 0x0C0C0C0CUL;
+  x ^= t ^ (t << 2);
+  t = (x ^ (x >> 4)) & 0x00F000F0UL;
+  x ^= t ^ (t << 4);
+  t = (x ^ (x >> 8)) & 0x0000FF00UL;
+  x ^= t ^ (t << 8);
+  return x;
+}
+
+/* Inverse of KeccakUnshuffle(). */
+static uint32_t KeccakShuffle(uint32_t x) {
+  uint32_t t;
+  t = (x ^ (x >> 8)) & 0x0000FF00UL;
+  x ^= t ^ (t << 8);
+  t = (x ^ (x >> 4)) & 0x00F000F0UL;
+  x ^= t ^ (t << 4);
+  t = (x ^ (x >> 2)) & 0x0C0C0C0CUL;
+  x ^= t ^ (t << 2);
+  t = (x ^ (x >> 1)) & 0x22222222UL;
+  x ^= t ^ (t << 1);
+  return x;
+}
+
+/* Converts a lane in memory order to bit-interleaved. */
+static keccak_uint_t KeccakInterleave(const uint8_t *bytes_ptr) {
+  uint32_t lo = KeccakUnshuffle(
+      (uint32_t)bytes_ptr[0] | (uint32_t)bytes_ptr[1] << 8 |
+      (uint32_t)bytes_ptr[2] << 16 | (uint32_t)bytes_ptr[3] << 24);
+  uint32_t hi = KeccakUnshuffle(
+      (uint32_t)bytes_ptr[4] | (uint32_t)bytes_ptr[5] << 8 |
+      (uint32_t)bytes_ptr[6] << 16 | (uint32_t)bytes_ptr[7] << 24);
+  uint32_t even = (lo & 0x0000FFFFUL) | (hi << 16);
+  uint32_t odd = (lo >> 16) | (hi & 0xFFFF0000UL);
+  return (keccak_uint_t)odd << 32 | even;
+}
+
+/* Converts a bit-interleaved lane to memory order. */
+static void KeccakDeinterleave(keccak_uint_t x, uint8_t *bytes_ptr) {
+  uint32_t even = (uint32_t)x, odd = (uint32_t)(x >> 32);
+  uint32_t lo = KeccakShuffle((even & 0x0000FFFFUL) | (odd << 16));
+  uint32_t hi = KeccakShuffle((even >> 16) | (odd & 0xFFFF0000UL));
+  bytes_ptr[0] = (uint8_t)lo;
+  bytes_ptr[1] = (uint8_t)(lo >> 8);
+  bytes_ptr[2] = (uint8_t)(lo >> 16);
+  bytes_ptr[3] = (uint8_t)(lo >> 24);
+  bytes_ptr[4] = (uint8_t)hi;
+  bytes_ptr[5] = (uint8_t)(hi >> 8);
+  bytes_ptr[6] = (uint8_t)(hi >> 16);
+  bytes_ptr[7] = (uint8_t)(hi >> 24);
+}
+
+/* The block functions process one lane at a time, converting whole lanes
+ * directly and partial lanes through a lane buffer. */
+
+static void BlockAbsorb(keccak_uint_t *a_ptr, uint8_t pos, uint8_t *buff_ptr,
+                        uint8_t num) {
+  uint8_t lane[KECCAK_WORD];
+  uint8_t n;
+
+  for (; num > 0; num -= n) {
+    n = KECCAK_WORD - pos % KECCAK_WORD;
+    if (n > num) {
+      n = num;
+    }
+    if (n == KECCAK_WORD) {
+      a_ptr[pos / KECCAK_WORD] ^= KeccakInterleave(buff_ptr);
+    } else {
+      memset(lane, 0, KECCAK_WORD);
+      memcpy(&lane[pos % KECCAK_WORD], buff_ptr, n);
+      a_ptr[pos / KECCAK_WORD] ^= KeccakInterleave(lane);
+    }
+    pos += n;
+    buff_ptr += n;
+  }
+}
+
+static void BlockSqueeze(keccak_uint_t *a_ptr, uint8_t pos, uint8_t *buff_ptr,
+                         uint8_t num) {
+  uint8_t lane[KECCAK_WORD];
+  uint8_t n;
+
+  for (; num > 0; num -= n) {
+    n = KECCAK_WORD - pos % KECCAK_WORD;
+    if (n > num) {
+      n = num;
+    }
+    if (n == KECCAK_WORD) {
+      KeccakDeinterleave(a_ptr[pos / KECCAK_WORD], buff_ptr);
+    } else {
+      KeccakDeinterleave(a_ptr[pos / KECCAK_WORD], lane);
+      memcpy(buff_ptr, &lane[pos % KECCAK_WORD], n);
+    }
+    pos += n;
+    buff_ptr += n;
+  }
+}
+
+static void BlockEncrypt(keccak_uint_t *a_ptr, uint8_t pos, uint8_t *buff_ptr,
+                         uint8_t num) {
+  /* The cipher-text is the state after absorbing the plain-text. */
+  BlockAbsorb(a_ptr, pos, buff_ptr, num);
+  BlockSqueeze(a_ptr, pos, buff_ptr, num);
+}
+
+static void BlockDecrypt(keccak_uint_t *a_ptr, uint8_t pos, uint8_t *buff_ptr,
+                         uint8_t num) {
+  uint8_t lane[KECCAK_WORD];
+  uint8_t i, n, c;
+
+  for (; num > 0; num -= n) {
+    n = KECCAK_WORD - pos % KECCAK_WORD;
+    if (n > num) {
+      n = num;
+    }
+    KeccakDeinterleave(a_ptr[pos / KECCAK_WORD], lane);
+    for (i = pos % KECCAK_WORD; i < pos % KECCAK_WORD + n; ++i) {
+      c = *buff_ptr;
+      *buff_ptr++ = lane[i] ^ c;
+      lane[i] = c;
+    }
+    a_ptr[pos / KECCAK_WORD] = KeccakInterleave(lane);
+    pos += n;
+  }
+}
+
+#else
+
+/*
+ * The block functions process the bytes up to a lane boundary one at a time,
+ * then whole lanes (keccak_uint_t) and then the remaining bytes. The buffer is
+ * accessed with memcpy(), it does not need to be aligned. The state bytes are
+ * in memory order in both cases, so the result does not depend on the
+ * endianness.
+ */
+
+static void BlockAbsorb(keccak_uint_t *a_ptr, uint8_t pos, uint8_t *buff_ptr,
+                        uint8_t num) {
+  uint8_t *state_ptr = (uint8_t *)a_ptr;
+  keccak_uint_t x;
+
+  for (; num > 0 && pos % KECCAK_WORD != 0; --num) {
+    state_ptr[pos++] ^= *buff_ptr++;
+  }
+  for (; num >= KECCAK_WORD; num -= KECCAK_WORD) {
+    memcpy(&x, buff_ptr, KECCAK_WORD);
+    a_ptr[pos / KECCAK_WORD] ^= x;
+    pos += KECCAK_WORD;
+    buff_ptr += KECCAK_WORD;
+  }
+  for (; num > 0; --num) {
+    state_ptr[pos++] ^= *buff_ptr++;
+  }
+}
+
+static void BlockSqueeze(keccak_uint_t *a_ptr, uint8_t pos, uint8_t *buff_ptr,
+                         uint8_t num) {
+  memcpy(buff_ptr, (uint8_t *)a_ptr + pos, num);
+}
+
+static void BlockEncrypt(keccak_uint_t *a_ptr, uint8_t pos, uint8_t *buff_ptr,
+                         uint8_t num) {
+  uint8_t *state_ptr = (uint8_t *)a_ptr;
+  keccak_uint_t x;
+
+  for (; num > 0 && pos % KECCAK_WORD != 0; --num) {
+    state_ptr[pos] ^= *buff_ptr;
+    *buff_ptr++ = state_ptr[pos++];
+  }
+  for (; num >= KECCAK_WORD; num -= KECCAK_WORD) {
+    memcpy(&x, buff_ptr, KECCAK_WORD);
+    x ^= a_ptr[pos / KECCAK_WORD];
+    a_ptr[pos / KECCAK_WORD] = x;
+    memcpy(buff_ptr, &x, KECCAK_WORD);
+    pos += KECCAK_WORD;
+    buff_ptr += KECCAK_WORD;
+  }
+  for (; num > 0; --num) {
+    state_ptr[pos] ^= *buff_ptr;
+    *buff_ptr++ = state_ptr[pos++];
+  }
+}
+
+static void BlockDecrypt(keccak_uint_t *a_ptr, uint8_t pos, uint8_t *buff_ptr,
+                         uint8_t num) {
+  uint8_t *state_ptr = (uint8_t *)a_ptr;
+  keccak_uint_t x;
+  uint8_t c;
+
+  for (; num > 0 && pos % KECCAK_WORD != 0; --num) {
+    c = *buff_ptr;
+    *buff_ptr++ = state_ptr[pos] ^ c;
+    state_ptr[pos++] = c;
+  }
+  for (; num >= KECCAK_WORD; num -= KECCAK_WORD) {
+    memcpy(&x, buff_ptr, KECCAK_WORD);
+    a_ptr[pos / KECCAK_WORD] ^= x;
+    memcpy(buff_ptr, &a_ptr[pos / KECCAK_WORD], KECCAK_WORD);
+    a_ptr[pos / KECCAK_WORD] = x;
+    pos += KECCAK_WORD;
+    buff_ptr += KECCAK_WORD;
+  }
+  for (; num > 0; --num) {
+    c = *buff_ptr;
+    *buff_ptr++ = state_ptr[pos] ^ c;
+    state_ptr[pos++] = c;
+  }
+}
+
+#endif /* KECCAK_INTERLEAVE */
+
+/* Processes the data block by block with 'function', permuting the state
+ * after each complete block. */
+static void KeccakProcessBlocks(struct keccak_t *state_ptr, uint8_t rate,
+                                uint8_t rounds, uint8_t *buff_ptr, size_t num,
+                                function_process_block function) {
+  uint8_t statenum = state_ptr->num;
+  uint8_t n;
+
+  if (statenum >= rate && num > 0) {
+    /* Invalid count (e.g. state not initialized): start a new block. */
+    KeccakF(state_ptr, rounds);
+    statenum = 0;
+  }
+
+  while (num > 0) {
+    n = rate - statenum;
+    if (n > num) {
+      n = (uint8_t)num;
+    }
+    function(state_ptr->a, statenum, buff_ptr, n);
+    statenum += n;
+    buff_ptr += n;
+    num -= n;
+
+    if (statenum >= rate) {
+      /* Block complete. */
+      KeccakF(state_ptr, rounds);
+      statenum = 0;
+    }
+  }
+  state_ptr->num = statenum;
 }
 
 void KeccakAbsorb(struct keccak_t *state_ptr, uint8_t rate, uint8_t rounds,
-                  const void *buff_ptr, uint16_t num) {
-  KeccakProcessData(state_ptr, rate, rounds, (uint8_t *)buff_ptr, num,
-                    (function_process_data)FunctionAbsorb);
+                  const void *buff_ptr, size_t num) {
+  KeccakProcessBlocks(state_ptr, rate, rounds, (uint8_t *)buff_ptr, num,
+                      BlockAbsorb);
 }
 
 void KeccakFinish(struct keccak_t *state_ptr, uint8_t rate, uint8_t rounds,
                   uint8_t pad_byte) {
-  uint8_t *a_ptr = (uint8_t *)&state_ptr->a[0];
+  uint8_t pad_end = KECCAK_PAD_END;
 
   /* Pad block. */
-  a_ptr[state_ptr->num] ^= pad_byte;
-  a_ptr[rate - 1] ^= KECCAK_PAD_END;
+  BlockAbsorb(state_ptr->a, state_ptr->num, &pad_byte, 1);
+  BlockAbsorb(state_ptr->a, rate - 1, &pad_end, 1);
 
   KeccakF(state_ptr, rounds);
 }
 
-static void FunctionSqueeze(const uint8_t *state_ptr, uint8_t *buff_ptr) {
-  *buff_ptr = *state_ptr;
-}
-
 void KeccakSqueeze(struct keccak_t *state_ptr, uint8_t rate, uint8_t rounds,
-                   void *buff_ptr, uint16_t num) {
-  KeccakProcessData(state_ptr, rate, rounds, buff_ptr, num,
-                    (function_process_data)FunctionSqueeze);
-}
-
-static void FunctionEncrypt(uint8_t *state_ptr, uint8_t *buff_ptr) {
-  uint8_t encrypted = *state_ptr ^ *buff_ptr;
-  *state_ptr = encrypted;
-  *buff_ptr = encrypted;
+                   void *buff_ptr, size_t num) {
+  KeccakProcessBlocks(state_ptr, rate, rounds, buff_ptr, num, BlockSqueeze);
 }
 
 void KeccakEncrypt(struct keccak_t *state_ptr, uint8_t rate, uint8_t rounds,
-                   void *buff_ptr, uint16_t num) {
-  KeccakProcessData(state_ptr, rate, rounds, buff_ptr, num, FunctionEncrypt);
-}
-
-static void FunctionDecrypt(uint8_t *state_ptr, uint8_t *buff_ptr) {
-  uint8_t decrypted = *state_ptr ^ *buff_ptr;
-  *state_ptr = *buff_ptr;
-  *buff_ptr = decrypted;
+                   void *buff_ptr, size_t num) {
+  KeccakProcessBlocks(state_ptr, rate, rounds, buff_ptr, num, BlockEncrypt);
 }
 
 void KeccakDecrypt(struct keccak_t *state_ptr, uint8_t rate, uint8_t rounds,
-                   void *buff_ptr, uint16_t num) {
-  KeccakProcessData(state_ptr, rate, rounds, buff_ptr, num, FunctionDecrypt);
+                   void *buff_ptr, size_t num) {
+  KeccakProcessBlocks(state_ptr, rate, rounds, buff_ptr, num, BlockDecrypt);
 }
 
 void KeccakProcessData(struct keccak_t *state_ptr, uint8_t rate, uint8_t rounds,
-                       void *buff_ptr, uint16_t num,
+                       void *buff_ptr, size_t num,
                        void (*function_ptr)(uint8_t *state_ptr,
                                             uint8_t *buff_ptr)) {
   uint8_t statenum = state_ptr->num;
   uint8_t *in_ptr = buff_ptr;
+#if KECCAK_INTERLEAVE
+  uint8_t lane[KECCAK_WORD];
+
+  while (num-- > 0) {
+    KeccakDeinterleave(state_ptr->a[statenum / KECCAK_WORD], lane);
+    function_ptr(&lane[statenum % KECCAK_WORD], in_ptr++);
+    state_ptr->a[statenum / KECCAK_WORD] = KeccakInterleave(lane);
+
+    if (++statenum >= rate) {
+      /* Block complete. */
+      KeccakF(state_ptr, rounds);
+      statenum = 0;
+    }
+  }
+#else
   uint8_t *out_ptr = ((uint8_t *)&state_ptr->a[0]) + statenum;
 
   while (num-- > 0) {
@@ -98,21 +365,74 @@ void KeccakProcessData(struct keccak_t *state_ptr, uint8_t rate, uint8_t rounds,
       out_ptr = (uint8_t *)&state_ptr->a[0];
     }
   }
+#endif
   state_ptr->num = statenum;
 }
 
+/** Keccak state to bytes
+ *
+ * Puts the state in memory order, so the output can be read from the state
+ * after KeccakFinish(). The state cannot be used afterwards. Does nothing if
+ * the lanes are not bit-interleaved.
+ */
+void KeccakStateToBytes(struct keccak_t *state_ptr) {
+#if KECCAK_INTERLEAVE
+  uint8_t i;
+  for (i = 0; i < 25; ++i) {
+    KeccakDeinterleave(state_ptr->a[i], (uint8_t *)&state_ptr->a[i]);
+  }
+#else
+  (void)state_ptr;
+#endif
+}
+
+/* KECCAK_F1600_UNROLLED
+ * Keccak-f[1600] with the rounds unrolled by two and lane complementing,
+ * for 64-bit words with faster code.
+ */
+#if (KECCAK_WORD == 8 && KECCAK_FASTER != 0 && KECCAK_INTERLEAVE == 0)
+#define KECCAK_F1600_UNROLLED 1
+#else
+#define KECCAK_F1600_UNROLLED 0
+#endif
+
+#if KECCAK_INTERLEAVE
+static void KeccakF1600Interleaved(keccak_uint_t *a_ptr, uint8_t rounds);
+#elif KECCAK_F1600_UNROLLED
+static void KeccakF1600(keccak_uint_t *a_ptr, uint8_t rounds);
+#else
 static void KeccakFRound(struct keccak_t *state_ptr, uint8_t round);
+#endif
+#if KECCAK_AVX512
+static void KeccakAvx512F1600(keccak_uint_t *a_ptr, uint8_t rounds);
+#endif
 
 void KeccakF(struct keccak_t *state_ptr, uint8_t rounds) {
+#if !KECCAK_F1600_UNROLLED && !KECCAK_INTERLEAVE
   uint8_t i;
-  for (i = KECCAK_NR - rounds; i < KECCAK_NR; ++i)
-    KeccakFRound(state_ptr, i);
+#endif
+#if KECCAK_AVX512
+  if (KeccakAvx512Supported()) {
+    KeccakAvx512F1600(state_ptr->a, rounds);
+  } else
+#endif
+  {
+#if KECCAK_INTERLEAVE
+    KeccakF1600Interleaved(state_ptr->a, rounds);
+#elif KECCAK_F1600_UNROLLED
+    KeccakF1600(state_ptr->a, rounds);
+#else
+    for (i = KECCAK_NR - rounds; i < KECCAK_NR; ++i)
+      KeccakFRound(state_ptr, i);
+#endif
+  }
   state_ptr->num = 0;
 }
 
 #ifdef AVR
 #include <avr/pgmspace.h>
 #define PGM_READ_BYTE(x) pgm_read_byte(x)
+#define PGM_READ_DWORD(x) pgm_read_dword(x)
 #if (KECCAK_WORD == 1)
 #define PGM_READ_KECCAK_WORD(x) pgm_read_byte(x)
 #elif (KECCAK_WORD == 2)
@@ -126,6 +446,7 @@ void KeccakF(struct keccak_t *state_ptr, uint8_t rounds) {
 #undef PROGMEM
 #define PROGMEM
 #define PGM_READ_BYTE(x) *(x)
+#define PGM_READ_DWORD(x) *(x)
 #if (KECCAK_WORD == 1)
 #define PGM_READ_KECCAK_WORD(x) *(x)
 #elif (KECCAK_WORD == 2)
@@ -159,6 +480,8 @@ static uint64_t pgm_read_qword(const void *address) {
 #define KRTM 0x3F
 #endif
 
+#if !KECCAK_INTERLEAVE
+
 PROGMEM
 static const keccak_uint_t Krc[KECCAK_NR] = {0x0000000000000001 & KRCM,
                                              0x0000000000008082 & KRCM,
@@ -192,6 +515,10 @@ static const keccak_uint_t Krc[KECCAK_NR] = {0x0000000000000001 & KRCM,
 #endif
 };
 
+#endif /* !KECCAK_INTERLEAVE */
+
+#if !KECCAK_F1600_UNROLLED && !KECCAK_INTERLEAVE
+
 PROGMEM
 static const uint8_t Krho[25] = {
     0 & KRTM,  1 & KRTM,  62 & KRTM, 28 & KRTM, 27 & KRTM, 36 & KRTM, 44 & KRTM,
@@ -292,3 +619,600 @@ static void KeccakFRound(struct keccak_t *state_ptr, uint8_t round) {
   /* Iota */
   state_ptr->a[0] ^= PGM_READ_KECCAK_WORD(&Krc[round]);
 }
+
+#endif /* !KECCAK_F1600_UNROLLED && !KECCAK_INTERLEAVE */
+
+#if KECCAK_F1600_UNROLLED
+
+/*
+ * The state is kept in 25 local variables, named after the lane coordinates:
+ * rows b, g, k, m, s (y = 0..4) and columns a, e, i, o, u (x = 0..4), so Abe
+ * is a[1] and Asa is a[20]. Rho and Pi are constant rotations and renames.
+ *
+ * Chi is x ^ (~y & z), which needs one NOT per lane. Lane complementing keeps
+ * the lanes Abe, Abi, Ago, Aki, Ami and Asa complemented during the
+ * permutation: Chi can then be computed with AND, OR and only one NOT per
+ * row. The lanes are complemented when loaded and when stored.
+ */
+
+#define ROL64(x, n) (((x) << (n)) | ((x) >> (64 - (n))))
+
+/* Theta: column parities and the D values. */
+#define KECCAK_THETA(A)                                                        \
+  do {                                                                         \
+    Ca = A##ba ^ A##ga ^ A##ka ^ A##ma ^ A##sa;                                \
+    Ce = A##be ^ A##ge ^ A##ke ^ A##me ^ A##se;                                \
+    Ci = A##bi ^ A##gi ^ A##ki ^ A##mi ^ A##si;                                \
+    Co = A##bo ^ A##go ^ A##ko ^ A##mo ^ A##so;                                \
+    Cu = A##bu ^ A##gu ^ A##ku ^ A##mu ^ A##su;                                \
+    Da = Cu ^ ROL64(Ce, 1);                                                    \
+    De = Ca ^ ROL64(Ci, 1);                                                    \
+    Di = Ce ^ ROL64(Co, 1);                                                    \
+    Do = Ci ^ ROL64(Cu, 1);                                                    \
+    Du = Co ^ ROL64(Ca, 1);                                                    \
+  } while (0)
+
+/* One round from state A to state E: Theta, Rho, Pi, Chi (complemented lanes)
+ * and Iota. */
+#define KECCAK_ROUND(A, E, rc)                                                 \
+  do {                                                                         \
+    KECCAK_THETA(A);                                                           \
+                                                                               \
+    Bba = A##ba ^ Da;                                                          \
+    Bbe = ROL64(A##ge ^ De, 44);                                               \
+    Bbi = ROL64(A##ki ^ Di, 43);                                               \
+    Bbo = ROL64(A##mo ^ Do, 21);                                               \
+    Bbu = ROL64(A##su ^ Du, 14);                                               \
+    E##ba = Bba ^ (Bbe | Bbi) ^ (rc);                                          \
+    E##be = Bbe ^ ((~Bbi) | Bbo);                                              \
+    E##bi = Bbi ^ (Bbo & Bbu);                                                 \
+    E##bo = Bbo ^ (Bbu | Bba);                                                 \
+    E##bu = Bbu ^ (Bba & Bbe);                                                 \
+                                                                               \
+    Bba = ROL64(A##bo ^ Do, 28);                                               \
+    Bbe = ROL64(A##gu ^ Du, 20);                                               \
+    Bbi = ROL64(A##ka ^ Da, 3);                                                \
+    Bbo = ROL64(A##me ^ De, 45);                                               \
+    Bbu = ROL64(A##si ^ Di, 61);                                               \
+    E##ga = Bba ^ (Bbe | Bbi);                                                 \
+    E##ge = Bbe ^ (Bbi & Bbo);                                                 \
+    E##gi = Bbi ^ (Bbo | (~Bbu));                                              \
+    E##go = Bbo ^ (Bbu | Bba);                                                 \
+    E##gu = Bbu ^ (Bba & Bbe);                                                 \
+                                                                               \
+    Bba = ROL64(A##be ^ De, 1);                                                \
+    Bbe = ROL64(A##gi ^ Di, 6);                                                \
+    Bbi = ROL64(A##ko ^ Do, 25);                                               \
+    Bbo = ROL64(A##mu ^ Du, 8);                                                \
+    Bbu = ROL64(A##sa ^ Da, 18);                                               \
+    E##ka = Bba ^ (Bbe | Bbi);                                                 \
+    E##ke = Bbe ^ (Bbi & Bbo);                                                 \
+    E##ki = Bbi ^ ((~Bbo) & Bbu);                                              \
+    E##ko = (~Bbo) ^ (Bbu | Bba);                                              \
+    E##ku = Bbu ^ (Bba & Bbe);                                                 \
+                                                                               \
+    Bba = ROL64(A##bu ^ Du, 27);                                               \
+    Bbe = ROL64(A##ga ^ Da, 36);                                               \
+    Bbi = ROL64(A##ke ^ De, 10);                                               \
+    Bbo = ROL64(A##mi ^ Di, 15);                                               \
+    Bbu = ROL64(A##so ^ Do, 56);                                               \
+    E##ma = Bba ^ (Bbe & Bbi);                                                 \
+    E##me = Bbe ^ (Bbi | Bbo);                                                 \
+    E##mi = Bbi ^ ((~Bbo) | Bbu);                                              \
+    E##mo = (~Bbo) ^ (Bbu & Bba);                                              \
+    E##mu = Bbu ^ (Bba | Bbe);                                                 \
+                                                                               \
+    Bba = ROL64(A##bi ^ Di, 62);                                               \
+    Bbe = ROL64(A##go ^ Do, 55);                                               \
+    Bbi = ROL64(A##ku ^ Du, 39);                                               \
+    Bbo = ROL64(A##ma ^ Da, 41);                                               \
+    Bbu = ROL64(A##se ^ De, 2);                                                \
+    E##sa = Bba ^ ((~Bbe) & Bbi);                                              \
+    E##se = (~Bbe) ^ (Bbi | Bbo);                                              \
+    E##si = Bbi ^ (Bbo & Bbu);                                                 \
+    E##so = Bbo ^ (Bbu | Bba);                                                 \
+    E##su = Bbu ^ (Bba & Bbe);                                                 \
+  } while (0)
+
+/* Loads the state to the lanes of state X, complementing lanes. */
+#define KECCAK_LOAD(X, a_ptr)                                                  \
+  do {                                                                         \
+    X##ba = a_ptr[0];                                                        \
+    X##be = ~a_ptr[1];                                                       \
+    X##bi = ~a_ptr[2];                                                       \
+    X##bo = a_ptr[3];                                                        \
+    X##bu = a_ptr[4];                                                        \
+    X##ga = a_ptr[5];                                                        \
+    X##ge = a_ptr[6];                                                        \
+    X##gi = a_ptr[7];                                                        \
+    X##go = ~a_ptr[8];                                                       \
+    X##gu = a_ptr[9];                                                        \
+    X##ka = a_ptr[10];                                                       \
+    X##ke = a_ptr[11];                                                       \
+    X##ki = ~a_ptr[12];                                                      \
+    X##ko = a_ptr[13];                                                       \
+    X##ku = a_ptr[14];                                                       \
+    X##ma = a_ptr[15];                                                       \
+    X##me = a_ptr[16];                                                       \
+    X##mi = ~a_ptr[17];                                                      \
+    X##mo = a_ptr[18];                                                       \
+    X##mu = a_ptr[19];                                                       \
+    X##sa = ~a_ptr[20];                                                      \
+    X##se = a_ptr[21];                                                       \
+    X##si = a_ptr[22];                                                       \
+    X##so = a_ptr[23];                                                       \
+    X##su = a_ptr[24];                                                       \
+  } while (0)
+
+/* Stores the lanes of state X to the state, complementing lanes. */
+#define KECCAK_STORE(X, a_ptr)                                                 \
+  do {                                                                         \
+    a_ptr[0] = X##ba;                                                        \
+    a_ptr[1] = ~X##be;                                                       \
+    a_ptr[2] = ~X##bi;                                                       \
+    a_ptr[3] = X##bo;                                                        \
+    a_ptr[4] = X##bu;                                                        \
+    a_ptr[5] = X##ga;                                                        \
+    a_ptr[6] = X##ge;                                                        \
+    a_ptr[7] = X##gi;                                                        \
+    a_ptr[8] = ~X##go;                                                       \
+    a_ptr[9] = X##gu;                                                        \
+    a_ptr[10] = X##ka;                                                       \
+    a_ptr[11] = X##ke;                                                       \
+    a_ptr[12] = ~X##ki;                                                      \
+    a_ptr[13] = X##ko;                                                       \
+    a_ptr[14] = X##ku;                                                       \
+    a_ptr[15] = X##ma;                                                       \
+    a_ptr[16] = X##me;                                                       \
+    a_ptr[17] = ~X##mi;                                                      \
+    a_ptr[18] = X##mo;                                                       \
+    a_ptr[19] = X##mu;                                                       \
+    a_ptr[20] = ~X##sa;                                                      \
+    a_ptr[21] = X##se;                                                       \
+    a_ptr[22] = X##si;                                                       \
+    a_ptr[23] = X##so;                                                       \
+    a_ptr[24] = X##su;                                                       \
+  } while (0)
+
+static void KeccakF1600(keccak_uint_t *a_ptr, uint8_t rounds) {
+  keccak_uint_t Aba, Abe, Abi, Abo, Abu, Aga, Age, Agi, Ago, Agu, Aka, Ake, Aki,
+      Ako, Aku, Ama, Ame, Ami, Amo, Amu, Asa, Ase, Asi, Aso, Asu;
+  keccak_uint_t Eba, Ebe, Ebi, Ebo, Ebu, Ega, Ege, Egi, Ego, Egu, Eka, Eke, Eki,
+      Eko, Eku, Ema, Eme, Emi, Emo, Emu, Esa, Ese, Esi, Eso, Esu;
+  keccak_uint_t Bba, Bbe, Bbi, Bbo, Bbu;
+  keccak_uint_t Ca, Ce, Ci, Co, Cu, Da, De, Di, Do, Du;
+  uint8_t i = KECCAK_NR - rounds;
+
+  KECCAK_LOAD(A, a_ptr);
+
+  if (rounds % 2 != 0) {
+    /* Odd number of rounds: one round from E to A. */
+    KECCAK_LOAD(E, a_ptr);
+    KECCAK_ROUND(E, A, PGM_READ_KECCAK_WORD(&Krc[i]));
+    ++i;
+  }
+
+  for (; i < KECCAK_NR; i += 2) {
+    KECCAK_ROUND(A, E, PGM_READ_KECCAK_WORD(&Krc[i]));
+    KECCAK_ROUND(E, A, PGM_READ_KECCAK_WORD(&Krc[i + 1]));
+  }
+
+  KECCAK_STORE(A, a_ptr);
+}
+
+#endif /* KECCAK_F1600_UNROLLED */
+
+#if KECCAK_INTERLEAVE
+
+/*
+ * The same permutation as KeccakF1600(), on the even (0) and odd (1) 32-bit
+ * halves of the bit-interleaved lanes. The round constants are interleaved
+ * too: even and odd halves of each one.
+ */
+
+#define ROL32(x, n) (((x) << (n)) | ((x) >> (32 - (n))))
+
+/* Theta on the halves: D = C[x - 1] ^ ROL64(C[x + 1], 1). */
+#define KECCAK_BI_THETA(A)                                                     \
+  do {                                                                         \
+    Ca0 = A##ba0 ^ A##ga0 ^ A##ka0 ^ A##ma0 ^ A##sa0;                          \
+    Ce0 = A##be0 ^ A##ge0 ^ A##ke0 ^ A##me0 ^ A##se0;                          \
+    Ci0 = A##bi0 ^ A##gi0 ^ A##ki0 ^ A##mi0 ^ A##si0;                          \
+    Co0 = A##bo0 ^ A##go0 ^ A##ko0 ^ A##mo0 ^ A##so0;                          \
+    Cu0 = A##bu0 ^ A##gu0 ^ A##ku0 ^ A##mu0 ^ A##su0;                          \
+    Ca1 = A##ba1 ^ A##ga1 ^ A##ka1 ^ A##ma1 ^ A##sa1;                          \
+    Ce1 = A##be1 ^ A##ge1 ^ A##ke1 ^ A##me1 ^ A##se1;                          \
+    Ci1 = A##bi1 ^ A##gi1 ^ A##ki1 ^ A##mi1 ^ A##si1;                          \
+    Co1 = A##bo1 ^ A##go1 ^ A##ko1 ^ A##mo1 ^ A##so1;                          \
+    Cu1 = A##bu1 ^ A##gu1 ^ A##ku1 ^ A##mu1 ^ A##su1;                          \
+    Da0 = Cu0 ^ ROL32(Ce1, 1);                                                 \
+    Da1 = Cu1 ^ Ce0;                                                           \
+    De0 = Ca0 ^ ROL32(Ci1, 1);                                                 \
+    De1 = Ca1 ^ Ci0;                                                           \
+    Di0 = Ce0 ^ ROL32(Co1, 1);                                                 \
+    Di1 = Ce1 ^ Co0;                                                           \
+    Do0 = Ci0 ^ ROL32(Cu1, 1);                                                 \
+    Do1 = Ci1 ^ Cu0;                                                           \
+    Du0 = Co0 ^ ROL32(Ca1, 1);                                                 \
+    Du1 = Co1 ^ Ca0;                                                           \
+  } while (0)
+
+/* One round from state A to state E. */
+#define KECCAK_BI_ROUND(A, E, rc0, rc1)                                        \
+  do {                                                                         \
+    KECCAK_BI_THETA(A);                                                        \
+                                                                               \
+    Bba = A##ba0 ^ Da0;                                                        \
+    Bbe = ROL32((A##ge0 ^ De0), 22);                                           \
+    Bbi = ROL32((A##ki1 ^ Di1), 22);                                           \
+    Bbo = ROL32((A##mo1 ^ Do1), 11);                                           \
+    Bbu = ROL32((A##su0 ^ Du0), 7);                                            \
+    E##ba0 = Bba ^ (Bbe | Bbi) ^ (rc0);                                        \
+    E##be0 = Bbe ^ ((~Bbi) | Bbo);                                             \
+    E##bi0 = Bbi ^ (Bbo & Bbu);                                                \
+    E##bo0 = Bbo ^ (Bbu | Bba);                                                \
+    E##bu0 = Bbu ^ (Bba & Bbe);                                                \
+                                                                               \
+    Bba = A##ba1 ^ Da1;                                                        \
+    Bbe = ROL32((A##ge1 ^ De1), 22);                                           \
+    Bbi = ROL32((A##ki0 ^ Di0), 21);                                           \
+    Bbo = ROL32((A##mo0 ^ Do0), 10);                                           \
+    Bbu = ROL32((A##su1 ^ Du1), 7);                                            \
+    E##ba1 = Bba ^ (Bbe | Bbi) ^ (rc1);                                        \
+    E##be1 = Bbe ^ ((~Bbi) | Bbo);                                             \
+    E##bi1 = Bbi ^ (Bbo & Bbu);                                                \
+    E##bo1 = Bbo ^ (Bbu | Bba);                                                \
+    E##bu1 = Bbu ^ (Bba & Bbe);                                                \
+                                                                               \
+    Bba = ROL32((A##bo0 ^ Do0), 14);                                           \
+    Bbe = ROL32((A##gu0 ^ Du0), 10);                                           \
+    Bbi = ROL32((A##ka1 ^ Da1), 2);                                            \
+    Bbo = ROL32((A##me1 ^ De1), 23);                                           \
+    Bbu = ROL32((A##si1 ^ Di1), 31);                                           \
+    E##ga0 = Bba ^ (Bbe | Bbi);                                                \
+    E##ge0 = Bbe ^ (Bbi & Bbo);                                                \
+    E##gi0 = Bbi ^ (Bbo | (~Bbu));                                             \
+    E##go0 = Bbo ^ (Bbu | Bba);                                                \
+    E##gu0 = Bbu ^ (Bba & Bbe);                                                \
+                                                                               \
+    Bba = ROL32((A##bo1 ^ Do1), 14);                                           \
+    Bbe = ROL32((A##gu1 ^ Du1), 10);                                           \
+    Bbi = ROL32((A##ka0 ^ Da0), 1);                                            \
+    Bbo = ROL32((A##me0 ^ De0), 22);                                           \
+    Bbu = ROL32((A##si0 ^ Di0), 30);                                           \
+    E##ga1 = Bba ^ (Bbe | Bbi);                                                \
+    E##ge1 = Bbe ^ (Bbi & Bbo);                                                \
+    E##gi1 = Bbi ^ (Bbo | (~Bbu));                                             \
+    E##go1 = Bbo ^ (Bbu | Bba);                                                \
+    E##gu1 = Bbu ^ (Bba & Bbe);                                                \
+                                                                               \
+    Bba = ROL32((A##be1 ^ De1), 1);                                            \
+    Bbe = ROL32((A##gi0 ^ Di0), 3);                                            \
+    Bbi = ROL32((A##ko1 ^ Do1), 13);                                           \
+    Bbo = ROL32((A##mu0 ^ Du0), 4);                                            \
+    Bbu = ROL32((A##sa0 ^ Da0), 9);                                            \
+    E##ka0 = Bba ^ (Bbe | Bbi);                                                \
+    E##ke0 = Bbe ^ (Bbi & Bbo);                                                \
+    E##ki0 = Bbi ^ ((~Bbo) & Bbu);                                             \
+    E##ko0 = (~Bbo) ^ (Bbu | Bba);                                             \
+    E##ku0 = Bbu ^ (Bba & Bbe);                                                \
+                                                                               \
+    Bba = A##be0 ^ De0;                                                        \
+    Bbe = ROL32((A##gi1 ^ Di1), 3);                                            \
+    Bbi = ROL32((A##ko0 ^ Do0), 12);                                           \
+    Bbo = ROL32((A##mu1 ^ Du1), 4);                                            \
+    Bbu = ROL32((A##sa1 ^ Da1), 9);                                            \
+    E##ka1 = Bba ^ (Bbe | Bbi);                                                \
+    E##ke1 = Bbe ^ (Bbi & Bbo);                                                \
+    E##ki1 = Bbi ^ ((~Bbo) & Bbu);                                             \
+    E##ko1 = (~Bbo) ^ (Bbu | Bba);                                             \
+    E##ku1 = Bbu ^ (Bba & Bbe);                                                \
+                                                                               \
+    Bba = ROL32((A##bu1 ^ Du1), 14);                                           \
+    Bbe = ROL32((A##ga0 ^ Da0), 18);                                           \
+    Bbi = ROL32((A##ke0 ^ De0), 5);                                            \
+    Bbo = ROL32((A##mi1 ^ Di1), 8);                                            \
+    Bbu = ROL32((A##so0 ^ Do0), 28);                                           \
+    E##ma0 = Bba ^ (Bbe & Bbi);                                                \
+    E##me0 = Bbe ^ (Bbi | Bbo);                                                \
+    E##mi0 = Bbi ^ ((~Bbo) | Bbu);                                             \
+    E##mo0 = (~Bbo) ^ (Bbu & Bba);                                             \
+    E##mu0 = Bbu ^ (Bba | Bbe);                                                \
+                                                                               \
+    Bba = ROL32((A##bu0 ^ Du0), 13);                                           \
+    Bbe = ROL32((A##ga1 ^ Da1), 18);                                           \
+    Bbi = ROL32((A##ke1 ^ De1), 5);                                            \
+    Bbo = ROL32((A##mi0 ^ Di0), 7);                                            \
+    Bbu = ROL32((A##so1 ^ Do1), 28);                                           \
+    E##ma1 = Bba ^ (Bbe & Bbi);                                                \
+    E##me1 = Bbe ^ (Bbi | Bbo);                                                \
+    E##mi1 = Bbi ^ ((~Bbo) | Bbu);                                             \
+    E##mo1 = (~Bbo) ^ (Bbu & Bba);                                             \
+    E##mu1 = Bbu ^ (Bba | Bbe);                                                \
+                                                                               \
+    Bba = ROL32((A##bi0 ^ Di0), 31);                                           \
+    Bbe = ROL32((A##go1 ^ Do1), 28);                                           \
+    Bbi = ROL32((A##ku1 ^ Du1), 20);                                           \
+    Bbo = ROL32((A##ma1 ^ Da1), 21);                                           \
+    Bbu = ROL32((A##se0 ^ De0), 1);                                            \
+    E##sa0 = Bba ^ ((~Bbe) & Bbi);                                             \
+    E##se0 = (~Bbe) ^ (Bbi | Bbo);                                             \
+    E##si0 = Bbi ^ (Bbo & Bbu);                                                \
+    E##so0 = Bbo ^ (Bbu | Bba);                                                \
+    E##su0 = Bbu ^ (Bba & Bbe);                                                \
+                                                                               \
+    Bba = ROL32((A##bi1 ^ Di1), 31);                                           \
+    Bbe = ROL32((A##go0 ^ Do0), 27);                                           \
+    Bbi = ROL32((A##ku0 ^ Du0), 19);                                           \
+    Bbo = ROL32((A##ma0 ^ Da0), 20);                                           \
+    Bbu = ROL32((A##se1 ^ De1), 1);                                            \
+    E##sa1 = Bba ^ ((~Bbe) & Bbi);                                             \
+    E##se1 = (~Bbe) ^ (Bbi | Bbo);                                             \
+    E##si1 = Bbi ^ (Bbo & Bbu);                                                \
+    E##so1 = Bbo ^ (Bbu | Bba);                                                \
+    E##su1 = Bbu ^ (Bba & Bbe);                                                \
+  } while (0)
+
+/* Loads the lanes of state X, complementing lanes. */
+#define KECCAK_BI_LOAD(X, a_ptr)                                               \
+  do {                                                                         \
+    X##ba0 = (uint32_t)a_ptr[0];                                               \
+    X##ba1 = (uint32_t)(a_ptr[0] >> 32);                                       \
+    X##be0 = ~(uint32_t)a_ptr[1];                                              \
+    X##be1 = ~(uint32_t)(a_ptr[1] >> 32);                                      \
+    X##bi0 = ~(uint32_t)a_ptr[2];                                              \
+    X##bi1 = ~(uint32_t)(a_ptr[2] >> 32);                                      \
+    X##bo0 = (uint32_t)a_ptr[3];                                               \
+    X##bo1 = (uint32_t)(a_ptr[3] >> 32);                                       \
+    X##bu0 = (uint32_t)a_ptr[4];                                               \
+    X##bu1 = (uint32_t)(a_ptr[4] >> 32);                                       \
+    X##ga0 = (uint32_t)a_ptr[5];                                               \
+    X##ga1 = (uint32_t)(a_ptr[5] >> 32);                                       \
+    X##ge0 = (uint32_t)a_ptr[6];                                               \
+    X##ge1 = (uint32_t)(a_ptr[6] >> 32);                                       \
+    X##gi0 = (uint32_t)a_ptr[7];                                               \
+    X##gi1 = (uint32_t)(a_ptr[7] >> 32);                                       \
+    X##go0 = ~(uint32_t)a_ptr[8];                                              \
+    X##go1 = ~(uint32_t)(a_ptr[8] >> 32);                                      \
+    X##gu0 = (uint32_t)a_ptr[9];                                               \
+    X##gu1 = (uint32_t)(a_ptr[9] >> 32);                                       \
+    X##ka0 = (uint32_t)a_ptr[10];                                              \
+    X##ka1 = (uint32_t)(a_ptr[10] >> 32);                                      \
+    X##ke0 = (uint32_t)a_ptr[11];                                              \
+    X##ke1 = (uint32_t)(a_ptr[11] >> 32);                                      \
+    X##ki0 = ~(uint32_t)a_ptr[12];                                             \
+    X##ki1 = ~(uint32_t)(a_ptr[12] >> 32);                                     \
+    X##ko0 = (uint32_t)a_ptr[13];                                              \
+    X##ko1 = (uint32_t)(a_ptr[13] >> 32);                                      \
+    X##ku0 = (uint32_t)a_ptr[14];                                              \
+    X##ku1 = (uint32_t)(a_ptr[14] >> 32);                                      \
+    X##ma0 = (uint32_t)a_ptr[15];                                              \
+    X##ma1 = (uint32_t)(a_ptr[15] >> 32);                                      \
+    X##me0 = (uint32_t)a_ptr[16];                                              \
+    X##me1 = (uint32_t)(a_ptr[16] >> 32);                                      \
+    X##mi0 = ~(uint32_t)a_ptr[17];                                             \
+    X##mi1 = ~(uint32_t)(a_ptr[17] >> 32);                                     \
+    X##mo0 = (uint32_t)a_ptr[18];                                              \
+    X##mo1 = (uint32_t)(a_ptr[18] >> 32);                                      \
+    X##mu0 = (uint32_t)a_ptr[19];                                              \
+    X##mu1 = (uint32_t)(a_ptr[19] >> 32);                                      \
+    X##sa0 = ~(uint32_t)a_ptr[20];                                             \
+    X##sa1 = ~(uint32_t)(a_ptr[20] >> 32);                                     \
+    X##se0 = (uint32_t)a_ptr[21];                                              \
+    X##se1 = (uint32_t)(a_ptr[21] >> 32);                                      \
+    X##si0 = (uint32_t)a_ptr[22];                                              \
+    X##si1 = (uint32_t)(a_ptr[22] >> 32);                                      \
+    X##so0 = (uint32_t)a_ptr[23];                                              \
+    X##so1 = (uint32_t)(a_ptr[23] >> 32);                                      \
+    X##su0 = (uint32_t)a_ptr[24];                                              \
+    X##su1 = (uint32_t)(a_ptr[24] >> 32);                                      \
+  } while (0)
+
+/* Stores the lanes of state X, complementing lanes. */
+#define KECCAK_BI_STORE(X, a_ptr)                                              \
+  do {                                                                         \
+    a_ptr[0] = (keccak_uint_t)X##ba1 << 32 | X##ba0;                           \
+    a_ptr[1] = ~((keccak_uint_t)X##be1 << 32 | X##be0);                        \
+    a_ptr[2] = ~((keccak_uint_t)X##bi1 << 32 | X##bi0);                        \
+    a_ptr[3] = (keccak_uint_t)X##bo1 << 32 | X##bo0;                           \
+    a_ptr[4] = (keccak_uint_t)X##bu1 << 32 | X##bu0;                           \
+    a_ptr[5] = (keccak_uint_t)X##ga1 << 32 | X##ga0;                           \
+    a_ptr[6] = (keccak_uint_t)X##ge1 << 32 | X##ge0;                           \
+    a_ptr[7] = (keccak_uint_t)X##gi1 << 32 | X##gi0;                           \
+    a_ptr[8] = ~((keccak_uint_t)X##go1 << 32 | X##go0);                        \
+    a_ptr[9] = (keccak_uint_t)X##gu1 << 32 | X##gu0;                           \
+    a_ptr[10] = (keccak_uint_t)X##ka1 << 32 | X##ka0;                          \
+    a_ptr[11] = (keccak_uint_t)X##ke1 << 32 | X##ke0;                          \
+    a_ptr[12] = ~((keccak_uint_t)X##ki1 << 32 | X##ki0);                       \
+    a_ptr[13] = (keccak_uint_t)X##ko1 << 32 | X##ko0;                          \
+    a_ptr[14] = (keccak_uint_t)X##ku1 << 32 | X##ku0;                          \
+    a_ptr[15] = (keccak_uint_t)X##ma1 << 32 | X##ma0;                          \
+    a_ptr[16] = (keccak_uint_t)X##me1 << 32 | X##me0;                          \
+    a_ptr[17] = ~((keccak_uint_t)X##mi1 << 32 | X##mi0);                       \
+    a_ptr[18] = (keccak_uint_t)X##mo1 << 32 | X##mo0;                          \
+    a_ptr[19] = (keccak_uint_t)X##mu1 << 32 | X##mu0;                          \
+    a_ptr[20] = ~((keccak_uint_t)X##sa1 << 32 | X##sa0);                       \
+    a_ptr[21] = (keccak_uint_t)X##se1 << 32 | X##se0;                          \
+    a_ptr[22] = (keccak_uint_t)X##si1 << 32 | X##si0;                          \
+    a_ptr[23] = (keccak_uint_t)X##so1 << 32 | X##so0;                          \
+    a_ptr[24] = (keccak_uint_t)X##su1 << 32 | X##su0;                          \
+  } while (0)
+
+PROGMEM
+static const uint32_t Krc_bi[2 * KECCAK_NR] = {
+    0x00000001, 0x00000000, 0x00000000, 0x00000089, 0x00000000, 0x8000008B,
+    0x00000000, 0x80008080, 0x00000001, 0x0000008B, 0x00000001, 0x00008000,
+    0x00000001, 0x80008088, 0x00000001, 0x80000082, 0x00000000, 0x0000000B,
+    0x00000000, 0x0000000A, 0x00000001, 0x00008082, 0x00000000, 0x00008003,
+    0x00000001, 0x0000808B, 0x00000001, 0x8000000B, 0x00000001, 0x8000008A,
+    0x00000001, 0x80000081, 0x00000000, 0x80000081, 0x00000000, 0x80000008,
+    0x00000000, 0x00000083, 0x00000000, 0x80008003, 0x00000001, 0x80008088,
+    0x00000000, 0x80000088, 0x00000001, 0x00008000, 0x00000000, 0x80008082};
+
+static void KeccakF1600Interleaved(keccak_uint_t *a_ptr, uint8_t rounds) {
+  uint32_t Aba0, Abe0, Abi0, Abo0, Abu0, Aga0, Age0, Agi0, Ago0, Agu0, Aka0,
+      Ake0, Aki0, Ako0, Aku0, Ama0, Ame0, Ami0, Amo0, Amu0, Asa0, Ase0, Asi0,
+      Aso0, Asu0;
+  uint32_t Aba1, Abe1, Abi1, Abo1, Abu1, Aga1, Age1, Agi1, Ago1, Agu1, Aka1,
+      Ake1, Aki1, Ako1, Aku1, Ama1, Ame1, Ami1, Amo1, Amu1, Asa1, Ase1, Asi1,
+      Aso1, Asu1;
+  uint32_t Eba0, Ebe0, Ebi0, Ebo0, Ebu0, Ega0, Ege0, Egi0, Ego0, Egu0, Eka0,
+      Eke0, Eki0, Eko0, Eku0, Ema0, Eme0, Emi0, Emo0, Emu0, Esa0, Ese0, Esi0,
+      Eso0, Esu0;
+  uint32_t Eba1, Ebe1, Ebi1, Ebo1, Ebu1, Ega1, Ege1, Egi1, Ego1, Egu1, Eka1,
+      Eke1, Eki1, Eko1, Eku1, Ema1, Eme1, Emi1, Emo1, Emu1, Esa1, Ese1, Esi1,
+      Eso1, Esu1;
+  uint32_t Bba, Bbe, Bbi, Bbo, Bbu;
+  uint32_t Ca0, Ce0, Ci0, Co0, Cu0, Ca1, Ce1, Ci1, Co1, Cu1;
+  uint32_t Da0, De0, Di0, Do0, Du0, Da1, De1, Di1, Do1, Du1;
+  uint8_t i = KECCAK_NR - rounds;
+
+  KECCAK_BI_LOAD(A, a_ptr);
+
+  if (rounds % 2 != 0) {
+    /* Odd number of rounds: one round from E to A. */
+    KECCAK_BI_LOAD(E, a_ptr);
+    KECCAK_BI_ROUND(E, A, PGM_READ_DWORD(&Krc_bi[2 * i]),
+                    PGM_READ_DWORD(&Krc_bi[2 * i + 1]));
+    ++i;
+  }
+
+  for (; i < KECCAK_NR; i += 2) {
+    KECCAK_BI_ROUND(A, E, PGM_READ_DWORD(&Krc_bi[2 * i]),
+                    PGM_READ_DWORD(&Krc_bi[2 * i + 1]));
+    KECCAK_BI_ROUND(E, A, PGM_READ_DWORD(&Krc_bi[2 * i + 2]),
+                    PGM_READ_DWORD(&Krc_bi[2 * i + 3]));
+  }
+
+  KECCAK_BI_STORE(A, a_ptr);
+}
+
+#endif /* KECCAK_INTERLEAVE */
+
+#if KECCAK_AVX512
+
+static int8_t Keccak_Avx512_Supported = -1;
+
+/** Keccak AVX-512 supported
+ *
+ * Returns 1 if the CPU and the operating system support the AVX-512F
+ * instructions, 0 otherwise. CPUID is queried only on the first call.
+ */
+uint8_t KeccakAvx512Supported(void) {
+  if (Keccak_Avx512_Supported < 0) {
+    unsigned int eax, ebx, ecx, edx, xcr0 = 0;
+    Keccak_Avx512_Supported = 0;
+    if (__get_cpuid(1, &eax, &ebx, &ecx, &edx) && (ecx & bit_OSXSAVE) != 0) {
+      /* The OS saves the YMM, ZMM and mask registers (XCR0 bits 1, 2, 5, 6
+       * and 7). */
+      __asm__("xgetbv" : "=a"(xcr0), "=d"(edx) : "c"(0));
+      if ((xcr0 & 0xE6) == 0xE6 &&
+          __get_cpuid_count(7, 0, &eax, &ebx, &ecx, &edx) &&
+          (ebx & bit_AVX512F) != 0) {
+        Keccak_Avx512_Supported = 1;
+      }
+    }
+  }
+  return (uint8_t)Keccak_Avx512_Supported;
+}
+
+/*
+ * AVX-512 permutation of a single state. Each row y of the state (lanes
+ * a[5y] to a[5y+4]) is in the first 5 lanes of a zmm register.
+ *
+ * Theta and Chi are one VPTERNLOGQ per row (3-input XOR and x ^ (~y & z)),
+ * with the neighbour columns moved into place by VPERMQ. Rho is one VPROLVQ
+ * per row. Pi moves lane (x, y) to (y, 2x + 3y): new row Y takes column
+ * X + 3Y of old row X, gathered with VPERMT2Q from pairs of rows.
+ */
+
+KECCAK_AVX512_TARGET
+static void KeccakAvx512F1600(keccak_uint_t *a_ptr, uint8_t rounds) {
+  const __m512i rot_m1 = _mm512_setr_epi64(4, 0, 1, 2, 3, 5, 6, 7);
+  const __m512i rot_p1 = _mm512_setr_epi64(1, 2, 3, 4, 0, 5, 6, 7);
+  const __m512i rot_p2 = _mm512_setr_epi64(2, 3, 4, 0, 1, 5, 6, 7);
+  const __m512i rho0 = _mm512_setr_epi64(0, 1, 62, 28, 27, 0, 0, 0);
+  const __m512i rho1 = _mm512_setr_epi64(36, 44, 6, 55, 20, 0, 0, 0);
+  const __m512i rho2 = _mm512_setr_epi64(3, 10, 43, 25, 39, 0, 0, 0);
+  const __m512i rho3 = _mm512_setr_epi64(41, 45, 15, 21, 8, 0, 0, 0);
+  const __m512i rho4 = _mm512_setr_epi64(18, 2, 61, 56, 14, 0, 0, 0);
+  /* Pi: columns of rows 0-1 and 2-3 for the new rows 0-3 (a) and 4 (b). */
+  const __m512i pi01a = _mm512_setr_epi64(0, 9, 3, 12, 1, 10, 4, 8);
+  const __m512i pi23a = _mm512_setr_epi64(2, 11, 0, 9, 3, 12, 1, 10);
+  const __m512i pi01b = _mm512_setr_epi64(2, 11, 0, 0, 0, 0, 0, 0);
+  const __m512i pi23b = _mm512_setr_epi64(4, 8, 0, 0, 0, 0, 0, 0);
+  /* Pi: new rows from the pairs, column 4 from row 4. */
+  const __m512i pi0 = _mm512_setr_epi64(0, 1, 8, 9, 4, 0, 0, 0);
+  const __m512i pi1 = _mm512_setr_epi64(2, 3, 10, 11, 2, 0, 0, 0);
+  const __m512i pi2 = _mm512_setr_epi64(4, 5, 12, 13, 0, 0, 0, 0);
+  const __m512i pi3 = _mm512_setr_epi64(6, 7, 14, 15, 3, 0, 0, 0);
+  const __m512i pi4 = _mm512_setr_epi64(0, 1, 8, 9, 1, 0, 0, 0);
+  __m512i a0, a1, a2, a3, a4;
+  __m512i c, cm1, cp1, z01a, z23a, z01b, z23b;
+  uint8_t i;
+
+  a0 = _mm512_maskz_loadu_epi64(0x1F, &a_ptr[0]);
+  a1 = _mm512_maskz_loadu_epi64(0x1F, &a_ptr[5]);
+  a2 = _mm512_maskz_loadu_epi64(0x1F, &a_ptr[10]);
+  a3 = _mm512_maskz_loadu_epi64(0x1F, &a_ptr[15]);
+  a4 = _mm512_maskz_loadu_epi64(0x1F, &a_ptr[20]);
+
+  for (i = KECCAK_NR - rounds; i < KECCAK_NR; ++i) {
+    /* Theta */
+    c = _mm512_ternarylogic_epi64(_mm512_ternarylogic_epi64(a0, a1, a2, 0x96),
+                                  a3, a4, 0x96);
+    cm1 = _mm512_permutexvar_epi64(rot_m1, c);
+    cp1 = _mm512_rol_epi64(_mm512_permutexvar_epi64(rot_p1, c), 1);
+    a0 = _mm512_ternarylogic_epi64(a0, cm1, cp1, 0x96);
+    a1 = _mm512_ternarylogic_epi64(a1, cm1, cp1, 0x96);
+    a2 = _mm512_ternarylogic_epi64(a2, cm1, cp1, 0x96);
+    a3 = _mm512_ternarylogic_epi64(a3, cm1, cp1, 0x96);
+    a4 = _mm512_ternarylogic_epi64(a4, cm1, cp1, 0x96);
+
+    /* Rho */
+    a0 = _mm512_rolv_epi64(a0, rho0);
+    a1 = _mm512_rolv_epi64(a1, rho1);
+    a2 = _mm512_rolv_epi64(a2, rho2);
+    a3 = _mm512_rolv_epi64(a3, rho3);
+    a4 = _mm512_rolv_epi64(a4, rho4);
+
+    /* Pi */
+    z01a = _mm512_permutex2var_epi64(a0, pi01a, a1);
+    z23a = _mm512_permutex2var_epi64(a2, pi23a, a3);
+    z01b = _mm512_permutex2var_epi64(a0, pi01b, a1);
+    z23b = _mm512_permutex2var_epi64(a2, pi23b, a3);
+    a0 = _mm512_mask_permutexvar_epi64(
+        _mm512_permutex2var_epi64(z01a, pi0, z23a), 0x10, pi0, a4);
+    a1 = _mm512_mask_permutexvar_epi64(
+        _mm512_permutex2var_epi64(z01a, pi1, z23a), 0x10, pi1, a4);
+    a2 = _mm512_mask_permutexvar_epi64(
+        _mm512_permutex2var_epi64(z01a, pi2, z23a), 0x10, pi2, a4);
+    a3 = _mm512_mask_permutexvar_epi64(
+        _mm512_permutex2var_epi64(z01a, pi3, z23a), 0x10, pi3, a4);
+    a4 = _mm512_mask_permutexvar_epi64(
+        _mm512_permutex2var_epi64(z01b, pi4, z23b), 0x10, pi4, a4);
+
+    /* Chi */
+    a0 = _mm512_ternarylogic_epi64(a0, _mm512_permutexvar_epi64(rot_p1, a0),
+                                   _mm512_permutexvar_epi64(rot_p2, a0), 0xD2);
+    a1 = _mm512_ternarylogic_epi64(a1, _mm512_permutexvar_epi64(rot_p1, a1),
+                                   _mm512_permutexvar_epi64(rot_p2, a1), 0xD2);
+    a2 = _mm512_ternarylogic_epi64(a2, _mm512_permutexvar_epi64(rot_p1, a2),
+                                   _mm512_permutexvar_epi64(rot_p2, a2), 0xD2);
+    a3 = _mm512_ternarylogic_epi64(a3, _mm512_permutexvar_epi64(rot_p1, a3),
+                                   _mm512_permutexvar_epi64(rot_p2, a3), 0xD2);
+    a4 = _mm512_ternarylogic_epi64(a4, _mm512_permutexvar_epi64(rot_p1, a4),
+                                   _mm512_permutexvar_epi64(rot_p2, a4), 0xD2);
+
+    /* Iota */
+    a0 = _mm512_xor_si512(a0, _mm512_maskz_loadu_epi64(0x01, &Krc[i]));
+  }
+
+  _mm512_mask_storeu_epi64(&a_ptr[0], 0x1F, a0);
+  _mm512_mask_storeu_epi64(&a_ptr[5], 0x1F, a1);
+  _mm512_mask_storeu_epi64(&a_ptr[10], 0x1F, a2);
+  _mm512_mask_storeu_epi64(&a_ptr[15], 0x1F, a3);
+  _mm512_mask_storeu_epi64(&a_ptr[20], 0x1F, a4);
+}
+
+#endif /* KECCAK_AVX512 */
@@ -0,0 +1,240 @@
+/*
+ Keccak batch hashing implementation.
+
+ Copyright 2021 Djones A. Boni
+
+ Licensed under the Apache License, Version 2.0 (the "License");
+ you may not use this file except in compliance with the License.
+ You may obtain a copy of the License at
+
+ http://www.apache.org/licenses/LICENSE-2.0
+
+ Unless required by applicable law or agreed to in writing, software
+ distributed under the License is distributed on an "AS IS" BASIS,
+ WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ See the License for the specific language governing permissions and
+ limitations under the License.
+*/
+
+#include "keccak_batch.h"
+#include "keccak_x4.h"
+
+#if (KECCAK_BATCH_PENDING < KECCAK_X4 || KECCAK_BATCH_PENDING > 255)
+#error "Invalid parameter KECCAK_BATCH_PENDING."
+#endif
+
+/* BATCH HASHING.
+ *
+ * Hashes many independent messages: message i is 'num[i]' bytes at
+ * 'data_ptr[i]' and its output is written at 'out_ptr + i * out_len'.
+ *
+ * Messages with the same number of whole blocks need the same number of
+ * permutations. A message waits (up to KECCAK_BATCH_PENDING messages) until
+ * three others with the same number of blocks arrive and the four are hashed
+ * together with the x4 functions (AVX2): the whole blocks are absorbed
+ * together, the tails (less than one block) one by one, then they are padded,
+ * permuted and squeezed together. The messages left without a group are
+ * hashed one at a time.
+ *
+ * const void *data[count];
+ * size_t length[count];
+ * uint8_t digest[count * 32];
+ * SHA3_256Batch(data, length, digest, count);
+ *
+ */
+
+/* Hashes one message. */
+void KeccakBatchOne(const void *data_ptr, size_t num, uint8_t *out_ptr,
+                    size_t out_len, uint8_t rate, uint8_t rounds,
+                    uint8_t pad_byte) {
+  struct keccak_t state;
+
+  KeccakInit(&state);
+  KeccakAbsorb(&state, rate, rounds, data_ptr, num);
+  KeccakFinish(&state, rate, rounds, pad_byte);
+  KeccakSqueeze(&state, rate, rounds, out_ptr, out_len);
+}
+
+/* Hashes four messages with the same number of whole blocks. */
+void KeccakBatchX4(const void *data_ptr[KECCAK_X4],
+                   const size_t num[KECCAK_X4], void *out_ptr[KECCAK_X4],
+                   size_t out_len, uint8_t rate, uint8_t rounds,
+                   uint8_t pad_byte) {
+  struct keccak_t state[KECCAK_X4];
+  struct keccak_t *state_ptr[KECCAK_X4];
+  size_t blocks_len = num[0] / rate * rate;
+  uint8_t j;
+
+  for (j = 0; j < KECCAK_X4; ++j) {
+    KeccakInit(&state[j]);
+    state_ptr[j] = &state[j];
+  }
+  KeccakAbsorb_x4(state_ptr, rate, rounds, data_ptr, blocks_len);
+  for (j = 0; j < KECCAK_X4; ++j) {
+    KeccakAbsorb(&state[j], rate, rounds,
+                 (const uint8_t *)data_ptr[j] + blocks_len,
+                 num[j] - blocks_len);
+  }
+  KeccakFinish_x4(state_ptr, rate, rounds, pad_byte);
+  KeccakSqueeze_x4(state_ptr, rate, rounds, out_ptr, out_len);
+}
+
+/* Hashes 'count' messages, grouping four messages with the same number of
+ * whole blocks. */
+void KeccakBatch(const void *const data_ptr[], const size_t num[],
+                 void *out_ptr, size_t out_len, size_t count, uint8_t rate,
+                 uint8_t rounds, uint8_t pad_byte) {
+  uint8_t *out_buff_ptr = (uint8_t *)out_ptr;
+  size_t pending[KECCAK_BATCH_PENDING];
+  uint8_t group[KECCAK_X4 - 1];
+  const void *group_data_ptr[KECCAK_X4];
+  size_t group_num[KECCAK_X4];
+  void *group_out_ptr[KECCAK_X4];
+  size_t i, blocks;
+  uint8_t num_pending = 0, j, k, g;
+
+  for (i = 0; i < count; ++i) {
+    /* Find three pending messages with the same number of whole blocks. */
+    blocks = num[i] / rate;
+    g = 0;
+    for (j = 0; j < num_pending && g < KECCAK_X4 - 1; ++j) {
+      if (num[pending[j]] / rate == blocks) {
+        group[g++] = j;
+      }
+    }
+
+    if (g == KECCAK_X4 - 1) {
+      for (j = 0; j < KECCAK_X4; ++j) {
+        size_t m = j < KECCAK_X4 - 1 ? pending[group[j]] : i;
+        group_data_ptr[j] = data_ptr[m];
+        group_num[j] = num[m];
+        group_out_ptr[j] = out_buff_ptr + out_len * m;
+      }
+      KeccakBatchX4(group_data_ptr, group_num, group_out_ptr, out_len, rate,
+                    rounds, pad_byte);
+
+      /* Remove the group from the pending messages. */
+      for (j = 0, k = 0, g = 0; j < num_pending; ++j) {
+        if (g < KECCAK_X4 - 1 && group[g] == j) {
+          ++g;
+        } else {
+          pending[k++] = pending[j];
+        }
+      }
+      num_pending = k;
+    } else {
+      if (num_pending == KECCAK_BATCH_PENDING) {
+        /* Full, the oldest message is hashed alone. */
+        KeccakBatchOne(data_ptr[pending[0]], num[pending[0]],
+                       out_buff_ptr + out_len * pending[0], out_len, rate,
+                       rounds, pad_byte);
+        for (j = 1; j < num_pending; ++j) {
+          pending[j - 1] = pending[j];
+        }
+        --num_pending;
+      }
+      pending[num_pending++] = i;
+    }
+  }
+
+  /* Messages left without a group. */
+  for (j = 0; j < num_pending; ++j) {
+    KeccakBatchOne(data_ptr[pending[j]], num[pending[j]],
+                   out_buff_ptr + out_len * pending[j], out_len, rate, rounds,
+                   pad_byte);
+  }
+}
+
+#if (KECCAK_WORD == 8)
+
+/** SHA3-512 batch
+ *
+ * Hashes 'count' messages: message i is 'num[i]' bytes at 'data_ptr[i]'. Its
+ * 64-byte digest is written at 'digest_ptr + 64 * i'.
+ */
+void SHA3_512Batch(const void *const data_ptr[], const size_t num[],
+                   void *digest_ptr, size_t count) {
+  KeccakBatch(data_ptr, num, digest_ptr, 64, count, 72, KECCAK_NR,
+              KECCAK_PAD_SHA3);
+}
+
+/** SHA3-384 batch
+ *
+ * Hashes 'count' messages: message i is 'num[i]' bytes at 'data_ptr[i]'. Its
+ * 48-byte digest is written at 'digest_ptr + 48 * i'.
+ */
+void SHA3_384Batch(const void *const data_ptr[], const size_t num[],
+                   void *digest_ptr, size_t count) {
+  KeccakBatch(data_ptr, num, digest_ptr, 48, count, 104, KECCAK_NR,
+              KECCAK_PAD_SHA3);
+}
+
+/** SHA3-256 batch
+ *
+ * Hashes 'count' messages: message i is 'num[i]' bytes at 'data_ptr[i]'. Its
+ * 32-byte digest is written at 'digest_ptr + 32 * i'.
+ */
+void SHA3_256Batch(const void *const data_ptr[], const size_t num[],
+                   void *digest_ptr, size_t count) {
+  KeccakBatch(data_ptr, num, digest_ptr, 32, count, 136, KECCAK_NR,
+              KECCAK_PAD_SHA3);
+}
+
+/** SHA3-224 batch
+ *
+ * Hashes 'count' messages: message i is 'num[i]' bytes at 'data_ptr[i]'. Its
+ * 28-byte digest is written at 'digest_ptr + 28 * i'.
+ */
+void SHA3_224Batch(const void *const data_ptr[], const size_t num[],
+                   void *digest_ptr, size_t count) {
+  KeccakBatch(data_ptr, num, digest_ptr, 28, count, 144, KECCAK_NR,
+              KECCAK_PAD_SHA3);
+}
+
+/** SHAKE256 batch
+ *
+ * Hashes 'count' messages: message i is 'num[i]' bytes at 'data_ptr[i]'. Its
+ * 'out_len' bytes of output are written at 'out_ptr + out_len * i'.
+ */
+void SHAKE256Batch(const void *const data_ptr[], const size_t num[],
+                   void *out_ptr, size_t out_len, size_t count) {
+  KeccakBatch(data_ptr, num, out_ptr, out_len, count, 136, KECCAK_NR,
+              KECCAK_PAD_SHAKE);
+}
+
+/** SHAKE128 batch
+ *
+ * Hashes 'count' messages: message i is 'num[i]' bytes at 'data_ptr[i]'. Its
+ * 'out_len' bytes of output are written at 'out_ptr + out_len * i'.
+ */
+void SHAKE128Batch(const void *const data_ptr[], const size_t num[],
+                   void *out_ptr, size_t out_len, size_t count) {
+  KeccakBatch(data_ptr, num, out_ptr, out_len, count, 168, KECCAK_NR,
+              KECCAK_PAD_SHAKE);
+}
+
+#endif
+
+/** Keccak hash batch
+ *
+ * Hashes 'count' messages as KeccakHash: message i is 'num[i]' bytes at
+ * 'data_ptr[i]'. Its KECCAK_HASH_OUTPUT-byte digest is written at
+ * 'digest_ptr + KECCAK_HASH_OUTPUT * i'.
+ */
+void KeccakHashBatch(const void *const data_ptr[], const size_t num[],
+                     void *digest_ptr, size_t count) {
+  KeccakBatch(data_ptr, num, digest_ptr, KECCAK_HASH_OUTPUT, count,
+              KECCAK_HASH_RATE, KECCAK_HASH_NR, KECCAK_PAD_SHA3);
+}
+
+/** Keccak XOF batch
+ *
+ * Hashes 'count' messages as KeccakXof: message i is 'num[i]' bytes at
+ * 'data_ptr[i]'. Its 'out_len' bytes of output are written at
+ * 'out_ptr + out_len * i'.
+ */
+void KeccakXofBatch(const void *const data_ptr[], const size_t num[],
+                    void *out_ptr, size_t out_len, size_t count) {
+  KeccakBatch(data_ptr, num, out_ptr, out_len, count, KECCAK_XOF_RATE,
+              KECCAK_XOF_NR, KECCAK_PAD_SHAKE);
+}
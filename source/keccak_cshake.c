@@ -0,0 +1,666 @@
+/*
+ cSHAKE, KMAC and ParallelHash (NIST SP 800-185) implementation.
+
+ Copyright 2021 Djones A. Boni
+
+ Licensed under the Apache License, Version 2.0 (the "License");
+ you may not use this file except in compliance with the License.
+ You may obtain a copy of the License at
+
+ http://www.apache.org/licenses/LICENSE-2.0
+
+ Unless required by applicable law or agreed to in writing, software
+ distributed under the License is distributed on an "AS IS" BASIS,
+ WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ See the License for the specific language governing permissions and
+ limitations under the License.
+*/
+
+#include "keccak_cshake.h"
+#include "keccak_x4.h"
+#include <string.h>
+
+#if (PARALLELHASH_LANES != 1 && PARALLELHASH_LANES != KECCAK_X4)
+#error "Invalid parameter PARALLELHASH_LANES."
+#endif
+#if (PARALLELHASH_THREADS < 1)
+#error "Invalid parameter PARALLELHASH_THREADS."
+#endif
+#if (PARALLELHASH_BUFFER_BLOCK_LEN < 0)
+#error "Invalid parameter PARALLELHASH_BUFFER_BLOCK_LEN."
+#endif
+
+#if PARALLELHASH_THREADS > 1
+#include <pthread.h>
+#endif
+
+/* CSHAKE, KMAC AND PARALLELHASH.
+ *
+ * cSHAKE is SHAKE with a function name N and a customization string S,
+ * absorbed first as bytepad(encode_string(N) || encode_string(S), rate).
+ *
+ * KMAC is cSHAKE with N = "KMAC" of bytepad(encode_string(K), rate), the
+ * message and the output length. The state after the key is kept in a
+ * struct kmac_key_t, so each message starts from a copy of it and costs only
+ * the permutations of its own data.
+ *
+ * struct kmac_key_t key;
+ * struct kmac_t kmac;
+ * KMAC256KeySetup(&key, key_buff, key_length, custom, custom_length); // Once
+ * KMACInit(&kmac, &key); // For each message
+ * KMACUpdate(&kmac, data, length); // Any number of times
+ * KMACFinish(&kmac, output_length); // Or KMACXofFinish(&kmac)
+ * KMACSqueeze(&kmac, output, output_length); // Any number of times
+ *
+ * ParallelHash splits the message in blocks of B bytes, hashes each block
+ * with SHAKE to a chaining value of 32 (ParallelHash128) or 64 bytes
+ * (ParallelHash256) and hashes the chaining values with cSHAKE, with
+ * N = "ParallelHash". Whole blocks are hashed PARALLELHASH_LANES at a time and,
+ * with PARALLELHASH_THREADS > 1, the batches of blocks of large inputs are
+ * divided between the threads. Small updates are collected in a buffer of
+ * PARALLELHASH_LANES * PARALLELHASH_THREADS blocks (of up to
+ * PARALLELHASH_BUFFER_BLOCK_LEN bytes) until it has a whole batch, hashed as
+ * the blocks of a large update. The output is the same for any configuration.
+ *
+ * struct parallelhash_t ph;
+ * ParallelHash128Init(&ph, block_len, custom, custom_length);
+ * ParallelHashUpdate(&ph, data, length); // Any number of times
+ * ParallelHashFinish(&ph, output_length); // Or ParallelHashXofFinish(&ph)
+ * ParallelHashSqueeze(&ph, output, output_length); // Any number of times
+ *
+ */
+
+/* Blocks hashed at a time, a multiple of PARALLELHASH_LANES. */
+#define PARALLELHASH_BATCH (8 * PARALLELHASH_LANES * PARALLELHASH_THREADS)
+
+/* Bytes of a batch below which the threads are not used (or the bytes of a
+ * whole buffered batch, if fewer). */
+#define PARALLELHASH_THREAD_MIN 65536
+
+#ifdef PARALLELHASH_DEBUG
+size_t ParallelHash_Batch_Blocks;
+size_t ParallelHash_Thread_Blocks;
+#endif
+
+/* Writes left_encode(x): the number of bytes of 'x' and its bytes big-endian
+ * without leading zeros (at least one). Returns the length. */
+uint8_t CSHAKELeftEncode(uint8_t buff[sizeof(size_t) + 1], size_t x) {
+  uint8_t i, n = 1;
+  size_t y;
+
+  for (y = x >> 8; y > 0; y >>= 8) {
+    ++n;
+  }
+  buff[0] = n;
+  for (i = 0; i < n; ++i) {
+    buff[1 + i] = (uint8_t)(x >> (8 * (n - 1 - i)));
+  }
+  return n + 1;
+}
+
+/* Writes right_encode(x): the bytes of 'x' big-endian without leading zeros
+ * (at least one) and their number. Returns the length. */
+uint8_t CSHAKERightEncode(uint8_t buff[sizeof(size_t) + 1], size_t x) {
+  uint8_t n = CSHAKELeftEncode(buff, x) - 1;
+  uint8_t i;
+
+  for (i = 0; i < n; ++i) {
+    buff[i] = buff[i + 1];
+  }
+  buff[n] = n;
+  return n + 1;
+}
+
+/* Absorbs encode_string(S): left_encode(bit length of S) and S. Returns the
+ * number of bytes absorbed. */
+size_t CSHAKEEncodeString(struct keccak_t *state_ptr, uint8_t rate,
+                          const void *str_ptr, size_t str_len) {
+  uint8_t buff[sizeof(size_t) + 1];
+  uint8_t n = CSHAKELeftEncode(buff, 8 * str_len);
+
+  KeccakAbsorb(state_ptr, rate, KECCAK_NR, buff, n);
+  KeccakAbsorb(state_ptr, rate, KECCAK_NR, str_ptr, str_len);
+  return n + str_len;
+}
+
+/* Absorbs the zeros of bytepad() after 'num' bytes, up to a multiple of the
+ * rate. */
+void CSHAKEBytepadEnd(struct keccak_t *state_ptr, uint8_t rate, size_t num) {
+  const uint8_t zeros[8] = {0, 0, 0, 0, 0, 0, 0, 0};
+  size_t n;
+
+  for (num = (rate - num % rate) % rate; num > 0; num -= n) {
+    n = num < sizeof(zeros) ? num : sizeof(zeros);
+    KeccakAbsorb(state_ptr, rate, KECCAK_NR, zeros, n);
+  }
+}
+
+/* Starts a cSHAKE: absorbs bytepad(encode_string(N) || encode_string(S),
+ * rate). Returns the pad byte, of SHAKE if both are empty. */
+uint8_t CSHAKEStart(struct keccak_t *state_ptr, uint8_t rate,
+                    const void *name_ptr, size_t name_len,
+                    const void *custom_ptr, size_t custom_len) {
+  uint8_t buff[sizeof(size_t) + 1];
+  size_t num;
+
+  KeccakInit(state_ptr);
+  if (name_len == 0 && custom_len == 0) {
+    return KECCAK_PAD_SHAKE;
+  }
+
+  num = CSHAKELeftEncode(buff, rate);
+  KeccakAbsorb(state_ptr, rate, KECCAK_NR, buff, num);
+  num += CSHAKEEncodeString(state_ptr, rate, name_ptr, name_len);
+  num += CSHAKEEncodeString(state_ptr, rate, custom_ptr, custom_len);
+  CSHAKEBytepadEnd(state_ptr, rate, num);
+  return CSHAKE_PAD;
+}
+
+void CSHAKE256Init(struct cshake_256_t *state_ptr, const void *name_ptr,
+                   size_t name_len, const void *custom_ptr, size_t custom_len) {
+  const uint8_t rate = 136;
+
+  state_ptr->pad_byte = CSHAKEStart(&state_ptr->hash, rate, name_ptr, name_len,
+                                    custom_ptr, custom_len);
+}
+
+void CSHAKE256Absorb(struct cshake_256_t *state_ptr, const void *data_ptr,
+                     size_t num) {
+  const uint8_t rate = 136;
+
+  KeccakAbsorb(&state_ptr->hash, rate, KECCAK_NR, data_ptr, num);
+}
+
+void CSHAKE256Finish(struct cshake_256_t *state_ptr) {
+  const uint8_t rate = 136;
+
+  KeccakFinish(&state_ptr->hash, rate, KECCAK_NR, state_ptr->pad_byte);
+}
+
+void CSHAKE256Squeeze(struct cshake_256_t *state_ptr, void *data_ptr,
+                      size_t num) {
+  const uint8_t rate = 136;
+
+  KeccakSqueeze(&state_ptr->hash, rate, KECCAK_NR, data_ptr, num);
+}
+
+void CSHAKE128Init(struct cshake_128_t *state_ptr, const void *name_ptr,
+                   size_t name_len, const void *custom_ptr, size_t custom_len) {
+  const uint8_t rate = 168;
+
+  state_ptr->pad_byte = CSHAKEStart(&state_ptr->hash, rate, name_ptr, name_len,
+                                    custom_ptr, custom_len);
+}
+
+void CSHAKE128Absorb(struct cshake_128_t *state_ptr, const void *data_ptr,
+                     size_t num) {
+  const uint8_t rate = 168;
+
+  KeccakAbsorb(&state_ptr->hash, rate, KECCAK_NR, data_ptr, num);
+}
+
+void CSHAKE128Finish(struct cshake_128_t *state_ptr) {
+  const uint8_t rate = 168;
+
+  KeccakFinish(&state_ptr->hash, rate, KECCAK_NR, state_ptr->pad_byte);
+}
+
+void CSHAKE128Squeeze(struct cshake_128_t *state_ptr, void *data_ptr,
+                      size_t num) {
+  const uint8_t rate = 168;
+
+  KeccakSqueeze(&state_ptr->hash, rate, KECCAK_NR, data_ptr, num);
+}
+
+/* Sets up a KMAC key with the given rate. */
+void KMACKeySetup(struct kmac_key_t *key_ptr, uint8_t rate,
+                  const void *key_buff_ptr, size_t key_len,
+                  const void *custom_ptr, size_t custom_len) {
+  const uint8_t name[4] = {'K', 'M', 'A', 'C'};
+  uint8_t buff[sizeof(size_t) + 1];
+  size_t num;
+
+  key_ptr->rate = rate;
+  CSHAKEStart(&key_ptr->hash, rate, name, sizeof(name), custom_ptr,
+              custom_len);
+  num = CSHAKELeftEncode(buff, rate);
+  KeccakAbsorb(&key_ptr->hash, rate, KECCAK_NR, buff, num);
+  num += CSHAKEEncodeString(&key_ptr->hash, rate, key_buff_ptr, key_len);
+  CSHAKEBytepadEnd(&key_ptr->hash, rate, num);
+}
+
+/** KMAC256 key setup
+ *
+ * Absorbs the key 'key_buff' and the customization string 'custom' (can be
+ * empty). The result is used by KMACInit() for any number of messages.
+ */
+void KMAC256KeySetup(struct kmac_key_t *key_ptr, const void *key_buff_ptr,
+                     size_t key_len, const void *custom_ptr,
+                     size_t custom_len) {
+  KMACKeySetup(key_ptr, 136, key_buff_ptr, key_len, custom_ptr, custom_len);
+}
+
+/** KMAC128 key setup
+ *
+ * Absorbs the key 'key_buff' and the customization string 'custom' (can be
+ * empty). The result is used by KMACInit() for any number of messages.
+ */
+void KMAC128KeySetup(struct kmac_key_t *key_ptr, const void *key_buff_ptr,
+                     size_t key_len, const void *custom_ptr,
+                     size_t custom_len) {
+  KMACKeySetup(key_ptr, 168, key_buff_ptr, key_len, custom_ptr, custom_len);
+}
+
+/** KMAC init
+ *
+ * Starts the MAC of a message from a copy of the key state.
+ */
+void KMACInit(struct kmac_t *kmac_ptr, const struct kmac_key_t *key_ptr) {
+  kmac_ptr->hash = key_ptr->hash;
+  kmac_ptr->rate = key_ptr->rate;
+}
+
+/** KMAC update
+ *
+ * Absorbs 'num' bytes of the message. Can be called any number of times.
+ */
+void KMACUpdate(struct kmac_t *kmac_ptr, const void *data_ptr, size_t num) {
+  KeccakAbsorb(&kmac_ptr->hash, kmac_ptr->rate, KECCAK_NR, data_ptr, num);
+}
+
+/** KMAC finish
+ *
+ * Finishes the MAC for an output of 'out_len' bytes, read with KMACSqueeze().
+ * The output depends on 'out_len'.
+ */
+void KMACFinish(struct kmac_t *kmac_ptr, size_t out_len) {
+  uint8_t buff[sizeof(size_t) + 1];
+  uint8_t n = CSHAKERightEncode(buff, 8 * out_len);
+
+  KeccakAbsorb(&kmac_ptr->hash, kmac_ptr->rate, KECCAK_NR, buff, n);
+  KeccakFinish(&kmac_ptr->hash, kmac_ptr->rate, KECCAK_NR, CSHAKE_PAD);
+}
+
+/** KMACXOF finish
+ *
+ * Finishes the MAC as KMACXOF128/256. Any number of bytes can be read with
+ * KMACSqueeze().
+ */
+void KMACXofFinish(struct kmac_t *kmac_ptr) {
+  KMACFinish(kmac_ptr, 0);
+}
+
+/** KMAC squeeze
+ *
+ * Outputs 'num' bytes of the MAC. Can be called any number of times.
+ */
+void KMACSqueeze(struct kmac_t *kmac_ptr, void *data_ptr, size_t num) {
+  KeccakSqueeze(&kmac_ptr->hash, kmac_ptr->rate, KECCAK_NR, data_ptr, num);
+}
+
+/* Hashes 'num' (multiple of PARALLELHASH_LANES) whole blocks of 'in' and
+ * writes their chaining values to 'cv'. */
+void ParallelHashLeaves(const struct parallelhash_t *ph_ptr,
+                        const uint8_t *in_ptr, uint8_t *cv_ptr, size_t num) {
+  const uint8_t rate = ph_ptr->rate;
+  const uint8_t cv_len = KECCAK_STATE_SIZE - rate;
+  struct keccak_t leaf[PARALLELHASH_LANES];
+#if PARALLELHASH_LANES == KECCAK_X4
+  struct keccak_t *leaf_ptr[KECCAK_X4];
+  const void *leaf_in_ptr[KECCAK_X4];
+  void *leaf_cv_ptr[KECCAK_X4];
+  uint8_t j;
+
+  for (; num >= KECCAK_X4; num -= KECCAK_X4) {
+    for (j = 0; j < KECCAK_X4; ++j) {
+      KeccakInit(&leaf[j]);
+      leaf_ptr[j] = &leaf[j];
+      leaf_in_ptr[j] = in_ptr + ph_ptr->block_len * j;
+      leaf_cv_ptr[j] = cv_ptr + cv_len * j;
+    }
+    KeccakAbsorb_x4(leaf_ptr, rate, KECCAK_NR, leaf_in_ptr, ph_ptr->block_len);
+    KeccakFinish_x4(leaf_ptr, rate, KECCAK_NR, KECCAK_PAD_SHAKE);
+    KeccakSqueeze_x4(leaf_ptr, rate, KECCAK_NR, leaf_cv_ptr, cv_len);
+    in_ptr += ph_ptr->block_len * KECCAK_X4;
+    cv_ptr += cv_len * KECCAK_X4;
+  }
+#else
+  for (; num > 0; --num) {
+    KeccakInit(&leaf[0]);
+    KeccakAbsorb(&leaf[0], rate, KECCAK_NR, in_ptr, ph_ptr->block_len);
+    KeccakFinish(&leaf[0], rate, KECCAK_NR, KECCAK_PAD_SHAKE);
+    KeccakSqueeze(&leaf[0], rate, KECCAK_NR, cv_ptr, cv_len);
+    in_ptr += ph_ptr->block_len;
+    cv_ptr += cv_len;
+  }
+#endif
+}
+
+#if PARALLELHASH_THREADS > 1
+
+/* Blocks hashed by a thread. */
+struct parallelhash_job_t {
+  const struct parallelhash_t *ph_ptr;
+  const uint8_t *in_ptr;
+  uint8_t *cv_ptr;
+  size_t num;
+};
+
+static void *ParallelHashWorker(void *arg_ptr) {
+  struct parallelhash_job_t *job_ptr = (struct parallelhash_job_t *)arg_ptr;
+  ParallelHashLeaves(job_ptr->ph_ptr, job_ptr->in_ptr, job_ptr->cv_ptr,
+                     job_ptr->num);
+  return NULL;
+}
+
+#endif /* PARALLELHASH_THREADS > 1 */
+
+/* Returns the length of the buffered blocks of a whole batch (a multiple of
+ * PARALLELHASH_LANES * PARALLELHASH_THREADS blocks), or zero if the blocks are
+ * not buffered. */
+size_t ParallelHashBufferLen(const struct parallelhash_t *ph_ptr) {
+#if PARALLELHASH_BUFFER_LEN > 0
+  const size_t lanes = PARALLELHASH_LANES * PARALLELHASH_THREADS;
+  size_t num;
+
+  if (ph_ptr->block_len > PARALLELHASH_BUFFER_BLOCK_LEN) {
+    return 0;
+  }
+  num = PARALLELHASH_BUFFER_LEN / ph_ptr->block_len;
+  return ph_ptr->block_len * (num - num % lanes);
+#else
+  (void)ph_ptr;
+  return 0;
+#endif
+}
+
+/* Hashes whole blocks of 'in' (at most PARALLELHASH_BATCH, a multiple of
+ * PARALLELHASH_LANES) and absorbs their chaining values into the final node.
+ * Returns the number of blocks. */
+size_t ParallelHashBatch(struct parallelhash_t *ph_ptr, const uint8_t *in_ptr,
+                         size_t num) {
+  const uint8_t cv_len = KECCAK_STATE_SIZE - ph_ptr->rate;
+  uint8_t cv[PARALLELHASH_BATCH * (KECCAK_STATE_SIZE - 136)];
+#if PARALLELHASH_THREADS > 1
+  size_t thread_min;
+#endif
+
+  if (num > PARALLELHASH_BATCH) {
+    num = PARALLELHASH_BATCH;
+  }
+  num -= num % PARALLELHASH_LANES;
+
+#if PARALLELHASH_THREADS > 1
+  thread_min = ParallelHashBufferLen(ph_ptr);
+  if (thread_min == 0 || thread_min > PARALLELHASH_THREAD_MIN) {
+    thread_min = PARALLELHASH_THREAD_MIN;
+  }
+  if (ph_ptr->block_len * num >= thread_min) {
+    /* The main thread hashes the first part, each other thread the next
+     * ones. A thread that cannot be started is replaced by a call. */
+    pthread_t thread[PARALLELHASH_THREADS - 1];
+    struct parallelhash_job_t job[PARALLELHASH_THREADS - 1];
+    uint8_t started[PARALLELHASH_THREADS - 1];
+    size_t part = (num / PARALLELHASH_LANES + PARALLELHASH_THREADS - 1) /
+                  PARALLELHASH_THREADS * PARALLELHASH_LANES;
+    size_t start;
+    uint8_t t;
+
+#ifdef PARALLELHASH_DEBUG
+    ParallelHash_Thread_Blocks += num;
+#endif
+
+    /* Detect the CPU features before the threads read the cached result. */
+#if KECCAK_AVX2
+    KeccakAvx2Supported();
+#endif
+#if KECCAK_AVX512
+    KeccakAvx512Supported();
+#endif
+
+    for (t = 0; t < PARALLELHASH_THREADS - 1; ++t) {
+      started[t] = 0;
+      start = part * (t + 1);
+      if (start < num) {
+        job[t].ph_ptr = ph_ptr;
+        job[t].in_ptr = in_ptr + ph_ptr->block_len * start;
+        job[t].cv_ptr = &cv[cv_len * start];
+        job[t].num = num - start < part ? num - start : part;
+        if (pthread_create(&thread[t], NULL, ParallelHashWorker, &job[t]) ==
+            0) {
+          started[t] = 1;
+        } else {
+          ParallelHashWorker(&job[t]);
+        }
+      }
+    }
+    ParallelHashLeaves(ph_ptr, in_ptr, cv, num < part ? num : part);
+    for (t = 0; t < PARALLELHASH_THREADS - 1; ++t) {
+      if (started[t]) {
+        pthread_join(thread[t], NULL);
+      }
+    }
+  } else {
+    ParallelHashLeaves(ph_ptr, in_ptr, cv, num);
+  }
+#else
+  ParallelHashLeaves(ph_ptr, in_ptr, cv, num);
+#endif
+
+  KeccakAbsorb(&ph_ptr->final, ph_ptr->rate, KECCAK_NR, cv, cv_len * num);
+  ph_ptr->num_blocks += num;
+#ifdef PARALLELHASH_DEBUG
+  ParallelHash_Batch_Blocks += num;
+#endif
+  return num;
+}
+
+/* Finishes the SHAKE of the current block and absorbs its chaining value into
+ * the final node. */
+void ParallelHashLeafFinish(struct parallelhash_t *ph_ptr) {
+  const uint8_t cv_len = KECCAK_STATE_SIZE - ph_ptr->rate;
+  uint8_t cv[KECCAK_STATE_SIZE - 136];
+
+  KeccakFinish(&ph_ptr->leaf, ph_ptr->rate, KECCAK_NR, KECCAK_PAD_SHAKE);
+  KeccakSqueeze(&ph_ptr->leaf, ph_ptr->rate, KECCAK_NR, cv, cv_len);
+  KeccakAbsorb(&ph_ptr->final, ph_ptr->rate, KECCAK_NR, cv, cv_len);
+  ph_ptr->block_num = 0;
+  ++ph_ptr->num_blocks;
+}
+
+/* Hashes 'num' bytes one block at a time in the SHAKE of the current block. */
+void ParallelHashLeafUpdate(struct parallelhash_t *ph_ptr,
+                            const uint8_t *in_ptr, size_t num) {
+  size_t n;
+
+  while (num > 0) {
+    if (ph_ptr->block_num == 0) {
+      KeccakInit(&ph_ptr->leaf);
+    }
+    n = ph_ptr->block_len - ph_ptr->block_num;
+    if (n > num) {
+      n = num;
+    }
+    KeccakAbsorb(&ph_ptr->leaf, ph_ptr->rate, KECCAK_NR, in_ptr, n);
+    ph_ptr->block_num += n;
+    in_ptr += n;
+    num -= n;
+
+    if (ph_ptr->block_num == ph_ptr->block_len) {
+      ParallelHashLeafFinish(ph_ptr);
+    }
+  }
+}
+
+/* Hashes the whole blocks of 'in' in batches while there are at least
+ * PARALLELHASH_LANES of them. Returns the number of bytes hashed. */
+size_t ParallelHashBlocks(struct parallelhash_t *ph_ptr, const uint8_t *in_ptr,
+                          size_t num) {
+  size_t n, total = 0;
+
+  while (num / ph_ptr->block_len >= PARALLELHASH_LANES) {
+    n = ph_ptr->block_len *
+        ParallelHashBatch(ph_ptr, in_ptr, num / ph_ptr->block_len);
+    in_ptr += n;
+    num -= n;
+    total += n;
+  }
+  return total;
+}
+
+#if PARALLELHASH_BUFFER_LEN > 0
+
+/* Hashes the buffered bytes: whole batches of blocks, then the rest one block
+ * at a time. */
+void ParallelHashFlush(struct parallelhash_t *ph_ptr) {
+  size_t n = ParallelHashBlocks(ph_ptr, ph_ptr->buff, ph_ptr->buff_num);
+  ParallelHashLeafUpdate(ph_ptr, &ph_ptr->buff[n], ph_ptr->buff_num - n);
+  ph_ptr->buff_num = 0;
+}
+
+#endif /* PARALLELHASH_BUFFER_LEN > 0 */
+
+/* Starts a ParallelHash with the given rate. Returns 1 on success, 0 if the
+ * block length is zero. */
+uint8_t ParallelHashStart(struct parallelhash_t *ph_ptr, uint8_t rate,
+                          size_t block_len, const void *custom_ptr,
+                          size_t custom_len) {
+  const uint8_t name[12] = {'P', 'a', 'r', 'a', 'l', 'l',
+                            'e', 'l', 'H', 'a', 's', 'h'};
+  uint8_t buff[sizeof(size_t) + 1];
+  uint8_t n;
+
+  if (block_len == 0) {
+    return 0;
+  }
+
+  ph_ptr->block_len = block_len;
+  ph_ptr->block_num = 0;
+  ph_ptr->num_blocks = 0;
+  ph_ptr->rate = rate;
+#if PARALLELHASH_BUFFER_LEN > 0
+  ph_ptr->buff_num = 0;
+#endif
+
+  CSHAKEStart(&ph_ptr->final, rate, name, sizeof(name), custom_ptr,
+              custom_len);
+  n = CSHAKELeftEncode(buff, block_len);
+  KeccakAbsorb(&ph_ptr->final, rate, KECCAK_NR, buff, n);
+  return 1;
+}
+
+/* Finishes a ParallelHash with right_encode(bit length of the output). */
+void ParallelHashEnd(struct parallelhash_t *ph_ptr, size_t out_bits) {
+  uint8_t buff[sizeof(size_t) + 1];
+  uint8_t n;
+
+#if PARALLELHASH_BUFFER_LEN > 0
+  ParallelHashFlush(ph_ptr);
+#endif
+  if (ph_ptr->block_num > 0) {
+    ParallelHashLeafFinish(ph_ptr);
+  }
+  n = CSHAKERightEncode(buff, ph_ptr->num_blocks);
+  KeccakAbsorb(&ph_ptr->final, ph_ptr->rate, KECCAK_NR, buff, n);
+  n = CSHAKERightEncode(buff, out_bits);
+  KeccakAbsorb(&ph_ptr->final, ph_ptr->rate, KECCAK_NR, buff, n);
+  KeccakFinish(&ph_ptr->final, ph_ptr->rate, KECCAK_NR, CSHAKE_PAD);
+}
+
+/** ParallelHash256 init
+ *
+ * Starts a ParallelHash256 with blocks of 'block_len' bytes (greater than
+ * zero) and the customization string 'custom' (can be empty). Returns 1 on
+ * success, 0 if 'block_len' is zero.
+ */
+uint8_t ParallelHash256Init(struct parallelhash_t *ph_ptr, size_t block_len,
+                            const void *custom_ptr, size_t custom_len) {
+  return ParallelHashStart(ph_ptr, 136, block_len, custom_ptr, custom_len);
+}
+
+/** ParallelHash128 init
+ *
+ * Starts a ParallelHash128 with blocks of 'block_len' bytes (greater than
+ * zero) and the customization string 'custom' (can be empty). Returns 1 on
+ * success, 0 if 'block_len' is zero.
+ */
+uint8_t ParallelHash128Init(struct parallelhash_t *ph_ptr, size_t block_len,
+                            const void *custom_ptr, size_t custom_len) {
+  return ParallelHashStart(ph_ptr, 168, block_len, custom_ptr, custom_len);
+}
+
+/** ParallelHash update
+ *
+ * Hashes 'num' bytes of the message. Can be called any number of times.
+ */
+void ParallelHashUpdate(struct parallelhash_t *ph_ptr, const void *data_ptr,
+                        size_t num) {
+  const uint8_t *in_ptr = (const uint8_t *)data_ptr;
+  size_t n;
+#if PARALLELHASH_BUFFER_LEN > 0
+  const size_t buff_len = ParallelHashBufferLen(ph_ptr);
+
+  if (buff_len > 0) {
+    while (num > 0) {
+      if (ph_ptr->buff_num == 0) {
+        /* Whole batches, hashed in place. */
+        n = ParallelHashBlocks(ph_ptr, in_ptr, num);
+        in_ptr += n;
+        num -= n;
+        if (num == 0) {
+          break;
+        }
+      }
+
+      n = buff_len - ph_ptr->buff_num;
+      if (n > num) {
+        n = num;
+      }
+      memcpy(&ph_ptr->buff[ph_ptr->buff_num], in_ptr, n);
+      ph_ptr->buff_num += n;
+      in_ptr += n;
+      num -= n;
+
+      if (ph_ptr->buff_num == buff_len) {
+        ParallelHashFlush(ph_ptr);
+      }
+    }
+    return;
+  }
+#endif
+
+  if (ph_ptr->block_num == 0) {
+    /* Whole batches, hashed in place. */
+    n = ParallelHashBlocks(ph_ptr, in_ptr, num);
+    in_ptr += n;
+    num -= n;
+  }
+  ParallelHashLeafUpdate(ph_ptr, in_ptr, num);
+}
+
+/** ParallelHash finish
+ *
+ * Finishes the hash for an output of 'out_len' bytes, read with
+ * ParallelHashSqueeze(). The output depends on 'out_len'.
+ */
+void ParallelHashFinish(struct parallelhash_t *ph_ptr, size_t out_len) {
+  ParallelHashEnd(ph_ptr, 8 * out_len);
+}
+
+/** ParallelHashXOF finish
+ *
+ * Finishes the hash as ParallelHashXOF128/256. Any number of bytes can be read
+ * with ParallelHashSqueeze().
+ */
+void ParallelHashXofFinish(struct parallelhash_t *ph_ptr) {
+  ParallelHashEnd(ph_ptr, 0);
+}
+
+/** ParallelHash squeeze
+ *
+ * Outputs 'num' bytes of the hash. Can be called any number of times.
+ */
+void ParallelHashSqueeze(struct parallelhash_t *ph_ptr, void *data_ptr,
+                         size_t num) {
+  KeccakSqueeze(&ph_ptr->final, ph_ptr->rate, KECCAK_NR, data_ptr, num);
+}
@@ -39,7 +39,7 @@ void KeccakHashInit(struct keccak_hash_t *hash_ptr) {
 }
 
 void KeccakHashUpdate(struct keccak_hash_t *hash_ptr, const void *buff_ptr,
-                      uint16_t num) {
+                      size_t num) {
   KeccakAbsorb(&hash_ptr->state, KECCAK_HASH_RATE, KECCAK_HASH_NR, buff_ptr,
                num);
 }
@@ -49,6 +49,7 @@ void KeccakHashFinish(struct keccak_hash_t *hash_ptr) {
 
   KeccakFinish(&hash_ptr->state, KECCAK_HASH_RATE, KECCAK_HASH_NR,
                KECCAK_PAD_SHA3);
+  KeccakStateToBytes(&hash_ptr->state);
 
   /* Zero extra bytes. */
   for (i = KECCAK_HASH_OUTPUT; i < KECCAK_STATE_SIZE; ++i)
@@ -100,7 +101,7 @@ void KeccakXofDomain(struct keccak_xof_t *xof_ptr, const void *domain_ptr,
 }
 
 void KeccakXofAbsorb(struct keccak_xof_t *xof_ptr, const void *buff_ptr,
-                     uint16_t num) {
+                     size_t num) {
   KeccakAbsorb(&xof_ptr->state, KECCAK_XOF_RATE, KECCAK_XOF_NR, buff_ptr, num);
 }
 
@@ -110,6 +111,6 @@ void KeccakXofFinish(struct keccak_xof_t *xof_ptr) {
 }
 
 void KeccakXofSqueeze(struct keccak_xof_t *xof_ptr, void *buff_ptr,
-                      uint16_t num) {
+                      size_t num) {
   KeccakSqueeze(&xof_ptr->state, KECCAK_XOF_RATE, KECCAK_XOF_NR, buff_ptr, num);
 }
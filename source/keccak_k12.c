@@ -0,0 +1,342 @@
+/*
+ TurboSHAKE and KangarooTwelve implementation.
+
+ Copyright 2021 Djones A. Boni
+
+ Licensed under the Apache License, Version 2.0 (the "License");
+ you may not use this file except in compliance with the License.
+ You may obtain a copy of the License at
+
+ http://www.apache.org/licenses/LICENSE-2.0
+
+ Unless required by applicable law or agreed to in writing, software
+ distributed under the License is distributed on an "AS IS" BASIS,
+ WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ See the License for the specific language governing permissions and
+ limitations under the License.
+*/
+
+#include "keccak_k12.h"
+#include "keccak_x4.h"
+
+#if (K12_THREADS < 1)
+#error "Invalid parameter K12_THREADS."
+#endif
+
+#if K12_THREADS > 1
+#include <pthread.h>
+#endif
+
+/* TURBOSHAKE AND KANGAROOTWELVE.
+ *
+ * TurboSHAKE is SHAKE with 12 rounds and a domain separation byte (0x01 to
+ * 0x7F) chosen by the user. TurboSHAKE128Finish() and TurboSHAKE256Finish()
+ * return 0, without finishing, for a domain byte out of that range, which
+ * would overlap the padding bits.
+ *
+ * KangarooTwelve (K12, RFC 9861 KT128) hashes the message with the
+ * customization string in chunks of 8 KiB. The first chunk goes into the final
+ * node and each of the other chunks is a leaf, hashed independently with
+ * TurboSHAKE128 to a 32-byte chaining value. The final node absorbs the
+ * chaining values in order.
+ *
+ * The leaves of whole chunks are hashed 4 at a time with KeccakF_x4() (AVX2)
+ * and, with K12_THREADS > 1, the batches of chunks of large inputs are divided
+ * between the threads. The output is the same for any number of threads.
+ *
+ * struct k12_t k12;
+ * K12Init(&k12);
+ * K12Update(&k12, data, length); // Any number of times
+ * K12Finish(&k12, custom, custom_length);
+ * K12Squeeze(&k12, output, output_length); // Any number of times
+ *
+ */
+
+#define K12_RATE 168         /* TurboSHAKE128 rate. */
+#define K12_PAD_SINGLE 0x07  /* Domain of a message of a single chunk. */
+#define K12_PAD_FINAL 0x06   /* Domain of the final node. */
+#define K12_PAD_LEAF 0x0B    /* Domain of the leaves. */
+
+/* Chunks hashed at a time, a multiple of KECCAK_X4. */
+#if K12_THREADS > 1
+#define K12_BATCH (32 * K12_THREADS)
+#else
+#define K12_BATCH KECCAK_X4
+#endif
+
+void TurboSHAKE256Init(struct turboshake_256_t *state_ptr) {
+  KeccakInit(&state_ptr->hash);
+}
+
+void TurboSHAKE256Absorb(struct turboshake_256_t *state_ptr,
+                         const void *data_ptr, size_t num) {
+  const uint8_t rate = 136;
+
+  KeccakAbsorb(&state_ptr->hash, rate, TURBOSHAKE_NR, data_ptr, num);
+}
+
+uint8_t TurboSHAKE256Finish(struct turboshake_256_t *state_ptr,
+                            uint8_t domain) {
+  const uint8_t rate = 136;
+
+  if (domain < 0x01 || domain > 0x7F) {
+    return 0;
+  }
+  KeccakFinish(&state_ptr->hash, rate, TURBOSHAKE_NR, domain);
+  return 1;
+}
+
+void TurboSHAKE256Squeeze(struct turboshake_256_t *state_ptr, void *data_ptr,
+                          size_t num) {
+  const uint8_t rate = 136;
+
+  KeccakSqueeze(&state_ptr->hash, rate, TURBOSHAKE_NR, data_ptr, num);
+}
+
+void TurboSHAKE128Init(struct turboshake_128_t *state_ptr) {
+  KeccakInit(&state_ptr->hash);
+}
+
+void TurboSHAKE128Absorb(struct turboshake_128_t *state_ptr,
+                         const void *data_ptr, size_t num) {
+  const uint8_t rate = 168;
+
+  KeccakAbsorb(&state_ptr->hash, rate, TURBOSHAKE_NR, data_ptr, num);
+}
+
+uint8_t TurboSHAKE128Finish(struct turboshake_128_t *state_ptr,
+                            uint8_t domain) {
+  const uint8_t rate = 168;
+
+  if (domain < 0x01 || domain > 0x7F) {
+    return 0;
+  }
+  KeccakFinish(&state_ptr->hash, rate, TURBOSHAKE_NR, domain);
+  return 1;
+}
+
+void TurboSHAKE128Squeeze(struct turboshake_128_t *state_ptr, void *data_ptr,
+                          size_t num) {
+  const uint8_t rate = 168;
+
+  KeccakSqueeze(&state_ptr->hash, rate, TURBOSHAKE_NR, data_ptr, num);
+}
+
+/* Writes length_encode(x): the bytes of 'x' big-endian without leading zeros
+ * and their number. Returns the length. */
+uint8_t K12LengthEncode(uint8_t buff[sizeof(size_t) + 1], size_t x) {
+  uint8_t i, n = 0;
+  size_t y;
+
+  for (y = x; y > 0; y >>= 8) {
+    ++n;
+  }
+  for (i = 0; i < n; ++i) {
+    buff[i] = (uint8_t)(x >> (8 * (n - 1 - i)));
+  }
+  buff[n] = n;
+  return n + 1;
+}
+
+/* Hashes 'num' (multiple of KECCAK_X4) whole chunks of 'in' as leaves and
+ * writes their chaining values to 'cv'. */
+void K12Leaves(const uint8_t *in_ptr, uint8_t *cv_ptr, size_t num) {
+  struct keccak_t leaf[KECCAK_X4];
+  struct keccak_t *leaf_ptr[KECCAK_X4];
+  const void *leaf_in_ptr[KECCAK_X4];
+  void *leaf_cv_ptr[KECCAK_X4];
+  uint8_t j;
+
+  for (; num >= KECCAK_X4; num -= KECCAK_X4) {
+    for (j = 0; j < KECCAK_X4; ++j) {
+      KeccakInit(&leaf[j]);
+      leaf_ptr[j] = &leaf[j];
+      leaf_in_ptr[j] = in_ptr + (size_t)K12_CHUNK_LEN * j;
+      leaf_cv_ptr[j] = cv_ptr + K12_CV_LEN * j;
+    }
+    KeccakAbsorb_x4(leaf_ptr, K12_RATE, TURBOSHAKE_NR, leaf_in_ptr,
+                    K12_CHUNK_LEN);
+    KeccakFinish_x4(leaf_ptr, K12_RATE, TURBOSHAKE_NR, K12_PAD_LEAF);
+    KeccakSqueeze_x4(leaf_ptr, K12_RATE, TURBOSHAKE_NR, leaf_cv_ptr,
+                     K12_CV_LEN);
+    in_ptr += (size_t)K12_CHUNK_LEN * KECCAK_X4;
+    cv_ptr += K12_CV_LEN * KECCAK_X4;
+  }
+}
+
+#if K12_THREADS > 1
+
+/* Chunks hashed by a thread. */
+struct k12_job_t {
+  const uint8_t *in_ptr;
+  uint8_t *cv_ptr;
+  size_t num;
+};
+
+static void *K12Worker(void *arg_ptr) {
+  struct k12_job_t *job_ptr = (struct k12_job_t *)arg_ptr;
+  K12Leaves(job_ptr->in_ptr, job_ptr->cv_ptr, job_ptr->num);
+  return NULL;
+}
+
+#endif /* K12_THREADS > 1 */
+
+/* Hashes whole chunks of 'in' as leaves (at most K12_BATCH, a multiple of
+ * KECCAK_X4) and absorbs their chaining values into the final node. Returns
+ * the number of chunks. */
+size_t K12Batch(struct k12_t *k12_ptr, const uint8_t *in_ptr, size_t num) {
+  uint8_t cv[K12_BATCH * K12_CV_LEN];
+
+  if (num > K12_BATCH) {
+    num = K12_BATCH;
+  }
+  num -= num % KECCAK_X4;
+
+#if K12_THREADS > 1
+  {
+    /* The main thread hashes the first part, each other thread the next
+     * ones. A thread that cannot be started is replaced by a call. */
+    pthread_t thread[K12_THREADS - 1];
+    struct k12_job_t job[K12_THREADS - 1];
+    uint8_t started[K12_THREADS - 1];
+    size_t part = (num / KECCAK_X4 + K12_THREADS - 1) / K12_THREADS * KECCAK_X4;
+    size_t start;
+    uint8_t t;
+
+    /* Detect the CPU features before the threads read the cached result. */
+#if KECCAK_AVX2
+    KeccakAvx2Supported();
+#endif
+#if KECCAK_AVX512
+    KeccakAvx512Supported();
+#endif
+
+    for (t = 0; t < K12_THREADS - 1; ++t) {
+      started[t] = 0;
+      start = part * (t + 1);
+      if (start < num) {
+        job[t].in_ptr = in_ptr + (size_t)K12_CHUNK_LEN * start;
+        job[t].cv_ptr = &cv[K12_CV_LEN * start];
+        job[t].num = num - start < part ? num - start : part;
+        if (pthread_create(&thread[t], NULL, K12Worker, &job[t]) == 0) {
+          started[t] = 1;
+        } else {
+          K12Worker(&job[t]);
+        }
+      }
+    }
+    K12Leaves(in_ptr, cv, num < part ? num : part);
+    for (t = 0; t < K12_THREADS - 1; ++t) {
+      if (started[t]) {
+        pthread_join(thread[t], NULL);
+      }
+    }
+  }
+#else
+  K12Leaves(in_ptr, cv, num);
+#endif
+
+  KeccakAbsorb(&k12_ptr->final, K12_RATE, TURBOSHAKE_NR, cv, K12_CV_LEN * num);
+  k12_ptr->num_chunks += (uint32_t)num;
+  return num;
+}
+
+/* Finishes the leaf of the current chunk and absorbs its chaining value into
+ * the final node. */
+void K12LeafFinish(struct k12_t *k12_ptr) {
+  uint8_t cv[K12_CV_LEN];
+
+  KeccakFinish(&k12_ptr->leaf, K12_RATE, TURBOSHAKE_NR, K12_PAD_LEAF);
+  KeccakSqueeze(&k12_ptr->leaf, K12_RATE, TURBOSHAKE_NR, cv, K12_CV_LEN);
+  KeccakAbsorb(&k12_ptr->final, K12_RATE, TURBOSHAKE_NR, cv, K12_CV_LEN);
+}
+
+/** KangarooTwelve init
+ *
+ * Starts a hash.
+ */
+void K12Init(struct k12_t *k12_ptr) {
+  KeccakInit(&k12_ptr->final);
+  k12_ptr->chunk_num = 0;
+  k12_ptr->num_chunks = 1;
+}
+
+/** KangarooTwelve update
+ *
+ * Hashes 'num' bytes of the message. Can be called any number of times.
+ */
+void K12Update(struct k12_t *k12_ptr, const void *data_ptr, size_t num) {
+  /* Separates the first chunk from the chaining values: 0x03 and 7 zeros. */
+  const uint8_t marker[8] = {0x03, 0, 0, 0, 0, 0, 0, 0};
+  const uint8_t *in_ptr = (const uint8_t *)data_ptr;
+  size_t n;
+
+  while (num > 0) {
+    if (k12_ptr->chunk_num == K12_CHUNK_LEN) {
+      /* The chunk is complete and there is more data. */
+      if (k12_ptr->num_chunks == 1) {
+        KeccakAbsorb(&k12_ptr->final, K12_RATE, TURBOSHAKE_NR, marker,
+                     sizeof(marker));
+      }
+      if (num >= (size_t)K12_CHUNK_LEN * KECCAK_X4) {
+        n = K12Batch(k12_ptr, in_ptr, num / K12_CHUNK_LEN);
+        in_ptr += (size_t)K12_CHUNK_LEN * n;
+        num -= (size_t)K12_CHUNK_LEN * n;
+        continue;
+      }
+      KeccakInit(&k12_ptr->leaf);
+      k12_ptr->chunk_num = 0;
+      ++k12_ptr->num_chunks;
+    }
+
+    n = K12_CHUNK_LEN - k12_ptr->chunk_num;
+    if (n > num) {
+      n = num;
+    }
+    KeccakAbsorb(k12_ptr->num_chunks == 1 ? &k12_ptr->final : &k12_ptr->leaf,
+                 K12_RATE, TURBOSHAKE_NR, in_ptr, n);
+    k12_ptr->chunk_num += (uint32_t)n;
+    in_ptr += n;
+    num -= n;
+
+    if (k12_ptr->num_chunks > 1 && k12_ptr->chunk_num == K12_CHUNK_LEN) {
+      K12LeafFinish(k12_ptr);
+    }
+  }
+}
+
+/** KangarooTwelve finish
+ *
+ * Hashes the customization string 'custom' (can be empty) and finishes the
+ * hash. The output is read with K12Squeeze().
+ */
+void K12Finish(struct k12_t *k12_ptr, const void *custom_ptr,
+               size_t custom_len) {
+  const uint8_t end[2] = {0xFF, 0xFF};
+  uint8_t buff[sizeof(size_t) + 1];
+  uint8_t n;
+
+  K12Update(k12_ptr, custom_ptr, custom_len);
+  n = K12LengthEncode(buff, custom_len);
+  K12Update(k12_ptr, buff, n);
+
+  if (k12_ptr->num_chunks == 1) {
+    KeccakFinish(&k12_ptr->final, K12_RATE, TURBOSHAKE_NR, K12_PAD_SINGLE);
+  } else {
+    if (k12_ptr->chunk_num < K12_CHUNK_LEN) {
+      K12LeafFinish(k12_ptr);
+    }
+    n = K12LengthEncode(buff, k12_ptr->num_chunks - 1);
+    KeccakAbsorb(&k12_ptr->final, K12_RATE, TURBOSHAKE_NR, buff, n);
+    KeccakAbsorb(&k12_ptr->final, K12_RATE, TURBOSHAKE_NR, end, sizeof(end));
+    KeccakFinish(&k12_ptr->final, K12_RATE, TURBOSHAKE_NR, K12_PAD_FINAL);
+  }
+}
+
+/** KangarooTwelve squeeze
+ *
+ * Outputs 'num' bytes of the hash. Can be called any number of times.
+ */
+void K12Squeeze(struct k12_t *k12_ptr, void *data_ptr, size_t num) {
+  KeccakSqueeze(&k12_ptr->final, K12_RATE, TURBOSHAKE_NR, data_ptr, num);
+}
@@ -0,0 +1,485 @@
+/*
+ Keccak 4-way parallel implementation.
+
+ Copyright 2021 Djones A. Boni
+
+ Licensed under the Apache License, Version 2.0 (the "License");
+ you may not use this file except in compliance with the License.
+ You may obtain a copy of the License at
+
+ http://www.apache.org/licenses/LICENSE-2.0
+
+ Unless required by applicable law or agreed to in writing, software
+ distributed under the License is distributed on an "AS IS" BASIS,
+ WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ See the License for the specific language governing permissions and
+ limitations under the License.
+*/
+
+#include "keccak_x4.h"
+#include <string.h>
+
+#if KECCAK_AVX2
+#include <cpuid.h>
+#include <immintrin.h>
+#define KECCAK_AVX2_TARGET __attribute__((target("avx2")))
+#endif
+
+/* KECCAK 4-WAY.
+ *
+ * Processes four independent Keccak states together, for example to hash
+ * four messages of the same length. With AVX2 each 256-bit register holds
+ * the same lane of the four states, so one permutation costs about as much as
+ * a single scalar one. Without AVX2 the states are processed one after the
+ * other with the scalar functions.
+ *
+ * The four states must be in the same position: initialized together and
+ * always given the same number of bytes. The buffers can be unaligned.
+ *
+ * struct keccak_t state[4];
+ * struct keccak_t *state_ptr[4] = {&state[0], &state[1], ...};
+ * const void *in_ptr[4] = {msg0, msg1, msg2, msg3};
+ * void *out_ptr[4] = {digest0, digest1, digest2, digest3};
+ * // For each state
+ * KeccakInit(state_ptr[i]);
+ * // Then
+ * KeccakAbsorb_x4(state_ptr, rate, rounds, in_ptr, length);
+ * KeccakFinish_x4(state_ptr, rate, rounds, KECCAK_PAD_SHA3);
+ * KeccakSqueeze_x4(state_ptr, rate, rounds, out_ptr, digest_length);
+ *
+ */
+
+#if KECCAK_AVX2
+
+static int8_t Keccak_Avx2_Supported = -1;
+
+/** Keccak AVX2 supported
+ *
+ * Returns 1 if the CPU and the operating system support the AVX2
+ * instructions, 0 otherwise. CPUID is queried only on the first call.
+ */
+uint8_t KeccakAvx2Supported(void) {
+  if (Keccak_Avx2_Supported < 0) {
+    unsigned int eax, ebx, ecx, edx, xcr0 = 0;
+    Keccak_Avx2_Supported = 0;
+    if (__get_cpuid(1, &eax, &ebx, &ecx, &edx) && (ecx & bit_OSXSAVE) != 0 &&
+        (ecx & bit_AVX) != 0) {
+      /* The OS saves the YMM registers (XCR0 bits 1 and 2). */
+      __asm__("xgetbv" : "=a"(xcr0), "=d"(edx) : "c"(0));
+      if ((xcr0 & 6) == 6 && __get_cpuid_count(7, 0, &eax, &ebx, &ecx, &edx) &&
+          (ebx & bit_AVX2) != 0) {
+        Keccak_Avx2_Supported = 1;
+      }
+    }
+  }
+  return (uint8_t)Keccak_Avx2_Supported;
+}
+
+static const uint64_t Krc_x4[KECCAK_NR] = {
+    0x0000000000000001, 0x0000000000008082, 0x800000000000808A,
+    0x8000000080008000, 0x000000000000808B, 0x0000000080000001,
+    0x8000000080008081, 0x8000000000008009, 0x000000000000008A,
+    0x0000000000000088, 0x0000000080008009, 0x000000008000000A,
+    0x000000008000808B, 0x800000000000008B, 0x8000000000008089,
+    0x8000000000008003, 0x8000000000008002, 0x8000000000000080,
+    0x000000000000800A, 0x800000008000000A, 0x8000000080008081,
+    0x8000000000008080, 0x0000000080000001, 0x8000000080008008};
+
+#define XOR(a, b) _mm256_xor_si256(a, b)
+#define ANDNOT(a, b) _mm256_andnot_si256(a, b) /* ~a & b */
+#define ROL(x, n)                                                              \
+  _mm256_or_si256(_mm256_slli_epi64(x, n), _mm256_srli_epi64(x, 64 - (n)))
+
+/*
+ * The permutation is the same as the unrolled one in keccak.c, with the lanes
+ * named after their coordinates (rows b, g, k, m, s and columns a, e, i, o,
+ * u), two rounds per iteration and constant rotations. AVX2 has an AND-NOT
+ * instruction, so Chi does not need lane complementing.
+ */
+
+/* Theta: column parities and the D values. */
+#define KECCAK_AVX2_THETA(A)                                                   \
+  do {                                                                         \
+    Ca = XOR(XOR(XOR(A##ba, A##ga), XOR(A##ka, A##ma)), A##sa);                \
+    Ce = XOR(XOR(XOR(A##be, A##ge), XOR(A##ke, A##me)), A##se);                \
+    Ci = XOR(XOR(XOR(A##bi, A##gi), XOR(A##ki, A##mi)), A##si);                \
+    Co = XOR(XOR(XOR(A##bo, A##go), XOR(A##ko, A##mo)), A##so);                \
+    Cu = XOR(XOR(XOR(A##bu, A##gu), XOR(A##ku, A##mu)), A##su);                \
+    Da = XOR(Cu, ROL(Ce, 1));                                                  \
+    De = XOR(Ca, ROL(Ci, 1));                                                  \
+    Di = XOR(Ce, ROL(Co, 1));                                                  \
+    Do = XOR(Ci, ROL(Cu, 1));                                                  \
+    Du = XOR(Co, ROL(Ca, 1));                                                  \
+  } while (0)
+
+/* One round from state A to state E. */
+#define KECCAK_AVX2_ROUND(A, E, rc)                                            \
+  do {                                                                         \
+    KECCAK_AVX2_THETA(A);                                                      \
+                                                                             \
+    Ba = XOR(A##ba, Da);                                                     \
+    Be = ROL(XOR(A##ge, De), 44);                                            \
+    Bi = ROL(XOR(A##ki, Di), 43);                                            \
+    Bo = ROL(XOR(A##mo, Do), 21);                                            \
+    Bu = ROL(XOR(A##su, Du), 14);                                            \
+    E##ba = XOR(XOR(Ba, ANDNOT(Be, Bi)), rc);                                \
+    E##be = XOR(Be, ANDNOT(Bi, Bo));                                         \
+    E##bi = XOR(Bi, ANDNOT(Bo, Bu));                                         \
+    E##bo = XOR(Bo, ANDNOT(Bu, Ba));                                         \
+    E##bu = XOR(Bu, ANDNOT(Ba, Be));                                         \
+                                                                             \
+    Ba = ROL(XOR(A##bo, Do), 28);                                            \
+    Be = ROL(XOR(A##gu, Du), 20);                                            \
+    Bi = ROL(XOR(A##ka, Da), 3);                                             \
+    Bo = ROL(XOR(A##me, De), 45);                                            \
+    Bu = ROL(XOR(A##si, Di), 61);                                            \
+    E##ga = XOR(Ba, ANDNOT(Be, Bi));                                         \
+    E##ge = XOR(Be, ANDNOT(Bi, Bo));                                         \
+    E##gi = XOR(Bi, ANDNOT(Bo, Bu));                                         \
+    E##go = XOR(Bo, ANDNOT(Bu, Ba));                                         \
+    E##gu = XOR(Bu, ANDNOT(Ba, Be));                                         \
+                                                                             \
+    Ba = ROL(XOR(A##be, De), 1);                                             \
+    Be = ROL(XOR(A##gi, Di), 6);                                             \
+    Bi = ROL(XOR(A##ko, Do), 25);                                            \
+    Bo = ROL(XOR(A##mu, Du), 8);                                             \
+    Bu = ROL(XOR(A##sa, Da), 18);                                            \
+    E##ka = XOR(Ba, ANDNOT(Be, Bi));                                         \
+    E##ke = XOR(Be, ANDNOT(Bi, Bo));                                         \
+    E##ki = XOR(Bi, ANDNOT(Bo, Bu));                                         \
+    E##ko = XOR(Bo, ANDNOT(Bu, Ba));                                         \
+    E##ku = XOR(Bu, ANDNOT(Ba, Be));                                         \
+                                                                             \
+    Ba = ROL(XOR(A##bu, Du), 27);                                            \
+    Be = ROL(XOR(A##ga, Da), 36);                                            \
+    Bi = ROL(XOR(A##ke, De), 10);                                            \
+    Bo = ROL(XOR(A##mi, Di), 15);                                            \
+    Bu = ROL(XOR(A##so, Do), 56);                                            \
+    E##ma = XOR(Ba, ANDNOT(Be, Bi));                                         \
+    E##me = XOR(Be, ANDNOT(Bi, Bo));                                         \
+    E##mi = XOR(Bi, ANDNOT(Bo, Bu));                                         \
+    E##mo = XOR(Bo, ANDNOT(Bu, Ba));                                         \
+    E##mu = XOR(Bu, ANDNOT(Ba, Be));                                         \
+                                                                             \
+    Ba = ROL(XOR(A##bi, Di), 62);                                            \
+    Be = ROL(XOR(A##go, Do), 55);                                            \
+    Bi = ROL(XOR(A##ku, Du), 39);                                            \
+    Bo = ROL(XOR(A##ma, Da), 41);                                            \
+    Bu = ROL(XOR(A##se, De), 2);                                             \
+    E##sa = XOR(Ba, ANDNOT(Be, Bi));                                         \
+    E##se = XOR(Be, ANDNOT(Bi, Bo));                                         \
+    E##si = XOR(Bi, ANDNOT(Bo, Bu));                                         \
+    E##so = XOR(Bo, ANDNOT(Bu, Ba));                                         \
+    E##su = XOR(Bu, ANDNOT(Ba, Be));                                         \
+  } while (0)
+
+/* Loads the lanes of state X from the array. */
+#define KECCAK_AVX2_LOAD(X, s)                                                 \
+  do {                                                                         \
+    X##ba = s[0];                                                            \
+    X##be = s[1];                                                            \
+    X##bi = s[2];                                                            \
+    X##bo = s[3];                                                            \
+    X##bu = s[4];                                                            \
+    X##ga = s[5];                                                            \
+    X##ge = s[6];                                                            \
+    X##gi = s[7];                                                            \
+    X##go = s[8];                                                            \
+    X##gu = s[9];                                                            \
+    X##ka = s[10];                                                           \
+    X##ke = s[11];                                                           \
+    X##ki = s[12];                                                           \
+    X##ko = s[13];                                                           \
+    X##ku = s[14];                                                           \
+    X##ma = s[15];                                                           \
+    X##me = s[16];                                                           \
+    X##mi = s[17];                                                           \
+    X##mo = s[18];                                                           \
+    X##mu = s[19];                                                           \
+    X##sa = s[20];                                                           \
+    X##se = s[21];                                                           \
+    X##si = s[22];                                                           \
+    X##so = s[23];                                                           \
+    X##su = s[24];                                                           \
+  } while (0)
+
+/* Stores the lanes of state X to the array. */
+#define KECCAK_AVX2_STORE(X, s)                                                \
+  do {                                                                         \
+    s[0] = X##ba;                                                            \
+    s[1] = X##be;                                                            \
+    s[2] = X##bi;                                                            \
+    s[3] = X##bo;                                                            \
+    s[4] = X##bu;                                                            \
+    s[5] = X##ga;                                                            \
+    s[6] = X##ge;                                                            \
+    s[7] = X##gi;                                                            \
+    s[8] = X##go;                                                            \
+    s[9] = X##gu;                                                            \
+    s[10] = X##ka;                                                           \
+    s[11] = X##ke;                                                           \
+    s[12] = X##ki;                                                           \
+    s[13] = X##ko;                                                           \
+    s[14] = X##ku;                                                           \
+    s[15] = X##ma;                                                           \
+    s[16] = X##me;                                                           \
+    s[17] = X##mi;                                                           \
+    s[18] = X##mo;                                                           \
+    s[19] = X##mu;                                                           \
+    s[20] = X##sa;                                                           \
+    s[21] = X##se;                                                           \
+    s[22] = X##si;                                                           \
+    s[23] = X##so;                                                           \
+    s[24] = X##su;                                                           \
+  } while (0)
+
+/* Permutes the four states, lane 'i' of the states in s[i]. */
+KECCAK_AVX2_TARGET
+static void KeccakAvx2Permute(__m256i s[25], uint8_t rounds) {
+  __m256i Aba, Abe, Abi, Abo, Abu, Aga, Age, Agi, Ago, Agu, Aka, Ake, Aki, Ako,
+      Aku, Ama, Ame, Ami, Amo, Amu, Asa, Ase, Asi, Aso, Asu;
+  __m256i Eba, Ebe, Ebi, Ebo, Ebu, Ega, Ege, Egi, Ego, Egu, Eka, Eke, Eki, Eko,
+      Eku, Ema, Eme, Emi, Emo, Emu, Esa, Ese, Esi, Eso, Esu;
+  __m256i Ba, Be, Bi, Bo, Bu;
+  __m256i Ca, Ce, Ci, Co, Cu, Da, De, Di, Do, Du;
+  uint8_t i = KECCAK_NR - rounds;
+
+  KECCAK_AVX2_LOAD(A, s);
+
+  if (rounds % 2 != 0) {
+    /* Odd number of rounds: one round from E to A. */
+    KECCAK_AVX2_LOAD(E, s);
+    KECCAK_AVX2_ROUND(E, A,
+                      _mm256_broadcastq_epi64(
+                          _mm_loadl_epi64((const __m128i *)&Krc_x4[i])));
+    ++i;
+  }
+
+  for (; i < KECCAK_NR; i += 2) {
+    KECCAK_AVX2_ROUND(A, E,
+                      _mm256_broadcastq_epi64(
+                          _mm_loadl_epi64((const __m128i *)&Krc_x4[i])));
+    KECCAK_AVX2_ROUND(E, A,
+                      _mm256_broadcastq_epi64(
+                          _mm_loadl_epi64((const __m128i *)&Krc_x4[i + 1])));
+  }
+
+  KECCAK_AVX2_STORE(A, s);
+}
+
+/* Loads the 8 bytes at 'offset' of the four buffers. */
+KECCAK_AVX2_TARGET
+static __m256i KeccakAvx2Load(const uint8_t *const ptr[KECCAK_X4],
+                              size_t offset) {
+  __m128i lo = _mm_unpacklo_epi64(
+      _mm_loadl_epi64((const __m128i *)(ptr[0] + offset)),
+      _mm_loadl_epi64((const __m128i *)(ptr[1] + offset)));
+  __m128i hi = _mm_unpacklo_epi64(
+      _mm_loadl_epi64((const __m128i *)(ptr[2] + offset)),
+      _mm_loadl_epi64((const __m128i *)(ptr[3] + offset)));
+  return _mm256_inserti128_si256(_mm256_castsi128_si256(lo), hi, 1);
+}
+
+/* Stores 'x' to the 8 bytes at 'offset' of the four buffers. */
+KECCAK_AVX2_TARGET
+static void KeccakAvx2Store(uint8_t *const ptr[KECCAK_X4], size_t offset,
+                            __m256i x) {
+  __m128i lo = _mm256_castsi256_si128(x);
+  __m128i hi = _mm256_extracti128_si256(x, 1);
+  _mm_storel_epi64((__m128i *)(ptr[0] + offset), lo);
+  _mm_storel_epi64((__m128i *)(ptr[1] + offset), _mm_unpackhi_epi64(lo, lo));
+  _mm_storel_epi64((__m128i *)(ptr[2] + offset), hi);
+  _mm_storel_epi64((__m128i *)(ptr[3] + offset), _mm_unpackhi_epi64(hi, hi));
+}
+
+/* Runs 'blocks' permutations of the four states. Before each one, absorbs a
+ * block of 'in' if not NULL, or squeezes a block to 'out' if not NULL, and
+ * advances the pointers. The rate is a multiple of 8 bytes. */
+KECCAK_AVX2_TARGET
+static void KeccakAvx2Blocks(struct keccak_t *state_ptr[KECCAK_X4],
+                             uint8_t rate, uint8_t rounds,
+                             const uint8_t *in_ptr[KECCAK_X4],
+                             uint8_t *out_ptr[KECCAK_X4], size_t blocks) {
+  __m256i s[25];
+  uint8_t *a_ptr[KECCAK_X4];
+  uint8_t i, j;
+
+  for (j = 0; j < KECCAK_X4; ++j) {
+    a_ptr[j] = (uint8_t *)state_ptr[j]->a;
+  }
+  for (i = 0; i < 25; ++i) {
+    s[i] = KeccakAvx2Load((const uint8_t *const *)a_ptr, 8 * i);
+  }
+
+  for (; blocks > 0; --blocks) {
+    if (in_ptr != NULL) {
+      for (i = 0; i < rate / 8; ++i) {
+        s[i] = XOR(s[i], KeccakAvx2Load(in_ptr, 8 * i));
+      }
+      for (j = 0; j < KECCAK_X4; ++j) {
+        in_ptr[j] += rate;
+      }
+    } else if (out_ptr != NULL) {
+      for (i = 0; i < rate / 8; ++i) {
+        KeccakAvx2Store(out_ptr, 8 * i, s[i]);
+      }
+      for (j = 0; j < KECCAK_X4; ++j) {
+        out_ptr[j] += rate;
+      }
+    }
+    KeccakAvx2Permute(s, rounds);
+  }
+
+  for (i = 0; i < 25; ++i) {
+    KeccakAvx2Store(a_ptr, 8 * i, s[i]);
+  }
+  for (j = 0; j < KECCAK_X4; ++j) {
+    state_ptr[j]->num = 0;
+  }
+}
+
+/* Absorbs 'in' (if not NULL) or squeezes to 'out' 'num' bytes of each state.
+ * Whole blocks are processed in the AVX2 registers, partial blocks byte by
+ * byte. */
+void KeccakX4ProcessBlocks(struct keccak_t *state_ptr[KECCAK_X4], uint8_t rate,
+                           uint8_t rounds, const uint8_t *in_ptr[KECCAK_X4],
+                           uint8_t *out_ptr[KECCAK_X4], size_t num) {
+  uint8_t statenum = state_ptr[0]->num;
+  size_t n;
+  uint8_t j;
+
+  if (statenum >= rate && num > 0) {
+    /* Invalid count (e.g. state not initialized): start a new block. */
+    KeccakAvx2Blocks(state_ptr, rate, rounds, NULL, NULL, 1);
+    statenum = 0;
+  }
+
+  while (num > 0) {
+    if (statenum == 0 && num >= rate && rate % 8 == 0) {
+      n = num / rate;
+      KeccakAvx2Blocks(state_ptr, rate, rounds, in_ptr, out_ptr, n);
+      num -= n * rate;
+      continue;
+    }
+
+    n = rate - statenum;
+    if (n > num) {
+      n = num;
+    }
+    for (j = 0; j < KECCAK_X4; ++j) {
+      uint8_t *a_ptr = (uint8_t *)state_ptr[j]->a + statenum;
+      size_t i;
+      if (in_ptr != NULL) {
+        for (i = 0; i < n; ++i) {
+          a_ptr[i] ^= in_ptr[j][i];
+        }
+        in_ptr[j] += n;
+      } else {
+        memcpy(out_ptr[j], a_ptr, n);
+        out_ptr[j] += n;
+      }
+    }
+    statenum += (uint8_t)n;
+    num -= n;
+
+    if (statenum >= rate) {
+      /* Block complete. */
+      KeccakAvx2Blocks(state_ptr, rate, rounds, NULL, NULL, 1);
+      statenum = 0;
+    }
+  }
+
+  for (j = 0; j < KECCAK_X4; ++j) {
+    state_ptr[j]->num = statenum;
+  }
+}
+
+#endif /* KECCAK_AVX2 */
+
+/** Keccak-f 4-way
+ *
+ * Permutes the four states, as KeccakF() of each one.
+ */
+void KeccakF_x4(struct keccak_t *state_ptr[KECCAK_X4], uint8_t rounds) {
+  uint8_t j;
+#if KECCAK_AVX2
+  if (KeccakAvx2Supported()) {
+    KeccakAvx2Blocks(state_ptr, 0, rounds, NULL, NULL, 1);
+    return;
+  }
+#endif
+  for (j = 0; j < KECCAK_X4; ++j) {
+    KeccakF(state_ptr[j], rounds);
+  }
+}
+
+/** Keccak absorb 4-way
+ *
+ * Absorbs 'num' bytes of each buffer into its state, as KeccakAbsorb() of each
+ * one.
+ */
+void KeccakAbsorb_x4(struct keccak_t *state_ptr[KECCAK_X4], uint8_t rate,
+                     uint8_t rounds, const void *buff_ptr[KECCAK_X4],
+                     size_t num) {
+  uint8_t j;
+#if KECCAK_AVX2
+  if (KeccakAvx2Supported()) {
+    const uint8_t *in_ptr[KECCAK_X4];
+    for (j = 0; j < KECCAK_X4; ++j) {
+      in_ptr[j] = (const uint8_t *)buff_ptr[j];
+    }
+    KeccakX4ProcessBlocks(state_ptr, rate, rounds, in_ptr, NULL, num);
+    return;
+  }
+#endif
+  for (j = 0; j < KECCAK_X4; ++j) {
+    KeccakAbsorb(state_ptr[j], rate, rounds, buff_ptr[j], num);
+  }
+}
+
+/** Keccak finish 4-way
+ *
+ * Pads the four states and permutes them, as KeccakFinish() of each one.
+ */
+void KeccakFinish_x4(struct keccak_t *state_ptr[KECCAK_X4], uint8_t rate,
+                     uint8_t rounds, uint8_t pad_byte) {
+  uint8_t j;
+#if KECCAK_AVX2
+  if (KeccakAvx2Supported()) {
+    uint8_t *a_ptr;
+    for (j = 0; j < KECCAK_X4; ++j) {
+      a_ptr = (uint8_t *)&state_ptr[j]->a[0];
+      a_ptr[state_ptr[j]->num] ^= pad_byte;
+      a_ptr[rate - 1] ^= KECCAK_PAD_END;
+    }
+    KeccakAvx2Blocks(state_ptr, 0, rounds, NULL, NULL, 1);
+    return;
+  }
+#endif
+  for (j = 0; j < KECCAK_X4; ++j) {
+    KeccakFinish(state_ptr[j], rate, rounds, pad_byte);
+  }
+}
+
+/** Keccak squeeze 4-way
+ *
+ * Squeezes 'num' bytes of each state to its buffer, as KeccakSqueeze() of each
+ * one.
+ */
+void KeccakSqueeze_x4(struct keccak_t *state_ptr[KECCAK_X4], uint8_t rate,
+                      uint8_t rounds, void *buff_ptr[KECCAK_X4], size_t num) {
+  uint8_t j;
+#if KECCAK_AVX2
+  if (KeccakAvx2Supported()) {
+    uint8_t *out_ptr[KECCAK_X4];
+    for (j = 0; j < KECCAK_X4; ++j) {
+      out_ptr[j] = (uint8_t *)buff_ptr[j];
+    }
+    KeccakX4ProcessBlocks(state_ptr, rate, rounds, NULL, out_ptr, num);
+    return;
+  }
+#endif
+  for (j = 0; j < KECCAK_X4; ++j) {
+    KeccakSqueeze(state_ptr[j], rate, rounds, buff_ptr[j], num);
+  }
+}
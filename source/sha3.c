@@ -24,7 +24,7 @@ void SHA3_512Init(struct sha3_512_t *state_ptr) {
 }
 
 void SHA3_512Update(struct sha3_512_t *state_ptr, const void *data_ptr,
-                    uint16_t num) {
+                    size_t num) {
   const uint8_t rate = 72;
 
   KeccakAbsorb(&state_ptr->hash, rate, 24, data_ptr, num);
@@ -38,6 +38,7 @@ void SHA3_512Finish(struct sha3_512_t *state_ptr) {
   uint8_t *a_ptr = (uint8_t *)&state_ptr->hash.a[0];
 
   KeccakFinish(&state_ptr->hash, rate, 24, KECCAK_PAD_SHA3);
+  KeccakStateToBytes(&state_ptr->hash);
 
   /* Zero extra bytes. */
   for (i = output; i < state_size; ++i)
@@ -49,7 +50,7 @@ void SHA3_384Init(struct sha3_384_t *state_ptr) {
 }
 
 void SHA3_384Update(struct sha3_384_t *state_ptr, const void *data_ptr,
-                    uint16_t num) {
+                    size_t num) {
   const uint8_t rate = 104;
 
   KeccakAbsorb(&state_ptr->hash, rate, 24, data_ptr, num);
@@ -63,6 +64,7 @@ void SHA3_384Finish(struct sha3_384_t *state_ptr) {
   uint8_t *a_ptr = (uint8_t *)&state_ptr->hash.a[0];
 
   KeccakFinish(&state_ptr->hash, rate, 24, KECCAK_PAD_SHA3);
+  KeccakStateToBytes(&state_ptr->hash);
 
   /* Zero extra bytes. */
   for (i = output; i < state_size; ++i)
@@ -74,7 +76,7 @@ void SHA3_256Init(struct sha3_256_t *state_ptr) {
 }
 
 void SHA3_256Update(struct sha3_256_t *state_ptr, const void *data_ptr,
-                    uint16_t num) {
+                    size_t num) {
   const uint8_t rate = 136;
 
   KeccakAbsorb(&state_ptr->hash, rate, 24, data_ptr, num);
@@ -88,6 +90,7 @@ void SHA3_256Finish(struct sha3_256_t *state_ptr) {
   uint8_t *a_ptr = (uint8_t *)&state_ptr->hash.a[0];
 
   KeccakFinish(&state_ptr->hash, rate, 24, KECCAK_PAD_SHA3);
+  KeccakStateToBytes(&state_ptr->hash);
 
   /* Zero extra bytes. */
   for (i = output; i < state_size; ++i)
@@ -99,7 +102,7 @@ void SHA3_224Init(struct sha3_224_t *state_ptr) {
 }
 
 void SHA3_224Update(struct sha3_224_t *state_ptr, const void *data_ptr,
-                    uint16_t num) {
+                    size_t num) {
   const uint8_t rate = 144;
 
   KeccakAbsorb(&state_ptr->hash, rate, 24, data_ptr, num);
@@ -113,6 +116,7 @@ void SHA3_224Finish(struct sha3_224_t *state_ptr) {
   uint8_t *a_ptr = (uint8_t *)&state_ptr->hash.a[0];
 
   KeccakFinish(&state_ptr->hash, rate, 24, KECCAK_PAD_SHA3);
+  KeccakStateToBytes(&state_ptr->hash);
 
   /* Zero extra bytes. */
   for (i = output; i < state_size; ++i)
@@ -130,7 +134,7 @@ void SHAKE256Domain(struct shake_256_t *state_ptr, const void *domain_ptr,
 }
 
 void SHAKE256Absorb(struct shake_256_t *state_ptr, const void *data_ptr,
-                    uint16_t num) {
+                    size_t num) {
   const uint8_t rate = 136;
 
   KeccakAbsorb(&state_ptr->hash, rate, 24, data_ptr, num);
@@ -143,7 +147,7 @@ void SHAKE256Finish(struct shake_256_t *state_ptr) {
 }
 
 void SHAKE256Squeeze(struct shake_256_t *state_ptr, void *data_ptr,
-                     uint16_t num) {
+                     size_t num) {
   const uint8_t rate = 136;
 
   KeccakSqueeze(&state_ptr->hash, rate, 24, data_ptr, num);
@@ -160,7 +164,7 @@ void SHAKE128Domain(struct shake_128_t *state_ptr, const void *domain_ptr,
 }
 
 void SHAKE128Absorb(struct shake_128_t *state_ptr, const void *data_ptr,
-                    uint16_t num) {
+                    size_t num) {
   const uint8_t rate = 168;
 
   KeccakAbsorb(&state_ptr->hash, rate, 24, data_ptr, num);
@@ -173,7 +177,7 @@ void SHAKE128Finish(struct shake_128_t *state_ptr) {
 }
 
 void SHAKE128Squeeze(struct shake_128_t *state_ptr, void *data_ptr,
-                     uint16_t num) {
+                     size_t num) {
   const uint8_t rate = 168;
 
   KeccakSqueeze(&state_ptr->hash, rate, 24, data_ptr, num);
@@ -25,44 +25,54 @@ AES_BLOCK_LEN = 16
 # Dicrionaries to hold modules and ffis
 module, ffi = {}, {}
 
-# Compile several modules with different key length
-for AES_KEY_LEN in (16, 24, 32):
-
-  # Every module have its own name
-  module_name = 'aes_%d_' % AES_KEY_LEN
-
-  source_files = [
-    '../source/aes.c',
-  ]
-
-  include_paths = [
-    '../include',
-  ]
-
-  # Each module has one key length
-  compiler_options = [
-    '-std=c90',
-    '-pedantic',
-    '-DAES_KEY_LEN=%d' % AES_KEY_LEN
-  ]
-
-  module[AES_KEY_LEN], ffi[AES_KEY_LEN] = load(
-      source_files, include_paths, compiler_options,
-      module_name=module_name)
+# Backends to test. The default one uses AES-NI if the CPU supports it.
+BACKENDS = {
+  'default': [],
+  'ttable': ['-DAES_AESNI=0', '-DAES_FASTER=1'],
+  'compact': ['-DAES_AESNI=0', '-DAES_FASTER=0'],
+}
+
+# Compile several modules with different key length and backend
+for BACKEND in BACKENDS:
+  for AES_KEY_LEN in (16, 24, 32):
+
+    # Every module have its own name
+    module_name = 'aes_%s_%d_' % (BACKEND, AES_KEY_LEN)
+
+    source_files = [
+      '../source/aes.c',
+    ]
+
+    include_paths = [
+      '../include',
+    ]
+
+    # Each module has one key length
+    compiler_options = [
+      '-std=c90',
+      '-pedantic',
+      '-DAES_KEY_LEN=%d' % AES_KEY_LEN
+    ] + BACKENDS[BACKEND]
+
+    module[BACKEND, AES_KEY_LEN], ffi[BACKEND, AES_KEY_LEN] = load(
+        source_files, include_paths, compiler_options,
+        module_name=module_name)
 
 from Crypto.Cipher import AES
+from Crypto.Hash import CMAC
+from Crypto.Util.Padding import pad
 
 class TestECBEncrypt(unittest.TestCase):
 
   def testECBEncryptZeros(self):
     # Test all the modules
-    # AES-128, AES-192, AES-256
-    for AES_KEY_LEN in (16, 24, 32):
+    # AES-128, AES-192, AES-256 with every backend
+    for BACKEND, AES_KEY_LEN in module:
       key = b'\x00' * AES_KEY_LEN
       plain = b'\x00' * AES_BLOCK_LEN
 
       cipher_module = b'\x00' * AES_BLOCK_LEN
-      module[AES_KEY_LEN].AES_ECBEncrypt(key, plain, cipher_module)
+      module[BACKEND, AES_KEY_LEN].AES_ECBEncrypt(key, plain, cipher_module)
 
       # The correct implementation is automatically selected with by the
       # key length
@@ -71,13 +81,13 @@ class TestECBEncrypt(unittest.TestCase):
       self.assertEqual(cipher_module, cipher_reference)
 
   def testECBEncryptRandom(self):
-    for AES_KEY_LEN in (16, 24, 32):
+    for BACKEND, AES_KEY_LEN in module:
       for count in range(1024):
         key = os.urandom(AES_KEY_LEN)
         plain = os.urandom(AES_BLOCK_LEN)
 
         cipher_module = b'\x00' * AES_BLOCK_LEN
-        module[AES_KEY_LEN].AES_ECBEncrypt(key, plain, cipher_module)
+        module[BACKEND, AES_KEY_LEN].AES_ECBEncrypt(key, plain, cipher_module)
 
         cipher_reference = AES.new(key, AES.MODE_ECB).encrypt(plain)
 
@@ -86,25 +96,25 @@ class TestECBEncrypt(unittest.TestCase):
 class TestECBDecrypt(unittest.TestCase):
 
   def testECBDecryptZeros(self):
-    for AES_KEY_LEN in (16, 24, 32):
+    for BACKEND, AES_KEY_LEN in module:
       key = b'\x00' * AES_KEY_LEN
       cipher = b'\x00' * AES_BLOCK_LEN
 
       plain_module = b'\x00' * AES_BLOCK_LEN
-      module[AES_KEY_LEN].AES_ECBDecrypt(key, cipher, plain_module)
+      module[BACKEND, AES_KEY_LEN].AES_ECBDecrypt(key, cipher, plain_module)
 
       plain_reference = AES.new(key, AES.MODE_ECB).decrypt(cipher)
 
       self.assertEqual(plain_module, plain_reference)
 
   def testECBDecryptRandom(self):
-    for AES_KEY_LEN in (16, 24, 32):
+    for BACKEND, AES_KEY_LEN in module:
       for count in range(1024):
         key = os.urandom(AES_KEY_LEN)
         cipher = os.urandom(AES_BLOCK_LEN)
 
         plain_module = b'\x00' * AES_BLOCK_LEN
-        module[AES_KEY_LEN].AES_ECBDecrypt(key, cipher, plain_module)
+        module[BACKEND, AES_KEY_LEN].AES_ECBDecrypt(key, cipher, plain_module)
 
         plain_reference = AES.new(key, AES.MODE_ECB).decrypt(cipher)
 
@@ -113,14 +123,14 @@ class TestECBDecrypt(unittest.TestCase):
 class TestCBCEncrypt(unittest.TestCase):
 
   def testCBCEncryptZeros(self):
-    for AES_KEY_LEN in (16, 24, 32):
+    for BACKEND, AES_KEY_LEN in module:
       length = AES_BLOCK_LEN * 2
       key = b'\x00' * AES_KEY_LEN
       iv = b'\x00' * AES_BLOCK_LEN
       plain = b'\x00' * length
 
       cipher_module = b'\x00' * length
-      module[AES_KEY_LEN].AES_CBCEncrypt(key, iv, plain, length, cipher_module)
+      module[BACKEND, AES_KEY_LEN].AES_CBCEncrypt(key, iv, plain, length, cipher_module)
 
       iv_ecb = AES.new(key, AES.MODE_ECB).encrypt(iv)
       cipher_reference = AES.new(key, AES.MODE_CBC, iv_ecb).encrypt(plain)
@@ -128,7 +138,7 @@ class TestCBCEncrypt(unittest.TestCase):
       self.assertEqual(cipher_module, cipher_reference)
 
   def testCBCEncryptRandom(self):
-    for AES_KEY_LEN in (16, 24, 32):
+    for BACKEND, AES_KEY_LEN in module:
       for count in range(1024):
         num = random.randint(0, 16)
         length = AES_BLOCK_LEN * num
@@ -137,7 +147,7 @@ class TestCBCEncrypt(unittest.TestCase):
         plain = os.urandom(length)
 
         cipher_module = b'\x00' * length
-        module[AES_KEY_LEN].AES_CBCEncrypt(key, iv, plain, length, cipher_module)
+        module[BACKEND, AES_KEY_LEN].AES_CBCEncrypt(key, iv, plain, length, cipher_module)
 
         iv_ecb = AES.new(key, AES.MODE_ECB).encrypt(iv)
         cipher_reference = AES.new(key, AES.MODE_CBC, iv_ecb).encrypt(plain)
@@ -147,14 +157,14 @@ class TestCBCEncrypt(unittest.TestCase):
 class TestCBCDecrypt(unittest.TestCase):
 
   def testCBCDecryptZeros(self):
-    for AES_KEY_LEN in (16, 24, 32):
+    for BACKEND, AES_KEY_LEN in module:
       length = AES_BLOCK_LEN * 2
       key = b'\x00' * AES_KEY_LEN
       iv = b'\x00' * AES_BLOCK_LEN
       cipher = b'\x00' * length
 
       plain_module = b'\x00' * length
-      module[AES_KEY_LEN].AES_CBCDecrypt(key, iv, cipher, length, plain_module)
+      module[BACKEND, AES_KEY_LEN].AES_CBCDecrypt(key, iv, cipher, length, plain_module)
 
       iv_ecb = AES.new(key, AES.MODE_ECB).encrypt(iv)
       plain_reference = AES.new(key, AES.MODE_CBC, iv_ecb).decrypt(cipher)
@@ -162,7 +172,7 @@ class TestCBCDecrypt(unittest.TestCase):
       self.assertEqual(plain_module, plain_reference)
 
   def testCBCDecryptRandom(self):
-    for AES_KEY_LEN in (16, 24, 32):
+    for BACKEND, AES_KEY_LEN in module:
       for count in range(1024):
         num = random.randint(0, 16)
         length = AES_BLOCK_LEN * num
@@ -171,12 +181,683 @@ class TestCBCDecrypt(unittest.TestCase):
         cipher = os.urandom(length)
 
         plain_module = b'\x00' * length
-        module[AES_KEY_LEN].AES_CBCDecrypt(key, iv, cipher, length, plain_module)
+        module[BACKEND, AES_KEY_LEN].AES_CBCDecrypt(key, iv, cipher, length, plain_module)
 
         iv_ecb = AES.new(key, AES.MODE_ECB).encrypt(iv)
         plain_reference = AES.new(key, AES.MODE_CBC, iv_ecb).decrypt(cipher)
 
         self.assertEqual(plain_module, plain_reference)
 
+class TestCtx(unittest.TestCase):
+
+  def testCtxEncryptDecryptRandom(self):
+    for BACKEND, AES_KEY_LEN in module:
+      for count in range(64):
+        key = os.urandom(AES_KEY_LEN)
+
+        pctx = ffi[BACKEND, AES_KEY_LEN].new('struct aes_ctx_t[1]')
+        module[BACKEND, AES_KEY_LEN].AESCtxInit(pctx, key)
+
+        # The same context is used for many blocks
+        for block in range(16):
+          plain = os.urandom(AES_BLOCK_LEN)
+
+          cipher_module = b'\x00' * AES_BLOCK_LEN
+          module[BACKEND, AES_KEY_LEN].AESCtxEncrypt(
+              pctx, plain, cipher_module)
+
+          plain_module = b'\x00' * AES_BLOCK_LEN
+          module[BACKEND, AES_KEY_LEN].AESCtxDecrypt(
+              pctx, cipher_module, plain_module)
+
+          cipher_reference = AES.new(key, AES.MODE_ECB).encrypt(plain)
+
+          self.assertEqual(cipher_module, cipher_reference)
+          self.assertEqual(plain_module, plain)
+
+  def testCtxCBCRandom(self):
+    for BACKEND, AES_KEY_LEN in module:
+      key = os.urandom(AES_KEY_LEN)
+
+      pctx = ffi[BACKEND, AES_KEY_LEN].new('struct aes_ctx_t[1]')
+      module[BACKEND, AES_KEY_LEN].AESCtxInit(pctx, key)
+
+      for count in range(64):
+        num = random.randint(0, 16)
+        length = AES_BLOCK_LEN * num
+        iv = os.urandom(AES_BLOCK_LEN)
+        plain = os.urandom(length)
+
+        cipher_module = b'\x00' * length
+        module[BACKEND, AES_KEY_LEN].AESCtxCBCEncrypt(
+            pctx, iv, plain, length, cipher_module)
+
+        plain_module = b'\x00' * length
+        module[BACKEND, AES_KEY_LEN].AESCtxCBCDecrypt(
+            pctx, iv, cipher_module, length, plain_module)
+
+        iv_ecb = AES.new(key, AES.MODE_ECB).encrypt(iv)
+        cipher_reference = AES.new(key, AES.MODE_CBC, iv_ecb).encrypt(plain)
+
+        self.assertEqual(cipher_module, cipher_reference)
+        self.assertEqual(plain_module, plain)
+
+class TestInvCtx(unittest.TestCase):
+
+  def testInvCtxDecryptRandom(self):
+    for BACKEND, AES_KEY_LEN in module:
+      for count in range(64):
+        key = os.urandom(AES_KEY_LEN)
+
+        pctx = ffi[BACKEND, AES_KEY_LEN].new('struct aes_ctx_t[1]')
+        pinv_ctx = ffi[BACKEND, AES_KEY_LEN].new('struct aes_inv_ctx_t[1]')
+        module[BACKEND, AES_KEY_LEN].AESCtxInit(pctx, key)
+        module[BACKEND, AES_KEY_LEN].AESInvCtxInit(pinv_ctx, pctx)
+
+        for block in range(16):
+          cipher = os.urandom(AES_BLOCK_LEN)
+
+          plain_module = b'\x00' * AES_BLOCK_LEN
+          module[BACKEND, AES_KEY_LEN].AESInvCtxDecrypt(
+              pinv_ctx, cipher, plain_module)
+
+          plain_reference = AES.new(key, AES.MODE_ECB).decrypt(cipher)
+
+          self.assertEqual(plain_module, plain_reference)
+
+  def testInvCtxCBCDecryptRandom(self):
+    for BACKEND, AES_KEY_LEN in module:
+      key = os.urandom(AES_KEY_LEN)
+
+      pctx = ffi[BACKEND, AES_KEY_LEN].new('struct aes_ctx_t[1]')
+      pinv_ctx = ffi[BACKEND, AES_KEY_LEN].new('struct aes_inv_ctx_t[1]')
+      module[BACKEND, AES_KEY_LEN].AESCtxInit(pctx, key)
+      module[BACKEND, AES_KEY_LEN].AESInvCtxInit(pinv_ctx, pctx)
+
+      for count in range(64):
+        num = random.randint(0, 16)
+        length = AES_BLOCK_LEN * num
+        iv = os.urandom(AES_BLOCK_LEN)
+        cipher = os.urandom(length)
+
+        plain_module = b'\x00' * length
+        module[BACKEND, AES_KEY_LEN].AESInvCtxCBCDecrypt(
+            pctx, pinv_ctx, iv, cipher, length, plain_module)
+
+        iv_ecb = AES.new(key, AES.MODE_ECB).encrypt(iv)
+        plain_reference = AES.new(key, AES.MODE_CBC, iv_ecb).decrypt(cipher)
+
+        self.assertEqual(plain_module, plain_reference)
+
+class TestCBCDecryptRange(unittest.TestCase):
+
+  def testCBCDecryptInPlace(self):
+    for BACKEND, AES_KEY_LEN in module:
+      for count in range(16):
+        length = AES_BLOCK_LEN * random.randint(1, 40)
+        key = os.urandom(AES_KEY_LEN)
+        iv = os.urandom(AES_BLOCK_LEN)
+        plain = os.urandom(length)
+
+        iv_ecb = AES.new(key, AES.MODE_ECB).encrypt(iv)
+        cipher = AES.new(key, AES.MODE_CBC, iv_ecb).encrypt(plain)
+
+        pctx = ffi[BACKEND, AES_KEY_LEN].new('struct aes_ctx_t[1]')
+        pinv_ctx = ffi[BACKEND, AES_KEY_LEN].new('struct aes_inv_ctx_t[1]')
+        module[BACKEND, AES_KEY_LEN].AESCtxInit(pctx, key)
+        module[BACKEND, AES_KEY_LEN].AESInvCtxInit(pinv_ctx, pctx)
+
+        buff = ffi[BACKEND, AES_KEY_LEN].new('uint8_t[%d]' % length, cipher)
+        module[BACKEND, AES_KEY_LEN].AESInvCtxCBCDecrypt(
+            pctx, pinv_ctx, iv, buff, length, buff)
+
+        self.assertEqual(bytes(buff), plain)
+
+  def testCBCDecryptRangeRandom(self):
+    for BACKEND, AES_KEY_LEN in module:
+      for count in range(16):
+        num = random.randint(1, 40)
+        key = os.urandom(AES_KEY_LEN)
+        iv = os.urandom(AES_BLOCK_LEN)
+        plain = os.urandom(AES_BLOCK_LEN * num)
+
+        iv_ecb = AES.new(key, AES.MODE_ECB).encrypt(iv)
+        cipher = AES.new(key, AES.MODE_CBC, iv_ecb).encrypt(plain)
+
+        pctx = ffi[BACKEND, AES_KEY_LEN].new('struct aes_ctx_t[1]')
+        pinv_ctx = ffi[BACKEND, AES_KEY_LEN].new('struct aes_inv_ctx_t[1]')
+        module[BACKEND, AES_KEY_LEN].AESCtxInit(pctx, key)
+        module[BACKEND, AES_KEY_LEN].AESInvCtxInit(pinv_ctx, pctx)
+
+        # Decrypt only blocks first..last-1, given the previous block
+        first = random.randint(0, num - 1)
+        last = random.randint(first + 1, num)
+        if first == 0:
+          prev = iv_ecb
+        else:
+          prev = cipher[AES_BLOCK_LEN * (first - 1):AES_BLOCK_LEN * first]
+        cipher_range = cipher[AES_BLOCK_LEN * first:AES_BLOCK_LEN * last]
+
+        plain_module = b'\x00' * len(cipher_range)
+        module[BACKEND, AES_KEY_LEN].AESInvCtxCBCDecryptRange(
+            pinv_ctx, prev, cipher_range, len(cipher_range), plain_module)
+
+        self.assertEqual(plain_module,
+                         plain[AES_BLOCK_LEN * first:AES_BLOCK_LEN * last])
+
+class TestECBBlocks(unittest.TestCase):
+
+  def testECBBlocksRandom(self):
+    for BACKEND, AES_KEY_LEN in module:
+      for count in range(64):
+        num = random.randint(0, 40)
+        length = AES_BLOCK_LEN * num
+        key = os.urandom(AES_KEY_LEN)
+        plain = os.urandom(length)
+
+        pctx = ffi[BACKEND, AES_KEY_LEN].new('struct aes_ctx_t[1]')
+        pinv_ctx = ffi[BACKEND, AES_KEY_LEN].new('struct aes_inv_ctx_t[1]')
+        module[BACKEND, AES_KEY_LEN].AESCtxInit(pctx, key)
+        module[BACKEND, AES_KEY_LEN].AESInvCtxInit(pinv_ctx, pctx)
+
+        cipher_module = b'\x00' * length
+        module[BACKEND, AES_KEY_LEN].AESCtxECBEncrypt(
+            pctx, plain, length, cipher_module)
+
+        plain_module = b'\x00' * length
+        module[BACKEND, AES_KEY_LEN].AESInvCtxECBDecrypt(
+            pinv_ctx, cipher_module, length, plain_module)
+
+        cipher_reference = AES.new(key, AES.MODE_ECB).encrypt(plain)
+
+        self.assertEqual(cipher_module, cipher_reference)
+        self.assertEqual(plain_module, plain)
+
+def ctr_reference(key, iv, counter_len, length):
+  # Key stream with a counter of 'counter_len' bytes that wraps
+  nonce = iv[:AES_BLOCK_LEN - counter_len]
+  counter = int.from_bytes(iv[AES_BLOCK_LEN - counter_len:], 'big')
+  ecb = AES.new(key, AES.MODE_ECB)
+  keystream = b''
+  while len(keystream) < length:
+    keystream += ecb.encrypt(nonce + counter.to_bytes(counter_len, 'big'))
+    counter = (counter + 1) % 2**(8 * counter_len)
+  return keystream[:length]
+
+class TestCTR(unittest.TestCase):
+
+  def testCTRReference(self):
+    for BACKEND, AES_KEY_LEN in module:
+      for counter_len in (4, 8, 16):
+        length = random.randint(0, 1024)
+        key = os.urandom(AES_KEY_LEN)
+        iv = os.urandom(AES_BLOCK_LEN)
+        plain = os.urandom(length)
+
+        pctr = ffi[BACKEND, AES_KEY_LEN].new('struct aes_ctr_t[1]')
+        module[BACKEND, AES_KEY_LEN].AESCtrInit(
+            pctr, key, len(key), iv, counter_len)
+
+        cipher_module = ffi[BACKEND, AES_KEY_LEN].new('uint8_t[]', length)
+        module[BACKEND, AES_KEY_LEN].AESCtrEncrypt(
+            pctr, plain, length, cipher_module)
+        cipher_module = bytes(cipher_module)
+
+        nonce = iv[:AES_BLOCK_LEN - counter_len]
+        initial_value = iv[AES_BLOCK_LEN - counter_len:]
+        cipher_reference = AES.new(
+            key, AES.MODE_CTR, nonce=nonce,
+            initial_value=initial_value).encrypt(plain)
+
+        self.assertEqual(cipher_module, cipher_reference)
+
+  def testCTRStreamingRandom(self):
+    for BACKEND, AES_KEY_LEN in module:
+      for count in range(16):
+        counter_len = random.randint(1, 16)
+        length = random.randint(0, 1024)
+        key = os.urandom(AES_KEY_LEN)
+        iv = os.urandom(AES_BLOCK_LEN)
+        plain = os.urandom(length)
+
+        pctr = ffi[BACKEND, AES_KEY_LEN].new('struct aes_ctr_t[1]')
+        module[BACKEND, AES_KEY_LEN].AESCtrInit(
+            pctr, key, len(key), iv, counter_len)
+
+        # Encrypt in pieces of random length
+        cipher_module = b''
+        pos = 0
+        while pos < length:
+          num = random.randint(0, 100)
+          piece = plain[pos:pos + num]
+          out = ffi[BACKEND, AES_KEY_LEN].new('uint8_t[]', len(piece))
+          module[BACKEND, AES_KEY_LEN].AESCtrEncrypt(
+              pctr, piece, len(piece), out)
+          cipher_module += bytes(out)
+          pos += num
+
+        keystream = ctr_reference(key, iv, counter_len, length)
+        cipher_reference = bytes(a ^ b for a, b in zip(plain, keystream))
+
+        self.assertEqual(cipher_module, cipher_reference)
+
+        # Decrypt
+        module[BACKEND, AES_KEY_LEN].AESCtrSeek(pctr, 0)
+        plain_module = ffi[BACKEND, AES_KEY_LEN].new('uint8_t[]', length)
+        module[BACKEND, AES_KEY_LEN].AESCtrDecrypt(
+            pctr, cipher_module, length, plain_module)
+        plain_module = bytes(plain_module)
+
+        self.assertEqual(plain_module, plain)
+
+  def testCTRSeekRandom(self):
+    for BACKEND, AES_KEY_LEN in module:
+      for count in range(16):
+        counter_len = random.choice((1, 2, 4, 8, 12, 16))
+        key = os.urandom(AES_KEY_LEN)
+        iv = os.urandom(AES_BLOCK_LEN)
+        offset = random.randint(0, 8192)
+        length = random.randint(0, 256)
+
+        pctr = ffi[BACKEND, AES_KEY_LEN].new('struct aes_ctr_t[1]')
+        module[BACKEND, AES_KEY_LEN].AESCtrInit(
+            pctr, key, len(key), iv, counter_len)
+        module[BACKEND, AES_KEY_LEN].AESCtrSeek(pctr, offset)
+
+        keystream_module = ffi[BACKEND, AES_KEY_LEN].new('uint8_t[]', length)
+        module[BACKEND, AES_KEY_LEN].AESCtrEncrypt(
+            pctr, bytes(length), length, keystream_module)
+        keystream_module = bytes(keystream_module)
+
+        keystream = ctr_reference(key, iv, counter_len, offset + length)
+
+        self.assertEqual(keystream_module, keystream[offset:])
+
+  def testCTRInvalidCounterLength(self):
+    for BACKEND, AES_KEY_LEN in module:
+      key = os.urandom(AES_KEY_LEN)
+      iv = os.urandom(AES_BLOCK_LEN)
+      pctr = ffi[BACKEND, AES_KEY_LEN].new('struct aes_ctr_t[1]')
+      for counter_len in (0, 17, 255):
+        self.assertEqual(module[BACKEND, AES_KEY_LEN].AESCtrInit(
+            pctr, key, len(key), iv, counter_len), 0)
+      for counter_len in (1, 16):
+        self.assertEqual(module[BACKEND, AES_KEY_LEN].AESCtrInit(
+            pctr, key, len(key), iv, counter_len), 1)
+
+class TestConstantTime(unittest.TestCase):
+
+  def testCtxInitCt(self):
+    for BACKEND, AES_KEY_LEN in module:
+      for count in range(64):
+        key = os.urandom(AES_KEY_LEN)
+
+        pctx = ffi[BACKEND, AES_KEY_LEN].new('struct aes_ctx_t[1]')
+        pctx_ct = ffi[BACKEND, AES_KEY_LEN].new('struct aes_ctx_t[1]')
+        module[BACKEND, AES_KEY_LEN].AESCtxInit(pctx, key)
+        module[BACKEND, AES_KEY_LEN].AESCtxInitCt(pctx_ct, key)
+
+        self.assertEqual(ffi[BACKEND, AES_KEY_LEN].buffer(pctx)[:],
+                         ffi[BACKEND, AES_KEY_LEN].buffer(pctx_ct)[:])
+
+  def testECBEncryptCtRandom(self):
+    for BACKEND, AES_KEY_LEN in module:
+      for count in range(64):
+        num = random.randint(0, 16)
+        length = AES_BLOCK_LEN * num
+        key = os.urandom(AES_KEY_LEN)
+        plain = os.urandom(length)
+
+        pctx = ffi[BACKEND, AES_KEY_LEN].new('struct aes_ctx_t[1]')
+        module[BACKEND, AES_KEY_LEN].AESCtxInitCt(pctx, key)
+
+        cipher_module = b'\x00' * length
+        module[BACKEND, AES_KEY_LEN].AESCtxECBEncryptCt(
+            pctx, plain, length, cipher_module)
+
+        cipher_reference = AES.new(key, AES.MODE_ECB).encrypt(plain)
+
+        self.assertEqual(cipher_module, cipher_reference)
+
+  def testCTREncryptCtRandom(self):
+    for BACKEND, AES_KEY_LEN in module:
+      for count in range(64):
+        length = random.randint(0, 256)
+        key = os.urandom(AES_KEY_LEN)
+        counter = os.urandom(AES_BLOCK_LEN)
+        plain = os.urandom(length)
+
+        pctx = ffi[BACKEND, AES_KEY_LEN].new('struct aes_ctx_t[1]')
+        module[BACKEND, AES_KEY_LEN].AESCtxInitCt(pctx, key)
+
+        pcounter = ffi[BACKEND, AES_KEY_LEN].new('uint8_t[16]', counter)
+        cipher_module = ffi[BACKEND, AES_KEY_LEN].new('uint8_t[]', length)
+        module[BACKEND, AES_KEY_LEN].AESCtxCTREncryptCt(
+            pctx, pcounter, plain, length, cipher_module)
+        cipher_module = bytes(cipher_module)
+
+        cipher_reference = AES.new(
+            key, AES.MODE_CTR, nonce=b'',
+            initial_value=counter).encrypt(plain)
+
+        # Counter points to the next unused block
+        num = (length + AES_BLOCK_LEN - 1) // AES_BLOCK_LEN
+        counter_reference = (int.from_bytes(counter, 'big') + num) % 2**128
+
+        self.assertEqual(cipher_module, cipher_reference)
+        self.assertEqual(ffi[BACKEND, AES_KEY_LEN].buffer(pcounter)[:],
+                         counter_reference.to_bytes(AES_BLOCK_LEN, 'big'))
+
+  def testCTRCounterWrap(self):
+    for BACKEND, AES_KEY_LEN in module:
+      key = os.urandom(AES_KEY_LEN)
+      counter = b'\xFF' * AES_BLOCK_LEN
+      length = AES_BLOCK_LEN * 3
+      plain = os.urandom(length)
+
+      pctx = ffi[BACKEND, AES_KEY_LEN].new('struct aes_ctx_t[1]')
+      module[BACKEND, AES_KEY_LEN].AESCtxInitCt(pctx, key)
+
+      pcounter = ffi[BACKEND, AES_KEY_LEN].new('uint8_t[16]', counter)
+      cipher_module = b'\x00' * length
+      module[BACKEND, AES_KEY_LEN].AESCtxCTREncryptCt(
+          pctx, pcounter, plain, length, cipher_module)
+
+      ecb = AES.new(key, AES.MODE_ECB)
+      keystream = (ecb.encrypt(counter) +
+                   ecb.encrypt(b'\x00' * AES_BLOCK_LEN) +
+                   ecb.encrypt(b'\x00' * (AES_BLOCK_LEN - 1) + b'\x01'))
+      cipher_reference = bytes(a ^ b for a, b in zip(plain, keystream))
+
+      self.assertEqual(cipher_module, cipher_reference)
+
+class TestKeyLen(unittest.TestCase):
+
+  def testCtxKeyLenRandom(self):
+    # Every module supports all the key lengths with AESCtxInitKeyLen()
+    for BACKEND, AES_KEY_LEN in module:
+      for key_len in (16, 24, 32):
+        key = os.urandom(key_len)
+        num = random.randint(0, 20)
+        plain = os.urandom(AES_BLOCK_LEN * num)
+
+        pctx = ffi[BACKEND, AES_KEY_LEN].new('struct aes_ctx_t[1]')
+        pctx_ct = ffi[BACKEND, AES_KEY_LEN].new('struct aes_ctx_t[1]')
+        pinv_ctx = ffi[BACKEND, AES_KEY_LEN].new('struct aes_inv_ctx_t[1]')
+        self.assertEqual(module[BACKEND, AES_KEY_LEN].AESCtxInitKeyLen(
+            pctx, key, key_len), 1)
+        self.assertEqual(module[BACKEND, AES_KEY_LEN].AESCtxInitCtKeyLen(
+            pctx_ct, key, key_len), 1)
+        module[BACKEND, AES_KEY_LEN].AESInvCtxInit(pinv_ctx, pctx)
+
+        self.assertEqual(pctx[0].rounds, key_len // 4 + 6)
+        self.assertEqual(ffi[BACKEND, AES_KEY_LEN].buffer(pctx)[:],
+                         ffi[BACKEND, AES_KEY_LEN].buffer(pctx_ct)[:])
+
+        cipher_module = b'\x00' * len(plain)
+        module[BACKEND, AES_KEY_LEN].AESCtxECBEncrypt(
+            pctx, plain, len(plain), cipher_module)
+
+        cipher_ct_module = b'\x00' * len(plain)
+        module[BACKEND, AES_KEY_LEN].AESCtxECBEncryptCt(
+            pctx_ct, plain, len(plain), cipher_ct_module)
+
+        plain_module = b'\x00' * len(plain)
+        module[BACKEND, AES_KEY_LEN].AESInvCtxECBDecrypt(
+            pinv_ctx, cipher_module, len(plain), plain_module)
+
+        cipher_reference = AES.new(key, AES.MODE_ECB).encrypt(plain)
+
+        self.assertEqual(cipher_module, cipher_reference)
+        self.assertEqual(cipher_ct_module, cipher_reference)
+        self.assertEqual(plain_module, plain)
+
+        # Decryption with the encryption context
+        if num > 0:
+          plain_module = b'\x00' * AES_BLOCK_LEN
+          module[BACKEND, AES_KEY_LEN].AESCtxDecrypt(
+              pctx, cipher_module, plain_module)
+          self.assertEqual(plain_module, plain[:AES_BLOCK_LEN])
+
+  def testCtxKeyLenInvalid(self):
+    for BACKEND, AES_KEY_LEN in module:
+      for key_len in (0, 4, 15, 17, 20, 33, 64):
+        pctx = ffi[BACKEND, AES_KEY_LEN].new('struct aes_ctx_t[1]')
+        self.assertEqual(module[BACKEND, AES_KEY_LEN].AESCtxInitKeyLen(
+            pctx, b'\x00' * key_len, key_len), 0)
+        self.assertEqual(module[BACKEND, AES_KEY_LEN].AESCtxInitCtKeyLen(
+            pctx, b'\x00' * key_len, key_len), 0)
+
+def mmo_reference(key, data, iv=b'\x00' * AES_BLOCK_LEN):
+  # hash = E(key, hash ^ block) ^ block, padded with 0x80 and zeros
+  ecb = AES.new(key, AES.MODE_ECB)
+  data += b'\x80' + b'\x00' * (-(len(data) + 1) % AES_BLOCK_LEN)
+  h = iv
+  for i in range(0, len(data), AES_BLOCK_LEN):
+    block = data[i:i + AES_BLOCK_LEN]
+    h = bytes(x ^ y for x, y in zip(ecb.encrypt(
+        bytes(x ^ y for x, y in zip(h, block))), block))
+  return h
+
+def random_pieces(data):
+  # Split data in pieces of random length
+  pieces = []
+  pos = 0
+  while pos < len(data):
+    num = random.randint(1, 40)
+    pieces.append(data[pos:pos + num])
+    pos += num
+  return pieces
+
+def cbc_stream(BACKEND, AES_KEY_LEN, key, iv, data, padding, decrypt):
+  # Encrypts or decrypts with the CBC stream context, in random pieces
+  pcbc = ffi[BACKEND, AES_KEY_LEN].new('struct aes_cbc_t[1]')
+  module[BACKEND, AES_KEY_LEN].AESCbcInit(pcbc, key, len(key))
+  module[BACKEND, AES_KEY_LEN].AESCbcStart(pcbc, iv, padding)
+
+  update = module[BACKEND, AES_KEY_LEN].AESCbcEncrypt
+  finish = module[BACKEND, AES_KEY_LEN].AESCbcEncryptFinish
+  if decrypt:
+    update = module[BACKEND, AES_KEY_LEN].AESCbcDecrypt
+    finish = module[BACKEND, AES_KEY_LEN].AESCbcDecryptFinish
+
+  out = b''
+  for piece in random_pieces(data):
+    buf = ffi[BACKEND, AES_KEY_LEN].new('uint8_t[]', len(piece) + AES_BLOCK_LEN)
+    n = update(pcbc, piece, len(piece), buf)
+    out += bytes(buf)[:n]
+
+  buf = ffi[BACKEND, AES_KEY_LEN].new('uint8_t[]', AES_BLOCK_LEN)
+  plength = ffi[BACKEND, AES_KEY_LEN].new('uint8_t[1]')
+  valid = finish(pcbc, buf, plength)
+  out += bytes(buf)[:plength[0]]
+
+  return out, valid
+
+class TestCBCStream(unittest.TestCase):
+
+  def testCBCStreamRandom(self):
+    for BACKEND, AES_KEY_LEN in module:
+      for count in range(16):
+        padding = count % 2
+        key = os.urandom(AES_KEY_LEN)
+        iv = os.urandom(AES_BLOCK_LEN)
+        length = random.randint(0, 300)
+        if not padding:
+          length -= length % AES_BLOCK_LEN
+        plain = os.urandom(length)
+
+        iv_ecb = AES.new(key, AES.MODE_ECB).encrypt(iv)
+        if padding:
+          cipher_reference = AES.new(key, AES.MODE_CBC, iv_ecb).encrypt(
+              pad(plain, AES_BLOCK_LEN))
+        else:
+          cipher_reference = AES.new(key, AES.MODE_CBC, iv_ecb).encrypt(plain)
+
+        cipher_module, valid = cbc_stream(
+            BACKEND, AES_KEY_LEN, key, iv, plain, padding, 0)
+        self.assertEqual(valid, 1)
+        self.assertEqual(cipher_module, cipher_reference)
+
+        plain_module, valid = cbc_stream(
+            BACKEND, AES_KEY_LEN, key, iv, cipher_reference, padding, 1)
+        self.assertEqual(valid, 1)
+        self.assertEqual(plain_module, plain)
+
+  def testCBCStreamInvalid(self):
+    for BACKEND, AES_KEY_LEN in module:
+      key = os.urandom(AES_KEY_LEN)
+      iv = os.urandom(AES_BLOCK_LEN)
+      iv_ecb = AES.new(key, AES.MODE_ECB).encrypt(iv)
+
+      # Partial last block without padding
+      for decrypt in (0, 1):
+        out, valid = cbc_stream(
+            BACKEND, AES_KEY_LEN, key, iv, os.urandom(40), 0, decrypt)
+        self.assertEqual(valid, 0)
+
+      # Empty message or partial last block with padding
+      for length in (0, 20):
+        out, valid = cbc_stream(
+            BACKEND, AES_KEY_LEN, key, iv, os.urandom(length), 1, 1)
+        self.assertEqual(valid, 0)
+
+      # Bad padding bytes: 0, more than a block, different bytes
+      for last in (b'\x00' * 16, b'\x11' * 16, b'\x00' * 13 + b'\x01\x02\x03'):
+        cipher = AES.new(key, AES.MODE_CBC, iv_ecb).encrypt(
+            os.urandom(AES_BLOCK_LEN) + last)
+        out, valid = cbc_stream(BACKEND, AES_KEY_LEN, key, iv, cipher, 1, 1)
+        self.assertEqual(valid, 0)
+
+      # Full block of padding
+      cipher = AES.new(key, AES.MODE_CBC, iv_ecb).encrypt(b'\x10' * 16)
+      out, valid = cbc_stream(BACKEND, AES_KEY_LEN, key, iv, cipher, 1, 1)
+      self.assertEqual((out, valid), (b'', 1))
+
+  def testCBCPartialBlockIgnored(self):
+    # The one-shot functions ignore a partial last block
+    for BACKEND, AES_KEY_LEN in module:
+      key = os.urandom(AES_KEY_LEN)
+      iv = os.urandom(AES_BLOCK_LEN)
+      data = os.urandom(40)
+
+      cipher_module = ffi[BACKEND, AES_KEY_LEN].new('uint8_t[]', 40)
+      module[BACKEND, AES_KEY_LEN].AES_CBCEncrypt(
+          key, iv, data, len(data), cipher_module)
+      plain_module = ffi[BACKEND, AES_KEY_LEN].new('uint8_t[]', 40)
+      module[BACKEND, AES_KEY_LEN].AES_CBCDecrypt(
+          key, iv, data, len(data), plain_module)
+
+      iv_ecb = AES.new(key, AES.MODE_ECB).encrypt(iv)
+      self.assertEqual(
+          bytes(cipher_module),
+          AES.new(key, AES.MODE_CBC, iv_ecb).encrypt(data[:32]) + bytes(8))
+      self.assertEqual(
+          bytes(plain_module),
+          AES.new(key, AES.MODE_CBC, iv_ecb).decrypt(data[:32]) + bytes(8))
+
+class TestCMAC(unittest.TestCase):
+
+  def testCMACVector(self):
+    # RFC 4493 example 2
+    key = bytes.fromhex('2b7e151628aed2a6abf7158809cf4f3c')
+    data = bytes.fromhex('6bc1bee22e409f96e93d7e117393172a')
+    tag = bytes.fromhex('070a16b46b4d4144f79bdd9dd04a287c')
+    for BACKEND, AES_KEY_LEN in module:
+      pcmac = ffi[BACKEND, AES_KEY_LEN].new('struct aes_cmac_t[1]')
+      module[BACKEND, AES_KEY_LEN].AESCmacInit(pcmac, key, len(key))
+      module[BACKEND, AES_KEY_LEN].AESCmacUpdate(pcmac, data, len(data))
+      tag_module = ffi[BACKEND, AES_KEY_LEN].new('uint8_t[]', 16)
+      module[BACKEND, AES_KEY_LEN].AESCmacFinish(pcmac, tag_module)
+      self.assertEqual(bytes(tag_module), tag)
+
+  def testCMACRandom(self):
+    for BACKEND, AES_KEY_LEN in module:
+      key = os.urandom(AES_KEY_LEN)
+      pcmac = ffi[BACKEND, AES_KEY_LEN].new('struct aes_cmac_t[1]')
+      self.assertEqual(module[BACKEND, AES_KEY_LEN].AESCmacInit(
+          pcmac, key, len(key)), 1)
+
+      # The same context for several messages
+      for count in range(8):
+        data = os.urandom(random.choice((0, 16, 32, random.randint(0, 200))))
+
+        module[BACKEND, AES_KEY_LEN].AESCmacStart(pcmac)
+        for piece in random_pieces(data):
+          module[BACKEND, AES_KEY_LEN].AESCmacUpdate(pcmac, piece, len(piece))
+        tag_module = ffi[BACKEND, AES_KEY_LEN].new('uint8_t[]', 16)
+        module[BACKEND, AES_KEY_LEN].AESCmacFinish(pcmac, tag_module)
+
+        tag_reference = CMAC.new(key, data, ciphermod=AES).digest()
+        self.assertEqual(bytes(tag_module), tag_reference)
+
+        # Verify the right tag, a truncated one and a modified one
+        for tag, valid in ((tag_reference, 1), (tag_reference[:8], 1),
+                           (bytes([tag_reference[0] ^ 1]) +
+                            tag_reference[1:], 0)):
+          module[BACKEND, AES_KEY_LEN].AESCmacStart(pcmac)
+          module[BACKEND, AES_KEY_LEN].AESCmacUpdate(pcmac, data, len(data))
+          self.assertEqual(module[BACKEND, AES_KEY_LEN].AESCmacVerify(
+              pcmac, tag, len(tag)), valid)
+
+  def testCMACShortTag(self):
+    # Correct tags shorter than AES_CMAC_MIN_TAG_LEN (8) are never accepted
+    for BACKEND, AES_KEY_LEN in module:
+      key = os.urandom(AES_KEY_LEN)
+      data = os.urandom(random.randint(0, 100))
+      tag = CMAC.new(key, data, ciphermod=AES).digest()
+      pcmac = ffi[BACKEND, AES_KEY_LEN].new('struct aes_cmac_t[1]')
+      module[BACKEND, AES_KEY_LEN].AESCmacInit(pcmac, key, len(key))
+
+      for tag_len in range(17):
+        module[BACKEND, AES_KEY_LEN].AESCmacStart(pcmac)
+        module[BACKEND, AES_KEY_LEN].AESCmacUpdate(pcmac, data, len(data))
+        self.assertEqual(module[BACKEND, AES_KEY_LEN].AESCmacVerify(
+            pcmac, tag[:tag_len], tag_len), int(tag_len >= 8))
+
+  def testCMACInvalidKeyLength(self):
+    for BACKEND, AES_KEY_LEN in module:
+      pcmac = ffi[BACKEND, AES_KEY_LEN].new('struct aes_cmac_t[1]')
+      self.assertEqual(module[BACKEND, AES_KEY_LEN].AESCmacInit(
+          pcmac, b'\x00' * 20, 20), 0)
+
+class TestMMO(unittest.TestCase):
+
+  def testMMORandom(self):
+    for BACKEND, AES_KEY_LEN in module:
+      key = os.urandom(AES_KEY_LEN)
+      pmmo = ffi[BACKEND, AES_KEY_LEN].new('struct aes_mmo_t[1]')
+      self.assertEqual(module[BACKEND, AES_KEY_LEN].AESMmoInit(
+          pmmo, key, len(key)), 1)
+
+      for count in range(8):
+        data = os.urandom(random.choice((0, 15, 16, random.randint(0, 200))))
+        iv = os.urandom(AES_BLOCK_LEN)
+
+        if count % 2 == 0:
+          module[BACKEND, AES_KEY_LEN].AESMmoStart(pmmo)
+          hash_reference = mmo_reference(key, data)
+        else:
+          module[BACKEND, AES_KEY_LEN].AESMmoStartIv(pmmo, iv)
+          hash_reference = mmo_reference(key, data, iv)
+
+        for piece in random_pieces(data):
+          module[BACKEND, AES_KEY_LEN].AESMmoUpdate(pmmo, piece, len(piece))
+        module[BACKEND, AES_KEY_LEN].AESMmoFinish(pmmo)
+
+        self.assertEqual(bytes(pmmo[0].hash), hash_reference)
+
+class TestAESNi(unittest.TestCase):
+
+  def testAESNiBackends(self):
+    # The default modules must use AES-NI when the CPU supports it, and the
+    # portable modules must never use it
+    for AES_KEY_LEN in (16, 24, 32):
+      self.assertFalse(hasattr(module['ttable', AES_KEY_LEN],
+                               'AESNiSupported'))
+      self.assertFalse(hasattr(module['compact', AES_KEY_LEN],
+                               'AESNiSupported'))
+      self.assertIn(module['default', AES_KEY_LEN].AESNiSupported(), (0, 1))
+
 if __name__ == '__main__':
   unittest.main()
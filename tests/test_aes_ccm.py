@@ -0,0 +1,321 @@
+#!/usr/bin/python3
+
+# Copyright 2021 Djones A. Boni
+#
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+# http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+
+from unit_test_c_with_python.load_c import load
+
+import unittest
+import os
+import random
+
+from Crypto.Cipher import AES
+
+# Dicrionaries to hold modules and ffis
+module, ffi = {}, {}
+
+# Backends to test. The default one uses AES-NI if the CPU supports it.
+BACKENDS = {
+  'default': [],
+  'compact': ['-DAES_AESNI=0', '-DAES_FASTER=0'],
+}
+
+# Key lengths are chosen at run-time, one module per backend
+AES_KEY_LENS = (16, 24, 32)
+
+# Compile one module for each backend
+for BACKEND in BACKENDS:
+
+  # Every module have its own name
+  module_name = 'aes_ccm_%s_' % BACKEND
+
+  source_files = [
+    '../source/aes.c',
+    '../source/aes_ccm.c',
+  ]
+
+  include_paths = [
+    '../include',
+  ]
+
+  compiler_options = [
+    '-std=c90',
+    '-pedantic',
+  ] + BACKENDS[BACKEND]
+
+  module[BACKEND], ffi[BACKEND] = load(
+      source_files, include_paths, compiler_options,
+      module_name=module_name)
+
+def random_pieces(data):
+  # Split data in pieces of random length
+  pieces = []
+  pos = 0
+  while pos < len(data):
+    num = random.randint(1, 40)
+    pieces.append(data[pos:pos + num])
+    pos += num
+  return pieces
+
+def ccm_encrypt(BACKEND, key, nonce, aad, plain, tag_len):
+  pccm = ffi[BACKEND].new('struct aes_ccm_t[1]')
+  module[BACKEND].AESCcmInit(pccm, key, len(key))
+  assert module[BACKEND].AESCcmStart(
+      pccm, nonce, len(nonce), len(aad), len(plain), tag_len) == 1
+
+  for piece in random_pieces(aad):
+    module[BACKEND].AESCcmAad(pccm, piece, len(piece))
+
+  cipher = b''
+  for piece in random_pieces(plain):
+    out = ffi[BACKEND].new('uint8_t[]', len(piece))
+    module[BACKEND].AESCcmEncrypt(pccm, piece, len(piece), out)
+    cipher += bytes(out)
+
+  tag = ffi[BACKEND].new('uint8_t[]', tag_len)
+  valid = module[BACKEND].AESCcmFinish(pccm, tag)
+
+  return cipher, bytes(tag), valid
+
+def ccm_decrypt(BACKEND, key, nonce, aad, cipher, tag,
+                aad_len=None, data_len=None):
+  if aad_len is None:
+    aad_len = len(aad)
+  if data_len is None:
+    data_len = len(cipher)
+
+  pccm = ffi[BACKEND].new('struct aes_ccm_t[1]')
+  module[BACKEND].AESCcmInit(pccm, key, len(key))
+  module[BACKEND].AESCcmStart(
+      pccm, nonce, len(nonce), aad_len, data_len, len(tag))
+
+  for piece in random_pieces(aad):
+    module[BACKEND].AESCcmAad(pccm, piece, len(piece))
+
+  plain = b''
+  for piece in random_pieces(cipher):
+    out = ffi[BACKEND].new('uint8_t[]', len(piece))
+    module[BACKEND].AESCcmDecrypt(pccm, piece, len(piece), out)
+    plain += bytes(out)
+
+  valid = module[BACKEND].AESCcmVerify(pccm, tag)
+
+  return plain, valid
+
+class TestCCM(unittest.TestCase):
+
+  def testVector(self):
+    # RFC 3610 packet vector #1
+    key = bytes.fromhex('c0c1c2c3c4c5c6c7c8c9cacbcccdcecf')
+    nonce = bytes.fromhex('00000003020100a0a1a2a3a4a5')
+    aad = bytes.fromhex('0001020304050607')
+    plain = bytes.fromhex('08090a0b0c0d0e0f101112131415161718191a1b1c1d1e')
+    cipher = bytes.fromhex('588c979a61c663d2f066d0c2c0f989806d5f6b61dac384')
+    tag = bytes.fromhex('17e8d12cfdf926e0')
+
+    for BACKEND in module:
+      self.assertEqual(ccm_encrypt(BACKEND, key, nonce, aad, plain, 8),
+                       (cipher, tag, 1))
+
+  def testEncryptRandom(self):
+    for BACKEND in module:
+      for AES_KEY_LEN in AES_KEY_LENS:
+        for count in range(32):
+          key = os.urandom(AES_KEY_LEN)
+          nonce = os.urandom(random.randint(7, 13))
+          tag_len = random.choice((4, 6, 8, 10, 12, 14, 16))
+          aad = os.urandom(random.choice((0, 14, random.randint(0, 100))))
+          plain = os.urandom(random.choice((0, 16, random.randint(0, 300))))
+
+          cipher_module, tag_module, valid = ccm_encrypt(
+              BACKEND, key, nonce, aad, plain, tag_len)
+
+          ccm = AES.new(key, AES.MODE_CCM, nonce=nonce, mac_len=tag_len)
+          ccm.update(aad)
+          cipher_reference, tag_reference = ccm.encrypt_and_digest(plain)
+
+          self.assertEqual(valid, 1)
+          self.assertEqual(cipher_module, cipher_reference)
+          self.assertEqual(tag_module, tag_reference)
+
+  def testDecryptRandom(self):
+    for BACKEND in module:
+      for AES_KEY_LEN in AES_KEY_LENS:
+        for count in range(32):
+          key = os.urandom(AES_KEY_LEN)
+          nonce = os.urandom(random.randint(7, 13))
+          tag_len = random.choice((4, 6, 8, 10, 12, 14, 16))
+          aad = os.urandom(random.randint(0, 100))
+          plain = os.urandom(random.randint(0, 300))
+
+          ccm = AES.new(key, AES.MODE_CCM, nonce=nonce, mac_len=tag_len)
+          ccm.update(aad)
+          cipher, tag = ccm.encrypt_and_digest(plain)
+
+          plain_module, valid = ccm_decrypt(
+              BACKEND, key, nonce, aad, cipher, tag)
+
+          self.assertEqual(plain_module, plain)
+          self.assertEqual(valid, 1)
+
+  def testLongAad(self):
+    # Associated data of 2^16 - 2^8 bytes or more has a 6-byte length
+    for BACKEND in module:
+      key = os.urandom(16)
+      nonce = os.urandom(12)
+      aad = os.urandom(0xFF00 + random.randint(0, 100))
+      plain = os.urandom(50)
+
+      pccm = ffi[BACKEND].new('struct aes_ccm_t[1]')
+      module[BACKEND].AESCcmInit(pccm, key, len(key))
+      module[BACKEND].AESCcmStart(pccm, nonce, len(nonce), len(aad),
+                                  len(plain), 16)
+      module[BACKEND].AESCcmAad(pccm, aad, len(aad))
+      cipher_module = ffi[BACKEND].new('uint8_t[]', len(plain))
+      module[BACKEND].AESCcmEncrypt(pccm, plain, len(plain), cipher_module)
+      tag_module = ffi[BACKEND].new('uint8_t[]', 16)
+      module[BACKEND].AESCcmFinish(pccm, tag_module)
+
+      ccm = AES.new(key, AES.MODE_CCM, nonce=nonce)
+      ccm.update(aad)
+      cipher_reference, tag_reference = ccm.encrypt_and_digest(plain)
+
+      self.assertEqual(bytes(cipher_module), cipher_reference)
+      self.assertEqual(bytes(tag_module), tag_reference)
+
+  def testVerifyModified(self):
+    for BACKEND in module:
+      key = os.urandom(16)
+      nonce = os.urandom(13)
+      aad = os.urandom(20)
+      plain = os.urandom(100)
+
+      ccm = AES.new(key, AES.MODE_CCM, nonce=nonce, mac_len=8)
+      ccm.update(aad)
+      cipher, tag = ccm.encrypt_and_digest(plain)
+
+      pos = random.randrange(len(tag))
+      bad_tag = tag[:pos] + bytes([tag[pos] ^ 0x01]) + tag[pos + 1:]
+      pos = random.randrange(len(cipher))
+      bad_cipher = cipher[:pos] + bytes([cipher[pos] ^ 0x80]) + cipher[pos + 1:]
+
+      self.assertEqual(ccm_decrypt(
+          BACKEND, key, nonce, aad, cipher, bad_tag)[1], 0)
+      self.assertEqual(ccm_decrypt(
+          BACKEND, key, nonce, aad, bad_cipher, tag)[1], 0)
+
+      # Lengths different from the ones given at the start
+      self.assertEqual(ccm_decrypt(
+          BACKEND, key, nonce, aad, cipher, tag, data_len=len(cipher) + 1)[1],
+          0)
+      self.assertEqual(ccm_decrypt(
+          BACKEND, key, nonce, aad, cipher, tag, aad_len=len(aad) - 1)[1], 0)
+
+  def testTooMuchAad(self):
+    # Associated data beyond the length given at the start is rejected
+    for BACKEND in module:
+      key = os.urandom(16)
+      nonce = os.urandom(13)
+      aad = os.urandom(30)
+      plain = os.urandom(40)
+
+      pccm = ffi[BACKEND].new('struct aes_ccm_t[1]')
+      module[BACKEND].AESCcmInit(pccm, key, len(key))
+      module[BACKEND].AESCcmStart(pccm, nonce, len(nonce), 20, len(plain), 8)
+      self.assertEqual(module[BACKEND].AESCcmAad(pccm, aad, 21), 0)
+      self.assertEqual(module[BACKEND].AESCcmAad(pccm, aad, 15), 1)
+      self.assertEqual(module[BACKEND].AESCcmAad(pccm, aad[15:], 6), 0)
+      self.assertEqual(module[BACKEND].AESCcmAad(pccm, aad[15:], 5), 1)
+      self.assertEqual(module[BACKEND].AESCcmAad(pccm, aad[20:], 1), 0)
+
+      cipher_module = ffi[BACKEND].new('uint8_t[]', len(plain))
+      module[BACKEND].AESCcmEncrypt(pccm, plain, len(plain), cipher_module)
+      tag_module = ffi[BACKEND].new('uint8_t[]', 8)
+      self.assertEqual(module[BACKEND].AESCcmFinish(pccm, tag_module), 1)
+
+      ccm = AES.new(key, AES.MODE_CCM, nonce=nonce, mac_len=8)
+      ccm.update(aad[:20])
+      cipher_reference, tag_reference = ccm.encrypt_and_digest(plain)
+
+      self.assertEqual(bytes(cipher_module), cipher_reference)
+      self.assertEqual(bytes(tag_module), tag_reference)
+
+  def testAadAfterData(self):
+    # Associated data is rejected once the data has started
+    for BACKEND in module:
+      key = os.urandom(16)
+      nonce = os.urandom(13)
+      aad = os.urandom(20)
+      plain = os.urandom(40)
+
+      for aad_len in (10, 20):
+        pccm = ffi[BACKEND].new('struct aes_ccm_t[1]')
+        module[BACKEND].AESCcmInit(pccm, key, len(key))
+        module[BACKEND].AESCcmStart(pccm, nonce, len(nonce), aad_len,
+                                    len(plain), 8)
+        self.assertEqual(module[BACKEND].AESCcmAad(pccm, aad, 10), 1)
+        cipher_module = ffi[BACKEND].new('uint8_t[]', len(plain))
+        self.assertEqual(module[BACKEND].AESCcmEncrypt(
+            pccm, plain, 5, cipher_module), 1)
+        self.assertEqual(module[BACKEND].AESCcmAad(pccm, aad[10:], 10), 0)
+        self.assertEqual(module[BACKEND].AESCcmAad(pccm, aad[10:], 0), 0)
+        self.assertEqual(module[BACKEND].AESCcmEncrypt(
+            pccm, plain[5:], len(plain) - 5, cipher_module + 5), 1)
+
+        # Valid only if all the associated data came before the data
+        tag_module = ffi[BACKEND].new('uint8_t[]', 8)
+        self.assertEqual(module[BACKEND].AESCcmFinish(pccm, tag_module),
+                         int(aad_len == 10))
+
+  def testTooMuchData(self):
+    # Data beyond the length given at the start is rejected without output,
+    # the counter never reaches the block of the tag (A0)
+    for BACKEND in module:
+      for function in ('AESCcmEncrypt', 'AESCcmDecrypt'):
+        key = os.urandom(16)
+        nonce = os.urandom(13)
+        data = os.urandom(0x10000 * 16 + 100)
+        data_len = 50
+
+        pccm = ffi[BACKEND].new('struct aes_ccm_t[1]')
+        module[BACKEND].AESCcmInit(pccm, key, len(key))
+        module[BACKEND].AESCcmStart(pccm, nonce, len(nonce), 0, data_len, 8)
+        out = ffi[BACKEND].new('uint8_t[]', len(data))
+        encrypt = getattr(module[BACKEND], function)
+
+        self.assertEqual(encrypt(pccm, data, len(data), out), 0)
+        self.assertEqual(encrypt(pccm, data, data_len + 1, out), 0)
+        self.assertEqual(bytes(out), bytes(len(data)))
+        self.assertEqual(encrypt(pccm, data, 30, out), 1)
+        self.assertEqual(encrypt(pccm, data[30:], 21, out + 30), 0)
+        self.assertEqual(encrypt(pccm, data[30:], 20, out + 30), 1)
+        self.assertEqual(encrypt(pccm, data[50:], 1, out + 50), 0)
+        self.assertEqual(bytes(out)[data_len:], bytes(len(data) - data_len))
+
+  def testInvalidParameters(self):
+    for BACKEND in module:
+      pccm = ffi[BACKEND].new('struct aes_ccm_t[1]')
+      self.assertEqual(module[BACKEND].AESCcmInit(pccm, b'\x00' * 20, 20), 0)
+      self.assertEqual(module[BACKEND].AESCcmInit(pccm, b'\x00' * 16, 16), 1)
+
+      nonce = bytes(13)
+      for nonce_len, tag_len in ((6, 8), (14, 8), (13, 2), (13, 5), (13, 18)):
+        self.assertEqual(module[BACKEND].AESCcmStart(
+            pccm, nonce, nonce_len, 0, 0, tag_len), 0)
+
+      # A 13-byte nonce leaves 2 bytes for the data length
+      self.assertEqual(module[BACKEND].AESCcmStart(
+          pccm, nonce, 13, 0, 0xFFFF, 8), 1)
+      self.assertEqual(module[BACKEND].AESCcmStart(
+          pccm, nonce, 13, 0, 0x10000, 8), 0)
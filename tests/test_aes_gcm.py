@@ -0,0 +1,273 @@
+#!/usr/bin/python3
+
+# Copyright 2021 Djones A. Boni
+#
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+# http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+
+from unit_test_c_with_python.load_c import load
+
+import unittest
+import os
+import random
+
+from Crypto.Cipher import AES
+
+AES_GCM_TAG_LEN = 16
+AES_GCM_IV_LEN = 12
+
+# Dicrionaries to hold modules and ffis
+module, ffi = {}, {}
+
+# Backends to test. The default one uses PCLMULQDQ if the CPU supports it.
+BACKENDS = {
+  'default': [],
+  'portable': ['-DAES_AESNI=0', '-DAES_GCM_PCLMUL=0'],
+  'short_tags': ['-DAES_GCM_MIN_TAG_LEN=4'],
+  'tags8': ['-DAES_GCM_MIN_TAG_LEN=8'],
+}
+
+# Shortest tag accepted by each backend
+MIN_TAG_LEN = {
+  'default': 12,
+  'portable': 12,
+  'short_tags': 4,
+  'tags8': 8,
+}
+
+# Tag lengths of NIST SP 800-38D
+TAG_LENS = (4, 8, 12, 13, 14, 15, 16)
+
+# Key lengths are chosen at run-time, one module per backend
+AES_KEY_LENS = (16, 24, 32)
+
+# Compile one module for each backend
+for BACKEND in BACKENDS:
+
+  # Every module have its own name
+  module_name = 'aes_gcm_%s_' % BACKEND
+
+  source_files = [
+    '../source/aes.c',
+    '../source/aes_gcm.c',
+  ]
+
+  include_paths = [
+    '../include',
+  ]
+
+  compiler_options = [
+    '-std=c90',
+    '-pedantic',
+  ] + BACKENDS[BACKEND]
+
+  module[BACKEND], ffi[BACKEND] = load(
+      source_files, include_paths, compiler_options,
+      module_name=module_name)
+
+def random_pieces(data):
+  # Split data in pieces of random length
+  pieces = []
+  pos = 0
+  while pos < len(data):
+    num = random.randint(1, 100)
+    pieces.append(data[pos:pos + num])
+    pos += num
+  return pieces
+
+def gcm_encrypt(BACKEND, key, iv, aad, plain):
+  pgcm = ffi[BACKEND].new('struct aes_gcm_t[1]')
+  module[BACKEND].AESGcmInit(pgcm, key, len(key))
+  module[BACKEND].AESGcmStart(pgcm, iv, len(iv))
+
+  for piece in random_pieces(aad):
+    module[BACKEND].AESGcmAad(pgcm, piece, len(piece))
+
+  cipher = b''
+  for piece in random_pieces(plain):
+    out = ffi[BACKEND].new('uint8_t[]', len(piece))
+    module[BACKEND].AESGcmEncrypt(pgcm, piece, len(piece), out)
+    cipher += bytes(out)
+
+  tag = ffi[BACKEND].new('uint8_t[]', AES_GCM_TAG_LEN)
+  module[BACKEND].AESGcmFinish(pgcm, tag)
+
+  return cipher, bytes(tag)
+
+def gcm_decrypt(BACKEND, key, iv, aad, cipher, tag):
+  pgcm = ffi[BACKEND].new('struct aes_gcm_t[1]')
+  module[BACKEND].AESGcmInit(pgcm, key, len(key))
+  module[BACKEND].AESGcmStart(pgcm, iv, len(iv))
+
+  for piece in random_pieces(aad):
+    module[BACKEND].AESGcmAad(pgcm, piece, len(piece))
+
+  plain = b''
+  for piece in random_pieces(cipher):
+    out = ffi[BACKEND].new('uint8_t[]', len(piece))
+    module[BACKEND].AESGcmDecrypt(pgcm, piece, len(piece), out)
+    plain += bytes(out)
+
+  valid = module[BACKEND].AESGcmVerify(pgcm, tag, len(tag))
+
+  return plain, valid
+
+class TestGCM(unittest.TestCase):
+
+  def testEncryptRandom(self):
+    for BACKEND in module:
+      for AES_KEY_LEN in AES_KEY_LENS:
+        for count in range(32):
+          key = os.urandom(AES_KEY_LEN)
+          iv = os.urandom(random.choice((AES_GCM_IV_LEN, 1, 8, 16, 60)))
+          aad = os.urandom(random.randint(0, 100))
+          plain = os.urandom(random.randint(0, 600))
+
+          cipher_module, tag_module = gcm_encrypt(
+              BACKEND, key, iv, aad, plain)
+
+          gcm = AES.new(key, AES.MODE_GCM, nonce=iv)
+          gcm.update(aad)
+          cipher_reference, tag_reference = gcm.encrypt_and_digest(plain)
+
+          self.assertEqual(cipher_module, cipher_reference)
+          self.assertEqual(tag_module, tag_reference)
+
+  def testDecryptRandom(self):
+    for BACKEND in module:
+      for AES_KEY_LEN in AES_KEY_LENS:
+        for count in range(32):
+          key = os.urandom(AES_KEY_LEN)
+          iv = os.urandom(random.choice((AES_GCM_IV_LEN, 1, 8, 16, 60)))
+          aad = os.urandom(random.randint(0, 100))
+          plain = os.urandom(random.randint(0, 600))
+
+          gcm = AES.new(key, AES.MODE_GCM, nonce=iv)
+          gcm.update(aad)
+          cipher, tag = gcm.encrypt_and_digest(plain)
+
+          plain_module, valid = gcm_decrypt(
+              BACKEND, key, iv, aad, cipher, tag)
+
+          self.assertEqual(plain_module, plain)
+          self.assertEqual(valid, 1)
+
+  def testVerifyTruncatedTag(self):
+    for BACKEND in module:
+      for AES_KEY_LEN in AES_KEY_LENS:
+        key = os.urandom(AES_KEY_LEN)
+        iv = os.urandom(AES_GCM_IV_LEN)
+        aad = os.urandom(20)
+        plain = os.urandom(100)
+
+        gcm = AES.new(key, AES.MODE_GCM, nonce=iv)
+        gcm.update(aad)
+        cipher, tag = gcm.encrypt_and_digest(plain)
+
+        for tag_len in TAG_LENS:
+          plain_module, valid = gcm_decrypt(
+              BACKEND, key, iv, aad, cipher, tag[:tag_len])
+          self.assertEqual(valid, int(tag_len >= MIN_TAG_LEN[BACKEND]))
+
+  def testVerifyInvalidTagLength(self):
+    # Correct tags of lengths not in SP 800-38D are never accepted
+    for BACKEND in module:
+      key = os.urandom(16)
+      iv = os.urandom(AES_GCM_IV_LEN)
+      plain = os.urandom(50)
+
+      gcm = AES.new(key, AES.MODE_GCM, nonce=iv)
+      cipher, tag = gcm.encrypt_and_digest(plain)
+
+      for tag_len in (0, 1, 2, 3, 5, 6, 7, 9, 10, 11):
+        plain_module, valid = gcm_decrypt(
+            BACKEND, key, iv, b'', cipher, tag[:tag_len])
+        self.assertEqual(valid, 0)
+
+  def testVerifyModified(self):
+    for BACKEND in module:
+      for AES_KEY_LEN in AES_KEY_LENS:
+        key = os.urandom(AES_KEY_LEN)
+        iv = os.urandom(AES_GCM_IV_LEN)
+        aad = os.urandom(20)
+        plain = os.urandom(100)
+
+        gcm = AES.new(key, AES.MODE_GCM, nonce=iv)
+        gcm.update(aad)
+        cipher, tag = gcm.encrypt_and_digest(plain)
+
+        # Flip one bit of the tag, the cipher-text or the associated data
+        pos = random.randrange(len(tag))
+        bad_tag = tag[:pos] + bytes([tag[pos] ^ 0x01]) + tag[pos + 1:]
+        pos = random.randrange(len(cipher))
+        bad_cipher = (cipher[:pos] + bytes([cipher[pos] ^ 0x80]) +
+                      cipher[pos + 1:])
+        pos = random.randrange(len(aad))
+        bad_aad = aad[:pos] + bytes([aad[pos] ^ 0x10]) + aad[pos + 1:]
+
+        plain_module, valid = gcm_decrypt(
+            BACKEND, key, iv, aad, cipher, bad_tag)
+        self.assertEqual(valid, 0)
+
+        plain_module, valid = gcm_decrypt(
+            BACKEND, key, iv, aad, bad_cipher, tag)
+        self.assertEqual(valid, 0)
+
+        plain_module, valid = gcm_decrypt(
+            BACKEND, key, iv, bad_aad, cipher, tag)
+        self.assertEqual(valid, 0)
+
+  def testRestart(self):
+    # The same context for several messages, without the key setup again
+    for BACKEND in module:
+      for AES_KEY_LEN in AES_KEY_LENS:
+        key = os.urandom(AES_KEY_LEN)
+        pgcm = ffi[BACKEND].new('struct aes_gcm_t[1]')
+        module[BACKEND].AESGcmInit(pgcm, key, len(key))
+
+        for count in range(8):
+          iv = os.urandom(AES_GCM_IV_LEN)
+          plain = os.urandom(random.randint(0, 300))
+
+          module[BACKEND].AESGcmStart(pgcm, iv, len(iv))
+          cipher_module = ffi[BACKEND].new('uint8_t[]', len(plain))
+          module[BACKEND].AESGcmEncrypt(
+              pgcm, plain, len(plain), cipher_module)
+          tag_module = ffi[BACKEND].new('uint8_t[]', AES_GCM_TAG_LEN)
+          module[BACKEND].AESGcmFinish(pgcm, tag_module)
+
+          gcm = AES.new(key, AES.MODE_GCM, nonce=iv)
+          cipher_reference, tag_reference = gcm.encrypt_and_digest(plain)
+
+          self.assertEqual(bytes(cipher_module), cipher_reference)
+          self.assertEqual(bytes(tag_module), tag_reference)
+
+  def testInvalidKeyLength(self):
+    for BACKEND in module:
+      for key_len in (0, 8, 20, 33, 64):
+        pgcm = ffi[BACKEND].new('struct aes_gcm_t[1]')
+        self.assertEqual(module[BACKEND].AESGcmInit(
+            pgcm, b'\x00' * key_len, key_len), 0)
+
+  def testEmptyIV(self):
+    # SP 800-38D requires an IV of at least one byte
+    for BACKEND in module:
+      key = os.urandom(16)
+      pgcm = ffi[BACKEND].new('struct aes_gcm_t[1]')
+      module[BACKEND].AESGcmInit(pgcm, key, len(key))
+      self.assertEqual(module[BACKEND].AESGcmStart(pgcm, b'', 0), 0)
+      for iv_len in (1, AES_GCM_IV_LEN, 60):
+        iv = os.urandom(iv_len)
+        self.assertEqual(module[BACKEND].AESGcmStart(pgcm, iv, iv_len), 1)
+
+  def testPclmulBackend(self):
+    self.assertFalse(hasattr(module['portable'], 'AESGcmPclmulSupported'))
@@ -0,0 +1,165 @@
+#!/usr/bin/python3
+
+# Copyright 2021 Djones A. Boni
+#
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+# http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+
+from unit_test_c_with_python.load_c import load
+
+import unittest
+import os
+import random
+
+from Crypto.Cipher import AES
+
+AES_BLOCK_LEN = 16
+AES_MB_LANES = 8
+AES_KEY_LENS = (16, 24, 32)
+
+# Dicrionaries to hold modules and ffis
+module, ffi = {}, {}
+
+# Backends to test. The default one uses AES-NI if the CPU supports it.
+BACKENDS = {
+  'default': [],
+  'portable': ['-DAES_AESNI=0'],
+}
+
+# Compile one module for each backend
+for BACKEND in BACKENDS:
+
+  # Every module have its own name
+  module_name = 'aes_mb_%s_' % BACKEND
+
+  source_files = [
+    '../source/aes.c',
+    '../source/aes_mb.c',
+  ]
+
+  include_paths = [
+    '../include',
+  ]
+
+  compiler_options = [
+    '-std=c90',
+    '-pedantic',
+  ] + BACKENDS[BACKEND]
+
+  module[BACKEND], ffi[BACKEND] = load(
+      source_files, include_paths, compiler_options,
+      module_name=module_name)
+
+class Job:
+  # One message with its own key, and the C buffers of its job
+
+  def __init__(self, BACKEND, key_len, length):
+    self.key = os.urandom(key_len)
+    self.iv = os.urandom(AES_BLOCK_LEN)
+    self.plain = os.urandom(length)
+
+    self.pctx = ffi[BACKEND].new('struct aes_ctx_t[1]')
+    assert module[BACKEND].AESCtxInitKeyLen(self.pctx, self.key, key_len) == 1
+    self.pplain = ffi[BACKEND].new('uint8_t[%d]' % length, self.plain)
+    self.pcipher = ffi[BACKEND].new('uint8_t[]', max(length, 1))
+
+    self.pjob = ffi[BACKEND].new('struct aes_mb_job_t[1]')
+    self.pjob[0].ctx_ptr = self.pctx
+    self.pjob[0].plain_ptr = self.pplain
+    self.pjob[0].cipher_ptr = self.pcipher
+    self.pjob[0].length = length
+    module[BACKEND].AESCtxEncrypt(self.pctx, self.iv, self.pjob[0].chain)
+
+  def reference(self):
+    # CBC with Ek(iv) as the first chaining value
+    iv_ecb = AES.new(self.key, AES.MODE_ECB).encrypt(self.iv)
+    return AES.new(self.key, AES.MODE_CBC, iv=iv_ecb).encrypt(self.plain)
+
+def run_jobs(BACKEND, jobs):
+  # Submits all the jobs, then flushes, returning the jobs in completion order
+  pmb = ffi[BACKEND].new('struct aes_mb_t[1]')
+  module[BACKEND].AESMbInit(pmb)
+
+  done = []
+  for job in jobs:
+    pjob = module[BACKEND].AESMbSubmit(pmb, job.pjob)
+    if pjob != ffi[BACKEND].NULL:
+      done.append(pjob)
+  while True:
+    pjob = module[BACKEND].AESMbFlush(pmb)
+    if pjob == ffi[BACKEND].NULL:
+      break
+    done.append(pjob)
+  return done
+
+class TestMultiBuffer(unittest.TestCase):
+
+  def testRandom(self):
+    for BACKEND in module:
+      for count in range(8):
+        jobs = [Job(BACKEND, random.choice(AES_KEY_LENS),
+                    AES_BLOCK_LEN * random.randint(0, 40))
+                for i in range(random.randint(1, 3 * AES_MB_LANES))]
+
+        done = run_jobs(BACKEND, jobs)
+        self.assertEqual(sorted(done), sorted(job.pjob for job in jobs))
+
+        for job in jobs:
+          length = len(job.plain)
+          cipher = job.reference()
+          self.assertEqual(bytes(job.pcipher)[:length], cipher)
+          if length > 0:
+            self.assertEqual(bytes(job.pjob[0].chain), cipher[-AES_BLOCK_LEN:])
+
+  def testSameKeyLength(self):
+    for BACKEND in module:
+      for key_len in AES_KEY_LENS:
+        jobs = [Job(BACKEND, key_len, AES_BLOCK_LEN * random.randint(1, 40))
+                for i in range(2 * AES_MB_LANES)]
+
+        done = run_jobs(BACKEND, jobs)
+        self.assertEqual(len(done), len(jobs))
+
+        for job in jobs:
+          self.assertEqual(bytes(job.pcipher), job.reference())
+
+  def testCompletionOrder(self):
+    # With all the lanes used the shortest job is returned first
+    for BACKEND in module:
+      lengths = [AES_BLOCK_LEN * (AES_MB_LANES - i)
+                 for i in range(AES_MB_LANES)]
+      jobs = [Job(BACKEND, 16, length) for length in lengths]
+
+      pmb = ffi[BACKEND].new('struct aes_mb_t[1]')
+      module[BACKEND].AESMbInit(pmb)
+      for job in jobs[:-1]:
+        self.assertEqual(module[BACKEND].AESMbSubmit(pmb, job.pjob),
+                         ffi[BACKEND].NULL)
+      self.assertEqual(module[BACKEND].AESMbSubmit(pmb, jobs[-1].pjob),
+                       jobs[-1].pjob)
+
+      for job in reversed(jobs[:-1]):
+        self.assertEqual(module[BACKEND].AESMbFlush(pmb), job.pjob)
+      self.assertEqual(module[BACKEND].AESMbFlush(pmb), ffi[BACKEND].NULL)
+
+      for job in jobs:
+        self.assertEqual(bytes(job.pcipher), job.reference())
+
+  def testInPlace(self):
+    for BACKEND in module:
+      jobs = [Job(BACKEND, 16, AES_BLOCK_LEN * 5) for i in range(3)]
+      for job in jobs:
+        job.pjob[0].cipher_ptr = job.pplain
+
+      run_jobs(BACKEND, jobs)
+      for job in jobs:
+        self.assertEqual(bytes(job.pplain), job.reference())
@@ -0,0 +1,211 @@
+#!/usr/bin/python3
+
+# Copyright 2021 Djones A. Boni
+#
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+# http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+
+from unit_test_c_with_python.load_c import load
+
+import unittest
+import os
+import random
+
+from Crypto.Cipher import AES
+
+AES_BLOCK_LEN = 16
+
+# Dicrionaries to hold modules and ffis
+module, ffi = {}, {}
+
+# Backends to test. The default one uses AES-NI if the CPU supports it.
+BACKENDS = {
+  'default': [],
+  'compact': ['-DAES_AESNI=0', '-DAES_FASTER=0'],
+}
+
+# Key lengths are chosen at run-time, one module per backend
+AES_KEY_LENS = (16, 24, 32)
+
+# Compile one module for each backend
+for BACKEND in BACKENDS:
+
+  # Every module have its own name
+  module_name = 'aes_ocb_%s_' % BACKEND
+
+  source_files = [
+    '../source/aes.c',
+    '../source/aes_ocb.c',
+  ]
+
+  include_paths = [
+    '../include',
+  ]
+
+  compiler_options = [
+    '-std=c90',
+    '-pedantic',
+  ] + BACKENDS[BACKEND]
+
+  module[BACKEND], ffi[BACKEND] = load(
+      source_files, include_paths, compiler_options,
+      module_name=module_name)
+
+def random_pieces(data):
+  # Split data in pieces of random length
+  pieces = []
+  pos = 0
+  while pos < len(data):
+    num = random.randint(1, 150)
+    pieces.append(data[pos:pos + num])
+    pos += num
+  return pieces
+
+def ocb_init(BACKEND, key):
+  pocb = ffi[BACKEND].new('struct aes_ocb_t[1]')
+  assert module[BACKEND].AESOcbInit(pocb, key, len(key)) == 1
+  return pocb
+
+def ocb_crypt(BACKEND, pocb, nonce, aad, data, tag_len, tag=None):
+  # Encrypts (or decrypts and verifies 'tag'), with the associated data and
+  # the data given in random pieces
+  assert module[BACKEND].AESOcbStart(pocb, nonce, len(nonce), tag_len) == 1
+  crypt = (module[BACKEND].AESOcbEncrypt if tag is None else
+           module[BACKEND].AESOcbDecrypt)
+
+  aad_pieces = random_pieces(aad)
+  out = b''
+  for piece in random_pieces(data):
+    if aad_pieces:
+      aad_piece = aad_pieces.pop(0)
+      module[BACKEND].AESOcbAad(pocb, aad_piece, len(aad_piece))
+    buf = ffi[BACKEND].new('uint8_t[]', len(piece) + AES_BLOCK_LEN)
+    n = crypt(pocb, piece, len(piece), buf)
+    out += bytes(buf)[:n]
+  for aad_piece in aad_pieces:
+    module[BACKEND].AESOcbAad(pocb, aad_piece, len(aad_piece))
+
+  buf = ffi[BACKEND].new('uint8_t[]', AES_BLOCK_LEN)
+  plength = ffi[BACKEND].new('uint8_t[1]')
+  if tag is None:
+    ptag = ffi[BACKEND].new('uint8_t[]', tag_len)
+    module[BACKEND].AESOcbEncryptFinish(pocb, buf, plength, ptag)
+    result = bytes(ptag)
+  else:
+    result = module[BACKEND].AESOcbDecryptFinish(pocb, buf, plength, tag)
+  out += bytes(buf)[:plength[0]]
+  return out, result
+
+class TestOCB(unittest.TestCase):
+
+  def testVectors(self):
+    # RFC 7253 appendix A
+    key = bytes(range(16))
+    vectors = [
+      ('BBAA99887766554433221100', '', '',
+       '785407BFFFC8AD9EDCC5520AC9111EE6'),
+      ('BBAA99887766554433221101', '0001020304050607', '0001020304050607',
+       '6820B3657B6F615A5725BDA0D3B4EB3A257C9AF1F8F03009'),
+      ('BBAA99887766554433221103', '', '0001020304050607',
+       '45DD69F8F5AAE72414054CD1F35D82760B2CD00D2F99BFA9'),
+    ]
+
+    for BACKEND in module:
+      pocb = ocb_init(BACKEND, key)
+      for nonce, aad, plain, expected in vectors:
+        nonce, aad, plain, expected = map(bytes.fromhex,
+                                          (nonce, aad, plain, expected))
+
+        cipher, tag = ocb_crypt(BACKEND, pocb, nonce, aad, plain, 16)
+        self.assertEqual(cipher + tag, expected)
+
+  def testEncryptRandom(self):
+    for BACKEND in module:
+      for key_len in AES_KEY_LENS:
+        for count in range(32):
+          key = os.urandom(key_len)
+          nonce = os.urandom(random.randint(1, 15))
+          tag_len = random.randint(8, 16)
+          aad = os.urandom(random.randint(0, 300))
+          plain = os.urandom(random.randint(0, 600))
+
+          pocb = ocb_init(BACKEND, key)
+          cipher, tag = ocb_crypt(BACKEND, pocb, nonce, aad, plain, tag_len)
+
+          ocb = AES.new(key, AES.MODE_OCB, nonce=nonce, mac_len=tag_len)
+          ocb.update(aad)
+          cipher_reference, tag_reference = ocb.encrypt_and_digest(plain)
+          self.assertEqual(cipher, cipher_reference)
+          self.assertEqual(tag, tag_reference)
+
+          # Consecutive nonces share the encrypted nonce (stretch)
+          nonce = nonce[:-1] + bytes([nonce[-1] ^ random.randint(1, 63)])
+          cipher, tag = ocb_crypt(BACKEND, pocb, nonce, aad, plain, tag_len)
+
+          ocb = AES.new(key, AES.MODE_OCB, nonce=nonce, mac_len=tag_len)
+          ocb.update(aad)
+          self.assertEqual(cipher + tag, b''.join(ocb.encrypt_and_digest(plain)))
+
+  def testDecryptRandom(self):
+    for BACKEND in module:
+      for key_len in AES_KEY_LENS:
+        for count in range(32):
+          key = os.urandom(key_len)
+          nonce = os.urandom(random.randint(1, 15))
+          tag_len = random.randint(8, 16)
+          aad = os.urandom(random.randint(0, 300))
+          plain = os.urandom(random.randint(0, 600))
+
+          ocb = AES.new(key, AES.MODE_OCB, nonce=nonce, mac_len=tag_len)
+          ocb.update(aad)
+          cipher, tag = ocb.encrypt_and_digest(plain)
+
+          pocb = ocb_init(BACKEND, key)
+          plain_module, valid = ocb_crypt(BACKEND, pocb, nonce, aad, cipher,
+                                          tag_len, tag)
+          self.assertEqual(valid, 1)
+          self.assertEqual(plain_module, plain)
+
+  def testModified(self):
+    for BACKEND in module:
+      key = os.urandom(16)
+      nonce = os.urandom(12)
+      aad = os.urandom(20)
+      plain = os.urandom(100)
+
+      pocb = ocb_init(BACKEND, key)
+      cipher, tag = ocb_crypt(BACKEND, pocb, nonce, aad, plain, 16)
+
+      def modify(data):
+        pos = random.randrange(len(data))
+        return data[:pos] + bytes([data[pos] ^ 1]) + data[pos + 1:]
+
+      for nonce_, aad_, cipher_, tag_ in (
+          (modify(nonce), aad, cipher, tag),
+          (nonce, modify(aad), cipher, tag),
+          (nonce, aad, modify(cipher), tag),
+          (nonce, aad, cipher, modify(tag))):
+        self.assertEqual(ocb_crypt(BACKEND, pocb, nonce_, aad_, cipher_, 16,
+                                   tag_)[1], 0)
+
+  def testInvalidParameters(self):
+    for BACKEND in module:
+      pocb = ffi[BACKEND].new('struct aes_ocb_t[1]')
+      for key_len in (0, 15, 20, 33):
+        key = os.urandom(key_len)
+        self.assertEqual(module[BACKEND].AESOcbInit(pocb, key, key_len), 0)
+
+      pocb = ocb_init(BACKEND, os.urandom(16))
+      nonce = os.urandom(16)
+      for nonce_len, tag_len in ((0, 16), (16, 16), (12, 0), (12, 17)):
+        self.assertEqual(module[BACKEND].AESOcbStart(
+            pocb, nonce, nonce_len, tag_len), 0)
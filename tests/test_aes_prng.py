@@ -0,0 +1,192 @@
+#!/usr/bin/python3
+
+# Copyright 2021 Djones A. Boni
+#
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+# http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+
+from unit_test_c_with_python.load_c import load
+
+import unittest
+import os
+import random
+
+from Crypto.Cipher import AES
+
+AES_BLOCK_LEN = 16
+RESEED_INTERVAL = 5
+
+# Dicrionaries to hold modules and ffis
+module, ffi = {}, {}
+
+# Key length of each configuration. The PRNG is deterministic (debug).
+KEY_LENS = {
+  'aes128': 16,
+  'aes192': 24,
+  'aes256': 32,
+  'portable': 16,
+}
+
+CONFIGS = {
+  'aes128': [],
+  'aes192': ['-DAES_PRNG_KEY_LEN=24'],
+  'aes256': ['-DAES_PRNG_KEY_LEN=32'],
+  'portable': ['-DAES_AESNI=0'],
+}
+
+# Compile one module for each configuration
+for CONFIG in CONFIGS:
+
+  # Every module have its own name
+  module_name = 'aes_prng_%s_' % CONFIG
+
+  source_files = [
+    '../source/aes.c',
+    '../source/aes_prng.c',
+  ]
+
+  include_paths = [
+    '../include',
+  ]
+
+  compiler_options = [
+    '-std=c90',
+    '-pedantic',
+    '-DAES_PRNG_DEBUG=1',
+    '-DAES_PRNG_RESEED_INTERVAL=%d' % RESEED_INTERVAL,
+  ] + CONFIGS[CONFIG]
+
+  module[CONFIG], ffi[CONFIG] = load(
+      source_files, include_paths, compiler_options,
+      module_name=module_name)
+
+class CtrDrbg:
+  # NIST SP 800-90A CTR_DRBG with derivation function, for reference
+
+  def __init__(self, key_len, entropy):
+    self.key_len = key_len
+    self.seed_len = key_len + AES_BLOCK_LEN
+    # Blocks of the seed length, the last one partial with AES-192
+    self.seed_blocks = (self.seed_len + AES_BLOCK_LEN - 1) // AES_BLOCK_LEN
+    self.key = bytes(key_len)
+    self.v = bytes(AES_BLOCK_LEN)
+    self.update(self.df(entropy))
+
+  def encrypt(self, key, block):
+    return AES.new(key, AES.MODE_ECB).encrypt(block)
+
+  def next_v(self):
+    n = (int.from_bytes(self.v, 'big') + 1) % (1 << 128)
+    self.v = n.to_bytes(AES_BLOCK_LEN, 'big')
+    return self.encrypt(self.key, self.v)
+
+  def update(self, data):
+    temp = b''.join(self.next_v()
+                    for i in range(self.seed_blocks))
+    temp = bytes(x ^ y for x, y in zip(temp, data))
+    self.key, self.v = temp[:self.key_len], temp[self.key_len:]
+
+  def bcc(self, key, data):
+    x = bytes(AES_BLOCK_LEN)
+    for i in range(0, len(data), AES_BLOCK_LEN):
+      block = bytes(a ^ b for a, b in zip(x, data[i:i + AES_BLOCK_LEN]))
+      x = self.encrypt(key, block)
+    return x
+
+  def df(self, data):
+    s = (len(data).to_bytes(4, 'big') + self.seed_len.to_bytes(4, 'big') +
+         data + b'\x80')
+    s += bytes(-len(s) % AES_BLOCK_LEN)
+    key = bytes(range(self.key_len))
+    temp = b''.join(
+        self.bcc(key, i.to_bytes(4, 'big') + bytes(12) + s)
+        for i in range(self.seed_blocks))
+    key = temp[:self.key_len]
+    x = temp[self.key_len:self.key_len + AES_BLOCK_LEN]
+    out = b''
+    while len(out) < self.seed_len:
+      x = self.encrypt(key, x)
+      out += x
+    return out[:self.seed_len]
+
+  def reseed(self, entropy):
+    self.update(self.df(entropy))
+
+  def generate(self, num):
+    out = b''
+    while len(out) < num:
+      out += self.next_v()
+    self.update(bytes(self.seed_len))
+    return out[:num]
+
+def prng_random(CONFIG, num):
+  buff = ffi[CONFIG].new('uint8_t[]', max(num, 1))
+  result = module[CONFIG].AESPrngRandom(buff, num)
+  return result, bytes(buff)[:num]
+
+class TestPRNG(unittest.TestCase):
+
+  def testVector(self):
+    # AES-128 CTR_DRBG with derivation function (as in OpenSSL 3 CTR-DRBG):
+    # seed = entropy | nonce | personalization string
+    entropy = bytes(i * 7 + 1 for i in range(32))
+    nonce = bytes(0xA0 + i for i in range(16))
+    personalization = b'OpenSSL NIST SP 800-90A DRBG\x00'
+    seed = entropy + nonce + personalization
+    expected = bytes.fromhex(
+        '333e0afd56625d5edc64bb04089907911e1ced1041ae4aa08983fc2b0e0dc802'
+        '51ad98a2c99d83b03ffd438af6e998ee917e8fdc960ec2d84f0ef16208329eb8'
+        '71a1e01aa20b868252d09ddb0509ef0f947512f0faf8cf3a2bab9e52053ebfdb'
+        'f5ad65f2')
+
+    for CONFIG in module:
+      if KEY_LENS[CONFIG] == 16:
+        module[CONFIG].AESPrngSeed(seed, len(seed))
+        self.assertEqual(prng_random(CONFIG, len(expected)), (1, expected))
+
+  def testRandom(self):
+    for CONFIG in module:
+      for count in range(16):
+        entropy = os.urandom(random.randint(0, 100))
+        drbg = CtrDrbg(KEY_LENS[CONFIG], entropy)
+        module[CONFIG].AESPrngSeed(entropy, len(entropy))
+
+        for i in range(RESEED_INTERVAL):
+          num = random.choice((0, 1, 16, random.randint(0, 1000)))
+          self.assertEqual(prng_random(CONFIG, num), (1, drbg.generate(num)))
+
+  def testLargeRequest(self):
+    # Requests larger than 64 KiB are split in many generate calls
+    for CONFIG in module:
+      entropy = os.urandom(32)
+      drbg = CtrDrbg(KEY_LENS[CONFIG], entropy)
+      module[CONFIG].AESPrngSeed(entropy, len(entropy))
+
+      num = 65536 + 100
+      result, random_bytes = prng_random(CONFIG, num)
+      self.assertEqual(result, 1)
+      self.assertEqual(random_bytes, drbg.generate(65536) + drbg.generate(100))
+
+  def testReseed(self):
+    for CONFIG in module:
+      entropy = os.urandom(48)
+      drbg = CtrDrbg(KEY_LENS[CONFIG], entropy)
+      module[CONFIG].AESPrngSeed(entropy, len(entropy))
+
+      for i in range(RESEED_INTERVAL):
+        self.assertEqual(prng_random(CONFIG, 20), (1, drbg.generate(20)))
+      self.assertEqual(prng_random(CONFIG, 20)[0], 0)
+
+      # Deterministic: seed() starts again from a zero state
+      module[CONFIG].AESPrngSeed(entropy, len(entropy))
+      drbg = CtrDrbg(KEY_LENS[CONFIG], entropy)
+      self.assertEqual(prng_random(CONFIG, 20), (1, drbg.generate(20)))
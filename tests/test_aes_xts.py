@@ -0,0 +1,241 @@
+#!/usr/bin/python3
+
+# Copyright 2021 Djones A. Boni
+#
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+# http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+
+from unit_test_c_with_python.load_c import load
+
+import unittest
+import os
+import random
+
+from Crypto.Cipher import AES
+
+AES_BLOCK_LEN = 16
+
+# Dicrionaries to hold modules and ffis
+module, ffi = {}, {}
+
+# Backends to test. The default one uses AES-NI if the CPU supports it.
+BACKENDS = {
+  'default': [],
+  'portable': ['-DAES_AESNI=0'],
+}
+
+# XTS keys are two AES keys
+AES_XTS_KEY_LENS = (32, 48, 64)
+
+# Compile one module for each backend
+for BACKEND in BACKENDS:
+
+  # Every module have its own name
+  module_name = 'aes_xts_%s_' % BACKEND
+
+  source_files = [
+    '../source/aes.c',
+    '../source/aes_xts.c',
+  ]
+
+  include_paths = [
+    '../include',
+  ]
+
+  compiler_options = [
+    '-std=c90',
+    '-pedantic',
+  ] + BACKENDS[BACKEND]
+
+  module[BACKEND], ffi[BACKEND] = load(
+      source_files, include_paths, compiler_options,
+      module_name=module_name)
+
+def xor(a, b):
+  return bytes(x ^ y for x, y in zip(a, b))
+
+def mul_x(t):
+  # Multiply the tweak by x in GF(2^128), little-endian
+  n = int.from_bytes(t, 'little') << 1
+  if n >> 128:
+    n ^= (1 << 128) | 0x87
+  return n.to_bytes(AES_BLOCK_LEN, 'little')
+
+def xts_reference(key, tweak, data, decrypt=False):
+  # IEEE 1619 XTS with cipher-text stealing, on top of AES ECB
+  half = len(key) // 2
+  ecb = AES.new(key[:half], AES.MODE_ECB)
+  crypt = ecb.decrypt if decrypt else ecb.encrypt
+  t = AES.new(key[half:], AES.MODE_ECB).encrypt(tweak)
+
+  blocks = [data[i:i + AES_BLOCK_LEN]
+            for i in range(0, len(data), AES_BLOCK_LEN)]
+  tweaks = []
+  for block in blocks:
+    tweaks.append(t)
+    t = mul_x(t)
+
+  def xex(block, t):
+    return xor(crypt(xor(block, t)), t)
+
+  partial = len(blocks[-1])
+  if partial == AES_BLOCK_LEN:
+    return b''.join(xex(b, t) for b, t in zip(blocks, tweaks))
+
+  m = len(blocks) - 1
+  out = [xex(blocks[i], tweaks[i]) for i in range(m - 1)]
+  if decrypt:
+    t1, t2 = tweaks[m], tweaks[m - 1]
+  else:
+    t1, t2 = tweaks[m - 1], tweaks[m]
+  a = xex(blocks[m - 1], t1)
+  out.append(xex(blocks[m] + a[partial:], t2))
+  out.append(a[:partial])
+  return b''.join(out)
+
+def sector_tweak(sector):
+  return sector.to_bytes(AES_BLOCK_LEN, 'little')
+
+def random_key(key_len):
+  key = os.urandom(key_len)
+  while key[:key_len // 2] == key[key_len // 2:]:
+    key = os.urandom(key_len)
+  return key
+
+def xts_init(BACKEND, key):
+  pxts = ffi[BACKEND].new('struct aes_xts_t[1]')
+  assert module[BACKEND].AESXtsInit(pxts, key, len(key)) == 1
+  return pxts
+
+class TestXTS(unittest.TestCase):
+
+  def testVectors(self):
+    # IEEE 1619 test vectors 4 (sector 0) and 15 (cipher-text stealing)
+    vectors = [
+      ('27182818284590452353602874713526' '31415926535897932384626433832795',
+       '00', bytes(range(256)) * 2,
+       '27a7479befa1d476489f308cd4cfa6e2' 'a96e4bbe3208ff25287dd3819616e89c'),
+      ('fffefdfcfbfaf9f8f7f6f5f4f3f2f1f0' 'bfbebdbcbbbab9b8b7b6b5b4b3b2b1b0',
+       '9a78563412', bytes(range(17)),
+       '6c1625db4671522d3d7599601de7ca09' 'ed'),
+    ]
+
+    for BACKEND in module:
+      for key, tweak, plain, cipher_start in vectors:
+        key = bytes.fromhex(key)
+        tweak = bytes.fromhex(tweak).ljust(AES_BLOCK_LEN, b'\x00')
+        cipher_start = bytes.fromhex(cipher_start)
+
+        pxts = xts_init(BACKEND, key)
+        cipher = ffi[BACKEND].new('uint8_t[]', len(plain))
+        self.assertEqual(module[BACKEND].AESXtsEncrypt(
+            pxts, tweak, plain, len(plain), cipher), 1)
+
+        self.assertEqual(bytes(cipher)[:len(cipher_start)], cipher_start)
+
+  def testEncryptRandom(self):
+    for BACKEND in module:
+      for key_len in AES_XTS_KEY_LENS:
+        for count in range(32):
+          key = random_key(key_len)
+          tweak = os.urandom(AES_BLOCK_LEN)
+          plain = os.urandom(random.randint(AES_BLOCK_LEN, 600))
+
+          pxts = xts_init(BACKEND, key)
+          cipher = ffi[BACKEND].new('uint8_t[]', len(plain))
+          module[BACKEND].AESXtsEncrypt(pxts, tweak, plain, len(plain), cipher)
+
+          self.assertEqual(bytes(cipher), xts_reference(key, tweak, plain))
+
+  def testDecryptRandom(self):
+    for BACKEND in module:
+      for key_len in AES_XTS_KEY_LENS:
+        for count in range(32):
+          key = random_key(key_len)
+          tweak = os.urandom(AES_BLOCK_LEN)
+          cipher = os.urandom(random.randint(AES_BLOCK_LEN, 600))
+
+          pxts = xts_init(BACKEND, key)
+          plain = ffi[BACKEND].new('uint8_t[]', len(cipher))
+          module[BACKEND].AESXtsDecrypt(pxts, tweak, cipher, len(cipher), plain)
+
+          self.assertEqual(bytes(plain),
+                           xts_reference(key, tweak, cipher, decrypt=True))
+
+  def testInPlace(self):
+    for BACKEND in module:
+      key = random_key(32)
+      tweak = os.urandom(AES_BLOCK_LEN)
+      for length in (16, 17, 31, 32, 33, 129, 200):
+        plain = os.urandom(length)
+
+        pxts = xts_init(BACKEND, key)
+        data = ffi[BACKEND].new('uint8_t[%d]' % length, plain)
+        module[BACKEND].AESXtsEncrypt(pxts, tweak, data, length, data)
+        self.assertEqual(bytes(data), xts_reference(key, tweak, plain))
+
+        module[BACKEND].AESXtsDecrypt(pxts, tweak, data, length, data)
+        self.assertEqual(bytes(data), plain)
+
+  def testSectorsRandom(self):
+    for BACKEND in module:
+      for key_len in AES_XTS_KEY_LENS:
+        for count in range(16):
+          key = random_key(key_len)
+          sector = random.choice((0, random.getrandbits(32),
+                                  random.getrandbits(64) - 20))
+          sector = max(sector, 0)
+          sector_len = random.choice((16, 33, 512, random.randint(16, 100)))
+          num_sectors = random.randint(0, 20)
+          plain = os.urandom(sector_len * num_sectors)
+
+          pxts = xts_init(BACKEND, key)
+          cipher = ffi[BACKEND].new('uint8_t[]', len(plain))
+          self.assertEqual(module[BACKEND].AESXtsEncryptSectors(
+              pxts, sector, sector_len, num_sectors, plain, cipher), 1)
+
+          cipher_reference = b''.join(
+              xts_reference(key, sector_tweak(sector + i),
+                            plain[i * sector_len:(i + 1) * sector_len])
+              for i in range(num_sectors))
+          self.assertEqual(bytes(cipher), cipher_reference)
+
+          plain_module = ffi[BACKEND].new('uint8_t[]', len(plain))
+          self.assertEqual(module[BACKEND].AESXtsDecryptSectors(
+              pxts, sector, sector_len, num_sectors, cipher, plain_module), 1)
+          self.assertEqual(bytes(plain_module), plain)
+
+  def testTooShort(self):
+    for BACKEND in module:
+      pxts = xts_init(BACKEND, random_key(32))
+      tweak = bytes(AES_BLOCK_LEN)
+      for length in (0, 1, 15):
+        data = ffi[BACKEND].new('uint8_t[]', AES_BLOCK_LEN)
+        self.assertEqual(module[BACKEND].AESXtsEncrypt(
+            pxts, tweak, data, length, data), 0)
+        self.assertEqual(module[BACKEND].AESXtsDecrypt(
+            pxts, tweak, data, length, data), 0)
+        self.assertEqual(module[BACKEND].AESXtsEncryptSectors(
+            pxts, 0, length, 1, data, data), 0)
+
+  def testInvalidKey(self):
+    for BACKEND in module:
+      pxts = ffi[BACKEND].new('struct aes_xts_t[1]')
+
+      for key_len in (0, 16, 33, 40, 80):
+        key = os.urandom(key_len)
+        self.assertEqual(module[BACKEND].AESXtsInit(pxts, key, key_len), 0)
+
+      # Data key and tweak key must be different
+      for key_len in AES_XTS_KEY_LENS:
+        key = os.urandom(key_len // 2) * 2
+        self.assertEqual(module[BACKEND].AESXtsInit(pxts, key, key_len), 0)
@@ -22,6 +22,7 @@ import random
 
 # Dicrionaries to hold modules and ffis
 module, ffi = {}, {}
+module_bi, ffi_bi = {}, {}
 
 # Compile several modules with hash lengths
 for HASH_BITS in (512, 384, 256, 224):
@@ -51,6 +52,12 @@ for HASH_BITS in (512, 384, 256, 224):
       source_files, include_paths, compiler_options,
       module_name=module_name)
 
+  # The same with bit-interleaved lanes
+  module_bi[HASH_BITS], ffi_bi[HASH_BITS] = load(
+      source_files, include_paths,
+      compiler_options + ['-DKECCAK_INTERLEAVE=1'],
+      module_name='keccak_bi_%d_' % HASH_BITS)
+
 import hashlib
 
 # Used to select the correct reference functions
@@ -229,5 +236,91 @@ class TestSHAKE(unittest.TestCase):
 
       self.assertEqual(xof_module, xof_reference)
 
+class TestInterleave(unittest.TestCase):
+
+  def testSHA3Pieces(self):
+    # Bit-interleaved lanes, data in random pieces
+    for HASH_BITS in (512, 384, 256, 224):
+      length = random.randint(0, 1024)
+      data = os.urandom(length)
+      hash_length = HASH_BITS // 8
+
+      phash_ = ffi_bi[HASH_BITS].new('struct keccak_hash_t[1]')
+
+      module_bi[HASH_BITS].KeccakHashInit(phash_)
+      pos = 0
+      while pos < length:
+        n = min(random.randint(0, 300), length - pos)
+        module_bi[HASH_BITS].KeccakHashUpdate(phash_, data[pos:pos + n], n)
+        pos += n
+      module_bi[HASH_BITS].KeccakHashFinish(phash_)
+
+      hash_module = ffi_bi[HASH_BITS].buffer(phash_[0].state.a, hash_length)
+      hash_module = hash_module[:]
+
+      hash_reference = sha3[HASH_BITS](data).digest()
+
+      self.assertEqual(hash_module, hash_reference)
+
+  def testSHAKEPieces(self):
+    for HASH_BITS in (512, 256):
+      length = random.randint(0, 1024)
+      data = os.urandom(length)
+      xof_length = random.randint(0, 1024)
+
+      pxof = ffi_bi[HASH_BITS].new('struct keccak_xof_t[1]')
+
+      module_bi[HASH_BITS].KeccakXofInit(pxof)
+      module_bi[HASH_BITS].KeccakXofAbsorb(pxof, data, length)
+      module_bi[HASH_BITS].KeccakXofFinish(pxof)
+
+      xof_module = b''
+      while len(xof_module) < xof_length:
+        n = min(random.randint(0, 300), xof_length - len(xof_module))
+        pbuff = ffi_bi[HASH_BITS].new('uint8_t[%d]' % max(n, 1))
+        module_bi[HASH_BITS].KeccakXofSqueeze(pxof, pbuff, n)
+        xof_module += bytes(ffi_bi[HASH_BITS].buffer(pbuff, n))
+
+      xof_reference = shake[HASH_BITS](data).digest(xof_length)
+
+      self.assertEqual(xof_module, xof_reference)
+
+class TestStateNum(unittest.TestCase):
+
+  def testInvalidNum(self):
+    # A state with a used byte count not below the rate (not initialized,
+    # e.g. in .noinit) is permuted and starts a new block
+    KECCAK_STATE_SIZE = 200
+    KECCAK_NR = 24
+    for HASH_BITS in module:
+      rate = KECCAK_STATE_SIZE - HASH_BITS // 4
+      for function in ('KeccakAbsorb', 'KeccakSqueeze', 'KeccakEncrypt',
+                       'KeccakDecrypt'):
+        num = random.randint(rate, 255)
+        length = random.randint(1, 400)
+        state = os.urandom(KECCAK_STATE_SIZE)
+        data = os.urandom(length)
+
+        pstate = ffi[HASH_BITS].new('struct keccak_t[1]')
+        ffi[HASH_BITS].memmove(pstate[0].a, state, KECCAK_STATE_SIZE)
+        pstate[0].num = num
+        pbuff = ffi[HASH_BITS].new('uint8_t[%d]' % length, data)
+        getattr(module[HASH_BITS], function)(pstate, rate, KECCAK_NR, pbuff,
+                                             length)
+
+        pref = ffi[HASH_BITS].new('struct keccak_t[1]')
+        ffi[HASH_BITS].memmove(pref[0].a, state, KECCAK_STATE_SIZE)
+        module[HASH_BITS].KeccakF(pref, KECCAK_NR)
+        pref[0].num = 0
+        pref_buff = ffi[HASH_BITS].new('uint8_t[%d]' % length, data)
+        getattr(module[HASH_BITS], function)(pref, rate, KECCAK_NR, pref_buff,
+                                             length)
+
+        self.assertEqual(ffi[HASH_BITS].buffer(pstate[0].a)[:],
+                         ffi[HASH_BITS].buffer(pref[0].a)[:])
+        self.assertEqual(pstate[0].num, pref[0].num)
+        self.assertEqual(ffi[HASH_BITS].buffer(pbuff)[:],
+                         ffi[HASH_BITS].buffer(pref_buff)[:])
+
 if __name__ == '__main__':
   unittest.main()
@@ -0,0 +1,133 @@
+#!/usr/bin/python3
+
+# Copyright 2021 Djones A. Boni
+#
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+# http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+
+from unit_test_c_with_python.load_c import load
+
+import unittest
+import os
+import random
+import hashlib
+
+# Dicrionaries to hold modules and ffis
+module, ffi = {}, {}
+
+# Backends to test. The interleave one also uses other KeccakHash and
+# KeccakXof lengths.
+BACKENDS = {
+  'default': [],
+  'portable': ['-DKECCAK_AVX2=0', '-DKECCAK_AVX512=0'],
+  'interleave': ['-DKECCAK_INTERLEAVE=1', '-DKECCAK_HASH_OUTPUT=64',
+                 '-DKECCAK_XOF_SECURITY=16'],
+}
+
+# KeccakHash and KeccakXof references of each backend
+HASH = {
+  'default': (hashlib.sha3_256, hashlib.shake_256),
+  'portable': (hashlib.sha3_256, hashlib.shake_256),
+  'interleave': (hashlib.sha3_512, hashlib.shake_128),
+}
+
+# Compile one module for each backend
+for BACKEND in BACKENDS:
+
+  # Every module have its own name
+  module_name = 'keccak_batch_%s_' % BACKEND
+
+  source_files = [
+    '../source/keccak.c',
+    '../source/keccak_hash.c',
+    '../source/keccak_x4.c',
+    '../source/keccak_batch.c',
+  ]
+
+  include_paths = [
+    '../include',
+  ]
+
+  compiler_options = [
+    '-std=c90',
+    '-pedantic',
+    '-DKECCAK_WORD=8',
+  ] + BACKENDS[BACKEND]
+
+  module[BACKEND], ffi[BACKEND] = load(
+      source_files, include_paths, compiler_options,
+      module_name=module_name)
+
+def Messages(count, max_length):
+  # Random lengths, with runs of equal lengths and of equal block counts
+  lengths = []
+  while len(lengths) < count:
+    length = random.randint(0, max_length)
+    lengths += [length] * random.randint(1, 5)
+  return [os.urandom(n) for n in lengths[:count]]
+
+def Batch(BACKEND, function, data, out_length, *args):
+  # Calls the batch function, returns the list of outputs
+  count = len(data)
+  pbuffs = [ffi[BACKEND].new('uint8_t[%d]' % max(len(d), 1), d) for d in data]
+  pptrs = ffi[BACKEND].new('void *[%d]' % max(count, 1), pbuffs)
+  pnums = ffi[BACKEND].new('size_t[%d]' % max(count, 1),
+                           [len(d) for d in data])
+  pout = ffi[BACKEND].new('uint8_t[%d]' % max(count * out_length, 1))
+  getattr(module[BACKEND], function)(pptrs, pnums, pout, *args, count)
+  out = bytes(ffi[BACKEND].buffer(pout, count * out_length))
+  return [out[i * out_length:(i + 1) * out_length] for i in range(count)]
+
+class TestBatch(unittest.TestCase):
+
+  def testSHA3(self):
+    for BACKEND in BACKENDS:
+      for bits in (224, 256, 384, 512):
+        data = Messages(random.randint(0, 100), 600)
+        digests = Batch(BACKEND, 'SHA3_%dBatch' % bits, data, bits // 8)
+        for i in range(len(data)):
+          self.assertEqual(digests[i],
+                           hashlib.new('sha3_%d' % bits, data[i]).digest())
+
+  def testStragglers(self):
+    # Many different block counts, more than the pending messages
+    for BACKEND in BACKENDS:
+      data = Messages(200, 5000)
+      digests = Batch(BACKEND, 'SHA3_512Batch', data, 64)
+      for i in range(len(data)):
+        self.assertEqual(digests[i], hashlib.sha3_512(data[i]).digest())
+
+  def testSHAKE(self):
+    for BACKEND in BACKENDS:
+      for bits, shake in ((128, hashlib.shake_128), (256, hashlib.shake_256)):
+        data = Messages(random.randint(0, 100), 600)
+        out_length = random.choice((0, 1, 32, random.randint(0, 500)))
+        outputs = Batch(BACKEND, 'SHAKE%dBatch' % bits, data, out_length,
+                        out_length)
+        for i in range(len(data)):
+          self.assertEqual(outputs[i], shake(data[i]).digest(out_length))
+
+  def testKeccakHash(self):
+    for BACKEND in BACKENDS:
+      sha3, shake = HASH[BACKEND]
+      data = Messages(random.randint(0, 100), 600)
+      digests = Batch(BACKEND, 'KeccakHashBatch', data, sha3().digest_size)
+      for i in range(len(data)):
+        self.assertEqual(digests[i], sha3(data[i]).digest())
+
+      out_length = random.randint(0, 300)
+      outputs = Batch(BACKEND, 'KeccakXofBatch', data, out_length, out_length)
+      for i in range(len(data)):
+        self.assertEqual(outputs[i], shake(data[i]).digest(out_length))
+
+if __name__ == '__main__':
+  unittest.main()
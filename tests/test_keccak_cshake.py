@@ -0,0 +1,317 @@
+#!/usr/bin/python3
+
+# Copyright 2021 Djones A. Boni
+#
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+# http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+
+from unit_test_c_with_python.load_c import load
+
+import unittest
+import os
+import random
+import hashlib
+from Crypto.Hash import cSHAKE128, cSHAKE256, KMAC128, KMAC256
+
+# Dicrionaries to hold modules and ffis
+module, ffi = {}, {}
+
+# Backends to test
+BACKENDS = {
+  'default': [],
+  'portable': ['-DKECCAK_AVX2=0', '-DKECCAK_AVX512=0'],
+  'interleave': ['-DKECCAK_INTERLEAVE=1'],
+  'lanes1': ['-DPARALLELHASH_LANES=1'],
+  'threads': ['-DPARALLELHASH_THREADS=4'],
+  'threads2': ['-DPARALLELHASH_THREADS=2'],
+  'unbuffered': ['-DPARALLELHASH_BUFFER_BLOCK_LEN=0'],
+}
+
+# Configuration of each backend: lanes, threads and the largest block length
+# buffered
+CONFIGS = {
+  'default': (4, 1, 8192),
+  'portable': (4, 1, 8192),
+  'interleave': (4, 1, 8192),
+  'lanes1': (1, 1, 0),
+  'threads': (4, 4, 8192),
+  'threads2': (4, 2, 8192),
+  'unbuffered': (4, 1, 0),
+}
+
+# Compile one module for each backend
+for BACKEND in BACKENDS:
+
+  # Every module have its own name
+  module_name = 'keccak_cshake_%s_' % BACKEND
+
+  source_files = [
+    '../source/keccak.c',
+    '../source/keccak_x4.c',
+    '../source/keccak_cshake.c',
+  ]
+
+  include_paths = [
+    '../include',
+  ]
+
+  compiler_options = [
+    '-std=c90',
+    '-pedantic',
+    '-DKECCAK_WORD=8',
+    '-DPARALLELHASH_DEBUG=1',
+  ] + BACKENDS[BACKEND]
+
+  module[BACKEND], ffi[BACKEND] = load(
+      source_files, include_paths, compiler_options,
+      module_name=module_name)
+
+def left_encode(x):
+  b = x.to_bytes((x.bit_length() + 7) // 8 or 1, 'big')
+  return bytes([len(b)]) + b
+
+def right_encode(x):
+  b = x.to_bytes((x.bit_length() + 7) // 8 or 1, 'big')
+  return b + bytes([len(b)])
+
+def cSHAKE(bits, data, name, custom):
+  cshake = cSHAKE128 if bits == 128 else cSHAKE256
+  return cshake._new(data, custom, name)
+
+def ParallelHashReference(bits, data, block_len, custom, out_length, xof):
+  # SP 800-185 ParallelHash, one block at a time
+  shake = hashlib.shake_128 if bits == 128 else hashlib.shake_256
+  n = (len(data) + block_len - 1) // block_len
+  z = left_encode(block_len)
+  for i in range(n):
+    z += shake(data[i * block_len:(i + 1) * block_len]).digest(bits // 4)
+  z += right_encode(n) + right_encode(0 if xof else 8 * out_length)
+  return cSHAKE(bits, z, b'ParallelHash', custom).read(out_length)
+
+def ParallelHash(BACKEND, bits, data, block_len, custom, out_length, xof,
+                 pieces=0):
+  pph = ffi[BACKEND].new('struct parallelhash_t[1]')
+  init = getattr(module[BACKEND], 'ParallelHash%dInit' % bits)
+  assert init(pph, block_len, custom, len(custom)) == 1
+  pos = 0
+  while pos < len(data):
+    n = random.randint(0, pieces) if pieces else len(data)
+    n = min(n, len(data) - pos)
+    module[BACKEND].ParallelHashUpdate(pph, data[pos:pos + n], n)
+    pos += n
+  if xof:
+    module[BACKEND].ParallelHashXofFinish(pph)
+  else:
+    module[BACKEND].ParallelHashFinish(pph, out_length)
+  pout = ffi[BACKEND].new('uint8_t[%d]' % max(out_length, 1))
+  module[BACKEND].ParallelHashSqueeze(pph, pout, out_length)
+  return bytes(ffi[BACKEND].buffer(pout, out_length))
+
+class TestCSHAKE(unittest.TestCase):
+
+  def testSample(self):
+    # NIST cSHAKE128 sample #2
+    expected = bytes.fromhex(
+        'c1c36925b6409a04f1b504fcbca9d82b'
+        '4017277cb5ed2b2065fc1d3814d5aaf5')
+    for BACKEND in BACKENDS:
+      pstate = ffi[BACKEND].new('struct cshake_128_t[1]')
+      pout = ffi[BACKEND].new('uint8_t[32]')
+      custom = b'Email Signature'
+      module[BACKEND].CSHAKE128Init(pstate, b'', 0, custom, len(custom))
+      module[BACKEND].CSHAKE128Absorb(pstate, bytes(range(4)), 4)
+      module[BACKEND].CSHAKE128Finish(pstate)
+      module[BACKEND].CSHAKE128Squeeze(pstate, pout, 32)
+      self.assertEqual(bytes(ffi[BACKEND].buffer(pout, 32)), expected)
+
+  def testCSHAKE(self):
+    # Empty name and customization is SHAKE
+    for BACKEND in BACKENDS:
+      for bits in (128, 256):
+        name = 'CSHAKE%d' % bits
+        for name_len, custom_len in ((0, 0), (5, 0), (0, 200), (300, 20)):
+          fname = os.urandom(name_len)
+          custom = os.urandom(custom_len)
+          data = os.urandom(random.randint(0, 1000))
+          out_length = random.randint(0, 1000)
+
+          pstate = ffi[BACKEND].new('struct cshake_%d_t[1]' % bits)
+          pout = ffi[BACKEND].new('uint8_t[%d]' % max(out_length, 1))
+          getattr(module[BACKEND], name + 'Init')(pstate, fname, name_len,
+                                                  custom, custom_len)
+          getattr(module[BACKEND], name + 'Absorb')(pstate, data, len(data))
+          getattr(module[BACKEND], name + 'Finish')(pstate)
+          getattr(module[BACKEND], name + 'Squeeze')(pstate, pout, out_length)
+
+          reference = cSHAKE(bits, data, fname, custom).read(out_length)
+          self.assertEqual(bytes(ffi[BACKEND].buffer(pout, out_length)),
+                           reference)
+
+def KMACReference(bits, key, data, custom, out_length, xof):
+  # SP 800-185 KMAC, also for KMACXOF
+  rate = 168 if bits == 128 else 136
+  x = left_encode(rate) + left_encode(8 * len(key)) + key
+  x += bytes(-len(x) % rate)
+  x += data + right_encode(0 if xof else 8 * out_length)
+  return cSHAKE(bits, x, b'KMAC', custom).read(out_length)
+
+def KMAC(BACKEND, pkey, data, out_length, xof):
+  pkmac = ffi[BACKEND].new('struct kmac_t[1]')
+  pout = ffi[BACKEND].new('uint8_t[%d]' % max(out_length, 1))
+  module[BACKEND].KMACInit(pkmac, pkey)
+  module[BACKEND].KMACUpdate(pkmac, data, len(data))
+  if xof:
+    module[BACKEND].KMACXofFinish(pkmac)
+  else:
+    module[BACKEND].KMACFinish(pkmac, out_length)
+  module[BACKEND].KMACSqueeze(pkmac, pout, out_length)
+  return bytes(ffi[BACKEND].buffer(pout, out_length))
+
+class TestKMAC(unittest.TestCase):
+
+  def testSample(self):
+    # NIST KMAC128 sample #1
+    expected = bytes.fromhex(
+        'e5780b0d3ea6f7d3a429c5706aa43a00'
+        'fadbd7d49628839e3187243f456ee14e')
+    key = bytes(range(0x40, 0x60))
+    for BACKEND in BACKENDS:
+      pkey = ffi[BACKEND].new('struct kmac_key_t[1]')
+      module[BACKEND].KMAC128KeySetup(pkey, key, len(key), b'', 0)
+      self.assertEqual(KMAC(BACKEND, pkey, bytes(range(4)), 32, False),
+                       expected)
+
+  def testKMAC(self):
+    # Many messages with the same key state
+    for BACKEND in BACKENDS:
+      for bits, kmac in ((128, KMAC128), (256, KMAC256)):
+        key = os.urandom(random.choice((32, 64, 200)))
+        custom = os.urandom(random.choice((0, 1, 200)))
+        pkey = ffi[BACKEND].new('struct kmac_key_t[1]')
+        getattr(module[BACKEND], 'KMAC%dKeySetup' % bits)(
+            pkey, key, len(key), custom, len(custom))
+        for i in range(5):
+          data = os.urandom(random.choice((0, 64, random.randint(0, 1000))))
+          out_length = random.randint(8, 100)
+          reference = kmac.new(key=key, data=data, mac_len=out_length,
+                               custom=custom).digest()
+          self.assertEqual(KMAC(BACKEND, pkey, data, out_length, False),
+                           reference)
+
+  def testKMACXOF(self):
+    for BACKEND in BACKENDS:
+      for bits in (128, 256):
+        key = os.urandom(random.randint(0, 300))
+        custom = os.urandom(random.randint(0, 50))
+        data = os.urandom(random.randint(0, 500))
+        out_length = random.randint(0, 500)
+        pkey = ffi[BACKEND].new('struct kmac_key_t[1]')
+        getattr(module[BACKEND], 'KMAC%dKeySetup' % bits)(
+            pkey, key, len(key), custom, len(custom))
+        self.assertEqual(
+            KMAC(BACKEND, pkey, data, out_length, True),
+            KMACReference(bits, key, data, custom, out_length, True))
+
+class TestParallelHash(unittest.TestCase):
+
+  def testSample(self):
+    # NIST ParallelHash128 sample #1
+    expected = bytes.fromhex(
+        'ba8dc1d1d979331d3f813603c67f7260'
+        '9ab5e44b94a0b8f9af46514454a2b4f5')
+    data = bytes(16 * i + j for i in range(3) for j in range(8))
+    for BACKEND in BACKENDS:
+      self.assertEqual(ParallelHash(BACKEND, 128, data, 8, b'', 32, False),
+                       expected)
+
+  def testParallelHash(self):
+    for BACKEND in BACKENDS:
+      for bits in (128, 256):
+        for xof in (False, True):
+          block_len = random.choice((1, 8, 168, 1000, 8192))
+          length = random.choice((0, block_len - 1, block_len,
+                                  random.randint(0, 40 * block_len)))
+          data = os.urandom(length)
+          custom = os.urandom(random.choice((0, 1, 200)))
+          out_length = random.randint(1, 300)
+          self.assertEqual(
+              ParallelHash(BACKEND, bits, data, block_len, custom, out_length,
+                           xof),
+              ParallelHashReference(bits, data, block_len, custom, out_length,
+                                    xof))
+
+  def testLarge(self):
+    # Large enough for the threads
+    for BACKEND in BACKENDS:
+      block_len = 1024
+      data = os.urandom(random.randint(100, 300) * block_len + 5)
+      self.assertEqual(
+          ParallelHash(BACKEND, 128, data, block_len, b'', 32, False),
+          ParallelHashReference(128, data, block_len, b'', 32, False))
+
+  def testPieces(self):
+    for BACKEND in BACKENDS:
+      block_len = random.randint(1, 3000)
+      data = os.urandom(random.randint(0, 30000))
+      custom = os.urandom(random.randint(0, 50))
+      self.assertEqual(
+          ParallelHash(BACKEND, 256, data, block_len, custom, 64, False, 5000),
+          ParallelHashReference(256, data, block_len, custom, 64, False))
+
+  def testSmallPieces(self):
+    # Small updates are buffered and hashed in batches (enough blocks for the
+    # threads), or one block at a time if the blocks do not fit in the buffer
+    for BACKEND in BACKENDS:
+      for block_len in (1024, 20000):
+        data = os.urandom(random.randint(100, 300) * 1024 + 5)
+        self.assertEqual(
+            ParallelHash(BACKEND, 128, data, block_len, b'', 32, False, 200),
+            ParallelHashReference(128, data, block_len, b'', 32, False))
+
+  def testZeroBlockLength(self):
+    for BACKEND in BACKENDS:
+      for bits in (128, 256):
+        pph = ffi[BACKEND].new('struct parallelhash_t[1]')
+        init = getattr(module[BACKEND], 'ParallelHash%dInit' % bits)
+        self.assertEqual(init(pph, 0, b'', 0), 0)
+        self.assertEqual(init(pph, 1, b'', 0), 1)
+
+  def testStreamBatches(self):
+    # Small updates fill whole batches, hashed by the lanes and the threads
+    for BACKEND in BACKENDS:
+      lanes, threads, buffer_block_len = CONFIGS[BACKEND]
+      for block_len in (8192, 6000):
+        data = os.urandom(random.randint(20, 40) * block_len + 5)
+        module[BACKEND].ParallelHash_Batch_Blocks = 0
+        module[BACKEND].ParallelHash_Thread_Blocks = 0
+        self.assertEqual(
+            ParallelHash(BACKEND, 128, data, block_len, b'', 32, False, 1000),
+            ParallelHashReference(128, data, block_len, b'', 32, False))
+
+        batch_blocks = module[BACKEND].ParallelHash_Batch_Blocks
+        thread_blocks = module[BACKEND].ParallelHash_Thread_Blocks
+        # Blocks of a whole buffered batch
+        buffer_blocks = lanes * threads * buffer_block_len // block_len
+        buffer_blocks -= buffer_blocks % (lanes * threads)
+        if buffer_blocks > 0 and lanes > 1:
+          # Only the last blocks, fewer than the lanes, are not in a batch
+          self.assertGreater(batch_blocks, len(data) // block_len - lanes)
+        if buffer_blocks == 0:
+          self.assertEqual(batch_blocks, 0)
+        if buffer_blocks > 0 and threads > 1:
+          # All but the blocks after the last whole buffered batch
+          self.assertGreater(thread_blocks, batch_blocks - buffer_blocks)
+        if threads == 1:
+          self.assertEqual(thread_blocks, 0)
+
+if __name__ == '__main__':
+  unittest.main()
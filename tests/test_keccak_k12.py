@@ -0,0 +1,148 @@
+#!/usr/bin/python3
+
+# Copyright 2021 Djones A. Boni
+#
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+# http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+
+from unit_test_c_with_python.load_c import load
+
+import unittest
+import os
+import random
+from Crypto.Hash import KangarooTwelve, TurboSHAKE128, TurboSHAKE256
+
+K12_CHUNK_LEN = 8192
+
+# Dicrionaries to hold modules and ffis
+module, ffi = {}, {}
+
+# Backends to test
+BACKENDS = {
+  'default': [],
+  'portable': ['-DKECCAK_AVX2=0', '-DKECCAK_AVX512=0'],
+  'interleave': ['-DKECCAK_INTERLEAVE=1'],
+  'threads': ['-DK12_THREADS=4'],
+}
+
+# Compile one module for each backend
+for BACKEND in BACKENDS:
+
+  # Every module have its own name
+  module_name = 'keccak_k12_%s_' % BACKEND
+
+  source_files = [
+    '../source/keccak.c',
+    '../source/keccak_x4.c',
+    '../source/keccak_k12.c',
+  ]
+
+  include_paths = [
+    '../include',
+  ]
+
+  compiler_options = [
+    '-std=c90',
+    '-pedantic',
+    '-DKECCAK_WORD=8',
+  ] + BACKENDS[BACKEND]
+
+  module[BACKEND], ffi[BACKEND] = load(
+      source_files, include_paths, compiler_options,
+      module_name=module_name)
+
+def K12(BACKEND, data, custom, out_length, pieces=0):
+  # Hashes the data in random pieces
+  pk12 = ffi[BACKEND].new('struct k12_t[1]')
+  module[BACKEND].K12Init(pk12)
+  pos = 0
+  while pos < len(data):
+    n = random.randint(0, pieces) if pieces else len(data)
+    n = min(n, len(data) - pos)
+    module[BACKEND].K12Update(pk12, data[pos:pos + n], n)
+    pos += n
+  module[BACKEND].K12Finish(pk12, custom, len(custom))
+  pout = ffi[BACKEND].new('uint8_t[%d]' % max(out_length, 1))
+  module[BACKEND].K12Squeeze(pk12, pout, out_length)
+  return bytes(ffi[BACKEND].buffer(pout, out_length))
+
+class TestKangarooTwelve(unittest.TestCase):
+
+  def testEmpty(self):
+    # RFC 9861, KT128(M=empty, C=empty, 32)
+    expected = bytes.fromhex(
+        '1ac2d450fc3b4205d19da7bfca1b3751'
+        '3c0803577ac7167f06fe2ce1f0ef39e5')
+    for BACKEND in BACKENDS:
+      self.assertEqual(K12(BACKEND, b'', b'', 32), expected)
+
+  def testLengths(self):
+    # Around the chunk boundaries and with more chunks than hashed together
+    lengths = (1, K12_CHUNK_LEN - 1, K12_CHUNK_LEN, K12_CHUNK_LEN + 1,
+               2 * K12_CHUNK_LEN, 5 * K12_CHUNK_LEN, 5 * K12_CHUNK_LEN + 1,
+               random.randint(6 * K12_CHUNK_LEN, 300 * K12_CHUNK_LEN))
+    for BACKEND in BACKENDS:
+      for length in lengths:
+        data = os.urandom(length)
+        custom = os.urandom(random.choice((0, 1, 300)))
+        reference = KangarooTwelve.new(data=data, custom=custom).read(64)
+        self.assertEqual(K12(BACKEND, data, custom, 64), reference)
+
+  def testPieces(self):
+    for BACKEND in BACKENDS:
+      data = os.urandom(random.randint(0, 12 * K12_CHUNK_LEN))
+      custom = os.urandom(random.randint(0, 100))
+      out_length = random.randint(0, 1000)
+      reference = KangarooTwelve.new(data=data, custom=custom).read(out_length)
+      self.assertEqual(K12(BACKEND, data, custom, out_length, 20000),
+                       reference)
+
+class TestTurboSHAKE(unittest.TestCase):
+
+  def testTurboSHAKE(self):
+    for BACKEND in BACKENDS:
+      for bits, turboshake in ((128, TurboSHAKE128), (256, TurboSHAKE256)):
+        name = 'TurboSHAKE%d' % bits
+        data = os.urandom(random.randint(0, 1000))
+        domain = random.randint(0x01, 0x7F)
+        out_length = random.randint(0, 1000)
+
+        pstate = ffi[BACKEND].new('struct turboshake_%d_t[1]' % bits)
+        pout = ffi[BACKEND].new('uint8_t[%d]' % max(out_length, 1))
+        getattr(module[BACKEND], name + 'Init')(pstate)
+        getattr(module[BACKEND], name + 'Absorb')(pstate, data, len(data))
+        self.assertEqual(
+            getattr(module[BACKEND], name + 'Finish')(pstate, domain), 1)
+        getattr(module[BACKEND], name + 'Squeeze')(pstate, pout, out_length)
+
+        reference = turboshake.new(data=data, domain=domain).read(out_length)
+        self.assertEqual(bytes(ffi[BACKEND].buffer(pout, out_length)),
+                         reference)
+
+  def testInvalidDomain(self):
+    # The domain byte must be 0x01 to 0x7F, the other values overlap the
+    # padding bits
+    for BACKEND in BACKENDS:
+      for bits in (128, 256):
+        name = 'TurboSHAKE%d' % bits
+        pstate = ffi[BACKEND].new('struct turboshake_%d_t[1]' % bits)
+        for domain in (0x00, 0x80, 0xFF):
+          getattr(module[BACKEND], name + 'Init')(pstate)
+          self.assertEqual(
+              getattr(module[BACKEND], name + 'Finish')(pstate, domain), 0)
+        for domain in (0x01, 0x1F, 0x7F):
+          getattr(module[BACKEND], name + 'Init')(pstate)
+          self.assertEqual(
+              getattr(module[BACKEND], name + 'Finish')(pstate, domain), 1)
+
+if __name__ == '__main__':
+  unittest.main()
@@ -0,0 +1,197 @@
+#!/usr/bin/python3
+
+# Copyright 2021 Djones A. Boni
+#
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+# http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+
+from unit_test_c_with_python.load_c import load
+
+import unittest
+import os
+import random
+import hashlib
+
+KECCAK_X4 = 4
+KECCAK_STATE_SIZE = 200
+KECCAK_NR = 24
+KECCAK_PAD_SHA3 = 0x06
+KECCAK_PAD_SHAKE = 0x1F
+
+# Dicrionaries to hold modules and ffis
+module, ffi = {}, {}
+
+# Backends to test. The default one uses AVX2 and AVX-512 if the CPU supports
+# them.
+BACKENDS = {
+  'default': [],
+  'portable': ['-DKECCAK_AVX2=0', '-DKECCAK_AVX512=0'],
+  'interleave': ['-DKECCAK_INTERLEAVE=1'],
+}
+
+# Compile one module for each backend
+for BACKEND in BACKENDS:
+
+  # Every module have its own name
+  module_name = 'keccak_x4_%s_' % BACKEND
+
+  source_files = [
+    '../source/keccak.c',
+    '../source/keccak_x4.c',
+  ]
+
+  include_paths = [
+    '../include',
+  ]
+
+  compiler_options = [
+    '-std=c90',
+    '-pedantic',
+    '-DKECCAK_WORD=8',
+  ] + BACKENDS[BACKEND]
+
+  module[BACKEND], ffi[BACKEND] = load(
+      source_files, include_paths, compiler_options,
+      module_name=module_name)
+
+class States:
+  # Four states and the C arrays of pointers to them
+
+  def __init__(self, BACKEND):
+    self.pstates = ffi[BACKEND].new('struct keccak_t[%d]' % KECCAK_X4)
+    self.pptrs = ffi[BACKEND].new('struct keccak_t *[%d]' % KECCAK_X4)
+    for i in range(KECCAK_X4):
+      self.pptrs[i] = self.pstates + i
+      module[BACKEND].KeccakInit(self.pptrs[i])
+
+  def absorb(self, BACKEND, rate, data, pieces):
+    # Absorbs the four messages (same length) in the same random pieces
+    pos = 0
+    while pos < len(data[0]):
+      n = random.randint(0, pieces) if pieces else len(data[0])
+      n = min(n, len(data[0]) - pos)
+      pbuffs = [ffi[BACKEND].new('uint8_t[%d]' % max(n, 1), d[pos:pos + n])
+                for d in data]
+      pptrs = ffi[BACKEND].new('void *[%d]' % KECCAK_X4, pbuffs)
+      module[BACKEND].KeccakAbsorb_x4(self.pptrs, rate, KECCAK_NR, pptrs, n)
+      pos += n
+
+  def squeeze(self, BACKEND, rate, length, pieces):
+    out = [b''] * KECCAK_X4
+    while len(out[0]) < length:
+      n = random.randint(0, pieces) if pieces else length
+      n = min(n, length - len(out[0]))
+      pbuffs = [ffi[BACKEND].new('uint8_t[%d]' % max(n, 1))
+                for i in range(KECCAK_X4)]
+      pptrs = ffi[BACKEND].new('void *[%d]' % KECCAK_X4, pbuffs)
+      module[BACKEND].KeccakSqueeze_x4(self.pptrs, rate, KECCAK_NR, pptrs, n)
+      out = [out[i] + bytes(ffi[BACKEND].buffer(pbuffs[i], n))
+             for i in range(KECCAK_X4)]
+    return out
+
+class TestKeccakF_x4(unittest.TestCase):
+
+  def testPermute(self):
+    # Random states, compared with KeccakF() of each state, with all the
+    # number of rounds (odd numbers of rounds are used by the PRNG)
+    for BACKEND in BACKENDS:
+      for rounds in range(1, KECCAK_NR + 1):
+        states = States(BACKEND)
+        pref = ffi[BACKEND].new('struct keccak_t[1]')
+        data = [os.urandom(KECCAK_STATE_SIZE) for i in range(KECCAK_X4)]
+        for i in range(KECCAK_X4):
+          ffi[BACKEND].memmove(states.pstates[i].a, data[i], KECCAK_STATE_SIZE)
+
+        module[BACKEND].KeccakF_x4(states.pptrs, rounds)
+
+        for i in range(KECCAK_X4):
+          ffi[BACKEND].memmove(pref[0].a, data[i], KECCAK_STATE_SIZE)
+          module[BACKEND].KeccakF(pref, rounds)
+          self.assertEqual(
+              ffi[BACKEND].buffer(states.pstates[i].a, KECCAK_STATE_SIZE)[:],
+              ffi[BACKEND].buffer(pref[0].a, KECCAK_STATE_SIZE)[:])
+          self.assertEqual(states.pstates[i].num, 0)
+
+class TestSHA3_x4(unittest.TestCase):
+
+  def testSHA3(self):
+    for BACKEND in BACKENDS:
+      for bits in (224, 256, 384, 512):
+        rate = KECCAK_STATE_SIZE - bits // 4
+        length = random.choice((0, 1, rate - 1, rate, rate + 1,
+                                random.randint(0, 2048)))
+        data = [os.urandom(length) for i in range(KECCAK_X4)]
+
+        states = States(BACKEND)
+        states.absorb(BACKEND, rate, data, 0)
+        module[BACKEND].KeccakFinish_x4(states.pptrs, rate, KECCAK_NR,
+                                        KECCAK_PAD_SHA3)
+        digests = states.squeeze(BACKEND, rate, bits // 8, 0)
+
+        for i in range(KECCAK_X4):
+          reference = hashlib.new('sha3_%d' % bits, data[i]).digest()
+          self.assertEqual(digests[i], reference)
+
+  def testSHA3Pieces(self):
+    for BACKEND in BACKENDS:
+      rate = 136
+      length = random.randint(0, 2048)
+      data = [os.urandom(length) for i in range(KECCAK_X4)]
+
+      states = States(BACKEND)
+      states.absorb(BACKEND, rate, data, 300)
+      module[BACKEND].KeccakFinish_x4(states.pptrs, rate, KECCAK_NR,
+                                      KECCAK_PAD_SHA3)
+      digests = states.squeeze(BACKEND, rate, 32, 0)
+
+      for i in range(KECCAK_X4):
+        self.assertEqual(digests[i], hashlib.sha3_256(data[i]).digest())
+
+class TestSHAKE_x4(unittest.TestCase):
+
+  def testSHAKE(self):
+    # SHAKE-128 and SHAKE-256 with many output blocks
+    for BACKEND in BACKENDS:
+      for bits, shake in ((128, hashlib.shake_128), (256, hashlib.shake_256)):
+        rate = KECCAK_STATE_SIZE - bits // 4
+        length = random.randint(0, 1024)
+        out_length = random.randint(0, 2048)
+        data = [os.urandom(length) for i in range(KECCAK_X4)]
+
+        states = States(BACKEND)
+        states.absorb(BACKEND, rate, data, 0)
+        module[BACKEND].KeccakFinish_x4(states.pptrs, rate, KECCAK_NR,
+                                        KECCAK_PAD_SHAKE)
+        outputs = states.squeeze(BACKEND, rate, out_length, 0)
+
+        for i in range(KECCAK_X4):
+          self.assertEqual(outputs[i], shake(data[i]).digest(out_length))
+
+  def testSHAKEPieces(self):
+    for BACKEND in BACKENDS:
+      rate = 168
+      length = random.randint(0, 1024)
+      out_length = random.randint(0, 2048)
+      data = [os.urandom(length) for i in range(KECCAK_X4)]
+
+      states = States(BACKEND)
+      states.absorb(BACKEND, rate, data, 400)
+      module[BACKEND].KeccakFinish_x4(states.pptrs, rate, KECCAK_NR,
+                                      KECCAK_PAD_SHAKE)
+      outputs = states.squeeze(BACKEND, rate, out_length, 400)
+
+      for i in range(KECCAK_X4):
+        self.assertEqual(outputs[i],
+                         hashlib.shake_128(data[i]).digest(out_length))
+
+if __name__ == '__main__':
+  unittest.main()
@@ -289,6 +289,52 @@ class TestSHA3_256(unittest.TestCase):
 
     self.assertEqual(hash_module, hash_reference)
 
+  def testSHA3_256Pieces(self):
+    HASH_BITS = 256
+    length = random.randint(0, 2048)
+    data = os.urandom(length)
+    hash_length = HASH_BITS // 8
+
+    phash_ = ffi.new('struct sha3_256_t[1]')
+    hash_ = phash_[0]
+
+    # Pieces of random length, not aligned to the lanes
+    module.SHA3_256Init(phash_)
+    pos = 0
+    while pos < length:
+      num = random.randint(1, 300)
+      piece = data[pos:pos + num]
+      module.SHA3_256Update(phash_, piece, len(piece))
+      pos += num
+    module.SHA3_256Finish(phash_)
+
+    hash_module = ffi.buffer(hash_.hash.a, hash_length)
+    hash_module = hash_module[:]
+
+    hash_reference = hashlib.sha3_256(data).digest()
+
+    self.assertEqual(hash_module, hash_reference)
+
+  def testSHA3_256Large(self):
+    HASH_BITS = 256
+    length = 65536 + random.randint(1, 1024)
+    data = os.urandom(length)
+    hash_length = HASH_BITS // 8
+
+    phash_ = ffi.new('struct sha3_256_t[1]')
+    hash_ = phash_[0]
+
+    module.SHA3_256Init(phash_)
+    module.SHA3_256Update(phash_, data, length)
+    module.SHA3_256Finish(phash_)
+
+    hash_module = ffi.buffer(hash_.hash.a, hash_length)
+    hash_module = hash_module[:]
+
+    hash_reference = hashlib.sha3_256(data).digest()
+
+    self.assertEqual(hash_module, hash_reference)
+
 class TestSHA3_224(unittest.TestCase):
 
   def testSHA3_224Empty(self):
@@ -527,5 +573,33 @@ class TestSHAKE_128(unittest.TestCase):
 
     self.assertEqual(hash_module, hash_reference)
 
+  def testSHAKE_128Pieces(self):
+    length = random.randint(0, 2048)
+    data = os.urandom(length)
+    hash_length = random.randint(0, 1024)
+
+    phash_ = ffi.new('struct shake_128_t[1]')
+
+    # Absorb and squeeze pieces of random length
+    module.SHAKE128Init(phash_)
+    pos = 0
+    while pos < length:
+      num = random.randint(1, 300)
+      piece = data[pos:pos + num]
+      module.SHAKE128Absorb(phash_, piece, len(piece))
+      pos += num
+    module.SHAKE128Finish(phash_)
+
+    hash_module = b''
+    while len(hash_module) < hash_length:
+      num = min(random.randint(1, 300), hash_length - len(hash_module))
+      piece = ffi.new('uint8_t[]', num)
+      module.SHAKE128Squeeze(phash_, piece, num)
+      hash_module += bytes(piece)
+
+    hash_reference = hashlib.shake_128(data).digest(hash_length)
+
+    self.assertEqual(hash_module, hash_reference)
+
 if __name__ == '__main__':
   unittest.main()